@@ -0,0 +1,584 @@
+/*  @file nicpoyiash_bench.c
+ *  @author Nicolas Poyiadjis
+ *
+ *  @brief Microbenchmark harness of the nicpoyia-sh shell
+ *
+ *  It is linked with the objects of the shell (except the one containing its main function),
+ *  and measures, on synthetic inputs of growing size:
+ *  	- Scanning (lexer) and parsing of scripts, and parse cache hits
+ *  	- Word expansion and redirection planning of single commands
+ *  	- Built-in function lookup and dispatch
+ *  	- Process launch latency through executeProcess (posix_spawn and fork modes)
+ *  	- Throughput of N-stage pipelines (bytes per second)
+ *  The results are printed as a JSON document, to be compared between releases.
+ *
+ *  Usage: nicpoyia-bench [-t seconds] [benchmark name prefix ...]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "nicpoyiash_interpreter.h"
+#include "processes.h"
+#include "jobs.h"
+
+// Minimum time measured for every benchmark (seconds)
+#define BENCH_DEFAULT_MIN_TIME 0.2
+// Data piped through every pipeline benchmark run
+#define BENCH_PIPELINE_BYTES (16 * 1024 * 1024)
+#define BENCH_MAX_TEXT_LENGTH 256
+
+// The environment the harness was started with
+extern char **environ;
+
+/**
+ * @brief A benchmark input: the script text, and its syntax tree where needed.
+ */
+struct benchCase {
+	char *script;
+	size_t length;
+	struct arena arena;
+	struct listNode *list;
+	// The first command of the script
+	struct commandNode *command;
+	struct pipelineNode *pipeline;
+	// The words of the first command, expanded
+	char **words;
+	int wordsCount;
+	// Bytes processed by a single operation (0: Not reported)
+	double bytes;
+};
+
+/**
+ * @brief A benchmark function: carries out the operation measured a number of times.
+ *
+ * @param bench The benchmark input
+ * @param iterations The number of times
+ * @return 0: OK / -1: Error
+ */
+typedef int (*benchFunction)(struct benchCase *bench, long iterations);
+
+// Minimum time measured for every benchmark (seconds)
+double benchMinTime = BENCH_DEFAULT_MIN_TIME;
+// The benchmark name prefixes selected (none: every benchmark is run)
+char **benchSelected = NULL;
+int benchSelectedCount = 0;
+// The JSON document of the results
+struct outputBuffer benchOutput;
+int benchResultsCount = 0;
+// Sink of the values computed, so that the work measured is never optimized away
+volatile long benchSink = 0;
+
+/**
+ * @brief Function that returns the current monotonic time in seconds.
+ *
+ * @return The time
+ */
+double benchNow() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Function that checks whether a benchmark has been selected.
+ *
+ * @param name The benchmark name
+ * @return 1: true / 0: false
+ */
+int benchSelectedName(const char *name) {
+	if (benchSelectedCount == 0)
+		return 1;
+	int i;
+	for (i = 0; i < benchSelectedCount; i++)
+		if (strncmp(name, benchSelected[i], strlen(benchSelected[i])) == 0)
+			return 1;
+	return 0;
+}
+
+/**
+ * @brief Function that runs a benchmark, doubling the iterations until the minimum time is measured,
+ * and appends its result to the JSON document.
+ *
+ * @param name The benchmark name
+ * @param size The input size (its unit depends on the benchmark)
+ * @param function The benchmark function
+ * @param bench The benchmark input
+ * @return 0: OK / -1: Error
+ */
+int runBenchmark(const char *name, long size, benchFunction function,
+		struct benchCase *bench) {
+	if (!benchSelectedName(name))
+		return 0;
+	long iterations = 1;
+	double elapsed;
+	while (1) {
+		double start = benchNow();
+		if (function(bench, iterations) == -1) {
+			fprintf(stderr, "nicpoyia-bench: %s (size %ld) failed\n", name,
+					size);
+			return -1;
+		}
+		elapsed = benchNow() - start;
+		if (elapsed >= benchMinTime)
+			break;
+		// Aim at the minimum time, growing at least twice and at most 100 times
+		long next = (elapsed > 0) ?
+				(long) (iterations * benchMinTime * 1.2 / elapsed) : 0;
+		if (next < iterations * 2)
+			next = iterations * 2;
+		if (next > iterations * 100)
+			next = iterations * 100;
+		iterations = next;
+	}
+	outputString(&benchOutput, benchResultsCount > 0 ? ",\n" : "\n");
+	outputFormat(&benchOutput,
+			"    {\"name\":\"%s\",\"size\":%ld,\"iterations\":%ld,\"seconds\":%.6f,"
+					"\"ns_per_op\":%.1f,\"ops_per_sec\":%.1f", name, size,
+			iterations, elapsed, elapsed * 1e9 / iterations,
+			iterations / elapsed);
+	if (bench->bytes > 0)
+		outputFormat(&benchOutput, ",\"bytes_per_sec\":%.0f",
+				bench->bytes * iterations / elapsed);
+	outputCharacter(&benchOutput, '}');
+	benchResultsCount++;
+	fprintf(stderr, "%-22s size %-8ld %12.1f ns/op\n", name, size,
+			elapsed * 1e9 / iterations);
+	return 0;
+}
+
+/**
+ * @brief Function that prepares a benchmark input, parsing the script given.
+ *
+ * @param bench The benchmark input
+ * @param script The script (allocated, released by releaseBenchCase)
+ * @param parse Whether the script is parsed, and its first command expanded
+ * @return 0: OK / -1: Error
+ */
+int prepareBenchCase(struct benchCase *bench, char *script, int parse) {
+	memset(bench, 0, sizeof(*bench));
+	if (script == NULL)
+		return -1;
+	bench->script = script;
+	bench->length = strlen(script);
+	initializeArena(&bench->arena);
+	if (!parse)
+		return 0;
+	bench->list = parseScript(&bench->arena, script, bench->length);
+	if ((bench->list == NULL) || (bench->list->statementsCount == 0))
+		return -1;
+	bench->pipeline = &bench->list->statements[0].pipeline;
+	bench->command = &bench->pipeline->commands[0];
+	bench->wordsCount = expandCommand(&bench->arena, bench->command,
+			&bench->words);
+	return (bench->wordsCount > 0) ? 0 : -1;
+}
+
+/**
+ * @brief Function that releases a benchmark input.
+ *
+ * @param bench
+ */
+void releaseBenchCase(struct benchCase *bench) {
+	destroyArena(&bench->arena);
+	free(bench->script);
+}
+
+/**
+ * @brief Function that generates a script of pipelines with quoting, variables and redirections.
+ *
+ * @param statements The number of statements
+ * @return The script (allocated): OK / NULL: Error
+ */
+char *syntheticScript(long statements) {
+	char *script = (char*) malloc(statements * BENCH_MAX_TEXT_LENGTH + 1);
+	if (script == NULL) {
+		perror("malloc error");
+		return NULL;
+	}
+	size_t length = 0;
+	long i;
+	for (i = 0; i < statements; i++)
+		length += sprintf(script + length,
+				"command%ld -v --name=value%ld 'single quoted' \"home $HOME\" < input%ld"
+						" | filter%ld -x \"$USER\" > output%ld 2>&1 && status%ld;\n",
+				i, i, i, i, i, i);
+	script[length] = '\0';
+	return script;
+}
+
+/**
+ * @brief Function that generates a single command, with some words and redirections.
+ *
+ * @param name The command name
+ * @param words The number of argument words
+ * @param variables Whether the words contain variable references
+ * @param redirections The number of redirections
+ * @return The script (allocated): OK / NULL: Error
+ */
+char *syntheticCommand(const char *name, long words, int variables,
+		long redirections) {
+	char *script = (char*) malloc(
+			(words + redirections + 1) * BENCH_MAX_TEXT_LENGTH + 1);
+	if (script == NULL) {
+		perror("malloc error");
+		return NULL;
+	}
+	size_t length = sprintf(script, "%s", name);
+	long i;
+	for (i = 0; i < words; i++)
+		length += sprintf(script + length,
+				variables ? " \"word%ld $HOME\"" : " word%ld", i);
+	for (i = 0; i < redirections; i++)
+		length += sprintf(script + length, " %ld> /dev/null", i % 2 + 1);
+	script[length] = '\0';
+	return script;
+}
+
+/**
+ * @brief Benchmark: scanning a script into tokens.
+ */
+int benchLex(struct benchCase *bench, long iterations) {
+	long i;
+	for (i = 0; i < iterations; i++) {
+		struct lexer lexer;
+		struct token token;
+		long tokens = 0;
+		initializeLexer(&lexer, bench->script, bench->length);
+		while (nextToken(&lexer, &token) > TOKEN_END)
+			tokens++;
+		if (token.type == TOKEN_ERROR)
+			return -1;
+		benchSink += tokens;
+	}
+	return 0;
+}
+
+/**
+ * @brief Benchmark: parsing a script into its syntax tree.
+ */
+int benchParse(struct benchCase *bench, long iterations) {
+	long i;
+	for (i = 0; i < iterations; i++) {
+		struct arenaMark mark = arenaGetMark(&bench->arena);
+		struct listNode *list = parseScript(&bench->arena, bench->script,
+				bench->length);
+		arenaRelease(&bench->arena, mark);
+		if (list == NULL)
+			return -1;
+		benchSink += list->statementsCount;
+	}
+	return 0;
+}
+
+/**
+ * @brief Benchmark: finding a script parsed before in the parse cache.
+ */
+int benchParseCache(struct benchCase *bench, long iterations) {
+	long i;
+	for (i = 0; i < iterations; i++) {
+		struct parseCacheEntry *entry;
+		if (getParsedScript(bench->script, bench->length, &entry) != 1)
+			return -1;
+		benchSink += entry->list->statementsCount;
+		releaseParsedScript(entry);
+	}
+	return 0;
+}
+
+/**
+ * @brief Benchmark: expanding the words of a command.
+ */
+int benchExpand(struct benchCase *bench, long iterations) {
+	long i;
+	for (i = 0; i < iterations; i++) {
+		struct arenaMark mark = arenaGetMark(&scriptArena);
+		char **words;
+		int wordsCount = expandCommand(&scriptArena, bench->command, &words);
+		arenaRelease(&scriptArena, mark);
+		if (wordsCount <= 0)
+			return -1;
+		benchSink += wordsCount;
+	}
+	return 0;
+}
+
+/**
+ * @brief Benchmark: planning the redirections of a command.
+ */
+int benchPlanRedirections(struct benchCase *bench, long iterations) {
+	long i;
+	for (i = 0; i < iterations; i++) {
+		struct arenaMark mark = arenaGetMark(&scriptArena);
+		struct launchPlan plan;
+		int result = planRedirections(bench->command, 0, 1, NULL, &plan);
+		arenaRelease(&scriptArena, mark);
+		if (result == -1)
+			return -1;
+		benchSink += plan.actionsCount;
+	}
+	return 0;
+}
+
+/**
+ * @brief Benchmark: looking up a command name among the built-in functions.
+ */
+int benchBuiltinLookup(struct benchCase *bench, long iterations) {
+	long i;
+	for (i = 0; i < iterations; i++)
+		benchSink += isBashBuiltinFunction(bench->words[0]);
+	return 0;
+}
+
+/**
+ * @brief Benchmark: dispatching a built-in function (with its arguments).
+ */
+int benchBuiltinDispatch(struct benchCase *bench, long iterations) {
+	long i;
+	for (i = 0; i < iterations; i++)
+		if (executeBashBuiltinFunction(bench->words[0], bench->words + 1,
+				bench->wordsCount - 1) != 1)
+			return -1;
+	return 0;
+}
+
+/**
+ * @brief Benchmark: launching a process through executeProcess, and waiting for it.
+ */
+int benchLaunch(struct benchCase *bench, long iterations) {
+	const char *commandPath = resolveCommand(bench->words[0]);
+	if (commandPath == NULL)
+		return -1;
+	long i;
+	for (i = 0; i < iterations; i++) {
+		int jobIndex = jobStarted(bench->pipeline);
+		if (jobIndex == -1)
+			return -1;
+		int result = executeProcess(jobIndex, commandPath, bench->words,
+				bench->command, 0, 1, NULL);
+		if (result != -1)
+			waitForJob(jobIndex);
+		jobFinished(jobIndex);
+		if (result == -1)
+			return -1;
+	}
+	return 0;
+}
+
+/**
+ * @brief Benchmark: executing a whole script (parse cache, expansion, pipes, launch and wait).
+ */
+int benchScript(struct benchCase *bench, long iterations) {
+	long i;
+	for (i = 0; i < iterations; i++) {
+		// The script given is released by executeScript
+		char *script = strdup(bench->script);
+		if ((script == NULL) || (executeScript(script) == -1)
+				|| (lastExitStatus != 0))
+			return -1;
+	}
+	return 0;
+}
+
+/**
+ * @brief Function that runs the scanning, parsing and parse cache benchmarks.
+ *
+ * @return 0: OK / -1: Error
+ */
+int runParserBenchmarks() {
+	const long sizes[] = { 1, 16, 256, 4096 };
+	int result = 0;
+	int i;
+	for (i = 0; i < (int) (sizeof(sizes) / sizeof(sizes[0])); i++) {
+		struct benchCase bench;
+		if (prepareBenchCase(&bench, syntheticScript(sizes[i]), 0) == -1)
+			return -1;
+		bench.bytes = bench.length;
+		if ((runBenchmark("lex", sizes[i], benchLex, &bench) == -1)
+				|| (runBenchmark("parse", sizes[i], benchParse, &bench) == -1))
+			result = -1;
+		// Only short scripts are cached
+		if ((bench.length <= PARSE_CACHE_MAX_SCRIPT_SIZE)
+				&& (runBenchmark("parseCacheHit", sizes[i], benchParseCache,
+						&bench) == -1))
+			result = -1;
+		releaseBenchCase(&bench);
+	}
+	return result;
+}
+
+/**
+ * @brief Function that runs the expansion and redirection planning benchmarks.
+ *
+ * @return 0: OK / -1: Error
+ */
+int runCommandBenchmarks() {
+	const long words[] = { 1, 16, 256 };
+	const long redirections[] = { 1, 4, MAX_IO_ACTIONS };
+	int result = 0;
+	int i;
+	for (i = 0; i < (int) (sizeof(words) / sizeof(words[0])); i++) {
+		struct benchCase bench;
+		if (prepareBenchCase(&bench, syntheticCommand("cmd", words[i], 1, 0),
+				1) == -1)
+			return -1;
+		if (runBenchmark("expand", words[i], benchExpand, &bench) == -1)
+			result = -1;
+		releaseBenchCase(&bench);
+	}
+	for (i = 0; i < (int) (sizeof(redirections) / sizeof(redirections[0]));
+			i++) {
+		struct benchCase bench;
+		if (prepareBenchCase(&bench,
+				syntheticCommand("cmd", 0, 0, redirections[i]), 1) == -1)
+			return -1;
+		if (runBenchmark("planRedirections", redirections[i],
+				benchPlanRedirections, &bench) == -1)
+			result = -1;
+		releaseBenchCase(&bench);
+	}
+	return result;
+}
+
+/**
+ * @brief Function that runs the built-in function benchmarks:
+ * the lookup of names found at growing depth of the dispatch (size: name position, or -1 if not a built-in),
+ * and the dispatch of a built-in function with a growing number of arguments.
+ *
+ * @return 0: OK / -1: Error
+ */
+int runBuiltinBenchmarks() {
+	const char *lookedUp[] = { ".", "history", "times", "ls" };
+	const long arguments[] = { 0, 16, 256 };
+	int result = 0;
+	int i;
+	for (i = 0; i < (int) (sizeof(lookedUp) / sizeof(lookedUp[0])); i++) {
+		struct benchCase bench;
+		if (prepareBenchCase(&bench, syntheticCommand(lookedUp[i], 0, 0, 0),
+				1) == -1)
+			return -1;
+		long position = -1;
+		long j;
+		for (j = 0; bashBuiltinNames[j] != NULL; j++)
+			if (strcmp(bashBuiltinNames[j], lookedUp[i]) == 0)
+				position = j;
+		if (runBenchmark("builtinLookup", position, benchBuiltinLookup, &bench)
+				== -1)
+			result = -1;
+		releaseBenchCase(&bench);
+	}
+	for (i = 0; i < (int) (sizeof(arguments) / sizeof(arguments[0])); i++) {
+		struct benchCase bench;
+		if (prepareBenchCase(&bench, syntheticCommand(":", arguments[i], 0, 0),
+				1) == -1)
+			return -1;
+		if (runBenchmark("builtinDispatch", arguments[i], benchBuiltinDispatch,
+				&bench) == -1)
+			result = -1;
+		releaseBenchCase(&bench);
+	}
+	return result;
+}
+
+/**
+ * @brief Function that runs the process launch benchmarks (size: number of arguments),
+ * in both launch modes.
+ *
+ * @return 0: OK / -1: Error
+ */
+int runLaunchBenchmarks() {
+	const long arguments[] = { 0, 256 };
+	int savedMode = launchMode;
+	int result = 0;
+	int i;
+	for (i = 0; i < (int) (sizeof(arguments) / sizeof(arguments[0])); i++) {
+		struct benchCase bench;
+		if (prepareBenchCase(&bench,
+				syntheticCommand("true", arguments[i], 0, 0), 1) == -1)
+			return -1;
+		// The executable is launched, not the built-in function of the same name
+		launchMode = LAUNCH_SPAWN;
+		if (runBenchmark("launchSpawn", arguments[i], benchLaunch, &bench)
+				== -1)
+			result = -1;
+		launchMode = LAUNCH_FORK;
+		if (runBenchmark("launchFork", arguments[i], benchLaunch, &bench) == -1)
+			result = -1;
+		releaseBenchCase(&bench);
+	}
+	launchMode = savedMode;
+	return result;
+}
+
+/**
+ * @brief Function that runs the pipeline throughput benchmarks (size: number of stages).
+ *
+ * @return 0: OK / -1: Error
+ */
+int runPipelineBenchmarks() {
+	const long stages[] = { 1, 2, 4, 8 };
+	int result = 0;
+	int i;
+	for (i = 0; i < (int) (sizeof(stages) / sizeof(stages[0])); i++) {
+		char *script = (char*) malloc((stages[i] + 1) * BENCH_MAX_TEXT_LENGTH);
+		if (script == NULL) {
+			perror("malloc error");
+			return -1;
+		}
+		size_t length = sprintf(script, "head -c %d /dev/zero",
+				BENCH_PIPELINE_BYTES);
+		long j;
+		for (j = 1; j < stages[i]; j++)
+			length += sprintf(script + length, " | cat");
+		sprintf(script + length, " > /dev/null");
+		struct benchCase bench;
+		if (prepareBenchCase(&bench, script, 0) == -1)
+			return -1;
+		bench.bytes = BENCH_PIPELINE_BYTES;
+		if (runBenchmark("pipeline", stages[i], benchScript, &bench) == -1)
+			result = -1;
+		releaseBenchCase(&bench);
+	}
+	return result;
+}
+
+/**
+ * @brief The main function of the benchmark harness
+ *
+ * @param args Number of command line arguments
+ * @param argv Array of command line arguments: [-t seconds] [benchmark name prefix ...]
+ * @return 0: OK / 1: Some benchmark failed
+ */
+int main(int args, char *argv[]) {
+	int i = 1;
+	if ((args > 2) && (strcmp(argv[1], "-t") == 0)) {
+		benchMinTime = atof(argv[2]);
+		i = 3;
+	}
+	benchSelected = argv + i;
+	benchSelectedCount = args - i;
+	// The shell is initialized as by its own main function
+	if (initializeVariables(environ) == -1)
+		return 1;
+	processesInitialization();
+	initializeOutputBuffer(&benchOutput, STDOUT_FILENO);
+	time_t now = time(NULL);
+	char date[64];
+	strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+	outputFormat(&benchOutput,
+			"{\n  \"suite\":\"nicpoyia-sh\",\n  \"date\":\"%s\",\n"
+					"  \"min_time\":%.3f,\n  \"results\":[", date,
+			benchMinTime);
+	// A failed group is reported, and the rest of the groups are still run
+	int (*groups[])() = { runParserBenchmarks, runCommandBenchmarks,
+			runBuiltinBenchmarks, runLaunchBenchmarks, runPipelineBenchmarks };
+	int result = 0;
+	for (i = 0; i < (int) (sizeof(groups) / sizeof(groups[0])); i++)
+		if (groups[i]() == -1)
+			result = 1;
+	outputString(&benchOutput, "\n  ]\n}\n");
+	outputFlush(&benchOutput);
+	return result;
+}
@@ -0,0 +1,234 @@
+/*  @file arena.c
+ *  @author Nicolas Poyiadjis
+ *
+ *  @brief Arena (bump) allocator implementation.
+ *  Memory is handed out sequentially from large chunks and is never released piece by piece.
+ *  Instead, everything allocated after a mark is released at once, by going back to the mark.
+ *  Released chunks are kept for reuse, so memory usage stays flat however many scripts are executed.
+ */
+
+#include "arena.h"
+
+// Arena of the scripts being executed
+struct arena scriptArena = { NULL, NULL, 0, 0, 0, ARENA_CHUNK_SIZE };
+
+/**
+ * @brief Function that initializes an empty arena.
+ *
+ * @param arena
+ */
+void initializeArena(struct arena *arena) {
+	initializeArenaWithChunkSize(arena, ARENA_CHUNK_SIZE);
+}
+
+/**
+ * @brief Function that initializes an empty arena, with chunks of a given size.
+ * Used by arenas holding little data each (e.g. a single parsed command line).
+ *
+ * @param arena
+ * @param chunkSize Size of every new chunk
+ */
+void initializeArenaWithChunkSize(struct arena *arena, size_t chunkSize) {
+	arena->first = NULL;
+	arena->current = NULL;
+	arena->allocated = 0;
+	arena->highWaterMark = 0;
+	arena->reserved = 0;
+	arena->chunkSize = chunkSize;
+}
+
+/**
+ * @brief Function that creates a new chunk, able to hold at least the given size.
+ *
+ * @return The chunk: OK / NULL: Error
+ */
+struct arenaChunk *createChunk(struct arena *arena, size_t size) {
+	size_t chunkSize = (size > arena->chunkSize) ? size : arena->chunkSize;
+	struct arenaChunk *chunk = (struct arenaChunk*) malloc(
+			sizeof(struct arenaChunk));
+	if (chunk == NULL) {
+		perror("malloc error");
+		return NULL;
+	}
+	chunk->data = (char*) malloc(chunkSize);
+	if (chunk->data == NULL) {
+		perror("malloc error");
+		free(chunk);
+		return NULL;
+	}
+	chunk->next = NULL;
+	chunk->size = chunkSize;
+	chunk->used = 0;
+	arena->reserved += chunkSize;
+	return chunk;
+}
+
+/**
+ * @brief Function that moves to a chunk able to hold the given size,
+ * reusing the next free chunk if it is big enough.
+ *
+ * @return 0: OK / -1: Error
+ */
+int nextChunk(struct arena *arena, size_t size) {
+	struct arenaChunk *next =
+			(arena->current == NULL) ? arena->first : arena->current->next;
+	if ((next == NULL) || (next->size < size)) {
+		struct arenaChunk *chunk = createChunk(arena, size);
+		if (chunk == NULL)
+			return -1;
+		// Insert the new chunk right after the current one
+		chunk->next = next;
+		if (arena->current == NULL)
+			arena->first = chunk;
+		else
+			arena->current->next = chunk;
+		next = chunk;
+	}
+	next->used = 0;
+	arena->current = next;
+	return 0;
+}
+
+/**
+ * @brief Function that allocates memory from an arena.
+ *
+ * @param arena
+ * @param size Number of bytes
+ * @return The memory allocated: OK / NULL: Error
+ */
+void *arenaAllocate(struct arena *arena, size_t size) {
+	size_t alignedSize = (size + ARENA_ALIGNMENT - 1)
+			& ~((size_t) ARENA_ALIGNMENT - 1);
+	if (alignedSize == 0)
+		alignedSize = ARENA_ALIGNMENT;
+	if ((arena->current == NULL)
+			|| (arena->current->used + alignedSize > arena->current->size))
+		if (nextChunk(arena, alignedSize) == -1)
+			return NULL;
+	void *memory = arena->current->data + arena->current->used;
+	arena->current->used += alignedSize;
+	arena->allocated += alignedSize;
+	if (arena->allocated > arena->highWaterMark)
+		arena->highWaterMark = arena->allocated;
+	return memory;
+}
+
+/**
+ * @brief Function that resizes an arena allocation, keeping its contents.
+ * The last allocation is resized in place, if possible.
+ *
+ * @param arena
+ * @param memory The memory allocated (NULL for a new allocation)
+ * @param oldSize The size allocated
+ * @param newSize The new size
+ * @return The memory allocated: OK / NULL: Error
+ */
+void *arenaResize(struct arena *arena, void *memory, size_t oldSize,
+		size_t newSize) {
+	if (memory == NULL)
+		return arenaAllocate(arena, newSize);
+	size_t oldAligned = (oldSize + ARENA_ALIGNMENT - 1)
+			& ~((size_t) ARENA_ALIGNMENT - 1);
+	size_t newAligned = (newSize + ARENA_ALIGNMENT - 1)
+			& ~((size_t) ARENA_ALIGNMENT - 1);
+	struct arenaChunk *chunk = arena->current;
+	// Grow in place, if it is the last allocation and the chunk has space left
+	if ((chunk != NULL)
+			&& ((char*) memory + oldAligned == chunk->data + chunk->used)
+			&& ((size_t) ((char*) memory - chunk->data) + newAligned
+					<= chunk->size)) {
+		chunk->used = ((char*) memory - chunk->data) + newAligned;
+		arena->allocated = arena->allocated - oldAligned + newAligned;
+		if (arena->allocated > arena->highWaterMark)
+			arena->highWaterMark = arena->allocated;
+		return memory;
+	}
+	void *newMemory = arenaAllocate(arena, newSize);
+	if (newMemory == NULL)
+		return NULL;
+	memcpy(newMemory, memory, (oldSize < newSize) ? oldSize : newSize);
+	return newMemory;
+}
+
+/**
+ * @brief Function that copies a string into an arena.
+ *
+ * @param arena
+ * @param string
+ * @return The copy: OK / NULL: Error
+ */
+char *arenaCopyString(struct arena *arena, const char *string) {
+	return arenaCopyText(arena, string, strlen(string));
+}
+
+/**
+ * @brief Function that copies a character sequence into an arena, as a NUL-terminated string.
+ *
+ * @param arena
+ * @param text
+ * @param length
+ * @return The copy: OK / NULL: Error
+ */
+char *arenaCopyText(struct arena *arena, const char *text, size_t length) {
+	char *copy = (char*) arenaAllocate(arena, length + 1);
+	if (copy == NULL)
+		return NULL;
+	memcpy(copy, text, length);
+	copy[length] = '\0';
+	return copy;
+}
+
+/**
+ * @brief Function that marks the current position of an arena.
+ *
+ * @param arena
+ * @return The mark
+ */
+struct arenaMark arenaGetMark(struct arena *arena) {
+	struct arenaMark mark;
+	mark.chunk = arena->current;
+	mark.used = (arena->current == NULL) ? 0 : arena->current->used;
+	mark.allocated = arena->allocated;
+	return mark;
+}
+
+/**
+ * @brief Function that releases everything allocated after a mark, at once.
+ *
+ * @param arena
+ * @param mark
+ */
+void arenaRelease(struct arena *arena, struct arenaMark mark) {
+	// The chunks after the marked one become free for reuse
+	arena->current = mark.chunk;
+	if (arena->current != NULL)
+		arena->current->used = mark.used;
+	arena->allocated = mark.allocated;
+}
+
+/**
+ * @brief Function that releases every chunk of an arena back to the system.
+ *
+ * @param arena
+ */
+void destroyArena(struct arena *arena) {
+	struct arenaChunk *chunk = arena->first;
+	while (chunk != NULL) {
+		struct arenaChunk *next = chunk->next;
+		free(chunk->data);
+		free(chunk);
+		chunk = next;
+	}
+	initializeArenaWithChunkSize(arena, arena->chunkSize);
+}
+
+/**
+ * @brief Function that prints the memory usage of an arena.
+ *
+ * @param name The arena name to display
+ * @param arena
+ */
+void printArenaStatistics(const char *name, struct arena *arena) {
+	printf("%s: %zu bytes in use, %zu bytes high-water mark, %zu bytes reserved\n",
+			name, arena->allocated, arena->highWaterMark, arena->reserved);
+}
@@ -0,0 +1,148 @@
+/*  @file arena.h
+ *  @author Nicolas Poyiadjis
+ *
+ *  @brief Arena (bump) allocator header.
+ *  Memory is handed out sequentially from large chunks and is never released piece by piece.
+ *  Instead, everything allocated after a mark is released at once, by going back to the mark.
+ *  Released chunks are kept for reuse, so memory usage stays flat however many scripts are executed.
+ */
+
+#ifndef ARENA_H_
+#define ARENA_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ARENA_CHUNK_SIZE 65536
+#define ARENA_ALIGNMENT 16
+
+/**
+ * @brief A chunk of arena memory.
+ */
+struct arenaChunk {
+	struct arenaChunk *next;
+	size_t size;
+	size_t used;
+	char *data;
+};
+
+/**
+ * @brief An arena: a list of chunks, the ones after the current chunk being free for reuse.
+ */
+struct arena {
+	struct arenaChunk *first;
+	struct arenaChunk *current;
+	// Bytes currently allocated
+	size_t allocated;
+	// Maximum bytes ever allocated at once
+	size_t highWaterMark;
+	// Bytes of all chunks held
+	size_t reserved;
+	// Size of every new chunk (unless an allocation needs more)
+	size_t chunkSize;
+};
+
+/**
+ * @brief A position within an arena, to go back to.
+ */
+struct arenaMark {
+	struct arenaChunk *chunk;
+	size_t used;
+	size_t allocated;
+};
+
+// Arena of the scripts being executed:
+// every parsing and execution temporary is allocated from it,
+// and released as soon as the script execution finishes.
+extern struct arena scriptArena;
+
+/**
+ * @brief Function that initializes an empty arena.
+ *
+ * @param arena
+ */
+void initializeArena(struct arena *arena);
+
+/**
+ * @brief Function that initializes an empty arena, with chunks of a given size.
+ * Used by arenas holding little data each (e.g. a single parsed command line).
+ *
+ * @param arena
+ * @param chunkSize Size of every new chunk
+ */
+void initializeArenaWithChunkSize(struct arena *arena, size_t chunkSize);
+
+/**
+ * @brief Function that allocates memory from an arena.
+ *
+ * @param arena
+ * @param size Number of bytes
+ * @return The memory allocated: OK / NULL: Error
+ */
+void *arenaAllocate(struct arena *arena, size_t size);
+
+/**
+ * @brief Function that resizes an arena allocation, keeping its contents.
+ * The last allocation is resized in place, if possible.
+ *
+ * @param arena
+ * @param memory The memory allocated (NULL for a new allocation)
+ * @param oldSize The size allocated
+ * @param newSize The new size
+ * @return The memory allocated: OK / NULL: Error
+ */
+void *arenaResize(struct arena *arena, void *memory, size_t oldSize,
+		size_t newSize);
+
+/**
+ * @brief Function that copies a string into an arena.
+ *
+ * @param arena
+ * @param string
+ * @return The copy: OK / NULL: Error
+ */
+char *arenaCopyString(struct arena *arena, const char *string);
+
+/**
+ * @brief Function that copies a character sequence into an arena, as a NUL-terminated string.
+ *
+ * @param arena
+ * @param text
+ * @param length
+ * @return The copy: OK / NULL: Error
+ */
+char *arenaCopyText(struct arena *arena, const char *text, size_t length);
+
+/**
+ * @brief Function that marks the current position of an arena.
+ *
+ * @param arena
+ * @return The mark
+ */
+struct arenaMark arenaGetMark(struct arena *arena);
+
+/**
+ * @brief Function that releases everything allocated after a mark, at once.
+ *
+ * @param arena
+ * @param mark
+ */
+void arenaRelease(struct arena *arena, struct arenaMark mark);
+
+/**
+ * @brief Function that releases every chunk of an arena back to the system.
+ *
+ * @param arena
+ */
+void destroyArena(struct arena *arena);
+
+/**
+ * @brief Function that prints the memory usage of an arena.
+ *
+ * @param name The arena name to display
+ * @param arena
+ */
+void printArenaStatistics(const char *name, struct arena *arena);
+
+#endif /* ARENA_H_ */
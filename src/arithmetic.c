@@ -0,0 +1,930 @@
+/*  @file arithmetic.c
+ *  @author Nicolas Poyiadjis
+ *
+ *  @brief Arithmetic expression engine implementation.
+ *  The expression is split into tokens, then compiled by precedence climbing, in order of precedence:
+ *  	- , (sequence)
+ *  	- = *= /= %= += -= <<= >>= &= ^= |= (right-associative)
+ *  	- ?: (conditional)
+ *  	- || && | ^ & (== !=) (< <= > >=) (<< >>) (+ -) (* / %) ** (right-associative)
+ *  	- ! ~ - + ++id --id (unary)
+ *  	- id++ id-- (postfix)
+ *  	- ( expr ), numbers (decimal, 0x hex, 0 octal, base#n), variables
+ *  Integers are 64-bit, and overflowing operations wrap around.
+ */
+
+#include "arithmetic.h"
+#include "parse_cache.h"
+#include "bash_builtin_functions.h"
+#include "variables.h"
+
+// Token types (single-character operators are their own character)
+#define ARITHMETIC_TOKEN_END 0
+#define ARITHMETIC_TOKEN_NUMBER 256
+#define ARITHMETIC_TOKEN_NAME 257
+#define ARITHMETIC_TOKEN_POWER 258			// **
+#define ARITHMETIC_TOKEN_SHIFT_LEFT 259		// <<
+#define ARITHMETIC_TOKEN_SHIFT_RIGHT 260	// >>
+#define ARITHMETIC_TOKEN_LESS_EQUAL 261		// <=
+#define ARITHMETIC_TOKEN_GREATER_EQUAL 262	// >=
+#define ARITHMETIC_TOKEN_EQUAL 263			// ==
+#define ARITHMETIC_TOKEN_NOT_EQUAL 264		// !=
+#define ARITHMETIC_TOKEN_AND 265			// &&
+#define ARITHMETIC_TOKEN_OR 266				// ||
+#define ARITHMETIC_TOKEN_INCREMENT 267		// ++
+#define ARITHMETIC_TOKEN_DECREMENT 268		// --
+// Assignments: the operator applied is the assignment token minus this offset (e.g. += is '+')
+#define ARITHMETIC_TOKEN_ASSIGN 1024		// =
+#define ARITHMETIC_ASSIGN_OFFSET 2048		// op=
+
+/**
+ * @brief A token of an expression.
+ */
+struct arithmeticToken {
+	int type;
+	long long value;
+	const char *text;
+	size_t length;
+};
+
+/**
+ * @brief The compiler state over the tokens of an expression.
+ */
+struct arithmeticCompiler {
+	const char *expressionText;
+	struct arithmeticToken *tokens;
+	int tokensCount;
+	int position;
+	struct arithmeticExpression *expression;
+	int error;
+};
+
+// The arithmetic cache of the shell
+struct arithmeticCache arithmeticCache;
+// Depth of the expressions being evaluated (variables containing expressions)
+int arithmeticDepth = 0;
+
+// Multi-character operators, longest first
+const char *const arithmeticOperators[] = { "<<=", ">>=", "**", "<<", ">>",
+		"<=", ">=", "==", "!=", "&&", "||", "++", "--", "+=", "-=", "*=", "/=",
+		"%=", "&=", "^=", "|=", NULL };
+const int arithmeticOperatorTokens[] = { ARITHMETIC_ASSIGN_OFFSET
+		+ ARITHMETIC_TOKEN_SHIFT_LEFT, ARITHMETIC_ASSIGN_OFFSET
+		+ ARITHMETIC_TOKEN_SHIFT_RIGHT, ARITHMETIC_TOKEN_POWER,
+		ARITHMETIC_TOKEN_SHIFT_LEFT, ARITHMETIC_TOKEN_SHIFT_RIGHT,
+		ARITHMETIC_TOKEN_LESS_EQUAL, ARITHMETIC_TOKEN_GREATER_EQUAL,
+		ARITHMETIC_TOKEN_EQUAL, ARITHMETIC_TOKEN_NOT_EQUAL, ARITHMETIC_TOKEN_AND,
+		ARITHMETIC_TOKEN_OR, ARITHMETIC_TOKEN_INCREMENT,
+		ARITHMETIC_TOKEN_DECREMENT, ARITHMETIC_ASSIGN_OFFSET + '+',
+		ARITHMETIC_ASSIGN_OFFSET + '-', ARITHMETIC_ASSIGN_OFFSET + '*',
+		ARITHMETIC_ASSIGN_OFFSET + '/', ARITHMETIC_ASSIGN_OFFSET + '%',
+		ARITHMETIC_ASSIGN_OFFSET + '&', ARITHMETIC_ASSIGN_OFFSET + '^',
+		ARITHMETIC_ASSIGN_OFFSET + '|' };
+
+/**
+ * @brief Function that reports an invalid expression.
+ *
+ * @param text The expression text
+ * @param message The error message
+ * @param errorToken The rest of the expression, from the erroneous token / NULL: None
+ */
+void arithmeticError(const char *text, const char *message,
+		const char *errorToken) {
+	if (errorToken != NULL)
+		fprintf(stderr, "nicpoyia-sh: %s: %s (error token is \"%s\")\n", text,
+				message, errorToken);
+	else
+		fprintf(stderr, "nicpoyia-sh: %s: %s\n", text, message);
+}
+
+/**
+ * @brief Function that converts the digits of a number in a given base.
+ * Digits greater than 9 are a-z, A-Z, @ and _ (or a-z and A-Z alike, in bases up to 36).
+ *
+ * @param digits The digits
+ * @param length Number of digits
+ * @param base The base (2 - 64)
+ * @param value Filled in with the value
+ * @return 0: OK / -1: Invalid digit
+ */
+int convertDigits(const char *digits, size_t length, int base,
+		long long *value) {
+	unsigned long long result = 0;
+	size_t i;
+	if (length == 0)
+		return -1;
+	for (i = 0; i < length; i++) {
+		char character = digits[i];
+		int digit;
+		if (isdigit((unsigned char) character))
+			digit = character - '0';
+		else if (islower((unsigned char) character))
+			digit = character - 'a' + 10;
+		else if (isupper((unsigned char) character))
+			digit = character - 'A' + ((base <= 36) ? 10 : 36);
+		else if (character == '@')
+			digit = 62;
+		else if (character == '_')
+			digit = 63;
+		else
+			return -1;
+		if (digit >= base)
+			return -1;
+		result = result * base + digit;
+	}
+	(*value) = (long long) result;
+	return 0;
+}
+
+/**
+ * @brief Function that converts a number constant (decimal, 0x hex, 0 octal, base#n).
+ *
+ * @param text The number text
+ * @param length The number length
+ * @param value Filled in with the value
+ * @return 0: OK / -1: Invalid number
+ */
+int convertNumber(const char *text, size_t length, long long *value) {
+	const char *hash = memchr(text, '#', length);
+	if (hash != NULL) {
+		long long base;
+		if ((convertDigits(text, hash - text, 10, &base) == -1) || (base < 2)
+				|| (base > 64))
+			return -1;
+		return convertDigits(hash + 1, length - (hash - text) - 1, (int) base,
+				value);
+	}
+	if ((length > 2) && (text[0] == '0') && ((text[1] == 'x') || (text[1] == 'X')))
+		return convertDigits(text + 2, length - 2, 16, value);
+	if ((length > 1) && (text[0] == '0'))
+		return convertDigits(text + 1, length - 1, 8, value);
+	return convertDigits(text, length, 10, value);
+}
+
+/**
+ * @brief Function that splits an expression into its tokens.
+ *
+ * @param text The expression text
+ * @param tokens Filled in with the tokens array (allocated, ending with an end token)
+ * @return Number of tokens: OK / -1: Error
+ */
+int tokenizeArithmetic(const char *text, struct arithmeticToken **tokens) {
+	int count = 0;
+	int capacity = 16;
+	(*tokens) = (struct arithmeticToken*) malloc(
+			capacity * sizeof(struct arithmeticToken));
+	if ((*tokens) == NULL) {
+		perror("malloc error");
+		return -1;
+	}
+	const char *position = text;
+	while (1) {
+		while (isspace((unsigned char) *position))
+			position++;
+		if (count == capacity) {
+			struct arithmeticToken *grownTokens = (struct arithmeticToken*) realloc(
+					*tokens, capacity * 2 * sizeof(struct arithmeticToken));
+			if (grownTokens == NULL) {
+				perror("malloc error");
+				free(*tokens);
+				return -1;
+			}
+			(*tokens) = grownTokens;
+			capacity *= 2;
+		}
+		struct arithmeticToken *token = &(*tokens)[count++];
+		token->text = position;
+		token->length = 1;
+		if (*position == '\0') {
+			token->type = ARITHMETIC_TOKEN_END;
+			token->length = 0;
+			return count;
+		}
+		if (isalnum((unsigned char) *position) || (*position == '_')) {
+			// Numbers may contain letters (hex / base#n digits)
+			int number = isdigit((unsigned char) *position);
+			while (isalnum((unsigned char) *position) || (*position == '_')
+					|| (number && ((*position == '#') || (*position == '@'))))
+				position++;
+			token->length = position - token->text;
+			if (!number) {
+				token->type = ARITHMETIC_TOKEN_NAME;
+				continue;
+			}
+			token->type = ARITHMETIC_TOKEN_NUMBER;
+			if (convertNumber(token->text, token->length, &token->value) == -1) {
+				arithmeticError(text, "value too great for base", token->text);
+				free(*tokens);
+				return -1;
+			}
+			continue;
+		}
+		int i;
+		for (i = 0; arithmeticOperators[i] != NULL; i++) {
+			size_t operatorLength = strlen(arithmeticOperators[i]);
+			if (strncmp(position, arithmeticOperators[i], operatorLength) == 0) {
+				token->type = arithmeticOperatorTokens[i];
+				token->length = operatorLength;
+				break;
+			}
+		}
+		if (arithmeticOperators[i] == NULL) {
+			if (strchr("+-*/%<>&|^!~?:,()=", *position) == NULL) {
+				arithmeticError(text, "syntax error: invalid arithmetic operator",
+						position);
+				free(*tokens);
+				return -1;
+			}
+			token->type =
+					(*position == '=') ? ARITHMETIC_TOKEN_ASSIGN : *position;
+		}
+		position += token->length;
+	}
+}
+
+/**
+ * @brief Function that adds a node to the expression being compiled.
+ *
+ * @param compiler
+ * @param type The node type
+ * @return Index of the node: OK / -1: Error
+ */
+int addArithmeticNode(struct arithmeticCompiler *compiler, int type) {
+	struct arithmeticExpression *expression = compiler->expression;
+	if (expression->nodesCount == expression->nodesCapacity) {
+		int newCapacity =
+				(expression->nodesCapacity == 0) ?
+						8 : (expression->nodesCapacity * 2);
+		struct arithmeticNode *newNodes = (struct arithmeticNode*) realloc(
+				expression->nodes, newCapacity * sizeof(struct arithmeticNode));
+		if (newNodes == NULL) {
+			perror("malloc error");
+			compiler->error = 1;
+			return -1;
+		}
+		expression->nodes = newNodes;
+		expression->nodesCapacity = newCapacity;
+	}
+	struct arithmeticNode *node = &expression->nodes[expression->nodesCount];
+	memset(node, 0, sizeof(struct arithmeticNode));
+	node->type = type;
+	node->left = node->right = node->third = -1;
+	return expression->nodesCount++;
+}
+
+/**
+ * @brief Function that reports a syntax error at the current token.
+ *
+ * @param compiler
+ * @return -1
+ */
+int arithmeticSyntaxError(struct arithmeticCompiler *compiler) {
+	if (!compiler->error) {
+		struct arithmeticToken *token = &compiler->tokens[compiler->position];
+		if (token->type == ARITHMETIC_TOKEN_END)
+			arithmeticError(compiler->expressionText,
+					"syntax error: operand expected", "");
+		else
+			arithmeticError(compiler->expressionText,
+					"syntax error in expression", token->text);
+	}
+	compiler->error = 1;
+	return -1;
+}
+
+/**
+ * @brief Function that returns the type of the current token.
+ */
+int currentArithmeticToken(struct arithmeticCompiler *compiler) {
+	return compiler->tokens[compiler->position].type;
+}
+
+/**
+ * @brief Function that copies the variable name of the current token.
+ *
+ * @return The name: OK / NULL: Error
+ */
+char *copyArithmeticName(struct arithmeticCompiler *compiler) {
+	struct arithmeticToken *token = &compiler->tokens[compiler->position];
+	char *name = (char*) malloc(token->length + 1);
+	if (name == NULL) {
+		perror("malloc error");
+		compiler->error = 1;
+		return NULL;
+	}
+	memcpy(name, token->text, token->length);
+	name[token->length] = '\0';
+	return name;
+}
+
+int compileSequence(struct arithmeticCompiler *compiler);
+int compileAssignment(struct arithmeticCompiler *compiler);
+int compileUnary(struct arithmeticCompiler *compiler);
+int evaluateExpression(const char *text, struct arithmeticExpression *expression,
+		int index, long long *result);
+
+/**
+ * @brief Function that adds a variable node (assignment / increment) for the current name token.
+ *
+ * @param compiler
+ * @param type The node type
+ * @return Index of the node: OK / -1: Error
+ */
+int addNamedNode(struct arithmeticCompiler *compiler, int type) {
+	int index = addArithmeticNode(compiler, type);
+	if (index == -1)
+		return -1;
+	char *name = copyArithmeticName(compiler);
+	if (name == NULL)
+		return -1;
+	compiler->expression->nodes[index].name = name;
+	compiler->position++;
+	return index;
+}
+
+/**
+ * @brief Function that compiles a primary expression: ( expr ), a number or a variable,
+ * possibly followed by ++ / --.
+ *
+ * @return Index of the node: OK / -1: Error
+ */
+int compilePrimary(struct arithmeticCompiler *compiler) {
+	struct arithmeticToken *token = &compiler->tokens[compiler->position];
+	int index;
+	switch (token->type) {
+	case '(':
+		compiler->position++;
+		index = compileSequence(compiler);
+		if (index == -1)
+			return -1;
+		if (currentArithmeticToken(compiler) != ')')
+			return arithmeticSyntaxError(compiler);
+		compiler->position++;
+		return index;
+	case ARITHMETIC_TOKEN_NUMBER:
+		index = addArithmeticNode(compiler, ARITHMETIC_NUMBER);
+		if (index == -1)
+			return -1;
+		compiler->expression->nodes[index].value = token->value;
+		compiler->position++;
+		return index;
+	case ARITHMETIC_TOKEN_NAME: {
+		int next = compiler->tokens[compiler->position + 1].type;
+		if ((next == ARITHMETIC_TOKEN_INCREMENT)
+				|| (next == ARITHMETIC_TOKEN_DECREMENT)) {
+			index = addNamedNode(compiler, ARITHMETIC_INCREMENT);
+			if (index == -1)
+				return -1;
+			compiler->expression->nodes[index].operator = next;
+			compiler->position++;
+			return index;
+		}
+		return addNamedNode(compiler, ARITHMETIC_VARIABLE);
+	}
+	}
+	return arithmeticSyntaxError(compiler);
+}
+
+/**
+ * @brief Function that compiles a unary expression (! ~ - + ++id --id).
+ *
+ * @return Index of the node: OK / -1: Error
+ */
+int compileUnary(struct arithmeticCompiler *compiler) {
+	int type = currentArithmeticToken(compiler);
+	int index;
+	switch (type) {
+	case '!':
+	case '~':
+	case '-':
+	case '+': {
+		compiler->position++;
+		int operand = compileUnary(compiler);
+		if (operand == -1)
+			return -1;
+		index = addArithmeticNode(compiler, ARITHMETIC_UNARY);
+		if (index == -1)
+			return -1;
+		compiler->expression->nodes[index].operator = type;
+		compiler->expression->nodes[index].left = operand;
+		return index;
+	}
+	case ARITHMETIC_TOKEN_INCREMENT:
+	case ARITHMETIC_TOKEN_DECREMENT:
+		compiler->position++;
+		if (currentArithmeticToken(compiler) != ARITHMETIC_TOKEN_NAME)
+			return arithmeticSyntaxError(compiler);
+		index = addNamedNode(compiler, ARITHMETIC_INCREMENT);
+		if (index == -1)
+			return -1;
+		compiler->expression->nodes[index].operator = type;
+		compiler->expression->nodes[index].prefix = 1;
+		return index;
+	}
+	return compilePrimary(compiler);
+}
+
+/**
+ * @brief Function that returns the precedence of a binary operator.
+ *
+ * @param type The token type
+ * @return The precedence (higher binds tighter) / 0: Not a binary operator
+ */
+int binaryPrecedence(int type) {
+	switch (type) {
+	case ARITHMETIC_TOKEN_OR:
+		return 1;
+	case ARITHMETIC_TOKEN_AND:
+		return 2;
+	case '|':
+		return 3;
+	case '^':
+		return 4;
+	case '&':
+		return 5;
+	case ARITHMETIC_TOKEN_EQUAL:
+	case ARITHMETIC_TOKEN_NOT_EQUAL:
+		return 6;
+	case '<':
+	case '>':
+	case ARITHMETIC_TOKEN_LESS_EQUAL:
+	case ARITHMETIC_TOKEN_GREATER_EQUAL:
+		return 7;
+	case ARITHMETIC_TOKEN_SHIFT_LEFT:
+	case ARITHMETIC_TOKEN_SHIFT_RIGHT:
+		return 8;
+	case '+':
+	case '-':
+		return 9;
+	case '*':
+	case '/':
+	case '%':
+		return 10;
+	case ARITHMETIC_TOKEN_POWER:
+		return 11;
+	}
+	return 0;
+}
+
+/**
+ * @brief Function that compiles binary operations of at least a given precedence (precedence climbing).
+ *
+ * @param compiler
+ * @param minimumPrecedence
+ * @return Index of the node: OK / -1: Error
+ */
+int compileBinary(struct arithmeticCompiler *compiler, int minimumPrecedence) {
+	int left = compileUnary(compiler);
+	if (left == -1)
+		return -1;
+	while (1) {
+		int type = currentArithmeticToken(compiler);
+		int precedence = binaryPrecedence(type);
+		if ((precedence == 0) || (precedence < minimumPrecedence))
+			return left;
+		compiler->position++;
+		// ** is right-associative
+		int right = compileBinary(compiler,
+				(type == ARITHMETIC_TOKEN_POWER) ? precedence : (precedence + 1));
+		if (right == -1)
+			return -1;
+		int index = addArithmeticNode(compiler, ARITHMETIC_BINARY);
+		if (index == -1)
+			return -1;
+		compiler->expression->nodes[index].operator = type;
+		compiler->expression->nodes[index].left = left;
+		compiler->expression->nodes[index].right = right;
+		left = index;
+	}
+}
+
+/**
+ * @brief Function that compiles a conditional expression (cond ? expr : expr).
+ *
+ * @return Index of the node: OK / -1: Error
+ */
+int compileConditional(struct arithmeticCompiler *compiler) {
+	int condition = compileBinary(compiler, 1);
+	if ((condition == -1) || (currentArithmeticToken(compiler) != '?'))
+		return condition;
+	compiler->position++;
+	int whenTrue = compileAssignment(compiler);
+	if (whenTrue == -1)
+		return -1;
+	if (currentArithmeticToken(compiler) != ':')
+		return arithmeticSyntaxError(compiler);
+	compiler->position++;
+	int whenFalse = compileAssignment(compiler);
+	if (whenFalse == -1)
+		return -1;
+	int index = addArithmeticNode(compiler, ARITHMETIC_CONDITIONAL);
+	if (index == -1)
+		return -1;
+	compiler->expression->nodes[index].left = condition;
+	compiler->expression->nodes[index].right = whenTrue;
+	compiler->expression->nodes[index].third = whenFalse;
+	return index;
+}
+
+/**
+ * @brief Function that compiles an assignment (id = expr, id op= expr), or a conditional expression.
+ *
+ * @return Index of the node: OK / -1: Error
+ */
+int compileAssignment(struct arithmeticCompiler *compiler) {
+	int next = compiler->tokens[compiler->position + 1].type;
+	if ((currentArithmeticToken(compiler) != ARITHMETIC_TOKEN_NAME)
+			|| ((next != ARITHMETIC_TOKEN_ASSIGN)
+					&& (next < ARITHMETIC_ASSIGN_OFFSET)))
+		return compileConditional(compiler);
+	int index = addNamedNode(compiler, ARITHMETIC_ASSIGNMENT);
+	if (index == -1)
+		return -1;
+	compiler->position++;
+	int value = compileAssignment(compiler);
+	if (value == -1)
+		return -1;
+	struct arithmeticNode *node = &compiler->expression->nodes[index];
+	node->operator =
+			(next == ARITHMETIC_TOKEN_ASSIGN) ? 0 : (next - ARITHMETIC_ASSIGN_OFFSET);
+	node->right = value;
+	return index;
+}
+
+/**
+ * @brief Function that compiles a sequence of expressions (expr, expr, ...).
+ *
+ * @return Index of the node: OK / -1: Error
+ */
+int compileSequence(struct arithmeticCompiler *compiler) {
+	int left = compileAssignment(compiler);
+	while ((left != -1) && (currentArithmeticToken(compiler) == ',')) {
+		compiler->position++;
+		int right = compileAssignment(compiler);
+		if (right == -1)
+			return -1;
+		int index = addArithmeticNode(compiler, ARITHMETIC_BINARY);
+		if (index == -1)
+			return -1;
+		compiler->expression->nodes[index].operator = ',';
+		compiler->expression->nodes[index].left = left;
+		compiler->expression->nodes[index].right = right;
+		left = index;
+	}
+	return left;
+}
+
+/**
+ * @brief Function that releases a compiled expression.
+ *
+ * @param expression
+ */
+void freeArithmeticExpression(struct arithmeticExpression *expression) {
+	int i;
+	for (i = 0; i < expression->nodesCount; i++)
+		free(expression->nodes[i].name);
+	free(expression->nodes);
+	expression->nodes = NULL;
+	expression->nodesCount = 0;
+	expression->nodesCapacity = 0;
+}
+
+/**
+ * @brief Function that compiles an expression into its syntax tree.
+ * An empty expression is compiled to 0.
+ *
+ * @param text The expression text
+ * @param expression The expression to be filled in
+ * @return 0: OK / -1: Error
+ */
+int compileArithmetic(const char *text, struct arithmeticExpression *expression) {
+	struct arithmeticCompiler compiler;
+	compiler.expressionText = text;
+	compiler.expression = expression;
+	compiler.position = 0;
+	compiler.error = 0;
+	expression->nodes = NULL;
+	expression->nodesCount = 0;
+	expression->nodesCapacity = 0;
+	compiler.tokensCount = tokenizeArithmetic(text, &compiler.tokens);
+	if (compiler.tokensCount == -1)
+		return -1;
+	if (compiler.tokens[0].type == ARITHMETIC_TOKEN_END) {
+		expression->root = addArithmeticNode(&compiler, ARITHMETIC_NUMBER);
+	} else {
+		expression->root = compileSequence(&compiler);
+		if ((expression->root != -1)
+				&& (currentArithmeticToken(&compiler) != ARITHMETIC_TOKEN_END))
+			expression->root = arithmeticSyntaxError(&compiler);
+	}
+	free(compiler.tokens);
+	if (expression->root == -1) {
+		freeArithmeticExpression(expression);
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * @brief Function that gets the value of a variable.
+ * An unset or empty variable is 0, and a variable containing an expression is evaluated.
+ *
+ * @param text The expression text (for reporting errors)
+ * @param name The variable name
+ * @param value Filled in with the value
+ * @return 0: OK / -1: Error
+ */
+int variableArithmeticValue(const char *text, const char *name,
+		long long *value) {
+	const char *variable = getVariable(name);
+	(*value) = 0;
+	if ((variable == NULL) || (variable[0] == '\0'))
+		return 0;
+	// Plain numbers (the usual case) are converted directly
+	const char *start = variable;
+	while (isspace((unsigned char) *start))
+		start++;
+	int negative = (*start == '-');
+	if ((*start == '-') || (*start == '+'))
+		start++;
+	size_t length = strlen(start);
+	while ((length > 0) && isspace((unsigned char) start[length - 1]))
+		length--;
+	if ((length > 0) && isdigit((unsigned char) start[0])
+			&& (strspn(start, "0123456789") == length)
+			&& (convertNumber(start, length, value) == 0)) {
+		if (negative)
+			(*value) = (long long) (0ULL - (unsigned long long) (*value));
+		return 0;
+	}
+	if (arithmeticDepth >= ARITHMETIC_MAX_DEPTH) {
+		arithmeticError(text, "expression recursion level exceeded", name);
+		return -1;
+	}
+	// The expression of a variable is not cached (it may change at any time)
+	struct arithmeticExpression expression;
+	if (compileArithmetic(variable, &expression) == -1)
+		return -1;
+	arithmeticDepth++;
+	int result = evaluateExpression(variable, &expression, expression.root,
+			value);
+	arithmeticDepth--;
+	freeArithmeticExpression(&expression);
+	return result;
+}
+
+/**
+ * @brief Function that assigns an integer value to a variable.
+ *
+ * @param name The variable name
+ * @param value
+ * @return 0: OK / -1: Error
+ */
+int assignArithmeticVariable(const char *name, long long value) {
+	char assignment[strlen(name) + 32];
+	sprintf(assignment, "%s=%lld", name, value);
+	return assignVariable(assignment);
+}
+
+/**
+ * @brief Function that applies a binary operator (except the short-circuit ones).
+ *
+ * @param text The expression text (for reporting errors)
+ * @param operator The operator (token type)
+ * @param left
+ * @param right
+ * @param result Filled in with the result
+ * @return 0: OK / -1: Error
+ */
+int applyBinaryOperator(const char *text, int operator, long long left,
+		long long right, long long *result) {
+	unsigned long long unsignedLeft = (unsigned long long) left;
+	unsigned long long unsignedRight = (unsigned long long) right;
+	switch (operator) {
+	case '+':
+		(*result) = (long long) (unsignedLeft + unsignedRight);
+		return 0;
+	case '-':
+		(*result) = (long long) (unsignedLeft - unsignedRight);
+		return 0;
+	case '*':
+		(*result) = (long long) (unsignedLeft * unsignedRight);
+		return 0;
+	case '/':
+	case '%':
+		if (right == 0) {
+			arithmeticError(text, "division by 0", NULL);
+			return -1;
+		}
+		// The only overflowing division
+		if ((left == LLONG_MIN) && (right == -1))
+			(*result) = (operator == '/') ? LLONG_MIN : 0;
+		else
+			(*result) = (operator == '/') ? (left / right) : (left % right);
+		return 0;
+	case ARITHMETIC_TOKEN_POWER: {
+		if (right < 0) {
+			arithmeticError(text, "exponent less than 0", NULL);
+			return -1;
+		}
+		unsigned long long power = 1;
+		while (unsignedRight > 0) {
+			if (unsignedRight & 1)
+				power *= unsignedLeft;
+			unsignedLeft *= unsignedLeft;
+			unsignedRight >>= 1;
+		}
+		(*result) = (long long) power;
+		return 0;
+	}
+	case ARITHMETIC_TOKEN_SHIFT_LEFT:
+		(*result) = (long long) (unsignedLeft << (right & 63));
+		return 0;
+	case ARITHMETIC_TOKEN_SHIFT_RIGHT:
+		(*result) = left >> (right & 63);
+		return 0;
+	case '<':
+		(*result) = left < right;
+		return 0;
+	case '>':
+		(*result) = left > right;
+		return 0;
+	case ARITHMETIC_TOKEN_LESS_EQUAL:
+		(*result) = left <= right;
+		return 0;
+	case ARITHMETIC_TOKEN_GREATER_EQUAL:
+		(*result) = left >= right;
+		return 0;
+	case ARITHMETIC_TOKEN_EQUAL:
+		(*result) = left == right;
+		return 0;
+	case ARITHMETIC_TOKEN_NOT_EQUAL:
+		(*result) = left != right;
+		return 0;
+	case '&':
+		(*result) = left & right;
+		return 0;
+	case '^':
+		(*result) = left ^ right;
+		return 0;
+	case '|':
+		(*result) = left | right;
+		return 0;
+	case ',':
+		(*result) = right;
+		return 0;
+	}
+	return -1;
+}
+
+/**
+ * @brief Function that evaluates a node of a compiled expression.
+ *
+ * @param text The expression text (for reporting errors)
+ * @param expression The compiled expression
+ * @param index Index of the node
+ * @param result Filled in with the value of the node
+ * @return 0: OK / -1: Error
+ */
+int evaluateExpression(const char *text, struct arithmeticExpression *expression,
+		int index, long long *result) {
+	struct arithmeticNode *node = &expression->nodes[index];
+	long long left, right;
+	switch (node->type) {
+	case ARITHMETIC_NUMBER:
+		(*result) = node->value;
+		return 0;
+	case ARITHMETIC_VARIABLE:
+		return variableArithmeticValue(text, node->name, result);
+	case ARITHMETIC_UNARY:
+		if (evaluateExpression(text, expression, node->left, &left) == -1)
+			return -1;
+		switch (node->operator) {
+		case '!':
+			(*result) = !left;
+			break;
+		case '~':
+			(*result) = ~left;
+			break;
+		case '-':
+			(*result) = (long long) (0ULL - (unsigned long long) left);
+			break;
+		default:
+			(*result) = left;
+			break;
+		}
+		return 0;
+	case ARITHMETIC_BINARY:
+		if (evaluateExpression(text, expression, node->left, &left) == -1)
+			return -1;
+		// Short-circuit operators evaluate their right operand only if needed
+		if ((node->operator == ARITHMETIC_TOKEN_AND)
+				|| (node->operator == ARITHMETIC_TOKEN_OR)) {
+			if ((node->operator == ARITHMETIC_TOKEN_AND) ? !left : left) {
+				(*result) = (left != 0);
+				return 0;
+			}
+			if (evaluateExpression(text, expression, node->right, &right) == -1)
+				return -1;
+			(*result) = (right != 0);
+			return 0;
+		}
+		if (evaluateExpression(text, expression, node->right, &right) == -1)
+			return -1;
+		return applyBinaryOperator(text, node->operator, left, right, result);
+	case ARITHMETIC_CONDITIONAL:
+		if (evaluateExpression(text, expression, node->left, &left) == -1)
+			return -1;
+		return evaluateExpression(text, expression,
+				left ? node->right : node->third, result);
+	case ARITHMETIC_ASSIGNMENT:
+		if (evaluateExpression(text, expression, node->right, &right) == -1)
+			return -1;
+		if (node->operator != 0) {
+			if ((variableArithmeticValue(text, node->name, &left) == -1)
+					|| (applyBinaryOperator(text, node->operator, left, right,
+							&right) == -1))
+				return -1;
+		}
+		(*result) = right;
+		return assignArithmeticVariable(node->name, right);
+	case ARITHMETIC_INCREMENT:
+		if (variableArithmeticValue(text, node->name, &left) == -1)
+			return -1;
+		right = (long long) ((unsigned long long) left
+				+ ((node->operator == ARITHMETIC_TOKEN_INCREMENT) ? 1ULL : -1ULL));
+		(*result) = node->prefix ? right : left;
+		return assignArithmeticVariable(node->name, right);
+	}
+	return -1;
+}
+
+/**
+ * @brief Function that evaluates an arithmetic expression (variables already expanded or referenced by name).
+ * Any error is reported.
+ *
+ * @param text The expression text
+ * @param result Filled in with the value of the expression
+ * @return 0: OK / -1: Error
+ */
+int evaluateArithmetic(const char *text, long long *result) {
+	unsigned int hash = scriptHash(text, strlen(text));
+	struct arithmeticCacheEntry *entry =
+			&arithmeticCache.entries[hash % ARITHMETIC_CACHE_SIZE];
+	if ((entry->text != NULL) && (entry->hash == hash)
+			&& (strcmp(entry->text, text) == 0)) {
+		arithmeticCache.hits++;
+	} else {
+		arithmeticCache.misses++;
+		struct arithmeticExpression expression;
+		if (compileArithmetic(text, &expression) == -1)
+			return -1;
+		char *entryText = strdup(text);
+		if (entryText == NULL) {
+			perror("malloc error");
+			freeArithmeticExpression(&expression);
+			return -1;
+		}
+		// Replace the expression of the slot
+		if (entry->text != NULL) {
+			free(entry->text);
+			freeArithmeticExpression(&entry->expression);
+		}
+		entry->text = entryText;
+		entry->hash = hash;
+		entry->expression = expression;
+	}
+	// Nested evaluations (variables containing expressions) never use the cache,
+	// so the entry stays in place during the evaluation
+	return evaluateExpression(entry->text, &entry->expression,
+			entry->expression.root, result);
+}
+
+/**
+ * @brief Function that forgets every compiled expression.
+ */
+void clearArithmeticCache() {
+	int i;
+	for (i = 0; i < ARITHMETIC_CACHE_SIZE; i++) {
+		struct arithmeticCacheEntry *entry = &arithmeticCache.entries[i];
+		if (entry->text == NULL)
+			continue;
+		free(entry->text);
+		entry->text = NULL;
+		freeArithmeticExpression(&entry->expression);
+	}
+}
+
+/**
+ * @brief Function that prints the statistics of the arithmetic cache.
+ */
+void printArithmeticCacheStatistics() {
+	int cached = 0;
+	int i;
+	for (i = 0; i < ARITHMETIC_CACHE_SIZE; i++)
+		if (arithmeticCache.entries[i].text != NULL)
+			cached++;
+	printf("arithmetic cache: %d/%d expressions, %lu hits, %lu misses\n",
+			cached, ARITHMETIC_CACHE_SIZE, arithmeticCache.hits,
+			arithmeticCache.misses);
+}
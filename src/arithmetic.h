@@ -0,0 +1,99 @@
+/*  @file arithmetic.h
+ *  @author Nicolas Poyiadjis
+ *
+ *  @brief Arithmetic expression engine header.
+ *  Evaluates the expressions of let, (( )) and $(( )) within the shell, using 64-bit integers.
+ *  Every expression is compiled once into its syntax tree, kept in the arithmetic cache,
+ *  so that an expression repeated (e.g. within a loop) is only evaluated again.
+ */
+
+#ifndef ARITHMETIC_H_
+#define ARITHMETIC_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <limits.h>
+
+#define ARITHMETIC_CACHE_SIZE 256
+// Variables may contain expressions themselves, evaluated up to this depth
+#define ARITHMETIC_MAX_DEPTH 32
+
+// Expression node types
+#define ARITHMETIC_NUMBER 1
+#define ARITHMETIC_VARIABLE 2
+#define ARITHMETIC_UNARY 3
+#define ARITHMETIC_BINARY 4
+#define ARITHMETIC_CONDITIONAL 5
+#define ARITHMETIC_ASSIGNMENT 6
+#define ARITHMETIC_INCREMENT 7
+
+/**
+ * @brief A node of a compiled expression.
+ * Operands are given as indices in the nodes array of the expression.
+ */
+struct arithmeticNode {
+	int type;
+	// Operator (token type), 0 for plain assignment
+	int operator;
+	long long value;
+	// Variable name (variables, assignments, increments)
+	char *name;
+	int left;
+	int right;
+	int third;
+	// Increments: whether the value is taken after the increment (++i)
+	int prefix;
+};
+
+/**
+ * @brief A compiled expression.
+ */
+struct arithmeticExpression {
+	struct arithmeticNode *nodes;
+	int nodesCount;
+	int nodesCapacity;
+	int root;
+};
+
+/**
+ * @brief An expression remembered by the arithmetic cache.
+ */
+struct arithmeticCacheEntry {
+	char *text;
+	unsigned int hash;
+	struct arithmeticExpression expression;
+};
+
+/**
+ * @brief The arithmetic cache: compiled expressions, by the hash of their text.
+ * An expression replaces any other one of the same slot.
+ */
+struct arithmeticCache {
+	struct arithmeticCacheEntry entries[ARITHMETIC_CACHE_SIZE];
+	unsigned long hits;
+	unsigned long misses;
+};
+
+/**
+ * @brief Function that evaluates an arithmetic expression (variables already expanded or referenced by name).
+ * Any error is reported.
+ *
+ * @param text The expression text
+ * @param result Filled in with the value of the expression
+ * @return 0: OK / -1: Error
+ */
+int evaluateArithmetic(const char *text, long long *result);
+
+/**
+ * @brief Function that forgets every compiled expression.
+ */
+void clearArithmeticCache();
+
+/**
+ * @brief Function that prints the statistics of the arithmetic cache.
+ */
+void printArithmeticCacheStatistics();
+
+#endif /* ARITHMETIC_H_ */
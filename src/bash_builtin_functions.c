@@ -5,6 +5,9 @@
  */
 
 #include "bash_builtin_functions.h"
+#include "processes.h"
+#include "parallel.h"
+#include "nicpoyiash_interpreter.h"
 
 // Flag that is turned to one if the exit command is executed.
 // Used to let the terminal know when it should be exit.
@@ -15,6 +18,11 @@ int waitForInput = 0;
 // Command waiting for input, if any.
 char *commandWaiting = NULL;
 
+//--- Loop control ---//
+int loopDepth = 0;
+int loopControl = LOOP_CONTROL_NONE;
+int loopControlLevels = 0;
+
 //--- Read operation ---//
 // Terminal blocked for read operation
 int waitToRead = 0;
@@ -62,92 +70,462 @@ int continueBashExecution(char *inputScript) {
 	return continueRsult;
 }
 
+// Names of the bash built-in functions (besides variable settings)
+const char *bashBuiltinNames[] = { ".", "source", "cd", "declare", "typeset", "echo",
+		"exec", "exit", "export", "hash", "history", "jobs", "kill", "let", "local",
+		"logout", "printf", "pwd", "read", "shellstat", "clear", "true", "false",
+		":", "test", "[", "break", "continue", "times", "parallel", "wait", NULL };
+
 /**
- * @brief Function that escapes characters to be passed to system calls
+ * @brief Function that checks if the command is an environmental variable setting (e.g. PS1=TEST)
  *
- * @param buffer A character sequence to be escaped
- * @return The escaped character sequence
+ * @param commandName The command name to check
+ * @return The index that the '=' delimiter is positioned / 0: If the command is not suck a statement
  */
-char* escape(char* buffer) {
-	int i, j;
-	int l = strlen(buffer) + 1;
-	char esc_char[] = { '\a', '\b', '\f', '\n', '\r', '\t', '\v', '\\' };
-	char essc_str[] = { 'a', 'b', 'f', 'n', 'r', 't', 'v', '\\' };
-	char* dest = (char*) calloc(l * 2, sizeof(char));
-	char* ptr = dest;
-	for (i = 0; i < l; i++) {
-		for (j = 0; j < 8; j++) {
-			if (buffer[i] == esc_char[j]) {
-				*ptr++ = '\\';
-				*ptr++ = essc_str[j];
-				break;
-			}
+int isEnvSet(char *commandName) {
+	int comIndex = 0;
+	while (comIndex < strlen(commandName)) {
+		if (commandName[comIndex] == '=')
+			return comIndex;
+		comIndex++;
+	}
+	return 0;
+}
+
+/**
+ * @brief Function that adds or replaces a shell variable, given as an assignment (NAME=value).
+ *
+ * @param assignment The assignment string
+ * @return 0: OK / -1: Error
+ */
+int assignVariable(char *assignment) {
+	char *separator = strchr(assignment, '=');
+	if ((separator == NULL)
+			|| (setVariable(assignment, separator - assignment, separator + 1)
+					== -1))
+		return -1;
+	commandHashVariableAssigned(assignment);
+	launchVariableAssigned(assignment);
+	traceVariableAssigned(assignment);
+	processesVariableAssigned(assignment);
+	return 0;
+}
+
+/**
+ * @brief Function that decodes a backslash escape sequence (as used by echo -e and printf).
+ *
+ * @param position The position of the character after the backslash (moved after the sequence)
+ * @param character The decoded character
+ * @param octalWithZero Whether octal numbers begin with a zero (\0nnn), instead of \nnn
+ * @return 0: Decoded / 1: Stop all output (\c) / -1: Not an escape sequence
+ */
+int decodeEscape(const char **position, char *character, int octalWithZero) {
+	const char *sequence = *position;
+	int value = 0;
+	int digits = 0;
+	switch (*sequence) {
+	case 'a':
+		*character = '\a';
+		break;
+	case 'b':
+		*character = '\b';
+		break;
+	case 'e':
+	case 'E':
+		*character = 27;
+		break;
+	case 'f':
+		*character = '\f';
+		break;
+	case 'n':
+		*character = '\n';
+		break;
+	case 'r':
+		*character = '\r';
+		break;
+	case 't':
+		*character = '\t';
+		break;
+	case 'v':
+		*character = '\v';
+		break;
+	case '\\':
+		*character = '\\';
+		break;
+	case 'c':
+		*position = sequence + 1;
+		return 1;
+	case 'x':
+		while ((digits < 2) && isxdigit((unsigned char) sequence[digits + 1])) {
+			char digit = tolower((unsigned char) sequence[digits + 1]);
+			value = value * 16
+					+ (isdigit((unsigned char) digit) ? digit - '0' : digit - 'a' + 10);
+			digits++;
 		}
-		if (j == 8)
-			*ptr++ = buffer[i];
+		if (digits == 0)
+			return -1;
+		*character = (char) value;
+		*position = sequence + 1 + digits;
+		return 0;
+	default:
+		if ((*sequence < '0') || (*sequence > '7'))
+			return -1;
+		if (octalWithZero) {
+			if (*sequence != '0')
+				return -1;
+			sequence++;
+		}
+		while ((digits < 3) && (sequence[digits] >= '0')
+				&& (sequence[digits] <= '7')) {
+			value = value * 8 + (sequence[digits] - '0');
+			digits++;
+		}
+		*character = (char) value;
+		*position = sequence + digits;
+		return 0;
 	}
-	*ptr = '\0';
-	return dest;
+	*position = sequence + 1;
+	return 0;
 }
 
 /**
- * @brief Function that creates a full bash command by concatenating the command name and its arguments.
+ * @brief Function that outputs a string, decoding its backslash escape sequences (as echo -e).
  *
- * @param bashCommand The pure command name
- * @param commandArguments The command arguemnts given
- * @param beg Index to start concatenating arguments from
- * @param fin Index to stop concatenating arguments
- * @return A full system call to be executed
+ * @param buffer The output buffer
+ * @param string The string to output
+ * @return 0: OK / 1: Output stopped (\c)
  */
-char *concatenateArguments(char *bashCommand, char **commandArguments, int beg,
-		int fin) {
-	if (bashCommand == NULL )
-		return NULL ;
-	if (commandArguments == NULL )
-		return bashCommand;
-	if (beg > fin)
-		return bashCommand;
-	char *fullCommand = (char*) malloc(MAX_COMMAND_LENGTH * sizeof(char));
-	if (fullCommand == NULL ) {
-		perror("malloc error");
-		return NULL ;
+int outputEscapedString(struct outputBuffer *buffer, const char *string) {
+	const char *position = string;
+	while (*position) {
+		// Output the plain characters at once
+		size_t plainLength = strcspn(position, "\\");
+		outputWrite(buffer, position, plainLength);
+		position += plainLength;
+		if (*position == '\0')
+			break;
+		position++;
+		char character;
+		int decoded = decodeEscape(&position, &character, 1);
+		if (decoded == 1)
+			return 1;
+		if (decoded == -1)
+			character = '\\';
+		outputCharacter(buffer, character);
 	}
-	fullCommand = strcpy(fullCommand, escape(bashCommand));
-	if (strcmp(bashCommand, "read") == 0){
-		strcpy(fullCommand,"");
+	return 0;
+}
+
+/**
+ * @brief Function that converts a printf argument to a number.
+ * A leading quote gives the value of the following character.
+ *
+ * @param argument The argument (NULL if missing)
+ * @param value The number
+ * @return 0: OK / -1: Invalid number (the value converted so far is given)
+ */
+int printfNumber(const char *argument, long long *value) {
+	*value = 0;
+	if ((argument == NULL) || (*argument == '\0'))
+		return 0;
+	if ((argument[0] == '\'') || (argument[0] == '"')) {
+		*value = (unsigned char) argument[1];
+		return 0;
 	}
-	else{
-		strcat(fullCommand, " ");
+	char *end;
+	errno = 0;
+	*value = strtoll(argument, &end, 0);
+	// Numbers out of range as signed are accepted as unsigned (e.g. 0xffffffffffffffff)
+	if (errno == ERANGE)
+		*value = (long long) strtoull(argument, &end, 0);
+	if ((*end != '\0') || (end == argument)) {
+		fprintf(stderr, "nicpoyia-sh: printf: %s: invalid number\n", argument);
+		return -1;
 	}
-	// No need of double quotes in case of a single argument
-	if ((beg == 0) && (fin == 0)) {
-		strcat(fullCommand, escape(commandArguments[beg]));
-		return fullCommand;
+	return 0;
+}
+
+/**
+ * @brief Function that quotes a string, so that it can be reused as shell input (as printf %q).
+ * The expansion of the quoted string gives the string itself.
+ *
+ * @param arena The arena to allocate the quoted string from
+ * @param string The string to quote
+ * @return The quoted string / NULL: Error
+ */
+char *quoteForShell(struct arena *arena, const char *string) {
+	if (*string == '\0')
+		return arenaCopyString(arena, "''");
+	char *quoted = (char*) arenaAllocate(arena, strlen(string) * 2 + 1);
+	if (quoted == NULL)
+		return NULL;
+	char *position = quoted;
+	for (; *string; string++) {
+		if (!isalnum((unsigned char) *string) && !strchr("_./-+,:=@%^", *string))
+			*position++ = '\\';
+		*position++ = *string;
 	}
-	// In case of more than one arguments
-	strcat(fullCommand, escape(commandArguments[beg]));
-	int i;
-	for (i = beg + 1; i <= fin; i++) {
-		strcat(fullCommand, " ");
-		strcat(fullCommand, escape(commandArguments[i]));
+	*position = '\0';
+	return quoted;
+}
+
+/**
+ * @brief Function that carries out the printf built-in function.
+ * The format is reused as long as there are arguments left to consume.
+ *
+ * @param format The format string
+ * @param arguments The arguments to be formatted
+ * @param args Number of arguments
+ * @return 0: OK / 1: Error in some format or argument
+ */
+int printfFormat(const char *format, char **arguments, int args) {
+	int status = 0;
+	int consumed = 0;
+	do {
+		int consumedBefore = consumed;
+		const char *position = format;
+		while (*position) {
+			// Output the plain characters at once
+			size_t plainLength = strcspn(position, "%\\");
+			outputWrite(&builtinOutput, position, plainLength);
+			position += plainLength;
+			if (*position == '\0')
+				break;
+			if (*position == '\\') {
+				position++;
+				char character;
+				int decoded = decodeEscape(&position, &character, 0);
+				if (decoded == 1)
+					return status;
+				if (decoded == -1)
+					character = '\\';
+				outputCharacter(&builtinOutput, character);
+				continue;
+			}
+			// Conversion specification: %[flags][width][.precision]conversion
+			position++;
+			if (*position == '%') {
+				outputCharacter(&builtinOutput, '%');
+				position++;
+				continue;
+			}
+			char specification[64] = "%";
+			size_t length = 1;
+			while (*position && strchr("-+ #0", *position)
+					&& (length < sizeof(specification) - 32))
+				specification[length++] = *position++;
+			int field;
+			for (field = 0; field < 2; field++) {
+				// Width (field 0) and precision (field 1), given or taken from an argument
+				if (field == 1) {
+					if (*position != '.')
+						break;
+					specification[length++] = *position++;
+				}
+				if (*position == '*') {
+					long long value;
+					if (printfNumber(
+							(consumed < args) ? arguments[consumed] : NULL, &value)
+							== -1)
+						status = 1;
+					if (consumed < args)
+						consumed++;
+					length += snprintf(specification + length,
+							sizeof(specification) - length, "%d", (int) value);
+					position++;
+				} else {
+					while (isdigit((unsigned char) *position)
+							&& (length < sizeof(specification) - 16))
+						specification[length++] = *position++;
+				}
+			}
+			char conversion = *position;
+			if (conversion == '\0') {
+				fprintf(stderr, "nicpoyia-sh: printf: %s: missing conversion\n",
+						specification);
+				return 1;
+			}
+			position++;
+			const char *argument = (consumed < args) ? arguments[consumed] : NULL;
+			if ((consumed < args) && strchr("diouxXcsbqeEfFgGaA", conversion))
+				consumed++;
+			long long value;
+			switch (conversion) {
+			case 'd':
+			case 'i':
+			case 'o':
+			case 'u':
+			case 'x':
+			case 'X':
+				if (printfNumber(argument, &value) == -1)
+					status = 1;
+				specification[length++] = 'l';
+				specification[length++] = 'l';
+				specification[length++] = conversion;
+				specification[length] = '\0';
+				outputFormat(&builtinOutput, specification, value);
+				break;
+			case 'e':
+			case 'E':
+			case 'f':
+			case 'F':
+			case 'g':
+			case 'G':
+			case 'a':
+			case 'A': {
+				long double number = 0;
+				if ((argument != NULL) && (*argument != '\0')) {
+					char *end;
+					number = strtold(argument, &end);
+					if (*end != '\0') {
+						fprintf(stderr,
+								"nicpoyia-sh: printf: %s: invalid number\n",
+								argument);
+						status = 1;
+					}
+				}
+				specification[length++] = 'L';
+				specification[length++] = conversion;
+				specification[length] = '\0';
+				outputFormat(&builtinOutput, specification, number);
+				break;
+			}
+			case 'c':
+			case 's':
+			case 'b':
+			case 'q': {
+				const char *text = (argument != NULL) ? argument : "";
+				char character[2] = { text[0], '\0' };
+				if (conversion == 'c')
+					text = character;
+				else if (conversion == 'q')
+					text = quoteForShell(&scriptArena, text);
+				else if (conversion == 'b') {
+					// The argument escape sequences are decoded in a copy of its own
+					char *decodedText = arenaAllocate(&scriptArena,
+							strlen(text) + 1);
+					if (decodedText == NULL)
+						return 1;
+					const char *textPosition = text;
+					size_t decodedLength = 0;
+					int stopped = 0;
+					while (*textPosition && !stopped) {
+						if (*textPosition != '\\') {
+							decodedText[decodedLength++] = *textPosition++;
+							continue;
+						}
+						textPosition++;
+						char decodedCharacter;
+						int result = decodeEscape(&textPosition,
+								&decodedCharacter, 1);
+						if (result == 1)
+							stopped = 1;
+						else
+							decodedText[decodedLength++] =
+									(result == -1) ? '\\' : decodedCharacter;
+					}
+					decodedText[decodedLength] = '\0';
+					text = decodedText;
+					// All output stops after the argument (\c)
+					if (stopped) {
+						strcpy(specification + length, "s");
+						outputFormat(&builtinOutput, specification, text);
+						return status;
+					}
+				}
+				if (text == NULL)
+					return 1;
+				specification[length++] = 's';
+				specification[length] = '\0';
+				outputFormat(&builtinOutput, specification, text);
+				break;
+			}
+			default:
+				fprintf(stderr,
+						"nicpoyia-sh: printf: `%c': invalid format character\n",
+						conversion);
+				return 1;
+			}
+		}
+		// Stop reusing the format, if no argument has been consumed at all
+		if (consumed == consumedBefore)
+			break;
+	} while (consumed < args);
+	return status;
+}
+
+/**
+ * @brief Function that finds a script to be sourced.
+ * A name without any '/' is searched in PATH first, and then in the current directory.
+ *
+ * @param name The script name, as given to source
+ * @return The script path (allocated from the script arena) / NULL: Not found
+ */
+char *findSourceFile(const char *name) {
+	if (strchr(name, '/') != NULL)
+		return (access(name, R_OK) == 0) ? (char*) name : NULL;
+	const char *path = getVariable("PATH");
+	while ((path != NULL) && (*path != '\0')) {
+		size_t directoryLength = strcspn(path, ":");
+		if (directoryLength > 0) {
+			char *candidate = (char*) arenaAllocate(&scriptArena,
+					directoryLength + strlen(name) + 2);
+			if (candidate == NULL)
+				return NULL;
+			memcpy(candidate, path, directoryLength);
+			candidate[directoryLength] = '/';
+			strcpy(candidate + directoryLength + 1, name);
+			struct stat candidateStatus;
+			if ((stat(candidate, &candidateStatus) == 0)
+					&& S_ISREG(candidateStatus.st_mode)
+					&& (access(candidate, R_OK) == 0))
+				return candidate;
+		}
+		path += directoryLength;
+		if (*path == ':')
+			path++;
 	}
-	return fullCommand;
+	return (access(name, R_OK) == 0) ? (char*) name : NULL;
 }
 
 /**
- * @brief Function that checks if the command is an environmental variable setting (e.g. PS1=TEST)
+ * @brief Function that declares shell variables (as declare, typeset and local do).
+ * The -x option exports the variables (+x stops exporting them); other options are accepted.
+ * Without any variable, every variable (or every exported one, using -x) is listed.
  *
- * @param commandName The command name to check
- * @return The index that the '=' delimiter is positioned / 0: If the command is not suck a statement
+ * @param commandArguments The options and assignments (NAME=value) or names
+ * @param args Number of arguments
  */
-int isEnvSet(char *commandName) {
-	int comIndex = 0;
-	while (comIndex < strlen(commandName)) {
-		if (commandName[comIndex] == '=')
-			return comIndex;
-		comIndex++;
+void declareVariables(char **commandArguments, int args) {
+	int i;
+	int declared = 0;
+	// -1: Export flag unchanged / 0: Not exported / 1: Exported
+	int exported = -1;
+	for (i = 0; i < args; i++) {
+		char *argument = commandArguments[i];
+		if ((argument[0] == '-') || (argument[0] == '+')) {
+			if (strchr(argument, 'x') != NULL)
+				exported = (argument[0] == '-');
+			continue;
+		}
+		declared = 1;
+		// A name without any value is only declared
+		int separator = isEnvSet(argument);
+		if ((separator > 0) && (assignVariable(argument) == -1))
+			continue;
+		if (exported != -1)
+			exportVariable(argument,
+					(separator > 0) ? (size_t) separator : strlen(argument),
+					exported);
 	}
-	return 0;
+	if (declared)
+		return;
+	// List the variables
+	fflush(stdout);
+	if (exported == 1)
+		outputVariables(&builtinOutput, 1, "declare -x ", 1);
+	else
+		outputVariables(&builtinOutput, 0, "", 0);
 }
 
 /**
@@ -157,11 +535,35 @@ int isEnvSet(char *commandName) {
  */
 
 void executeDot(char *commandName, char **commandArguments, int args) {
-	system(concatenateArguments(commandName, commandArguments, 0, args - 1));
+	if (args == 0) {
+		fprintf(stderr, "%s: filename argument required\n", commandName);
+		return;
+	}
+	char *scriptPath = findSourceFile(commandArguments[0]);
+	if (scriptPath == NULL) {
+		fprintf(stderr, "nicpoyia-sh: %s: No such file or directory\n",
+				commandArguments[0]);
+		return;
+	}
+	// The script is executed by the current shell, so that its settings persist
+	if (args == 1) {
+		executeScriptFile(scriptPath);
+		return;
+	}
+	// Any further arguments are the positional parameters of the script, while it is executed
+	struct positionalParameters callerParameters = positionalParameters;
+	positionalParameters.name = NULL;
+	positionalParameters.values = NULL;
+	positionalParameters.count = 0;
+	if (setPositionalParameters(callerParameters.name, commandArguments + 1,
+			args - 1) == 0)
+		executeScriptFile(scriptPath);
+	freePositionalParameters(&positionalParameters);
+	positionalParameters = callerParameters;
 }
 
 void executeSource(char **commandArguments, int args) {
-	system(concatenateArguments("source", commandArguments, 0, args - 1));
+	executeDot("source", commandArguments, args);
 }
 
 void executeCd(char **commandArguments, int args) {
@@ -169,88 +571,425 @@ void executeCd(char **commandArguments, int args) {
 }
 
 void executeDeclare(char **commandArguments, int args) {
-	if (args == 0) {
-		system("declare");
-		return;
-	}
-	putenv(commandArguments[0]);
+	declareVariables(commandArguments, args);
 }
 
 void executeTypeset(char **commandArguments, int args) {
-	if (args == 0) {
-		system("typeset");
-		return;
-	}
-	putenv(commandArguments[0]);
+	declareVariables(commandArguments, args);
 }
 
 void executeEcho(char **commandArguments, int args) {
-	char *echoCommand = concatenateArguments("echo", commandArguments, 0,
-			args - 1);
-	system(echoCommand);
+	int newline = 1;
+	int escapes = 0;
+	int i = 0;
+	// Options (-n, -e, -E, or combined, e.g. -ne), up to the first non-option argument
+	for (; i < args; i++) {
+		char *option = commandArguments[i];
+		if ((option[0] != '-') || (option[1] == '\0')
+				|| (strspn(option + 1, "neE") != strlen(option + 1)))
+			break;
+		for (option++; *option; option++) {
+			if (*option == 'n')
+				newline = 0;
+			else
+				escapes = (*option == 'e');
+		}
+	}
+	fflush(stdout);
+	int stopped = 0;
+	for (; (i < args) && !stopped; i++) {
+		if (escapes)
+			stopped = outputEscapedString(&builtinOutput, commandArguments[i]);
+		else
+			outputString(&builtinOutput, commandArguments[i]);
+		if ((i < args - 1) && !stopped)
+			outputCharacter(&builtinOutput, ' ');
+	}
+	if (newline && !stopped)
+		outputCharacter(&builtinOutput, '\n');
+	outputFlush(&builtinOutput);
+}
+
+void executePrintf(char **commandArguments, int args) {
+	if (args == 0) {
+		fprintf(stderr, "printf: usage: printf format [arguments]\n");
+		return;
+	}
+	fflush(stdout);
+	printfFormat(commandArguments[0], commandArguments + 1, args - 1);
+	outputFlush(&builtinOutput);
 }
 
 void executeExec(char **commandArguments, int args) {
-	execvp(commandArguments[0], commandArguments);
+	// The replacing program receives SIGCHLD as usual
+	sigset_t childSignalMask;
+	sigemptyset(&childSignalMask);
+	sigaddset(&childSignalMask, SIGCHLD);
+	// The program is handed the exported variables only
+	const char *commandPath = resolveCommand(commandArguments[0]);
+	char **environment = exportedEnvironment();
+	if ((commandPath == NULL) || (environment == NULL)) {
+		fprintf(stderr, "nicpoyia-sh: exec: %s: not found\n",
+				commandArguments[0]);
+		lastExitStatus = 127;
+		return;
+	}
+	sigprocmask(SIG_UNBLOCK, &childSignalMask, NULL);
+	execve(commandPath, commandArguments, environment);
+	perror(commandArguments[0]);
+	sigprocmask(SIG_BLOCK, &childSignalMask, NULL);
 }
 
 void executeExit(char **commandArguments, int args) {
+	if (args > 0)
+		lastExitStatus = atoi(commandArguments[0]) & 0xff;
 	exitEnabled = 1;
 }
 
 void executeExport(char **commandArguments, int args) {
-	putenv(commandArguments[0]);
+	int exported = 1;
+	int exportedAny = 0;
+	int i;
+	for (i = 0; i < args; i++) {
+		char *argument = commandArguments[i];
+		// export -n stops exporting the variables
+		if (argument[0] == '-') {
+			if (strchr(argument, 'n') != NULL)
+				exported = 0;
+			continue;
+		}
+		exportedAny = 1;
+		int separator = isEnvSet(argument);
+		if ((separator > 0) && (assignVariable(argument) == -1))
+			continue;
+		exportVariable(argument,
+				(separator > 0) ? (size_t) separator : strlen(argument),
+				exported);
+	}
+	// List the exported variables
+	if (!exportedAny) {
+		fflush(stdout);
+		outputVariables(&builtinOutput, 1, "declare -x ", 1);
+	}
+}
+
+void executeHash(char **commandArguments, int args) {
+	// If plain hash command
+	if (args == 0) {
+		printCommandHash();
+		return;
+	}
+	// Forget every remembered command
+	if (strcmp(commandArguments[0], "-r") == 0) {
+		resetCommandHash();
+		return;
+	}
+	// Use the given path for a command, without searching PATH
+	if (strcmp(commandArguments[0], "-p") == 0) {
+		if (args < 3) {
+			printf("hash: usage: hash [-r] [-p pathname] [-dt] [name ...]\n");
+			return;
+		}
+		int i;
+		for (i = 2; i < args; i++)
+			pinCommand(commandArguments[i], commandArguments[1]);
+		return;
+	}
+	// Forget the given commands
+	if (strcmp(commandArguments[0], "-d") == 0) {
+		int i;
+		for (i = 1; i < args; i++)
+			if (forgetCommand(commandArguments[i]) == -1)
+				fprintf(stderr, "nicpoyia-sh: hash: %s: not found\n",
+						commandArguments[i]);
+		return;
+	}
+	// Print (-t) or just remember the given commands
+	int printPaths = (strcmp(commandArguments[0], "-t") == 0);
+	int i;
+	for (i = printPaths; i < args; i++) {
+		const char *commandPath = resolveCommand(commandArguments[i]);
+		if (commandPath == NULL)
+			fprintf(stderr, "nicpoyia-sh: hash: %s: not found\n",
+					commandArguments[i]);
+		else if (printPaths)
+			printf("%s\n", commandPath);
+	}
 }
 
 void executeHistory(char **commandArguments, int args) {
 	// If too many arguments
 	if (args > 1) {
-		printf("nicpoyia-sh: history: too many arguments\n");
+		fprintf(stderr, "nicpoyia-sh: history: too many arguments\n");
+		lastExitStatus = 1;
 		return;
 	}
-	// If history command with a numeric argument
-	int parValue;
-	if ((args == 1) && (sscanf(commandArguments[0], "%d", &parValue) == 1)) {
-		//
-		//
-		//
+	if ((args == 1) && (strcmp(commandArguments[0], "-c") == 0)) {
+		clearHistory();
+		return;
+	}
+	// If history command with a numeric argument, only the last entries are listed
+	unsigned long count = 0;
+	if (args == 1) {
+		char *end;
+		count = strtoul(commandArguments[0], &end, 10);
+		if ((*end != '\0') || (commandArguments[0][0] == '-')) {
+			fprintf(stderr, "nicpoyia-sh: history: %s: numeric argument required\n",
+					commandArguments[0]);
+			lastExitStatus = 1;
+			return;
+		}
+		if (count == 0)
+			return;
+	}
+	fflush(stdout);
+	outputHistory(&builtinOutput, count);
+}
+
+void executeJobs(char **commandArguments, int args) {
+	int format = JOBS_LIST_DEFAULT;
+	int i;
+	for (i = 0; i < args; i++) {
+		if (strcmp(commandArguments[i], "-l") == 0) {
+			format = JOBS_LIST_LONG;
+		} else if (strcmp(commandArguments[i], "-p") == 0) {
+			format = JOBS_LIST_PIDS;
+		} else {
+			fprintf(stderr, "nicpoyia-sh: jobs: %s: invalid option\n",
+					commandArguments[i]);
+			fprintf(stderr, "jobs: usage: jobs [-l | -p]\n");
+			lastExitStatus = 2;
+			return;
+		}
+	}
+	fflush(stdout);
+	for (i = 0; i < jobsCapacity; i++)
+		if (jobs[i].running && (jobs[i].processesCount > 0))
+			outputJob(&builtinOutput, i, format);
+	outputQueuedJobs(&builtinOutput, format);
+	outputFlush(&builtinOutput);
+}
+
+void executeTimes(char **commandArguments, int args) {
+	// The shell times, then the times of its finished children
+	struct rusage self;
+	struct rusage children;
+	getrusage(RUSAGE_SELF, &self);
+	getrusage(RUSAGE_CHILDREN, &children);
+	struct timeval *times[4] = { &self.ru_utime, &self.ru_stime,
+			&children.ru_utime, &children.ru_stime };
+	fflush(stdout);
+	int i;
+	for (i = 0; i < 4; i++) {
+		double seconds = timevalSeconds(times[i]);
+		long minutes = (long) (seconds / 60);
+		outputFormat(&builtinOutput, "%ldm%.3fs%c", minutes, seconds - minutes * 60,
+				(i % 2 == 0) ? ' ' : '\n');
+	}
+	outputFlush(&builtinOutput);
+}
+
+void executeParallel(char **commandArguments, int args) {
+	struct parallelOptions options;
+	memset(&options, 0, sizeof(options));
+	options.jobs = (int) sysconf(_SC_NPROCESSORS_ONLN);
+	if (options.jobs < 1)
+		options.jobs = 1;
+	options.separator = '\n';
+	int i = 0;
+	while ((i < args) && (commandArguments[i][0] == '-')) {
+		char *option = commandArguments[i++];
+		if (strcmp(option, "--") == 0)
+			break;
+		if ((option[1] == 'j') || (option[1] == 'n')) {
+			// The number is given either attached (-j4) or as the next argument
+			char *numberString = option + 2;
+			if ((*numberString == '\0') && (i < args))
+				numberString = commandArguments[i++];
+			char *end;
+			long number = strtol(numberString, &end, 10);
+			if ((*numberString == '\0') || (*end != '\0') || (number < 1)
+					|| (number > INT_MAX)) {
+				fprintf(stderr,
+						"nicpoyia-sh: parallel: %.2s: positive number expected\n",
+						option);
+				lastExitStatus = 2;
+				return;
+			}
+			if (option[1] == 'j')
+				options.jobs = (int) number;
+			else
+				options.maxItems = (int) number;
+		} else if (strcmp(option, "-X") == 0) {
+			options.batch = 1;
+		} else if (strcmp(option, "-k") == 0) {
+			options.keepOrder = 1;
+		} else if (strcmp(option, "-0") == 0) {
+			options.separator = '\0';
+		} else {
+			fprintf(stderr, "nicpoyia-sh: parallel: %s: invalid option\n",
+					option);
+			i = args;
+			break;
+		}
+	}
+	// The command template, then the items given after :::
+	int templateCount = 0;
+	while ((i + templateCount < args)
+			&& (strcmp(commandArguments[i + templateCount],
+					PARALLEL_ITEMS_SEPARATOR) != 0))
+		templateCount++;
+	if (templateCount == 0) {
+		fprintf(stderr, "parallel: usage: parallel [-j jobs] [-n items] [-X] "
+				"[-k] [-0] command [arguments] [::: items]\n");
+		lastExitStatus = 2;
 		return;
 	}
-	// If plain history command
-	//
-	//
-	//
+	char **items = NULL;
+	int itemsCount = 0;
+	if (i + templateCount < args) {
+		items = commandArguments + i + templateCount + 1;
+		itemsCount = args - i - templateCount - 1;
+	}
+	lastExitStatus = runParallel(&options, commandArguments + i, templateCount,
+			items, itemsCount);
+}
+
+/**
+ * @brief Function that sends a signal to a process, or to every running process of a job (%job).
+ *
+ * @param target The PID or job specification
+ * @param signalCode
+ * @return 0: OK / -1: Error
+ */
+int killTarget(const char *target, int signalCode) {
+	if (target[0] == '%') {
+		int jobIndex = findJob(target, 0);
+		if (jobIndex == -1) {
+			fprintf(stderr, "nicpoyia-sh: kill: %s: no such job\n", target);
+			return -1;
+		}
+		struct job *job = &jobs[jobIndex];
+		int i;
+		for (i = 0; i < job->processesCount; i++)
+			if (job->statuses[i] == -1)
+				kill(job->pids[i], signalCode);
+		return 0;
+	}
+	char *end;
+	long pid = strtol(target, &end, 10);
+	if ((*target == '\0') || (*end != '\0') || (pid <= 0) || (pid > INT_MAX)) {
+		fprintf(stderr,
+				"nicpoyia-sh: kill: %s: arguments must be process or job IDs\n",
+				target);
+		return -1;
+	}
+	if (kill((pid_t) pid, signalCode) == -1) {
+		fprintf(stderr, "nicpoyia-sh: kill: (%ld) - %s\n", pid, strerror(errno));
+		return -1;
+	}
+	return 0;
 }
 
 void executeKill(char **commandArguments, int args) {
-	if (args == 0) {
+	// If no signal specified, send the default signal SIGTERM
+	// (a signal is given like "kill -9 1234")
+	int signalCode = SIGTERM;
+	int i = 0;
+	if ((args > 1) && (commandArguments[0][0] == '-')) {
+		// Ignore the '-' symbol attached in the front of the signal code given
+		signalCode = atoi(commandArguments[0] + 1);
+		i = 1;
+	}
+	if ((args == 0) || (commandArguments[i][0] == '-')) {
 		printf(
 				"kill: usage: kill [-s sigspec | -n signum | -sigspec] pid | jobspec ... or kill -l [sigspec]\n");
 		return;
 	}
-	// If no signal specified, send the default signal SIGTERM
-	if (args == 1) {
-		int pid = atoi(commandArguments[0]);
-		kill(pid, SIGTERM);
+	lastExitStatus = 0;
+	for (; i < args; i++)
+		if (killTarget(commandArguments[i], signalCode) == -1)
+			lastExitStatus = 1;
+}
+
+void executeWait(char **commandArguments, int args) {
+	int next = 0;
+	int i = 0;
+	if ((args > 0) && (strcmp(commandArguments[0], "-n") == 0)) {
+		next = 1;
+		i = 1;
+	}
+	// Wait for every background job
+	if (i >= args) {
+		lastExitStatus = next ? waitForNextJob(NULL, 0) : waitForBackgroundJobs();
 		return;
 	}
-	// If a signal is specified, it should be like "kill -9 1234"
-	if (commandArguments[0][0] != '-')
-		printf(
-				"kill: usage: kill [-s sigspec | -n signum | -sigspec] pid | jobspec ... or kill -l [sigspec]\n");
-	else {
-		// Ignore the '-' symbol attached in the front of the signal code given
-		char *signalNumberString = commandArguments[0] + 1;
-		// Get the signal code and thepid
-		int signalCode = atoi(signalNumberString);
-		int pid = atoi(commandArguments[1]);
-		// Send the signal
-		kill(pid, signalCode);
+	// The processes given (the last process of every job given)
+	pid_t *pids = (pid_t*) malloc((args - i) * sizeof(pid_t));
+	int *jobIndexes = (int*) malloc((args - i) * sizeof(int));
+	if ((pids == NULL) || (jobIndexes == NULL)) {
+		perror("malloc error");
+		free(pids);
+		free(jobIndexes);
+		lastExitStatus = 1;
+		return;
+	}
+	int count = 0;
+	lastExitStatus = 0;
+	for (; i < args; i++) {
+		char *target = commandArguments[i];
+		int jobIndex = -1;
+		pid_t pid = 0;
+		if (target[0] == '%') {
+			jobIndex = findJob(target, 1);
+			if (jobIndex == -1) {
+				fprintf(stderr, "nicpoyia-sh: wait: %s: no such job\n", target);
+				lastExitStatus = WAIT_UNKNOWN_STATUS;
+				continue;
+			}
+			pid = jobs[jobIndex].pids[jobs[jobIndex].processesCount - 1];
+		} else {
+			char *end;
+			long number = strtol(target, &end, 10);
+			if ((*target == '\0') || (*end != '\0') || (number <= 0)
+					|| (number > INT_MAX)) {
+				fprintf(stderr,
+						"nicpoyia-sh: wait: `%s': not a pid or valid job spec\n",
+						target);
+				lastExitStatus = 2;
+				continue;
+			}
+			pid = (pid_t) number;
+			if ((pidMapLookup(&processes, pid) == NULL)
+					&& (findFinishedStatus(pid) == -1)) {
+				fprintf(stderr,
+						"nicpoyia-sh: wait: pid %d is not a child of this shell\n",
+						(int) pid);
+				lastExitStatus = WAIT_UNKNOWN_STATUS;
+				continue;
+			}
+		}
+		pids[count] = pid;
+		jobIndexes[count++] = jobIndex;
 	}
+	if (next) {
+		if (count > 0)
+			lastExitStatus = waitForNextJob(pids, count);
+	} else {
+		// The exit status is that of the last process or job given
+		for (i = 0; i < count; i++)
+			lastExitStatus =
+					(jobIndexes[i] != -1) ?
+							waitForBackgroundJob(jobIndexes[i]) :
+							waitForBackgroundProcess(pids[i]);
+	}
+	free(pids);
+	free(jobIndexes);
 }
 
 /**
  * @brief Function that gets obtains a specific substring and returns a pointer to it.
+ * The substring is allocated from the script arena.
  *
  * @param str The original string
  * @param begin The index within the string to begin getting characters from
@@ -262,89 +1001,25 @@ char* subString(const char* str, size_t begin, size_t len) {
 			|| strlen(str) < (begin + len))
 		return 0;
 
-	return strndup(str + begin, len);
-}
-
-/**
- * @brief Function that parses a let command to define its elements.
- * Fills in the two values variables and the operator character variable.
- *
- * @return 0: OK / -1: Error
- */
-int parseLetCommand(const char *argument, char **variable, int *value1,
-		int *value2, char *operator) {
-	// Discover the operators indices within the character sequence
-	int argIndex = 0;
-	int equalIndex = 0;
-	int operatorIndex = 0;
-	while (argIndex < strlen(argument)) {
-		switch (argument[argIndex]) {
-		case '=':
-			equalIndex = argIndex;
-			break;
-		case '+':
-		case '-':
-		case '*':
-		case '/':
-		case '%':
-			operatorIndex = argIndex;
-			break;
-		}
-		argIndex++;
-	}
-	// If a parser error occurred
-	if ((equalIndex == 0) || (operatorIndex == 0))
-		return -1;
-	if (abs(equalIndex - operatorIndex) <= 1)
-		return -1;
-	// Get the values and the operator using the discovered indices
-	(*operator) = argument[operatorIndex];
-	char *value1String;
-	char *value2String;
-	value1String = subString(argument, equalIndex + 1,
-			operatorIndex - equalIndex - 1);
-	(*value1) = atoi(value1String);
-	value2String = subString(argument, operatorIndex + 1,
-			strlen(argument) - operatorIndex - 1);
-	(*value2) = atoi(value2String);
-	(*variable) = subString(argument, 0, equalIndex);
-	return 0;
+	return arenaCopyText(&scriptArena, str + begin, len);
 }
 
 void executeLet(char **commandArguments, int args) {
 	if (args == 0) {
-		printf("nicpoyia-sh: let: expression expected\n");
+		fprintf(stderr, "nicpoyia-sh: let: expression expected\n");
+		lastExitStatus = 1;
 		return;
 	}
-	char *variableName;
-	int value1;
-	int value2;
-	char operator;
-	if (parseLetCommand(commandArguments[0], &variableName, &value1, &value2,
-			&operator) == -1)
-		return;
-	int result = 0;
-	switch (operator) {
-	case '+':
-		result = value1 + value2;
-		break;
-	case '-':
-		result = value1 - value2;
-		break;
-	case '*':
-		result = value1 * value2;
-		break;
-	case '/':
-		result = value1 / value2;
-		break;
-	case '%':
-		result = value1 % value2;
-		break;
+	// Every argument is an expression; the status tells whether the last one is non-zero
+	long long value = 0;
+	int i;
+	for (i = 0; i < args; i++) {
+		if (evaluateArithmetic(commandArguments[i], &value) == -1) {
+			lastExitStatus = 1;
+			return;
+		}
 	}
-	// Add or replace the evaluated expression into the desired variable
-	char resultString[16];
-	sprintf(resultString, "%d", result);
-	setenv(variableName, resultString, 1);
+	lastExitStatus = (value == 0);
 }
 
 void executeLocal(char **commandArguments, int args) {
@@ -353,9 +1028,8 @@ void executeLocal(char **commandArguments, int args) {
 		commandWaiting = "local";
 		return;
 	}
-	char *localCommand = concatenateArguments("local", commandArguments, 0,
-			args - 1);
-	system(localCommand);
+	// There are no function scopes, so local variables are shell variables
+	declareVariables(commandArguments, args);
 }
 
 void executeLogout(char **commandArguments, int args) {
@@ -369,16 +1043,18 @@ void executeLogout(char **commandArguments, int args) {
 
 void executePwd(char **commandArguments, int args) {
 	char workingDirectory[MAX_DIR_LENGTH];
-	if (getcwd(workingDirectory, MAX_DIR_LENGTH) != NULL )
-		printf("%s\n", workingDirectory);
-	else
+	if (getcwd(workingDirectory, MAX_DIR_LENGTH) != NULL) {
+		fflush(stdout);
+		outputFormat(&builtinOutput, "%s\n", workingDirectory);
+		outputFlush(&builtinOutput);
+	} else
 		perror("pwd error:");
 }
 
 void executeRead(char **commandArguments, int args) {
 	// If the command is going to read a variable without using an option
 	if (waitToRead) {
-		setenv(variableToRead, commandArguments[0], 1);
+		setVariable(variableToRead, strlen(variableToRead), commandArguments[0]);
 		waitToRead = 0;
 		free(variableToRead);
 		variableToRead = NULL;
@@ -403,8 +1079,7 @@ void executeRead(char **commandArguments, int args) {
 			int variableIndex = -1;
 			int i;
 			for (i = 0; i < args; i++) {
-				if ((commandArguments[i][0] != '-')
-						&& (commandArguments[i][0] != '"'))
+				if (commandArguments[i][0] != '-')
 					variableIndex = i;
 			}
 			if (variableIndex >= 0) {
@@ -414,18 +1089,9 @@ void executeRead(char **commandArguments, int args) {
 						switch (commandArguments[0][1]) {
 						// -p option selector tag
 						case 'p':
-							if ((variableIndex - 1) > 0) {
-								// Remove quotes (the characters are escaped)
-								// Do not use more that one arguments in case quotes not used properly
-								(commandArguments[1])++;
-								commandArguments[variableIndex - 1][strlen(
-										commandArguments[args - 1]) - 1] = '\0';
-								// Print user-selected prompt message
-								printf("%s\n",
-										concatenateArguments("read",
-												commandArguments, 1,
-												(variableIndex - 1)));
-							}
+							// Print user-selected prompt message
+							// (quotes have already been removed)
+							printf("%s\n", commandArguments[1]);
 							break;
 							//
 							// OTHER OPTIONS...
@@ -435,14 +1101,11 @@ void executeRead(char **commandArguments, int args) {
 					}
 				}
 				// Execute the read procedure
-				variableToRead = (char*) malloc(
-						strlen(commandArguments[variableIndex] + 1)
-								* sizeof(char));
+				variableToRead = strdup(commandArguments[variableIndex]);
 				if (variableToRead == NULL ) {
-					perror("malloc error");
+					perror("strdup error");
 					return;
 				}
-				strcpy(variableToRead, commandArguments[variableIndex]);
 				waitToRead = 1;
 				commandWaiting = "read";
 				return;
@@ -451,12 +1114,74 @@ void executeRead(char **commandArguments, int args) {
 	}
 }
 
+void executeShellStat(char **commandArguments, int args) {
+	printArenaStatistics("script arena", &scriptArena);
+	printParseCacheStatistics();
+	printArithmeticCacheStatistics();
+	printEnvironmentStatistics();
+	printCompletionStatistics();
+}
+
 void executeClear(char **commandArguments, int args) {
 	system("clear");
 }
 
+void executeTest(char **commandArguments, int args) {
+	lastExitStatus = evaluateTestExpression(commandArguments, args);
+}
+
+void executeBracket(char **commandArguments, int args) {
+	if ((args == 0) || (strcmp(commandArguments[args - 1], "]") != 0)) {
+		fprintf(stderr, "nicpoyia-sh: [: missing `]'\n");
+		lastExitStatus = 2;
+		return;
+	}
+	lastExitStatus = evaluateTestExpression(commandArguments, args - 1);
+}
+
+void executeLoopControl(char *commandName, char **commandArguments, int args) {
+	int levels = 1;
+	if (args > 0) {
+		char *end;
+		levels = (int) strtol(commandArguments[0], &end, 10);
+		if ((*end != '\0') || (levels < 1)) {
+			fprintf(stderr, "nicpoyia-sh: %s: %s: loop count out of range\n",
+					commandName, commandArguments[0]);
+			lastExitStatus = 1;
+			return;
+		}
+	}
+	if (loopDepth == 0) {
+		fprintf(stderr,
+				"nicpoyia-sh: %s: only meaningful in a `for', `while', or `until' loop\n",
+				commandName);
+		return;
+	}
+	// Leaving more loops than the enclosing ones leaves the outermost one
+	if (levels > loopDepth)
+		levels = loopDepth;
+	loopControl = (strcmp(commandName, "break") == 0) ?
+			LOOP_CONTROL_BREAK : LOOP_CONTROL_CONTINUE;
+	loopControlLevels = levels;
+}
+
 void executeSetEnv(char *commandName) {
-	putenv(commandName);
+	assignVariable(commandName);
+}
+
+/**
+ * @brief Function that checks whether a command represents a bash built-in function,
+ * without executing it.
+ *
+ * @param commandName The pure command name
+ * @return Whether the command is a bash built-in function
+ */
+int isBashBuiltinFunction(char *commandName) {
+	int i;
+	for (i = 0; bashBuiltinNames[i] != NULL; i++)
+		if (strcmp(commandName, bashBuiltinNames[i]) == 0)
+			return 1;
+	return isEnvSet(commandName) > 0;
 }
 
 /**
@@ -473,7 +1198,7 @@ void executeSetEnv(char *commandName) {
  */
 int executeBashBuiltinFunction(char *commandName, char **commandArguments,
 		int args) {
-	if (commandName[0] == '.') {
+	if (strcmp(commandName, ".") == 0) {
 		executeDot(commandName, commandArguments, args);
 		return 1;
 	}
@@ -508,15 +1233,21 @@ int executeBashBuiltinFunction(char *commandName, char **commandArguments,
 		return 1;
 	}
 	if (strcmp(commandName, "export") == 0) {
-		if (args == 0)
-			return -1;
 		executeExport(commandArguments, args);
 		return 1;
 	}
+	if (strcmp(commandName, "hash") == 0) {
+		executeHash(commandArguments, args);
+		return 1;
+	}
 	if (strcmp(commandName, "history") == 0) {
 		executeHistory(commandArguments, args);
 		return 1;
 	}
+	if (strcmp(commandName, "jobs") == 0) {
+		executeJobs(commandArguments, args);
+		return 1;
+	}
 	if (strcmp(commandName, "kill") == 0) {
 		executeKill(commandArguments, args);
 		return 1;
@@ -533,6 +1264,10 @@ int executeBashBuiltinFunction(char *commandName, char **commandArguments,
 		executeLogout(commandArguments, args);
 		return 1;
 	}
+	if (strcmp(commandName, "printf") == 0) {
+		executePrintf(commandArguments, args);
+		return 1;
+	}
 	if (strcmp(commandName, "pwd") == 0) {
 		executePwd(commandArguments, args);
 		return 1;
@@ -541,10 +1276,45 @@ int executeBashBuiltinFunction(char *commandName, char **commandArguments,
 		executeRead(commandArguments, args);
 		return 1;
 	}
+	if (strcmp(commandName, "shellstat") == 0) {
+		executeShellStat(commandArguments, args);
+		return 1;
+	}
 	if (strcmp(commandName, "clear") == 0) {
 		executeClear(commandArguments, args);
 		return 1;
 	}
+	if ((strcmp(commandName, "true") == 0) || (strcmp(commandName, ":") == 0))
+		return 1;
+	if (strcmp(commandName, "false") == 0) {
+		lastExitStatus = 1;
+		return 1;
+	}
+	if (strcmp(commandName, "test") == 0) {
+		executeTest(commandArguments, args);
+		return 1;
+	}
+	if (strcmp(commandName, "[") == 0) {
+		executeBracket(commandArguments, args);
+		return 1;
+	}
+	if ((strcmp(commandName, "break") == 0)
+			|| (strcmp(commandName, "continue") == 0)) {
+		executeLoopControl(commandName, commandArguments, args);
+		return 1;
+	}
+	if (strcmp(commandName, "times") == 0) {
+		executeTimes(commandArguments, args);
+		return 1;
+	}
+	if (strcmp(commandName, "parallel") == 0) {
+		executeParallel(commandArguments, args);
+		return 1;
+	}
+	if (strcmp(commandName, "wait") == 0) {
+		executeWait(commandArguments, args);
+		return 1;
+	}
 	int envDelPos;
 	if ((envDelPos = isEnvSet(commandName)) > 0) {
 		executeSetEnv(commandName);
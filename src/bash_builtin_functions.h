@@ -12,12 +12,38 @@
 #include <string.h>
 #include <unistd.h>
 #include <signal.h>
+#include <ctype.h>
+#include <errno.h>
 #include <math.h>
 
-#define MAX_COMMAND_LENGTH 512
+#include "command_hash.h"
+#include "process_launch.h"
+#include "arena.h"
+#include "output.h"
+#include "test_expression.h"
+#include "arithmetic.h"
+#include "variables.h"
+#include "history.h"
+#include "completion.h"
+
 #define MAX_DIR_LENGTH 1024
 #define MAX_INPUT_SIZE 1024
 
+// Loop control requested by break / continue
+#define LOOP_CONTROL_NONE 0
+#define LOOP_CONTROL_BREAK 1
+#define LOOP_CONTROL_CONTINUE 2
+
+// Names of the bash built-in functions (NULL terminated)
+extern const char *bashBuiltinNames[];
+
+// Number of loops currently executing (nested)
+extern int loopDepth;
+// Pending loop control (LOOP_CONTROL_*), stopping the execution of the loop bodies
+extern int loopControl;
+// Number of enclosing loops the pending loop control applies to
+extern int loopControlLevels;
+
 /**
  * @brief Function that defines whether the shell should terminate now.
  *
@@ -47,6 +73,23 @@ int readFromUser();
  */
 int continueBashExecution(char *inputScript);
 
+/**
+ * @brief Function that adds or replaces a shell variable, given as an assignment (NAME=value).
+ *
+ * @param assignment The assignment string
+ * @return 0: OK / -1: Error
+ */
+int assignVariable(char *assignment);
+
+/**
+ * @brief Function that checks whether a command represents a bash built-in function,
+ * without executing it.
+ *
+ * @param commandName The pure command name
+ * @return Whether the command is a bash built-in function
+ */
+int isBashBuiltinFunction(char *commandName);
+
 /**
  * @brief Function that checks whether a command represents a bash built-in function.
  * If it is a bash built-in function, then it is executed.
@@ -62,8 +105,28 @@ int continueBashExecution(char *inputScript);
 int executeBashBuiltinFunction(char *commandName, char **commandArguments,
 		int args);
 
+/**
+ * @brief Function that quotes a string, so that it can be reused as shell input (as printf %q).
+ * The expansion of the quoted string gives the string itself.
+ *
+ * @param arena The arena to allocate the quoted string from
+ * @param string The string to quote
+ * @return The quoted string / NULL: Error
+ */
+char *quoteForShell(struct arena *arena, const char *string);
+
+/**
+ * @brief Function that sends a signal to a process, or to every running process of a job (%job).
+ *
+ * @param target The PID or job specification
+ * @param signalCode
+ * @return 0: OK / -1: Error
+ */
+int killTarget(const char *target, int signalCode);
+
 /**
  * @brief Function that gets obtains a specific substring and returns a pointer to it.
+ * The substring is allocated from the script arena.
  *
  * @param str The original string
  * @param begin The index within the string to begin getting characters from
@@ -0,0 +1,167 @@
+/*  @file builtin_stages.c
+ *  @author Nicolas Poyiadjis
+ *
+ *  @brief Implementation of the built-in functions run as pipeline stages
+ */
+
+#include "builtin_stages.h"
+
+// Built-in functions without side effects on the shell, not reading their input
+// (each thread writes to an output buffer of its own, and keeps an exit status of its own)
+const char *threadSafeBuiltinNames[] = { "echo", "pwd", "true", "false", ":",
+		"test", "[", NULL };
+
+/**
+ * @brief Function that checks whether a built-in function can be run in a thread of the shell:
+ * it has no side effects on the shell state, and it does not read its input.
+ *
+ * @param commandName The built-in function name
+ * @return 1: true / 0: false
+ */
+int isThreadSafeBuiltin(const char *commandName) {
+	int i;
+	for (i = 0; threadSafeBuiltinNames[i] != NULL; i++)
+		if (strcmp(commandName, threadSafeBuiltinNames[i]) == 0)
+			return 1;
+	return 0;
+}
+
+/**
+ * @brief The function of a built-in function thread.
+ *
+ * @param argument The thread record
+ * @return NULL
+ */
+void *runBuiltinThread(void *argument) {
+	struct builtinThread *stage = (struct builtinThread*) argument;
+	builtinOutput.fd = stage->outputFd;
+	lastExitStatus = 0;
+	executeBashBuiltinFunction(stage->words[0], stage->words + 1,
+			stage->wordsCount - 1);
+	outputFlush(&builtinOutput);
+	stage->status = lastExitStatus;
+	// The next stage sees the end of its input
+	close(stage->outputFd);
+	return NULL;
+}
+
+/**
+ * @brief Function that starts a built-in function in a thread of the shell.
+ *
+ * @param stage The thread record to fill in
+ * @param commandWords The command words (kept until the thread is joined)
+ * @param wordsCount Number of command words
+ * @param outputFd The descriptor the output is written to
+ * @return 0: OK / -1: Error
+ */
+int startBuiltinThread(struct builtinThread *stage, char **commandWords,
+		int wordsCount, int outputFd) {
+	stage->words = commandWords;
+	stage->wordsCount = wordsCount;
+	stage->status = 0;
+	// The thread keeps a copy of its own, as the shell releases the pipe ends of the started stages
+	stage->outputFd = fcntl(outputFd, F_DUPFD_CLOEXEC, 0);
+	if (stage->outputFd == -1) {
+		perror("fcntl");
+		return -1;
+	}
+	// Every signal is left to the main thread (a closed pipe fails the write with EPIPE instead)
+	sigset_t allSignals, savedMask;
+	sigfillset(&allSignals);
+	pthread_sigmask(SIG_SETMASK, &allSignals, &savedMask);
+	int result = pthread_create(&stage->thread, NULL, runBuiltinThread, stage);
+	pthread_sigmask(SIG_SETMASK, &savedMask, NULL);
+	if (result != 0) {
+		fprintf(stderr, "pthread_create: %s\n", strerror(result));
+		close(stage->outputFd);
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * @brief Function that waits for every built-in function thread of a pipeline.
+ *
+ * @param stages The thread records
+ * @param stagesCount Number of threads
+ * @return The exit status of the last thread / 0: No threads
+ */
+int joinBuiltinThreads(struct builtinThread *stages, int stagesCount) {
+	int i;
+	for (i = 0; i < stagesCount; i++)
+		pthread_join(stages[i].thread, NULL);
+	return (stagesCount > 0) ? stages[stagesCount - 1].status : 0;
+}
+
+/**
+ * @brief Function that runs a built-in function in a forked child,
+ * with its pipes and redirections applied, as a process of the given job.
+ *
+ * @param jobIndex The job of the pipeline
+ * @param commandWords The command words (the built-in function name, followed by its arguments)
+ * @param wordsCount Number of command words
+ * @param command The command syntax tree, containing its redirections
+ * @param pipelinePos The position of the process in the pipeline
+ * @param pipelineCount How many pipelined processes are there
+ * @param pipesArray An array containing the pipe descriptor pairs of the pipeline
+ * @return The number of forked processes: OK / -1: Error occurred
+ */
+int executeBuiltinProcess(int jobIndex, char **commandWords, int wordsCount,
+		struct commandNode *command, int pipelinePos, int pipelineCount,
+		int pipesArray[][2]) {
+	// Allocate process space within the shell
+	if (allocateProcess() == -1)
+		return -1;
+	struct launchPlan plan;
+	if (planRedirections(command, pipelinePos, pipelineCount, pipesArray,
+			&plan) == -1) {
+		fprintf(stderr, "Error while redirecting input/output\n");
+		deallocateProcess();
+		return -1;
+	}
+	// The job time is measured from the start of its first process
+	if (jobs[jobIndex].processesCount == 0)
+		clock_gettime(CLOCK_MONOTONIC, &jobs[jobIndex].started);
+	fflush(stdout);
+	fflush(stderr);
+	uint64_t traceStart = tracing ? traceNow() : 0;
+	pid_t processPid = fork();
+	if (processPid == -1) {
+		perror("fork error");
+		deallocateProcess();
+		return -1;
+	}
+	//------------------------------ Parent-Process ------------------------------//
+	if (processPid > 0) {
+		if (tracing)
+			traceSpan("fork", traceStart, commandWords[0]);
+		if (processStarted(jobIndex, processPid) == -1) {
+			kill(processPid, SIGKILL);
+			waitpid(processPid, NULL, 0);
+			deallocateProcess();
+			return -1;
+		}
+		return 1;
+	}
+	//------------------------------ Child-Process ------------------------------//
+	// (the signal mask of the shell is kept, as the child reaps its own children the same way)
+	if (tracing)
+		traceChildStarted();
+	if (applyLaunchPlan(&plan) == -1)
+		_exit(EXIT_FAILURE);
+	// The child keeps no other pipe end (it is not replaced by exec, closing them)
+	destroyPipes(pipelineCount, pipesArray);
+	// The jobs of the shell (including this pipeline) are not children of the child
+	forgetInheritedJobs();
+	traceStart = tracing ? traceNow() : 0;
+	lastExitStatus = 0;
+	executeBashBuiltinFunction(commandWords[0], commandWords + 1,
+			wordsCount - 1);
+	if (tracing)
+		traceSpan("builtin", traceStart, commandWords[0]);
+	outputFlush(&builtinOutput);
+	fflush(stdout);
+	fflush(stderr);
+	// The exit handlers of the shell are not run by its stages
+	_exit(lastExitStatus);
+}
@@ -0,0 +1,88 @@
+/*  @file builtin_stages.h
+ *  @author Nicolas Poyiadjis
+ *
+ *  @brief Header of the built-in functions run as pipeline stages.
+ *  A built-in function within a pipeline is connected to its pipes like any other stage:
+ *  	- Built-in functions without side effects on the shell (e.g. echo, pwd, test) are run in a thread
+ *  	  of the shell, writing to their own output buffer, so that no process is forked for them
+ *  	- Any other built-in function (e.g. cd, read, export) is run in a forked child,
+ *  	  so that its side effects remain within its own pipeline stage (as in a subshell)
+ */
+
+#ifndef BUILTIN_STAGES_H_
+#define BUILTIN_STAGES_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <pthread.h>
+
+#include "processes.h"
+#include "pipes.h"
+#include "output.h"
+
+/**
+ * @brief A built-in function run in a thread of the shell.
+ */
+struct builtinThread {
+	pthread_t thread;
+	// The command words (the built-in function name, followed by its arguments)
+	char **words;
+	int wordsCount;
+	// The output of the thread (a copy of the descriptor given, closed once the function returns)
+	int outputFd;
+	// Exit status of the built-in function
+	int status;
+};
+
+/**
+ * @brief Function that checks whether a built-in function can be run in a thread of the shell:
+ * it has no side effects on the shell state, and it does not read its input.
+ *
+ * @param commandName The built-in function name
+ * @return 1: true / 0: false
+ */
+int isThreadSafeBuiltin(const char *commandName);
+
+/**
+ * @brief Function that starts a built-in function in a thread of the shell.
+ *
+ * @param stage The thread record to fill in
+ * @param commandWords The command words (kept until the thread is joined)
+ * @param wordsCount Number of command words
+ * @param outputFd The descriptor the output is written to
+ * @return 0: OK / -1: Error
+ */
+int startBuiltinThread(struct builtinThread *stage, char **commandWords,
+		int wordsCount, int outputFd);
+
+/**
+ * @brief Function that waits for every built-in function thread of a pipeline.
+ *
+ * @param stages The thread records
+ * @param stagesCount Number of threads
+ * @return The exit status of the last thread / 0: No threads
+ */
+int joinBuiltinThreads(struct builtinThread *stages, int stagesCount);
+
+/**
+ * @brief Function that runs a built-in function in a forked child,
+ * with its pipes and redirections applied, as a process of the given job.
+ *
+ * @param jobIndex The job of the pipeline
+ * @param commandWords The command words (the built-in function name, followed by its arguments)
+ * @param wordsCount Number of command words
+ * @param command The command syntax tree, containing its redirections
+ * @param pipelinePos The position of the process in the pipeline
+ * @param pipelineCount How many pipelined processes are there
+ * @param pipesArray An array containing the pipe descriptor pairs of the pipeline
+ * @return The number of forked processes: OK / -1: Error occurred
+ */
+int executeBuiltinProcess(int jobIndex, char **commandWords, int wordsCount,
+		struct commandNode *command, int pipelinePos, int pipelineCount,
+		int pipesArray[][2]);
+
+#endif /* BUILTIN_STAGES_H_ */
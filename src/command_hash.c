@@ -0,0 +1,293 @@
+/*  @file command_hash.c
+ *  @author Nicolas Poyiadjis
+ *
+ *  @brief Command path hash table implementation.
+ *  Remembers where every command name has been found in PATH (or that it has not been found),
+ *  so that a command is searched for only once until PATH changes.
+ */
+
+#include "command_hash.h"
+
+// A remembered command.
+// A NULL path marks a command known not to exist in PATH (negative entry).
+struct commandHashEntry {
+	char *name;
+	char *path;
+	int hits;
+	struct commandHashEntry *next;
+};
+
+// Hash table buckets (separate chaining)
+struct commandHashEntry **commandHashBuckets = NULL;
+int commandHashSize = 0;
+int commandHashEntries = 0;
+
+/**
+ * @brief FNV-1a hash of a command name
+ *
+ * @param name
+ * @return The hash value
+ */
+unsigned int commandNameHash(const char *name) {
+	unsigned int hash = 2166136261u;
+	while (*name) {
+		hash ^= (unsigned char) (*name);
+		hash *= 16777619u;
+		name++;
+	}
+	return hash;
+}
+
+/**
+ * @brief Function that finds the remembered entry of a command.
+ *
+ * @param name
+ * @return The entry / NULL: Not remembered
+ */
+struct commandHashEntry *findCommandEntry(const char *name) {
+	if (commandHashBuckets == NULL)
+		return NULL;
+	struct commandHashEntry *entry = commandHashBuckets[commandNameHash(name)
+			% commandHashSize];
+	while (entry != NULL) {
+		if (strcmp(entry->name, name) == 0)
+			return entry;
+		entry = entry->next;
+	}
+	return NULL;
+}
+
+/**
+ * @brief Function that doubles the buckets of the table, once it is getting full.
+ *
+ * @return 0: OK / -1: Error
+ */
+int growCommandHash() {
+	int newSize =
+			(commandHashSize == 0) ?
+					COMMAND_HASH_INITIAL_SIZE : (commandHashSize * 2);
+	struct commandHashEntry **newBuckets = (struct commandHashEntry**) calloc(
+			newSize, sizeof(struct commandHashEntry*));
+	if (newBuckets == NULL) {
+		perror("calloc error");
+		return -1;
+	}
+	int i;
+	for (i = 0; i < commandHashSize; i++) {
+		struct commandHashEntry *entry = commandHashBuckets[i];
+		while (entry != NULL) {
+			struct commandHashEntry *next = entry->next;
+			unsigned int bucket = commandNameHash(entry->name) % newSize;
+			entry->next = newBuckets[bucket];
+			newBuckets[bucket] = entry;
+			entry = next;
+		}
+	}
+	free(commandHashBuckets);
+	commandHashBuckets = newBuckets;
+	commandHashSize = newSize;
+	return 0;
+}
+
+/**
+ * @brief Function that adds (or replaces) a remembered command.
+ *
+ * @param name The command name
+ * @param path The executable path / NULL: Command not found
+ * @return The entry: OK / NULL: Error
+ */
+struct commandHashEntry *storeCommand(const char *name, const char *path) {
+	struct commandHashEntry *entry = findCommandEntry(name);
+	if (entry == NULL) {
+		if ((commandHashEntries + 1) * 4 > commandHashSize * 3)
+			if (growCommandHash() == -1)
+				return NULL;
+		entry = (struct commandHashEntry*) malloc(
+				sizeof(struct commandHashEntry));
+		if (entry == NULL) {
+			perror("malloc error");
+			return NULL;
+		}
+		entry->name = strdup(name);
+		entry->path = NULL;
+		unsigned int bucket = commandNameHash(name) % commandHashSize;
+		entry->next = commandHashBuckets[bucket];
+		commandHashBuckets[bucket] = entry;
+		commandHashEntries++;
+	}
+	free(entry->path);
+	entry->path = (path == NULL) ? NULL : strdup(path);
+	entry->hits = 0;
+	return entry;
+}
+
+/**
+ * @brief Function that checks whether a path is an executable regular file.
+ *
+ * @param path
+ * @return 1: Executable / 0: Not executable
+ */
+int isExecutableFile(const char *path) {
+	struct stat fileStatus;
+	if (stat(path, &fileStatus) == -1)
+		return 0;
+	if (!S_ISREG(fileStatus.st_mode))
+		return 0;
+	return (access(path, X_OK) == 0);
+}
+
+/**
+ * @brief Function that searches every PATH directory for the command executable.
+ *
+ * @param commandName The command name
+ * @param commandPath Container to be filled with the executable path
+ * @return 1: Found / 0: Not found
+ */
+int searchPath(const char *commandName, char *commandPath) {
+	const char *path = getVariable("PATH");
+	if (path == NULL)
+		path = "/usr/local/bin:/usr/bin:/bin";
+	size_t nameLength = strlen(commandName);
+	while (1) {
+		const char *separator = strchr(path, ':');
+		size_t dirLength = (separator == NULL) ? strlen(path) : (size_t) (separator - path);
+		// An empty PATH component means the current directory
+		if (dirLength + nameLength + 2 <= MAX_COMMAND_PATH_LENGTH) {
+			if (dirLength == 0) {
+				strcpy(commandPath, commandName);
+			} else {
+				memcpy(commandPath, path, dirLength);
+				commandPath[dirLength] = '/';
+				strcpy(commandPath + dirLength + 1, commandName);
+			}
+			if (isExecutableFile(commandPath))
+				return 1;
+		}
+		if (separator == NULL)
+			return 0;
+		path = separator + 1;
+	}
+}
+
+/**
+ * @brief Function that resolves a command name to the absolute path of its executable.
+ * Command names containing a '/' are not searched in PATH, nor remembered.
+ *
+ * @param commandName The command name to resolve
+ * @return The path of the executable (owned by the hash table) / NULL: Command not found
+ */
+const char *resolveCommand(const char *commandName) {
+	if ((commandName == NULL) || (commandName[0] == '\0'))
+		return NULL;
+	if (strchr(commandName, '/') != NULL) {
+		if (isExecutableFile(commandName))
+			return commandName;
+		return NULL;
+	}
+	struct commandHashEntry *entry = findCommandEntry(commandName);
+	if (entry == NULL) {
+		char commandPath[MAX_COMMAND_PATH_LENGTH];
+		int found = searchPath(commandName, commandPath);
+		entry = storeCommand(commandName, found ? commandPath : NULL);
+		if (entry == NULL)
+			return NULL;
+	}
+	if (entry->path != NULL)
+		entry->hits++;
+	return entry->path;
+}
+
+/**
+ * @brief Function that stores a command path given by the user,
+ * which is used from now on without any PATH search.
+ *
+ * @param commandName The command name
+ * @param commandPath The executable path to use for the command
+ * @return 0: OK / -1: Error
+ */
+int pinCommand(const char *commandName, const char *commandPath) {
+	if (storeCommand(commandName, commandPath) == NULL)
+		return -1;
+	return 0;
+}
+
+/**
+ * @brief Function that forgets a single remembered command.
+ *
+ * @param commandName The command name
+ * @return 0: OK / -1: The command was not remembered
+ */
+int forgetCommand(const char *commandName) {
+	if (commandHashBuckets == NULL)
+		return -1;
+	struct commandHashEntry **link = &commandHashBuckets[commandNameHash(
+			commandName) % commandHashSize];
+	while ((*link) != NULL) {
+		struct commandHashEntry *entry = (*link);
+		if (strcmp(entry->name, commandName) == 0) {
+			(*link) = entry->next;
+			free(entry->name);
+			free(entry->path);
+			free(entry);
+			commandHashEntries--;
+			return 0;
+		}
+		link = &entry->next;
+	}
+	return -1;
+}
+
+/**
+ * @brief Function that forgets every remembered command (positive and negative entries).
+ */
+void resetCommandHash() {
+	int i;
+	for (i = 0; i < commandHashSize; i++) {
+		struct commandHashEntry *entry = commandHashBuckets[i];
+		while (entry != NULL) {
+			struct commandHashEntry *next = entry->next;
+			free(entry->name);
+			free(entry->path);
+			free(entry);
+			entry = next;
+		}
+		commandHashBuckets[i] = NULL;
+	}
+	commandHashEntries = 0;
+}
+
+/**
+ * @brief Function to be notified about every variable assignment.
+ * Any change of PATH invalidates the remembered commands.
+ *
+ * @param assignment The assignment string (NAME=value)
+ */
+void commandHashVariableAssigned(const char *assignment) {
+	if (strncmp(assignment, "PATH=", 5) == 0)
+		resetCommandHash();
+}
+
+/**
+ * @brief Function that prints the remembered commands, as the hash built-in command does.
+ *
+ * @return Number of commands printed
+ */
+int printCommandHash() {
+	int printed = 0;
+	int i;
+	for (i = 0; i < commandHashSize; i++) {
+		struct commandHashEntry *entry = commandHashBuckets[i];
+		for (; entry != NULL; entry = entry->next) {
+			// Commands not found are not listed
+			if (entry->path == NULL)
+				continue;
+			if (printed == 0)
+				printf("hits\tcommand\n");
+			printf("%4d\t%s\n", entry->hits, entry->path);
+			printed++;
+		}
+	}
+	if (printed == 0)
+		printf("hash: hash table empty\n");
+	return printed;
+}
@@ -0,0 +1,70 @@
+/*  @file command_hash.h
+ *  @author Nicolas Poyiadjis
+ *
+ *  @brief Command path hash table header.
+ *  Remembers where every command name has been found in PATH (or that it has not been found),
+ *  so that a command is searched for only once until PATH changes.
+ */
+
+#ifndef COMMAND_HASH_H_
+#define COMMAND_HASH_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "variables.h"
+
+#define COMMAND_HASH_INITIAL_SIZE 64
+#define MAX_COMMAND_PATH_LENGTH 4096
+
+/**
+ * @brief Function that resolves a command name to the absolute path of its executable.
+ * Command names containing a '/' are not searched in PATH, nor remembered.
+ *
+ * @param commandName The command name to resolve
+ * @return The path of the executable (owned by the hash table) / NULL: Command not found
+ */
+const char *resolveCommand(const char *commandName);
+
+/**
+ * @brief Function that stores a command path given by the user,
+ * which is used from now on without any PATH search.
+ *
+ * @param commandName The command name
+ * @param commandPath The executable path to use for the command
+ * @return 0: OK / -1: Error
+ */
+int pinCommand(const char *commandName, const char *commandPath);
+
+/**
+ * @brief Function that forgets a single remembered command.
+ *
+ * @param commandName The command name
+ * @return 0: OK / -1: The command was not remembered
+ */
+int forgetCommand(const char *commandName);
+
+/**
+ * @brief Function that forgets every remembered command (positive and negative entries).
+ */
+void resetCommandHash();
+
+/**
+ * @brief Function to be notified about every variable assignment.
+ * Any change of PATH invalidates the remembered commands.
+ *
+ * @param assignment The assignment string (NAME=value)
+ */
+void commandHashVariableAssigned(const char *assignment);
+
+/**
+ * @brief Function that prints the remembered commands, as the hash built-in command does.
+ *
+ * @return Number of commands printed
+ */
+int printCommandHash();
+
+#endif /* COMMAND_HASH_H_ */
@@ -1,70 +1,64 @@
 /*  @file commands.c
  *  @author Nicolas Poyiadjis
  *
- *  @brief Command-parsing functions implementation
+ *  @brief Command-expansion functions implementation
  */
 
 #include "commands.h"
 
-/** @brief Function the takes the full command.
- * Command includes the executable name/path and [some arguments]
+/** @brief Function that expands a sequence of words, as written in the script.
+ * "$@" expands to every positional parameter, as a separate word.
  *
- * Fills in the arguments array of strings
+ * Fills in the expanded words array of strings (NULL-terminated).
  *
- * @param command The full command string
- * @param commandName Container to store the command name
- * @param arguments Container to store the command arguments
- * @return the number of arguments: OK / -1: Error
+ * @param arena The arena to allocate the expanded words from
+ * @param words The words as written
+ * @param wordsCount Number of words
+ * @param expandedWords Container to store the expanded words
+ * @return the number of expanded words: OK / -1: Error
  */
-int parseCommand(char *command, char **commandName, char ***arguments) {
-	// Count the command words
-	// Do not count the command name
-	int argumentsCount = -1;
-	char *commandCopy = (char*) malloc((strlen(command)+1)*sizeof(char));
-	if (commandCopy == NULL) {
-		perror("malloc error");
+int expandWords(struct arena *arena, char **words, int wordsCount,
+		char ***expandedWords) {
+	int expandedCount = 0;
+	int wordIndex;
+	for (wordIndex = 0; wordIndex < wordsCount; wordIndex++)
+		expandedCount +=
+				isAllParametersWord(words[wordIndex]) ?
+						positionalParameters.count : 1;
+	(*expandedWords) = (char**) arenaAllocate(arena,
+			(expandedCount + 1) * sizeof(char*));
+	if ((*expandedWords) == NULL)
 		return -1;
-	}
-	strcpy(commandCopy, command);
-	char *nextWord = strtok(commandCopy, " ");
-	while (nextWord != NULL) {
-		argumentsCount++;
-		nextWord = strtok(NULL, " ");
-	}
-	// Allocate space for the arguments array
-	(*arguments) = (char**) malloc(argumentsCount * sizeof(char*));
-	if ((*arguments) == NULL) {
-		perror("malloc error");
-		return -1;
-	}
-	// Parse the individual arguments
-	// Command name is the first word
-	strcpy(commandCopy, command);
-	nextWord = strtok(commandCopy, " ");
-	char *commandNameCopy = (char*) malloc((strlen(nextWord)+1)*sizeof(char));
-	if (commandNameCopy == NULL) {
-		perror("malloc error");
-		return -1;
-	}
-	strcpy(commandNameCopy, nextWord);
-	(*commandName) = commandNameCopy;
-	// Split the arguments
-	// Multiple spaces are ignored
-	int argIndex = 0;
-	nextWord = strtok(NULL, " ");
-	while (argIndex < argumentsCount) {
-		if (nextWord != NULL) {
-			char *argumentCopy = (char*) malloc((strlen(nextWord)+1)*sizeof(char));
-			if (argumentCopy == NULL) {
-				perror("malloc error");
-				return -1;
-			}
-			strcpy(argumentCopy, nextWord);
-			removeSpacesFromBeginning(&argumentCopy);
-			(*arguments)[argIndex] = argumentCopy;
-			argIndex++;
+	int expandedIndex = 0;
+	for (wordIndex = 0; wordIndex < wordsCount; wordIndex++) {
+		if (isAllParametersWord(words[wordIndex])) {
+			int i;
+			for (i = 0; i < positionalParameters.count; i++)
+				(*expandedWords)[expandedIndex++] = positionalParameters.values[i];
+			continue;
 		}
-		nextWord = strtok(NULL, " ");
+		char *expandedWord = expandWord(arena, words[wordIndex]);
+		if (expandedWord == NULL)
+			return -1;
+		(*expandedWords)[expandedIndex++] = expandedWord;
 	}
-	return argumentsCount;
+	(*expandedWords)[expandedCount] = NULL;
+	return expandedCount;
+}
+
+/** @brief Function the takes a parsed command and expands its words.
+ * Command words include the executable name/path and [some arguments]
+ *
+ * Fills in the command words array of strings (NULL-terminated),
+ * with the command name at index 0, followed by the arguments.
+ *
+ * @param arena The arena to allocate the command words from
+ * @param command The command syntax tree
+ * @param commandWords Container to store the command words
+ * @return the number of words: OK / -1: Error
+ */
+int expandCommand(struct arena *arena, struct commandNode *command,
+		char ***commandWords) {
+	return expandWords(arena, command->words, command->wordsCount,
+			commandWords);
 }
@@ -1,7 +1,7 @@
 /*  @file commands.h
  *  @author Nicolas Poyiadjis
  *
- *  @brief Command-parsing functions header
+ *  @brief Command-expansion functions header
  */
 
 #ifndef COMMANDS_H_
@@ -11,17 +11,35 @@
 #include <stdlib.h>
 #include <string.h>
 #include "string_processing.h"
+#include "parser.h"
+#include "expansion.h"
 
-/** @brief Function the takes the full command.
- * Command includes the executable name/path and [some arguments]
+/** @brief Function that expands a sequence of words, as written in the script.
+ * "$@" expands to every positional parameter, as a separate word.
  *
- * Fills in the arguments array of strings
+ * Fills in the expanded words array of strings (NULL-terminated).
  *
- * @param command The full command string
- * @param commandName Container to store the command name
- * @param arguments Container to store the command arguments
- * @return the number of arguments: OK / -1: Error
+ * @param arena The arena to allocate the expanded words from
+ * @param words The words as written
+ * @param wordsCount Number of words
+ * @param expandedWords Container to store the expanded words
+ * @return the number of expanded words: OK / -1: Error
  */
-int parseCommand(char *command, char **commandName, char ***arguments);
+int expandWords(struct arena *arena, char **words, int wordsCount,
+		char ***expandedWords);
+
+/** @brief Function the takes a parsed command and expands its words.
+ * Command words include the executable name/path and [some arguments]
+ *
+ * Fills in the command words array of strings (NULL-terminated),
+ * with the command name at index 0, followed by the arguments.
+ *
+ * @param arena The arena to allocate the command words from
+ * @param command The command syntax tree
+ * @param commandWords Container to store the command words
+ * @return the number of words: OK / -1: Error
+ */
+int expandCommand(struct arena *arena, struct commandNode *command,
+		char ***commandWords);
 
 #endif /* COMMANDS_H_ */
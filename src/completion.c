@@ -0,0 +1,733 @@
+/*  @file completion.c
+ *  @author Nicolas Poyiadjis
+ *
+ *  @brief Tab completion implementation
+ */
+
+// memrchr() is a GNU extension
+#define _GNU_SOURCE
+
+#include "completion.h"
+#include "bash_builtin_functions.h"
+
+// The command index, shared between the shell and the thread building it
+struct commandIndex commandIndex = { PTHREAD_MUTEX_INITIALIZER,
+		PTHREAD_COND_INITIALIZER };
+// The directory listings cached for file name completion
+struct directoryListing directoryCache[COMPLETION_DIRECTORY_CACHE_SIZE];
+unsigned long directoryCacheUses = 0;
+unsigned long directoryCacheHits = 0;
+unsigned long directoryCacheLoads = 0;
+
+// Characters escaped (using \) when inserted by the completion
+const char *completionEscapedCharacters = " \t\\'\"|&;<>()$`!*?[]{}#";
+// Keywords followed by a command
+const char *completionCommandKeywords[] = { "if", "then", "else", "elif",
+		"do", "while", "until", "!", "time", NULL };
+
+/**
+ * @brief Function that adds a node to the command trie.
+ *
+ * @param trie
+ * @param character The node character
+ * @return The node index / 0: Error
+ */
+uint32_t addTrieNode(struct commandTrie *trie, unsigned char character) {
+	if (trie->nodesCount == trie->nodesCapacity) {
+		size_t capacity = (trie->nodesCapacity == 0) ? 1024 : (trie->nodesCapacity * 2);
+		struct trieNode *nodes = (struct trieNode*) realloc(trie->nodes,
+				capacity * sizeof(struct trieNode));
+		if (nodes == NULL)
+			return 0;
+		trie->nodes = nodes;
+		trie->nodesCapacity = capacity;
+	}
+	struct trieNode *node = &trie->nodes[trie->nodesCount];
+	memset(node, 0, sizeof(struct trieNode));
+	node->character = character;
+	return trie->nodesCount++;
+}
+
+/**
+ * @brief Function that inserts a command name in the trie (once).
+ *
+ * @param trie
+ * @param name The command name
+ * @return 0: OK / -1: Error
+ */
+int insertTrieName(struct commandTrie *trie, const char *name) {
+	size_t length = strlen(name);
+	if ((length == 0) || (length >= COMPLETION_MAX_NAME_LENGTH))
+		return 0;
+	uint32_t visited[length + 1];
+	uint32_t node = 0;
+	size_t i;
+	for (i = 0; i < length; i++) {
+		visited[i] = node;
+		unsigned char character = name[i];
+		// Children are kept sorted by character
+		uint32_t previous = 0;
+		uint32_t child = trie->nodes[node].firstChild;
+		while ((child != 0) && (trie->nodes[child].character < character)) {
+			previous = child;
+			child = trie->nodes[child].nextSibling;
+		}
+		if ((child == 0) || (trie->nodes[child].character != character)) {
+			uint32_t added = addTrieNode(trie, character);
+			if (added == 0)
+				return -1;
+			trie->nodes[added].nextSibling = child;
+			if (previous == 0)
+				trie->nodes[node].firstChild = added;
+			else
+				trie->nodes[previous].nextSibling = added;
+			child = added;
+		}
+		node = child;
+	}
+	visited[length] = node;
+	if (trie->nodes[node].terminal)
+		return 0;
+	trie->nodes[node].terminal = 1;
+	for (i = 0; i <= length; i++)
+		trie->nodes[visited[i]].count++;
+	return 0;
+}
+
+/**
+ * @brief Function that finds the trie node of a command name prefix.
+ *
+ * @param trie
+ * @param prefix
+ * @param length The prefix length
+ * @param node Filled in with the node index
+ * @return 1: Found / 0: No command begins with the prefix
+ */
+int findTrieNode(struct commandTrie *trie, const char *prefix, size_t length,
+		uint32_t *node) {
+	uint32_t current = 0;
+	size_t i;
+	for (i = 0; i < length; i++) {
+		uint32_t child = trie->nodes[current].firstChild;
+		while ((child != 0)
+				&& (trie->nodes[child].character != (unsigned char) prefix[i]))
+			child = trie->nodes[child].nextSibling;
+		if (child == 0)
+			return 0;
+		current = child;
+	}
+	(*node) = current;
+	return 1;
+}
+
+/**
+ * @brief Function that releases a command trie.
+ *
+ * @param trie
+ */
+void releaseCommandTrie(struct commandTrie *trie) {
+	if (trie == NULL)
+		return;
+	free(trie->nodes);
+	free(trie);
+}
+
+/**
+ * @brief Function that releases the directory stamps of the command index.
+ *
+ * @param stamps
+ * @param count Number of stamps
+ */
+void releaseDirectoryStamps(struct directoryStamp *stamps, size_t count) {
+	size_t i;
+	for (i = 0; i < count; i++)
+		free(stamps[i].path);
+	free(stamps);
+}
+
+/**
+ * @brief Function that takes the modification time of a directory.
+ *
+ * @param stamp The stamp to fill in (its path given)
+ */
+void stampDirectory(struct directoryStamp *stamp) {
+	struct stat status;
+	stamp->exists = (stat(stamp->path, &status) == 0) && S_ISDIR(status.st_mode);
+	if (stamp->exists)
+		stamp->modified = status.st_mtim;
+	else
+		memset(&stamp->modified, 0, sizeof(stamp->modified));
+}
+
+/**
+ * @brief Function that adds the executables of a directory to the command trie.
+ *
+ * @param trie
+ * @param path The directory path
+ * @return 0: OK / -1: Error
+ */
+int addDirectoryCommands(struct commandTrie *trie, const char *path) {
+	DIR *directory = opendir(path);
+	if (directory == NULL)
+		return 0;
+	int fd = dirfd(directory);
+	struct dirent *entry;
+	int result = 0;
+	while ((result == 0) && ((entry = readdir(directory)) != NULL)) {
+		if (entry->d_name[0] == '.')
+			continue;
+		if (entry->d_type == DT_DIR)
+			continue;
+		if ((entry->d_type != DT_REG)) {
+			// Symbolic links (or unknown types) are followed
+			struct stat status;
+			if ((fstatat(fd, entry->d_name, &status, 0) == -1)
+					|| !S_ISREG(status.st_mode))
+				continue;
+		}
+		if (faccessat(fd, entry->d_name, X_OK, 0) == 0)
+			result = insertTrieName(trie, entry->d_name);
+	}
+	closedir(directory);
+	return result;
+}
+
+/**
+ * @brief Function (the body of the building thread) that builds the command trie
+ * from a PATH value, and publishes it in the command index.
+ *
+ * @param argument The PATH value (allocated, owned by the thread)
+ * @return NULL
+ */
+void *buildCommandIndex(void *argument) {
+	char *path = (char*) argument;
+	struct commandTrie *trie = (struct commandTrie*) calloc(1,
+			sizeof(struct commandTrie));
+	size_t stampsCount = 1;
+	const char *position;
+	for (position = path; *position != '\0'; position++)
+		if (*position == ':')
+			stampsCount++;
+	struct directoryStamp *stamps = (struct directoryStamp*) calloc(stampsCount,
+			sizeof(struct directoryStamp));
+	int result = -1;
+	// The root node comes first
+	if ((trie != NULL) && (stamps != NULL)) {
+		addTrieNode(trie, '\0');
+		if (trie->nodesCount == 1)
+			result = 0;
+	}
+	// Every PATH directory is stamped before being read,
+	// so that any later change causes another build
+	const char *start = path;
+	size_t i;
+	for (i = 0; (i < stampsCount) && (result == 0); i++) {
+		const char *end = strchr(start, ':');
+		size_t length = (end != NULL) ? (size_t) (end - start) : strlen(start);
+		// An empty PATH component means the current directory
+		stamps[i].path = (length == 0) ? strdup(".") : strndup(start, length);
+		if (stamps[i].path == NULL) {
+			result = -1;
+			break;
+		}
+		stampDirectory(&stamps[i]);
+		if (stamps[i].exists)
+			result = addDirectoryCommands(trie, stamps[i].path);
+		start = (end != NULL) ? (end + 1) : (start + length);
+	}
+	for (i = 0; (bashBuiltinNames[i] != NULL) && (result == 0); i++)
+		result = insertTrieName(trie, bashBuiltinNames[i]);
+	pthread_mutex_lock(&commandIndex.lock);
+	if (result == 0) {
+		releaseCommandTrie(commandIndex.trie);
+		releaseDirectoryStamps(commandIndex.stamps, commandIndex.stampsCount);
+		free(commandIndex.path);
+		commandIndex.trie = trie;
+		commandIndex.stamps = stamps;
+		commandIndex.stampsCount = stampsCount;
+		commandIndex.path = path;
+		commandIndex.builds++;
+	}
+	commandIndex.building = 0;
+	pthread_cond_broadcast(&commandIndex.built);
+	pthread_mutex_unlock(&commandIndex.lock);
+	if (result == -1) {
+		releaseCommandTrie(trie);
+		if (stamps != NULL)
+			releaseDirectoryStamps(stamps, stampsCount);
+		free(path);
+	}
+	return NULL;
+}
+
+/**
+ * @brief Function that checks whether the command index is up to date with PATH,
+ * and starts rebuilding it in the background otherwise.
+ */
+void refreshCommandIndex() {
+	const char *path = getVariable("PATH");
+	if (path == NULL)
+		path = "";
+	pthread_mutex_lock(&commandIndex.lock);
+	if (commandIndex.building) {
+		pthread_mutex_unlock(&commandIndex.lock);
+		return;
+	}
+	int stale = (commandIndex.path == NULL) || (strcmp(path, commandIndex.path) != 0);
+	size_t i;
+	for (i = 0; (i < commandIndex.stampsCount) && !stale; i++) {
+		struct directoryStamp current = commandIndex.stamps[i];
+		stampDirectory(&current);
+		stale = (current.exists != commandIndex.stamps[i].exists)
+				|| (current.modified.tv_sec != commandIndex.stamps[i].modified.tv_sec)
+				|| (current.modified.tv_nsec
+						!= commandIndex.stamps[i].modified.tv_nsec);
+	}
+	if (stale) {
+		char *copy = strdup(path);
+		pthread_t thread;
+		if ((copy != NULL)
+				&& (pthread_create(&thread, NULL, buildCommandIndex, copy) == 0)) {
+			pthread_detach(thread);
+			commandIndex.building = 1;
+		} else {
+			free(copy);
+		}
+	}
+	pthread_mutex_unlock(&commandIndex.lock);
+}
+
+/**
+ * @brief Function that adds a candidate to the completion result (up to the listing limit).
+ *
+ * @param completion
+ * @param name The candidate name
+ * @param length The name length
+ * @param suffix Character appended to the listed name / '\0': None
+ * @return 0: OK / -1: Error
+ */
+int addCompletionCandidate(struct completion *completion, const char *name,
+		size_t length, char suffix) {
+	if (completion->candidatesCount >= COMPLETION_MAX_LISTED)
+		return 0;
+	if (completion->candidates == NULL) {
+		completion->candidates = (char**) malloc(
+				COMPLETION_MAX_LISTED * sizeof(char*));
+		if (completion->candidates == NULL) {
+			perror("malloc error");
+			return -1;
+		}
+	}
+	char *candidate = (char*) malloc(length + 2);
+	if (candidate == NULL) {
+		perror("malloc error");
+		return -1;
+	}
+	memcpy(candidate, name, length);
+	candidate[length] = suffix;
+	candidate[length + ((suffix != '\0') ? 1 : 0)] = '\0';
+	completion->candidates[completion->candidatesCount++] = candidate;
+	return 0;
+}
+
+/**
+ * @brief Function that lists the command names under a trie node, in order.
+ *
+ * @param trie
+ * @param node The trie node
+ * @param name The name of the node (filled in while descending)
+ * @param length The name length
+ * @param completion The completion result
+ */
+void collectTrieNames(struct commandTrie *trie, uint32_t node, char *name,
+		size_t length, struct completion *completion) {
+	if (trie->nodes[node].terminal)
+		addCompletionCandidate(completion, name, length, '\0');
+	uint32_t child;
+	for (child = trie->nodes[node].firstChild;
+			(child != 0) && (completion->candidatesCount < COMPLETION_MAX_LISTED);
+			child = trie->nodes[child].nextSibling) {
+		name[length] = trie->nodes[child].character;
+		collectTrieNames(trie, child, name, length + 1, completion);
+	}
+}
+
+/**
+ * @brief Function that makes the insertion of a completion, escaping the special characters.
+ *
+ * @param completion
+ * @param text The text completed
+ * @param length The text length
+ * @param suffix Character appended (not escaped) / '\0': None
+ * @return 0: OK / -1: Error
+ */
+int setCompletionInsertion(struct completion *completion, const char *text,
+		size_t length, char suffix) {
+	char *insertion = (char*) malloc(2 * length + 2);
+	if (insertion == NULL) {
+		perror("malloc error");
+		return -1;
+	}
+	size_t used = 0;
+	size_t i;
+	for (i = 0; i < length; i++) {
+		if (strchr(completionEscapedCharacters, text[i]) != NULL)
+			insertion[used++] = '\\';
+		insertion[used++] = text[i];
+	}
+	if (suffix != '\0')
+		insertion[used++] = suffix;
+	insertion[used] = '\0';
+	completion->insertion = insertion;
+	return 0;
+}
+
+/**
+ * @brief Function that completes a command name.
+ *
+ * @param word The name prefix (unescaped)
+ * @param length The prefix length
+ * @param completion The completion result
+ * @return 0: OK / -1: Error
+ */
+int completeCommand(const char *word, size_t length,
+		struct completion *completion) {
+	refreshCommandIndex();
+	char name[COMPLETION_MAX_NAME_LENGTH];
+	if (length >= COMPLETION_MAX_NAME_LENGTH)
+		return 0;
+	memcpy(name, word, length);
+	size_t nameLength = length;
+	pthread_mutex_lock(&commandIndex.lock);
+	// Before the first trie is built, the completion waits for it
+	while ((commandIndex.trie == NULL) && commandIndex.building)
+		pthread_cond_wait(&commandIndex.built, &commandIndex.lock);
+	struct commandTrie *trie = commandIndex.trie;
+	uint32_t node;
+	if ((trie != NULL) && findTrieNode(trie, word, length, &node)) {
+		completion->count = trie->nodes[node].count;
+		// The names share the characters below the node, up to the first branch
+		while (!trie->nodes[node].terminal && (trie->nodes[node].firstChild != 0)
+				&& (trie->nodes[trie->nodes[node].firstChild].nextSibling == 0)
+				&& (nameLength + 1 < COMPLETION_MAX_NAME_LENGTH)) {
+			node = trie->nodes[node].firstChild;
+			name[nameLength++] = trie->nodes[node].character;
+		}
+		completion->unique = (completion->count == 1);
+		if (completion->count > 1)
+			collectTrieNames(trie, node, name, nameLength, completion);
+	}
+	pthread_mutex_unlock(&commandIndex.lock);
+	if (completion->count == 0)
+		return 0;
+	return setCompletionInsertion(completion, name + length, nameLength - length,
+			completion->unique ? ' ' : '\0');
+}
+
+/**
+ * @brief Function that releases a cached directory listing.
+ *
+ * @param listing
+ */
+void releaseDirectoryListing(struct directoryListing *listing) {
+	free(listing->path);
+	free(listing->names);
+	free(listing->directories);
+	free(listing->storage);
+	memset(listing, 0, sizeof(struct directoryListing));
+}
+
+/**
+ * @brief Function that compares two names (for sorting).
+ */
+int compareListingNames(const void *first, const void *second) {
+	return strcmp(*(char**) first, *(char**) second);
+}
+
+/**
+ * @brief Function that reads a directory into a listing, sorted by name.
+ * Every name is stored after a character telling whether it is a directory.
+ *
+ * @param listing The listing (empty)
+ * @param path The directory path
+ * @param status The directory status
+ * @return 0: OK / -1: Error
+ */
+int loadDirectoryListing(struct directoryListing *listing, const char *path,
+		struct stat *status) {
+	DIR *directory = opendir(path);
+	if (directory == NULL)
+		return -1;
+	int fd = dirfd(directory);
+	size_t used = 0;
+	size_t capacity = 4096;
+	size_t count = 0;
+	char *storage = (char*) malloc(capacity);
+	struct dirent *entry;
+	while ((storage != NULL) && ((entry = readdir(directory)) != NULL)) {
+		if ((strcmp(entry->d_name, ".") == 0) || (strcmp(entry->d_name, "..") == 0))
+			continue;
+		size_t length = strlen(entry->d_name);
+		if (used + length + 2 > capacity) {
+			capacity = 2 * (used + length + 2);
+			char *grown = (char*) realloc(storage, capacity);
+			if (grown == NULL) {
+				free(storage);
+				storage = NULL;
+				break;
+			}
+			storage = grown;
+		}
+		int isDirectory = (entry->d_type == DT_DIR);
+		if ((entry->d_type == DT_LNK) || (entry->d_type == DT_UNKNOWN)) {
+			struct stat entryStatus;
+			isDirectory = (fstatat(fd, entry->d_name, &entryStatus, 0) == 0)
+					&& S_ISDIR(entryStatus.st_mode);
+		}
+		storage[used] = isDirectory ? 'd' : 'f';
+		memcpy(storage + used + 1, entry->d_name, length + 1);
+		used += length + 2;
+		count++;
+	}
+	closedir(directory);
+	listing->names = (char**) malloc((count + 1) * sizeof(char*));
+	listing->directories = (unsigned char*) malloc(count + 1);
+	listing->path = strdup(path);
+	if ((storage == NULL) || (listing->names == NULL)
+			|| (listing->directories == NULL) || (listing->path == NULL)) {
+		perror("malloc error");
+		free(storage);
+		releaseDirectoryListing(listing);
+		return -1;
+	}
+	size_t offset = 0;
+	size_t i;
+	for (i = 0; i < count; i++) {
+		listing->names[i] = storage + offset + 1;
+		offset += strlen(storage + offset + 1) + 2;
+	}
+	qsort(listing->names, count, sizeof(char*), compareListingNames);
+	for (i = 0; i < count; i++)
+		listing->directories[i] = (listing->names[i][-1] == 'd');
+	listing->storage = storage;
+	listing->count = count;
+	listing->device = status->st_dev;
+	listing->inode = status->st_ino;
+	listing->modified = status->st_mtim;
+	directoryCacheLoads++;
+	return 0;
+}
+
+/**
+ * @brief Function that returns the listing of a directory,
+ * read again only if the directory has changed since it was cached.
+ *
+ * @param path The directory path
+ * @return The listing / NULL: Not a readable directory
+ */
+struct directoryListing *getDirectoryListing(const char *path) {
+	struct stat status;
+	if ((stat(path, &status) == -1) || !S_ISDIR(status.st_mode))
+		return NULL;
+	struct directoryListing *victim = &directoryCache[0];
+	int i;
+	for (i = 0; i < COMPLETION_DIRECTORY_CACHE_SIZE; i++) {
+		struct directoryListing *listing = &directoryCache[i];
+		if ((listing->path != NULL) && (strcmp(listing->path, path) == 0)) {
+			victim = listing;
+			if ((listing->device == status.st_dev)
+					&& (listing->inode == status.st_ino)
+					&& (listing->modified.tv_sec == status.st_mtim.tv_sec)
+					&& (listing->modified.tv_nsec == status.st_mtim.tv_nsec)) {
+				listing->lastUse = ++directoryCacheUses;
+				directoryCacheHits++;
+				return listing;
+			}
+			break;
+		}
+		// The least recently used listing is replaced
+		if (listing->lastUse < victim->lastUse)
+			victim = listing;
+	}
+	releaseDirectoryListing(victim);
+	if (loadDirectoryListing(victim, path, &status) == -1)
+		return NULL;
+	victim->lastUse = ++directoryCacheUses;
+	return victim;
+}
+
+/**
+ * @brief Function that completes a file name.
+ *
+ * @param word The file name prefix (unescaped)
+ * @param length The prefix length
+ * @param completion The completion result
+ * @return 0: OK / -1: Error
+ */
+int completeFileName(const char *word, size_t length,
+		struct completion *completion) {
+	// The directory part of the word (up to its last /), and the name prefix
+	const char *slash = memrchr(word, '/', length);
+	size_t directoryLength = (slash != NULL) ? (size_t) (slash - word + 1) : 0;
+	const char *prefix = word + directoryLength;
+	size_t prefixLength = length - directoryLength;
+	char path[COMPLETION_MAX_NAME_LENGTH];
+	const char *home = getVariable("HOME");
+	if (directoryLength == 0) {
+		strcpy(path, ".");
+	} else if ((word[0] == '~') && (directoryLength >= 2) && (word[1] == '/')
+			&& (home != NULL)) {
+		if (snprintf(path, sizeof(path), "%s%.*s", home,
+				(int) (directoryLength - 1), word + 1) >= (int) sizeof(path))
+			return 0;
+	} else {
+		if (directoryLength >= sizeof(path))
+			return 0;
+		memcpy(path, word, directoryLength);
+		path[directoryLength] = '\0';
+	}
+	struct directoryListing *listing = getDirectoryListing(path);
+	if (listing == NULL)
+		return 0;
+	// The names beginning with the prefix are found by binary search
+	size_t low = 0;
+	size_t high = listing->count;
+	while (low < high) {
+		size_t middle = (low + high) / 2;
+		if (strncmp(listing->names[middle], prefix, prefixLength) < 0)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	// Hidden files are completed only if asked for
+	int hidden = (prefixLength > 0) && (prefix[0] == '.');
+	const char *first = NULL;
+	size_t common = 0;
+	int firstDirectory = 0;
+	size_t i;
+	for (i = low; (i < listing->count)
+			&& (strncmp(listing->names[i], prefix, prefixLength) == 0); i++) {
+		const char *name = listing->names[i];
+		if ((name[0] == '.') && !hidden)
+			continue;
+		if (first == NULL) {
+			first = name;
+			common = strlen(name);
+			firstDirectory = listing->directories[i];
+		} else {
+			size_t shared = prefixLength;
+			while ((shared < common) && (name[shared] == first[shared]))
+				shared++;
+			common = shared;
+		}
+		completion->count++;
+		if (addCompletionCandidate(completion, name, strlen(name),
+				listing->directories[i] ? '/' : '\0') == -1)
+			return -1;
+	}
+	if (first == NULL)
+		return 0;
+	completion->unique = (completion->count == 1);
+	char suffix = '\0';
+	if (completion->unique)
+		suffix = firstDirectory ? '/' : ' ';
+	return setCompletionInsertion(completion, first + prefixLength,
+			common - prefixLength, suffix);
+}
+
+/**
+ * @brief Function that checks whether a character ends a word of the line being completed.
+ *
+ * @param character
+ * @return 1: true / 0: false
+ */
+int isCompletionDelimiter(char character) {
+	return (strchr(" \t;|&<>()", character) != NULL) && (character != '\0');
+}
+
+/**
+ * @brief Function that checks whether the word at a position of a line is in command position.
+ *
+ * @param line The line
+ * @param wordStart The word position
+ * @return 1: true / 0: false
+ */
+int isCommandPosition(const char *line, size_t wordStart) {
+	size_t end = wordStart;
+	while ((end > 0) && ((line[end - 1] == ' ') || (line[end - 1] == '\t')))
+		end--;
+	if ((end == 0) || (strchr(";|&(", line[end - 1]) != NULL))
+		return 1;
+	// The previous word may be a keyword followed by a command
+	size_t start = end;
+	while ((start > 0) && !isCompletionDelimiter(line[start - 1]))
+		start--;
+	int i;
+	for (i = 0; completionCommandKeywords[i] != NULL; i++)
+		if ((strlen(completionCommandKeywords[i]) == end - start)
+				&& (strncmp(completionCommandKeywords[i], line + start, end - start)
+						== 0))
+			return isCommandPosition(line, start);
+	return 0;
+}
+
+/**
+ * @brief Function that completes the word before the cursor of a line.
+ * Words in command position are completed as command names, the rest as file names.
+ *
+ * @param line The line
+ * @param cursor The cursor position
+ * @param completion Filled in with the result (released by releaseCompletion)
+ * @return 0: OK / -1: Error
+ */
+int completeLine(const char *line, size_t cursor, struct completion *completion) {
+	memset(completion, 0, sizeof(struct completion));
+	size_t start = cursor;
+	while ((start > 0) && !(isCompletionDelimiter(line[start - 1])
+			&& !((start >= 2) && (line[start - 2] == '\\'))))
+		start--;
+	completion->wordStart = start;
+	// The word is unescaped (quotes and backslashes removed)
+	char word[COMPLETION_MAX_NAME_LENGTH];
+	size_t length = 0;
+	size_t i;
+	for (i = start; (i < cursor) && (length + 1 < sizeof(word)); i++) {
+		if ((line[i] == '\'') || (line[i] == '"'))
+			continue;
+		if ((line[i] == '\\') && (i + 1 < cursor))
+			i++;
+		word[length++] = line[i];
+	}
+	word[length] = '\0';
+	if (isCommandPosition(line, start) && (memchr(word, '/', length) == NULL))
+		return completeCommand(word, length, completion);
+	return completeFileName(word, length, completion);
+}
+
+/**
+ * @brief Function that releases the result of a completion.
+ *
+ * @param completion
+ */
+void releaseCompletion(struct completion *completion) {
+	size_t i;
+	for (i = 0; i < completion->candidatesCount; i++)
+		free(completion->candidates[i]);
+	free(completion->candidates);
+	free(completion->insertion);
+	memset(completion, 0, sizeof(struct completion));
+}
+
+/**
+ * @brief Function that prints the completion statistics (command trie and directory cache).
+ */
+void printCompletionStatistics() {
+	pthread_mutex_lock(&commandIndex.lock);
+	size_t commands = (commandIndex.trie != NULL) ? commandIndex.trie->nodes[0].count : 0;
+	size_t nodes = (commandIndex.trie != NULL) ? commandIndex.trie->nodesCount : 0;
+	unsigned long builds = commandIndex.builds;
+	pthread_mutex_unlock(&commandIndex.lock);
+	printf("completion: %zu commands (%zu trie nodes, %lu builds), "
+			"directory cache %lu hits, %lu loads\n", commands, nodes, builds,
+			directoryCacheHits, directoryCacheLoads);
+}
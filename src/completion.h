@@ -0,0 +1,137 @@
+/*  @file completion.h
+ *  @author Nicolas Poyiadjis
+ *
+ *  @brief Tab completion header.
+ *  Command names are completed from a trie of the executables found in PATH (and the built-in names).
+ *  The trie is built in a background thread, and rebuilt whenever PATH or the modification time
+ *  of any PATH directory changes, while completion keeps using the previous trie meanwhile.
+ *  File names are completed from sorted directory listings, cached until the directory changes.
+ */
+
+#ifndef COMPLETION_H_
+#define COMPLETION_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "variables.h"
+
+// Directory listings cached for file name completion
+#define COMPLETION_DIRECTORY_CACHE_SIZE 16
+// Maximum number of candidates listed
+#define COMPLETION_MAX_LISTED 200
+#define COMPLETION_MAX_NAME_LENGTH 4096
+
+/**
+ * @brief A node of the command trie: one character of a command name.
+ * The children of a node are linked in a list, sorted by character.
+ */
+struct trieNode {
+	unsigned char character;
+	unsigned char terminal;
+	uint32_t firstChild;
+	uint32_t nextSibling;
+	// Number of command names ending at or under this node
+	uint32_t count;
+};
+
+/**
+ * @brief The trie of the command names (node 0 is the root).
+ */
+struct commandTrie {
+	struct trieNode *nodes;
+	size_t nodesCount;
+	size_t nodesCapacity;
+};
+
+/**
+ * @brief The modification time of a PATH directory, when the trie was built.
+ */
+struct directoryStamp {
+	char *path;
+	struct timespec modified;
+	int exists;
+};
+
+/**
+ * @brief The command index: the latest trie built, shared with the building thread.
+ */
+struct commandIndex {
+	pthread_mutex_t lock;
+	pthread_cond_t built;
+	struct commandTrie *trie;
+	// PATH and the directory stamps the trie was built from
+	char *path;
+	struct directoryStamp *stamps;
+	size_t stampsCount;
+	int building;
+	unsigned long builds;
+};
+
+/**
+ * @brief A cached directory listing: the entry names, sorted.
+ */
+struct directoryListing {
+	char *path;
+	dev_t device;
+	ino_t inode;
+	struct timespec modified;
+	char **names;
+	unsigned char *directories;
+	size_t count;
+	char *storage;
+	unsigned long lastUse;
+};
+
+/**
+ * @brief The result of a completion.
+ */
+struct completion {
+	// Start of the completed word in the line
+	size_t wordStart;
+	// Text to insert at the cursor (allocated, escaped), and whether it completes a single candidate
+	char *insertion;
+	int unique;
+	// Number of candidates, and the candidates listed (allocated), in order
+	size_t count;
+	char **candidates;
+	size_t candidatesCount;
+};
+
+/**
+ * @brief Function that checks whether the command index is up to date with PATH,
+ * and starts rebuilding it in the background otherwise.
+ */
+void refreshCommandIndex();
+
+/**
+ * @brief Function that completes the word before the cursor of a line.
+ * Words in command position are completed as command names, the rest as file names.
+ *
+ * @param line The line
+ * @param cursor The cursor position
+ * @param completion Filled in with the result (released by releaseCompletion)
+ * @return 0: OK / -1: Error
+ */
+int completeLine(const char *line, size_t cursor, struct completion *completion);
+
+/**
+ * @brief Function that releases the result of a completion.
+ *
+ * @param completion
+ */
+void releaseCompletion(struct completion *completion);
+
+/**
+ * @brief Function that prints the completion statistics (command trie and directory cache).
+ */
+void printCompletionStatistics();
+
+#endif /* COMPLETION_H_ */
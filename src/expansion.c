@@ -0,0 +1,432 @@
+/*  @file expansion.c
+ *  @author Nicolas Poyiadjis
+ *
+ *  @brief Word expansion functions implementation.
+ *  Words are kept in the syntax tree as written, and expanded whenever a command is executed.
+ */
+
+#include "expansion.h"
+#include "processes.h"
+
+// Positional parameters of the shell (or of the script being executed)
+struct positionalParameters positionalParameters = { NULL, NULL, 0 };
+
+/**
+ * @brief Function that releases the positional parameters.
+ *
+ * @param parameters The positional parameters
+ */
+void freePositionalParameters(struct positionalParameters *parameters) {
+	int i;
+	for (i = 0; i < parameters->count; i++)
+		free(parameters->values[i]);
+	free(parameters->values);
+	free(parameters->name);
+	parameters->name = NULL;
+	parameters->values = NULL;
+	parameters->count = 0;
+}
+
+/**
+ * @brief Function that sets the positional parameters, replacing the current ones.
+ * The strings given are copied.
+ *
+ * @param name The shell or script name ($0), NULL to keep the current one
+ * @param values The parameters ($1, $2, ...)
+ * @param count Number of parameters
+ * @return 0: OK / -1: Error
+ */
+int setPositionalParameters(const char *name, char **values, int count) {
+	char *nameCopy = NULL;
+	if ((name != NULL) || (positionalParameters.name != NULL)) {
+		nameCopy = strdup((name != NULL) ? name : positionalParameters.name);
+		if (nameCopy == NULL) {
+			perror("malloc error");
+			return -1;
+		}
+	}
+	char **valuesCopy = (char**) malloc((count + 1) * sizeof(char*));
+	if (valuesCopy == NULL) {
+		perror("malloc error");
+		free(nameCopy);
+		return -1;
+	}
+	int i;
+	for (i = 0; i < count; i++) {
+		valuesCopy[i] = strdup(values[i]);
+		if (valuesCopy[i] == NULL) {
+			perror("malloc error");
+			while (i > 0)
+				free(valuesCopy[--i]);
+			free(valuesCopy);
+			free(nameCopy);
+			return -1;
+		}
+	}
+	valuesCopy[count] = NULL;
+	freePositionalParameters(&positionalParameters);
+	positionalParameters.name = nameCopy;
+	positionalParameters.values = valuesCopy;
+	positionalParameters.count = count;
+	return 0;
+}
+
+/**
+ * @brief A word being expanded, grown within an arena.
+ */
+struct expandedText {
+	struct arena *arena;
+	char *text;
+	size_t length;
+	size_t capacity;
+};
+
+/**
+ * @brief Function that appends some text to a word being expanded.
+ *
+ * @param expanded The word being expanded
+ * @param text The text to append
+ * @param length The text length
+ * @return 0: OK / -1: Error
+ */
+int appendText(struct expandedText *expanded, const char *text, size_t length) {
+	if (expanded->length + length + 1 > expanded->capacity) {
+		size_t newCapacity = expanded->capacity * 2;
+		while (expanded->length + length + 1 > newCapacity)
+			newCapacity *= 2;
+		char *newText = (char*) arenaResize(expanded->arena, expanded->text,
+				expanded->capacity, newCapacity);
+		if (newText == NULL)
+			return -1;
+		expanded->text = newText;
+		expanded->capacity = newCapacity;
+	}
+	memcpy(expanded->text + expanded->length, text, length);
+	expanded->length += length;
+	expanded->text[expanded->length] = '\0';
+	return 0;
+}
+
+/**
+ * @brief Function that appends every positional parameter to a word being expanded ($@, $*).
+ *
+ * @param expanded The word being expanded
+ * @return 0: OK / -1: Error
+ */
+int appendAllParameters(struct expandedText *expanded) {
+	int i;
+	for (i = 0; i < positionalParameters.count; i++) {
+		if ((i > 0) && (appendText(expanded, " ", 1) == -1))
+			return -1;
+		if (appendText(expanded, positionalParameters.values[i],
+				strlen(positionalParameters.values[i])) == -1)
+			return -1;
+	}
+	return 0;
+}
+
+/**
+ * @brief Function that finds the value of a parameter, given by its name.
+ * Special parameters (?, $, #, !, 0) are formatted in the given space.
+ *
+ * @param name The parameter name
+ * @param length The name length
+ * @param number Space to format numerical special parameters in
+ * @return The parameter value / NULL: The parameter is not set
+ */
+const char *parameterValue(const char *name, size_t length, char number[32]) {
+	if (length == 1) {
+		switch (name[0]) {
+		case '?':
+			snprintf(number, 32, "%d", lastExitStatus);
+			return number;
+		case '$':
+			snprintf(number, 32, "%d", (int) getpid());
+			return number;
+		case '#':
+			snprintf(number, 32, "%d", positionalParameters.count);
+			return number;
+		case '!':
+			if (lastBackgroundPid == 0)
+				return NULL;
+			snprintf(number, 32, "%d", (int) lastBackgroundPid);
+			return number;
+		case '0':
+			return (positionalParameters.name != NULL) ?
+					positionalParameters.name : SHELL_NAME;
+		}
+	}
+	// Positional parameters ($1, ${10}, ...)
+	if (isdigit((unsigned char) name[0])) {
+		int position = 0;
+		size_t i;
+		for (i = 0; i < length; i++) {
+			if (!isdigit((unsigned char) name[i]))
+				return NULL;
+			position = position * 10 + (name[i] - '0');
+			if (position > positionalParameters.count)
+				return NULL;
+		}
+		return (position == 0) ?
+				parameterValue(name, 1, number) :
+				positionalParameters.values[position - 1];
+	}
+	// Variables
+	return getVariableText(name, length);
+}
+
+/**
+ * @brief Function that measures the name of a variable (letters, digits and underscores).
+ *
+ * @param text The text beginning with the name
+ * @return The name length (0: Not a name)
+ */
+size_t variableNameLength(const char *text) {
+	if (!isalpha((unsigned char) text[0]) && (text[0] != '_'))
+		return 0;
+	size_t length = 1;
+	while (isalnum((unsigned char) text[length]) || (text[length] == '_'))
+		length++;
+	return length;
+}
+
+/**
+ * @brief Function that expands a parameter in braces: ${NAME}, ${#NAME}, ${NAME:-word},
+ * ${NAME-word}, ${NAME:=word}, ${NAME=word}, ${NAME:+word} and ${NAME+word}.
+ *
+ * @param expanded The word being expanded
+ * @param position The position after the opening brace (moved after the closing one)
+ * @return 0: OK / -1: Error
+ */
+int expandBracedParameter(struct expandedText *expanded, const char **position) {
+	const char *text = *position;
+	const char *start = text;
+	const char *closing = text;
+	// Find the matching closing brace
+	int depth = 1;
+	while (*closing) {
+		if ((*closing == '\\') && (closing[1] != '\0'))
+			closing++;
+		else if (*closing == '{')
+			depth++;
+		else if ((*closing == '}') && (--depth == 0))
+			break;
+		closing++;
+	}
+	if (*closing != '}') {
+		fprintf(stderr, "nicpoyia-sh: ${%s: bad substitution\n", text);
+		return -1;
+	}
+	*position = closing + 1;
+	int lengthOf = 0;
+	if ((text[0] == '#') && (text + 1 < closing)) {
+		lengthOf = 1;
+		text++;
+	}
+	size_t nameLength = variableNameLength(text);
+	if (nameLength == 0) {
+		while (isdigit((unsigned char) text[nameLength]))
+			nameLength++;
+		if ((nameLength == 0) && strchr("?$#!@*", text[0]))
+			nameLength = 1;
+	}
+	const char *operator = text + nameLength;
+	if ((nameLength == 0)
+			|| ((operator != closing) && (lengthOf || !strchr(":-=+", *operator)))) {
+		fprintf(stderr, "nicpoyia-sh: ${%.*s}: bad substitution\n",
+				(int) (closing - start), start);
+		return -1;
+	}
+	char number[32];
+	const char *value;
+	if ((text[0] == '@') || (text[0] == '*')) {
+		struct expandedText all = { expanded->arena, NULL, 0, 0 };
+		all.text = (char*) arenaAllocate(expanded->arena, 16);
+		if (all.text == NULL)
+			return -1;
+		all.text[0] = '\0';
+		all.capacity = 16;
+		if (appendAllParameters(&all) == -1)
+			return -1;
+		value = (positionalParameters.count > 0) ? all.text : NULL;
+	} else
+		value = parameterValue(text, nameLength, number);
+	if (lengthOf) {
+		snprintf(number, sizeof(number), "%zu",
+				(value != NULL) ? strlen(value) : 0);
+		return appendText(expanded, number, strlen(number));
+	}
+	if (operator != closing) {
+		// A colon treats empty values as not set
+		int checkEmpty = (*operator == ':');
+		if (checkEmpty)
+			operator++;
+		int set = (value != NULL) && (!checkEmpty || (value[0] != '\0'));
+		char mode = *operator;
+		if ((mode != '-') && (mode != '=') && (mode != '+')) {
+			fprintf(stderr, "nicpoyia-sh: ${%.*s}: bad substitution\n",
+					(int) (closing - start), start);
+			return -1;
+		}
+		// The word is expanded only if used
+		if ((mode == '+') ? set : !set) {
+			char *word = arenaCopyText(expanded->arena, operator + 1,
+					closing - operator - 1);
+			if (word == NULL)
+				return -1;
+			char *expandedWord = expandWord(expanded->arena, word);
+			if (expandedWord == NULL)
+				return -1;
+			if ((mode == '=') && (variableNameLength(text) == nameLength)) {
+				char *assignment = arenaAllocate(expanded->arena,
+						nameLength + strlen(expandedWord) + 2);
+				if (assignment == NULL)
+					return -1;
+				sprintf(assignment, "%.*s=%s", (int) nameLength, text,
+						expandedWord);
+				assignVariable(assignment);
+			}
+			value = expandedWord;
+		} else if (mode == '+')
+			value = NULL;
+	}
+	if (value == NULL)
+		return 0;
+	return appendText(expanded, value, strlen(value));
+}
+
+/**
+ * @brief Function that expands an arithmetic expansion $(( )).
+ * Parameters within the expression are expanded, before it is evaluated.
+ *
+ * @param expanded The word being expanded
+ * @param position The position after the dollar sign (moved after the closing parentheses)
+ * @return 0: OK / -1: Error
+ */
+int expandArithmetic(struct expandedText *expanded, const char **position) {
+	const char *text = *position + 2;
+	long expressionLength = arithmeticExpressionLength(text, strlen(text));
+	// Without the closing parentheses, the dollar sign is kept as it is
+	if (expressionLength == -1)
+		return appendText(expanded, "$", 1);
+	*position = text + expressionLength + 2;
+	char *expression = arenaCopyText(expanded->arena, text, expressionLength);
+	if (expression == NULL)
+		return -1;
+	expression = expandWord(expanded->arena, expression);
+	long long value;
+	if ((expression == NULL) || (evaluateArithmetic(expression, &value) == -1)) {
+		lastExitStatus = 1;
+		return -1;
+	}
+	char number[32];
+	int numberLength = snprintf(number, sizeof(number), "%lld", value);
+	return appendText(expanded, number, numberLength);
+}
+
+/**
+ * @brief Function that expands a parameter ($NAME, ${...}, $1, $?, ...), if any.
+ *
+ * @param expanded The word being expanded
+ * @param position The position after the dollar sign (moved after the parameter)
+ * @return 0: OK / -1: Error
+ */
+int expandParameter(struct expandedText *expanded, const char **position) {
+	const char *text = *position;
+	if ((text[0] == '(') && (text[1] == '('))
+		return expandArithmetic(expanded, position);
+	if (text[0] == '{') {
+		*position = text + 1;
+		return expandBracedParameter(expanded, position);
+	}
+	if ((text[0] == '@') || (text[0] == '*')) {
+		*position = text + 1;
+		return appendAllParameters(expanded);
+	}
+	size_t nameLength = variableNameLength(text);
+	if ((nameLength == 0)
+			&& (isdigit((unsigned char) text[0]) || strchr("?$#!", text[0]))
+			&& (text[0] != '\0'))
+		nameLength = 1;
+	// A lone dollar sign is kept as it is
+	if (nameLength == 0)
+		return appendText(expanded, "$", 1);
+	*position = text + nameLength;
+	char number[32];
+	const char *value = parameterValue(text, nameLength, number);
+	if (value == NULL)
+		return 0;
+	return appendText(expanded, value, strlen(value));
+}
+
+/**
+ * @brief Function that expands a word as written in the script into its final value.
+ * Parameters are expanded (except within single quotes),
+ * quotes are removed and escaped characters are replaced by themselves.
+ *
+ * @param arena The arena to allocate the expanded word from
+ * @param word The word as written
+ * @return The expanded word: OK / NULL: Error
+ */
+char *expandWord(struct arena *arena, const char *word) {
+	struct expandedText expanded;
+	expanded.arena = arena;
+	expanded.length = 0;
+	// Most words do not grow
+	expanded.capacity = strlen(word) + 1;
+	expanded.text = (char*) arenaAllocate(arena, expanded.capacity);
+	if (expanded.text == NULL)
+		return NULL;
+	expanded.text[0] = '\0';
+	char quote = '\0';
+	while (*word) {
+		char character = *word;
+		int result = 0;
+		if (quote == '\'') {
+			// Everything is literal within single quotes
+			if (character == '\'')
+				quote = '\0';
+			else
+				result = appendText(&expanded, word, 1);
+		} else if (character == '\\') {
+			char escaped = word[1];
+			if (escaped == '\0')
+				break;
+			// Within double quotes, only a few characters can be escaped
+			if ((quote == '"') && (escaped != '"') && (escaped != '\\')
+					&& (escaped != '$') && (escaped != '`'))
+				result = appendText(&expanded, word, 1);
+			if (result != -1)
+				result = appendText(&expanded, word + 1, 1);
+			word++;
+		} else if (character == '$') {
+			word++;
+			result = expandParameter(&expanded, &word);
+			if (result == -1)
+				return NULL;
+			continue;
+		} else if (character == '"') {
+			quote = (quote == '"') ? '\0' : '"';
+		} else if ((character == '\'') && (quote == '\0')) {
+			quote = '\'';
+		} else {
+			result = appendText(&expanded, word, 1);
+		}
+		if (result == -1)
+			return NULL;
+		word++;
+	}
+	return expanded.text;
+}
+
+/**
+ * @brief Function that checks whether a word, as written, expands to every positional parameter
+ * as a separate word ("$@").
+ *
+ * @param word The word as written
+ * @return Whether the word is "$@"
+ */
+int isAllParametersWord(const char *word) {
+	return (strcmp(word, "\"$@\"") == 0) || (strcmp(word, "$@") == 0)
+			|| (strcmp(word, "\"${@}\"") == 0) || (strcmp(word, "${@}") == 0);
+}
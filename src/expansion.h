@@ -0,0 +1,75 @@
+/*  @file expansion.h
+ *  @author Nicolas Poyiadjis
+ *
+ *  @brief Word expansion functions header.
+ *  Words are kept in the syntax tree as written, and expanded whenever a command is executed.
+ */
+
+#ifndef EXPANSION_H_
+#define EXPANSION_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+
+#include "arena.h"
+#include "lexer.h"
+#include "arithmetic.h"
+#include "variables.h"
+
+// The shell name ($0), when no script is executed
+#define SHELL_NAME "nicpoyia-sh"
+
+/**
+ * @brief The positional parameters ($0, and $1, $2, ...).
+ */
+struct positionalParameters {
+	char *name;
+	char **values;
+	int count;
+};
+
+// Positional parameters of the shell (or of the script being executed)
+extern struct positionalParameters positionalParameters;
+
+/**
+ * @brief Function that sets the positional parameters, replacing the current ones.
+ * The strings given are copied.
+ *
+ * @param name The shell or script name ($0), NULL to keep the current one
+ * @param values The parameters ($1, $2, ...)
+ * @param count Number of parameters
+ * @return 0: OK / -1: Error
+ */
+int setPositionalParameters(const char *name, char **values, int count);
+
+/**
+ * @brief Function that releases the positional parameters.
+ *
+ * @param parameters The positional parameters
+ */
+void freePositionalParameters(struct positionalParameters *parameters);
+
+/**
+ * @brief Function that expands a word as written in the script into its final value.
+ * Parameters are expanded (except within single quotes),
+ * quotes are removed and escaped characters are replaced by themselves.
+ *
+ * @param arena The arena to allocate the expanded word from
+ * @param word The word as written
+ * @return The expanded word: OK / NULL: Error
+ */
+char *expandWord(struct arena *arena, const char *word);
+
+/**
+ * @brief Function that checks whether a word, as written, expands to every positional parameter
+ * as a separate word ("$@").
+ *
+ * @param word The word as written
+ * @return Whether the word is "$@"
+ */
+int isAllParametersWord(const char *word);
+
+#endif /* EXPANSION_H_ */
@@ -1,7 +1,9 @@
 /*  @file files.c
  *  @author Nicolas Poyiadjis
  *
- *  @brief File-redirection functions header
+ *  @brief File-redirection functions header.
+ *  Redirections are not carried out immediately,
+ *  but added to the launch plan of the process they are given for.
  */
 
 #ifndef FILES_H_
@@ -11,53 +13,38 @@
 #include <unistd.h>
 #include <fcntl.h>
 
-/**
- * @brief Redirects a file to a process standard input
- *
- * @param filename Filename to redirect
- * @return Error code: 0: OK / -1: Error
- */
-int redirectStdIn(char *filename);
+#include "process_launch.h"
 
 /**
- * @brief Redirects a file descriptor to a process standard input
- *
- * @param fd File desciptor to redirect
- * @return Error code: 0: OK / -1: Error
- */
-int redirectStdInFd(int fd);
-
-/**
- * @brief Redirects a process standard output to a file.
+ * @brief Redirects a file to a process file descriptor, for reading (e.g. <, 0<)
  *
+ * @param plan The launch plan of the process
+ * @param fd File descriptor of the process
  * @param filename Filename to redirect
- * @param appendMode Flag to show whether the append symbol used (>>)
- * @return Error code: 0: OK / -1: Error
- */
-int redirectStdOut(char *filename, int appendMode);
-
-/**
- * @brief Redirects a process standard output to a file descriptor
- *
- * @param fd File desciptor to redirect
  * @return Error code: 0: OK / -1: Error
  */
-int redirectStdOutFd(int fd);
+int redirectFromFile(struct launchPlan *plan, int fd, char *filename);
 
 /**
- * @brief Redirects a process standard error to a file.
+ * @brief Redirects a process file descriptor to a file, for writing (e.g. >, 2>, >>)
  *
+ * @param plan The launch plan of the process
+ * @param fd File descriptor of the process
  * @param filename Filename to redirect
+ * @param appendMode Flag to show whether the append symbol used (>>)
  * @return Error code: 0: OK / -1: Error
  */
-int redirectStdErr(char *filename);
+int redirectToFile(struct launchPlan *plan, int fd, char *filename,
+		int appendMode);
 
 /**
- * @brief Redirects a process standard error to a file descriptor
+ * @brief Redirects a process file descriptor to another file descriptor (e.g. 2>&1)
  *
- * @param fd File desciptor to redirect
+ * @param plan The launch plan of the process
+ * @param fd File descriptor of the process
+ * @param targetFd File desciptor to redirect to
  * @return Error code: 0: OK / -1: Error
  */
-int redirectStdErrFd(int fd);
+int redirectToFd(struct launchPlan *plan, int fd, int targetFd);
 
 #endif /* FILES_H_ */
@@ -0,0 +1,684 @@
+/*  @file history.c
+ *  @author Nicolas Poyiadjis
+ *
+ *  @brief Command history implementation
+ */
+
+// memmem() is a GNU extension
+#define _GNU_SOURCE
+
+#include "history.h"
+#include "parse_cache.h"
+
+// The command history of the shell
+struct history history;
+
+// Free slot, and removed entry, of the deduplication hash set
+#define HISTORY_SET_FREE 0
+#define HISTORY_SET_REMOVED ((unsigned long) -1)
+
+/**
+ * @brief Function that returns the number of the oldest entry kept.
+ */
+unsigned long firstHistoryNumber() {
+	return (history.last > history.size) ? (history.last - history.size + 1) : 1;
+}
+
+/**
+ * @brief Function that finds a history entry by its number.
+ *
+ * @param number The entry number
+ * @return The entry / NULL: Not kept (or superseded by a newer identical one)
+ */
+struct historyEntry *findHistoryEntry(unsigned long number) {
+	if ((number == 0) || (number > history.last)
+			|| (number < firstHistoryNumber()))
+		return NULL;
+	struct historyEntry *entry = &history.ring[(number - 1) % history.size];
+	return entry->erased ? NULL : entry;
+}
+
+/**
+ * @brief Function that maps a trigram to its bit in the block signatures.
+ *
+ * @param trigram The three characters
+ * @return The bit position
+ */
+unsigned int trigramBit(const char *trigram) {
+	unsigned int value = ((unsigned char) trigram[0] << 16)
+			| ((unsigned char) trigram[1] << 8) | (unsigned char) trigram[2];
+	return (value * 2654435761u) >> 20;
+}
+
+/**
+ * @brief Function that adds the trigrams of an entry to the signature of its block.
+ *
+ * @param slot The ring slot of the entry
+ */
+void indexHistoryEntry(size_t slot) {
+	struct historyEntry *entry = &history.ring[slot];
+	uint64_t *signature = &history.signatures[(slot / HISTORY_INDEX_BLOCK_SIZE)
+			* HISTORY_SIGNATURE_WORDS];
+	size_t i;
+	for (i = 0; i + 3 <= entry->length; i++) {
+		unsigned int bit = trigramBit(entry->text + i);
+		signature[bit / 64] |= (uint64_t) 1 << (bit % 64);
+	}
+}
+
+/**
+ * @brief Function that finds the deduplication set slot of an entry text.
+ *
+ * @param text
+ * @param length
+ * @param hash The hash of the text
+ * @return The set slot holding the identical entry / NULL: Not found
+ */
+unsigned long *findHistorySetSlot(const char *text, size_t length,
+		unsigned int hash) {
+	if (history.setCapacity == 0)
+		return NULL;
+	size_t mask = history.setCapacity - 1;
+	size_t index = hash & mask;
+	while (history.set[index] != HISTORY_SET_FREE) {
+		if (history.set[index] != HISTORY_SET_REMOVED) {
+			struct historyEntry *entry = findHistoryEntry(history.set[index]);
+			if ((entry != NULL) && (entry->hash == hash)
+					&& (entry->length == length)
+					&& (memcmp(entry->text, text, length) == 0))
+				return &history.set[index];
+		}
+		index = (index + 1) & mask;
+	}
+	return NULL;
+}
+
+/**
+ * @brief Function that inserts an entry number in the deduplication set.
+ *
+ * @param number The entry number
+ * @param hash The hash of the entry text
+ */
+void insertHistorySet(unsigned long number, unsigned int hash) {
+	size_t mask = history.setCapacity - 1;
+	size_t index = hash & mask;
+	while ((history.set[index] != HISTORY_SET_FREE)
+			&& (history.set[index] != HISTORY_SET_REMOVED))
+		index = (index + 1) & mask;
+	if (history.set[index] == HISTORY_SET_FREE)
+		history.setUsed++;
+	history.set[index] = number;
+}
+
+/**
+ * @brief Function that rebuilds the deduplication set, dropping the removed entries,
+ * with room for at least a given number of entries.
+ *
+ * @param entries Number of entries to make room for
+ * @return 0: OK / -1: Error
+ */
+int rebuildHistorySet(size_t entries) {
+	size_t capacity = 64;
+	while (capacity < 4 * entries)
+		capacity *= 2;
+	unsigned long *set = (unsigned long*) calloc(capacity, sizeof(unsigned long));
+	if (set == NULL) {
+		perror("malloc error");
+		return -1;
+	}
+	free(history.set);
+	history.set = set;
+	history.setCapacity = capacity;
+	history.setUsed = 0;
+	unsigned long number;
+	for (number = firstHistoryNumber(); number <= history.last; number++) {
+		struct historyEntry *entry = findHistoryEntry(number);
+		if (entry != NULL)
+			insertHistorySet(number, entry->hash);
+	}
+	return 0;
+}
+
+/**
+ * @brief Function that grows the ring buffer (and its index), up to the history size.
+ *
+ * @return 0: OK / -1: Error
+ */
+int growHistoryRing() {
+	size_t capacity =
+			(history.ringCapacity == 0) ?
+					HISTORY_INITIAL_CAPACITY : (history.ringCapacity * 2);
+	if (capacity > history.size)
+		capacity = history.size;
+	struct historyEntry *ring = (struct historyEntry*) realloc(history.ring,
+			capacity * sizeof(struct historyEntry));
+	if (ring == NULL) {
+		perror("malloc error");
+		return -1;
+	}
+	history.ring = ring;
+	size_t oldBlocks = (history.ringCapacity + HISTORY_INDEX_BLOCK_SIZE - 1)
+			/ HISTORY_INDEX_BLOCK_SIZE;
+	size_t blocks = (capacity + HISTORY_INDEX_BLOCK_SIZE - 1)
+			/ HISTORY_INDEX_BLOCK_SIZE;
+	uint64_t *signatures = (uint64_t*) realloc(history.signatures,
+			blocks * HISTORY_SIGNATURE_WORDS * sizeof(uint64_t));
+	if (signatures == NULL) {
+		perror("malloc error");
+		return -1;
+	}
+	memset(signatures + oldBlocks * HISTORY_SIGNATURE_WORDS, 0,
+			(blocks - oldBlocks) * HISTORY_SIGNATURE_WORDS * sizeof(uint64_t));
+	history.signatures = signatures;
+	history.ringCapacity = capacity;
+	return 0;
+}
+
+/**
+ * @brief Function that releases the text of an entry.
+ *
+ * @param entry
+ */
+void releaseHistoryText(struct historyEntry *entry) {
+	if (entry->allocated)
+		free((char*) entry->text);
+	entry->text = NULL;
+	entry->length = 0;
+	entry->allocated = 0;
+}
+
+/**
+ * @brief Function that adds an entry to the ring buffer, superseding any identical older entry.
+ *
+ * @param text The entry text (owned by the history if allocated)
+ * @param length The text length
+ * @param allocated Whether the text is allocated
+ * @return 0: OK / -1: Error
+ */
+int addHistoryEntry(const char *text, size_t length, int allocated) {
+	unsigned int hash = scriptHash(text, length);
+	// Only the latest of identical entries is kept
+	unsigned long *duplicate = findHistorySetSlot(text, length, hash);
+	if (duplicate != NULL) {
+		struct historyEntry *entry = findHistoryEntry(*duplicate);
+		releaseHistoryText(entry);
+		entry->erased = 1;
+		(*duplicate) = HISTORY_SET_REMOVED;
+	}
+	if ((history.last == history.ringCapacity)
+			&& (history.ringCapacity < history.size))
+		if (growHistoryRing() == -1)
+			return -1;
+	if ((history.setUsed + 1) * 2 > history.setCapacity)
+		if (rebuildHistorySet(history.ringCapacity) == -1)
+			return -1;
+	unsigned long number = history.last + 1;
+	size_t slot = (number - 1) % history.size;
+	struct historyEntry *entry = &history.ring[slot];
+	if (number > history.size) {
+		// The oldest entry is overwritten
+		if (!entry->erased) {
+			unsigned long *oldSlot = findHistorySetSlot(entry->text, entry->length,
+					entry->hash);
+			if (oldSlot != NULL)
+				(*oldSlot) = HISTORY_SET_REMOVED;
+		}
+		releaseHistoryText(entry);
+	}
+	entry->text = text;
+	entry->length = length;
+	entry->hash = hash;
+	entry->allocated = allocated;
+	entry->erased = 0;
+	history.last = number;
+	insertHistorySet(number, hash);
+	// A block reused from its start gets a fresh signature,
+	// made of its new entry and the older entries still kept
+	if ((number > history.size) && (slot % HISTORY_INDEX_BLOCK_SIZE == 0)) {
+		memset(&history.signatures[(slot / HISTORY_INDEX_BLOCK_SIZE)
+				* HISTORY_SIGNATURE_WORDS], 0,
+				HISTORY_SIGNATURE_WORDS * sizeof(uint64_t));
+		size_t other;
+		for (other = slot + 1;
+				(other < slot + HISTORY_INDEX_BLOCK_SIZE) && (other < history.size);
+				other++)
+			indexHistoryEntry(other);
+	}
+	indexHistoryEntry(slot);
+	return 0;
+}
+
+/**
+ * @brief Function that adds the lines of a text to the history, as allocated entries.
+ *
+ * @param text
+ * @param length
+ * @return 0: OK / -1: Error
+ */
+int addHistoryLines(const char *text, size_t length) {
+	const char *end = text + length;
+	while (text < end) {
+		const char *newline = memchr(text, '\n', end - text);
+		if (newline == NULL)
+			newline = end;
+		if (newline > text) {
+			char *line = (char*) malloc(newline - text);
+			if (line == NULL) {
+				perror("malloc error");
+				return -1;
+			}
+			memcpy(line, text, newline - text);
+			if (addHistoryEntry(line, newline - text, 1) == -1) {
+				free(line);
+				return -1;
+			}
+		}
+		text = newline + 1;
+	}
+	return 0;
+}
+
+/**
+ * @brief Function that loads the latest distinct entries of the mapped history file.
+ * The file is scanned backwards, so that only the entries kept are visited,
+ * and the entries kept are copied into a single block owned by the history
+ * (the file may be truncated by another process while mapped).
+ *
+ * @param start Start of the mapped file
+ * @param end End of the complete lines of the file
+ * @return 0: OK / -1: Error
+ */
+int loadHistoryMapping(const char *start, const char *end) {
+	// The latest entries, newest first, deduplicated through a temporary hash set
+	size_t capacity = 64;
+	while (capacity < 2 * history.size)
+		capacity *= 2;
+	size_t *seen = (size_t*) calloc(capacity, sizeof(size_t));
+	const char **lines = (const char**) malloc(
+			history.size * sizeof(const char*));
+	size_t *lengths = (size_t*) malloc(history.size * sizeof(size_t));
+	if ((seen == NULL) || (lines == NULL) || (lengths == NULL)) {
+		perror("malloc error");
+		free(seen);
+		free(lines);
+		free(lengths);
+		return -1;
+	}
+	size_t count = 0;
+	const char *lineEnd = end;
+	while ((lineEnd > start) && (count < history.size)) {
+		// The line ends at lineEnd (its newline character)
+		const char *lineStart = lineEnd;
+		while ((lineStart > start) && (lineStart[-1] != '\n'))
+			lineStart--;
+		size_t length = lineEnd - lineStart;
+		if (length > 0) {
+			size_t index = scriptHash(lineStart, length) & (capacity - 1);
+			int duplicate = 0;
+			while (seen[index] != 0) {
+				size_t other = seen[index] - 1;
+				if ((lengths[other] == length)
+						&& (memcmp(lines[other], lineStart, length) == 0)) {
+					duplicate = 1;
+					break;
+				}
+				index = (index + 1) & (capacity - 1);
+			}
+			if (!duplicate) {
+				seen[index] = count + 1;
+				lines[count] = lineStart;
+				lengths[count] = length;
+				count++;
+			}
+		}
+		lineEnd = lineStart - 1;
+	}
+	size_t textLength = 0;
+	size_t i;
+	for (i = 0; i < count; i++)
+		textLength += lengths[i];
+	history.loadedText = (char*) malloc(textLength + 1);
+	if (history.loadedText == NULL) {
+		perror("malloc error");
+		count = 0;
+	}
+	// Entries are added oldest first, referring to the loaded block
+	int result = (history.loadedText == NULL) ? -1 : 0;
+	char *text = history.loadedText;
+	while ((count > 0) && (result == 0)) {
+		count--;
+		memcpy(text, lines[count], lengths[count]);
+		result = addHistoryEntry(text, lengths[count], 0);
+		text += lengths[count];
+	}
+	free(seen);
+	free(lines);
+	free(lengths);
+	return result;
+}
+
+/**
+ * @brief Function that loads the history file and enables the history.
+ * The history size and file are given by HISTSIZE and HISTFILE.
+ *
+ * @return 0: OK / -1: Error
+ */
+int initializeHistory() {
+	memset(&history, 0, sizeof(history));
+	history.fd = -1;
+	history.size = HISTORY_DEFAULT_SIZE;
+	const char *size = getVariable("HISTSIZE");
+	if ((size != NULL) && (atol(size) > 0))
+		history.size = atol(size);
+	history.enabled = 1;
+	// The history file
+	const char *path = getVariable("HISTFILE");
+	if ((path != NULL) && (*path != '\0')) {
+		history.path = strdup(path);
+	} else {
+		const char *home = getVariable("HOME");
+		if (home == NULL)
+			return 0;
+		history.path = (char*) malloc(strlen(home) + strlen(HISTORY_FILE_NAME) + 2);
+		if (history.path != NULL)
+			sprintf(history.path, "%s/%s", home, HISTORY_FILE_NAME);
+	}
+	if (history.path == NULL) {
+		perror("malloc error");
+		return -1;
+	}
+	history.fd = open(history.path, O_RDWR | O_APPEND | O_CREAT | O_CLOEXEC,
+			0600);
+	if (history.fd == -1) {
+		// The history is kept in memory only
+		perror(history.path);
+		return -1;
+	}
+	// The file is mapped while no concurrent session appends to it
+	flock(history.fd, LOCK_SH);
+	struct stat fileStatus;
+	if ((fstat(history.fd, &fileStatus) == 0) && (fileStatus.st_size > 0)) {
+		char *mapping = (char*) mmap(NULL, fileStatus.st_size, PROT_READ,
+				MAP_PRIVATE, history.fd, 0);
+		if (mapping != MAP_FAILED) {
+			// Only complete lines are loaded
+			const char *end = mapping + fileStatus.st_size;
+			while ((end > mapping) && (end[-1] != '\n'))
+				end--;
+			history.fileEnd = end - mapping;
+			if (end > mapping)
+				loadHistoryMapping(mapping, end - 1);
+			// (the entries loaded do not refer to the file)
+			munmap(mapping, fileStatus.st_size);
+		}
+	}
+	flock(history.fd, LOCK_UN);
+	return 0;
+}
+
+/**
+ * @brief Function that appends a command to the history file, under an exclusive lock.
+ * The commands appended by concurrent sessions since are added to the history first.
+ *
+ * @param command The command text
+ * @param length The command length
+ * @return 0: OK / -1: Error
+ */
+int appendHistoryFile(const char *command, size_t length) {
+	if (flock(history.fd, LOCK_EX) == -1)
+		return -1;
+	struct stat fileStatus;
+	if (fstat(history.fd, &fileStatus) == -1) {
+		flock(history.fd, LOCK_UN);
+		return -1;
+	}
+	if (fileStatus.st_size > history.fileEnd) {
+		size_t newLength = fileStatus.st_size - history.fileEnd;
+		char *newLines = (char*) malloc(newLength);
+		if ((newLines != NULL)
+				&& (pread(history.fd, newLines, newLength, history.fileEnd)
+						== (ssize_t) newLength))
+			addHistoryLines(newLines, newLength);
+		free(newLines);
+	}
+	struct iovec line[2] = { { (void*) command, length }, { "\n", 1 } };
+	int result = (writev(history.fd, line, 2) == (ssize_t) (length + 1)) ? 0 : -1;
+	history.fileEnd = fileStatus.st_size + length + 1;
+	flock(history.fd, LOCK_UN);
+	return result;
+}
+
+/**
+ * @brief Function that adds a command to the history, and appends it to the history file.
+ *
+ * @param command The command text
+ * @return 0: OK / -1: Error
+ */
+int addHistory(const char *command) {
+	if (!history.enabled)
+		return 0;
+	size_t length = strlen(command);
+	if (strspn(command, " \t\n") == length)
+		return 0;
+	// Commands of several lines are kept in memory only (the file holds one command per line)
+	if ((history.fd != -1) && (memchr(command, '\n', length) == NULL))
+		appendHistoryFile(command, length);
+	char *text = (char*) malloc(length);
+	if (text == NULL) {
+		perror("malloc error");
+		return -1;
+	}
+	memcpy(text, command, length);
+	if (addHistoryEntry(text, length, 1) == -1) {
+		free(text);
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * @brief Function that finds the latest entry beginning with a prefix.
+ *
+ * @param prefix
+ * @param length The prefix length
+ * @return The entry / NULL: Not found
+ */
+struct historyEntry *findHistoryPrefix(const char *prefix, size_t length) {
+	unsigned long number;
+	for (number = history.last; number >= firstHistoryNumber() && number > 0;
+			number--) {
+		struct historyEntry *entry = findHistoryEntry(number);
+		if ((entry != NULL) && (entry->length >= length)
+				&& (memcmp(entry->text, prefix, length) == 0))
+			return entry;
+	}
+	return NULL;
+}
+
+/**
+ * @brief Function that finds the latest entry containing a string.
+ * Blocks of entries whose signature lacks any trigram of the string are skipped at once.
+ *
+ * @param string
+ * @param length The string length
+ * @return The entry / NULL: Not found
+ */
+struct historyEntry *findHistorySubstring(const char *string, size_t length) {
+	size_t trigramsCount = (length >= 3) ? (length - 2) : 0;
+	unsigned int trigrams[trigramsCount + 1];
+	size_t i;
+	for (i = 0; i < trigramsCount; i++)
+		trigrams[i] = trigramBit(string + i);
+	unsigned long first = firstHistoryNumber();
+	unsigned long number = history.last;
+	while ((number >= first) && (number > 0)) {
+		size_t slot = (number - 1) % history.size;
+		uint64_t *signature = &history.signatures[(slot / HISTORY_INDEX_BLOCK_SIZE)
+				* HISTORY_SIGNATURE_WORDS];
+		int possible = 1;
+		for (i = 0; (i < trigramsCount) && possible; i++)
+			possible = (signature[trigrams[i] / 64] >> (trigrams[i] % 64)) & 1;
+		if (!possible) {
+			// Skip the entries of the block before this one
+			unsigned long skipped = (slot % HISTORY_INDEX_BLOCK_SIZE) + 1;
+			if (number < first + skipped)
+				break;
+			number -= skipped;
+			continue;
+		}
+		struct historyEntry *entry = findHistoryEntry(number);
+		if ((entry != NULL) && (memmem(entry->text, entry->length, string, length)
+				!= NULL))
+			return entry;
+		number--;
+	}
+	return NULL;
+}
+
+/**
+ * @brief Function that finds the entry referred to by a history event (after the !).
+ *
+ * @param event The event text (moved after the event)
+ * @return The entry / NULL: Event not found
+ */
+struct historyEntry *findHistoryEvent(const char **event) {
+	const char *text = *event;
+	if (text[0] == '!') {
+		(*event) = text + 1;
+		return findHistoryEntry(history.last);
+	}
+	if (isdigit((unsigned char) text[0])
+			|| ((text[0] == '-') && isdigit((unsigned char) text[1]))) {
+		char *end;
+		long number = strtol(text, &end, 10);
+		(*event) = end;
+		if (number < 0)
+			number = (long) history.last + 1 + number;
+		return (number > 0) ? findHistoryEntry(number) : NULL;
+	}
+	if (text[0] == '?') {
+		const char *end = strchr(text + 1, '?');
+		size_t length = (end != NULL) ? (size_t) (end - text - 1) : strlen(text + 1);
+		(*event) = text + 1 + length + ((end != NULL) ? 1 : 0);
+		return (length > 0) ? findHistorySubstring(text + 1, length) : NULL;
+	}
+	size_t length = strcspn(text, " \t\n;&|<>()'\"");
+	(*event) = text + length;
+	return findHistoryPrefix(text, length);
+}
+
+/**
+ * @brief Function that performs history expansion on a command line:
+ * !! (last command), !n (command n), !-n (n commands back),
+ * !prefix (last command beginning with prefix) and !?string[?] (last command containing string).
+ *
+ * @param line The command line
+ * @param expanded Filled in with the expanded line (allocated), if anything was expanded
+ * @return 1: Expanded / 0: Nothing to expand / -1: Event not found (reported)
+ */
+int expandHistory(const char *line, char **expanded) {
+	if (!history.enabled || (strchr(line, '!') == NULL))
+		return 0;
+	size_t capacity = strlen(line) + 64;
+	size_t length = 0;
+	char *result = (char*) malloc(capacity);
+	if (result == NULL) {
+		perror("malloc error");
+		return -1;
+	}
+	int expandedAny = 0;
+	int quoted = 0;
+	const char *position = line;
+	while (*position != '\0') {
+		const char *piece = position;
+		size_t pieceLength = 1;
+		char next = position[1];
+		if (*position == '\'') {
+			quoted = !quoted;
+		} else if ((*position == '\\') && (next != '\0')) {
+			pieceLength = 2;
+		} else if ((*position == '!') && !quoted && (next != '\0')
+				&& !strchr(" \t\n=(", next)) {
+			const char *event = position + 1;
+			struct historyEntry *entry = findHistoryEvent(&event);
+			if (entry == NULL) {
+				fprintf(stderr, "nicpoyia-sh: %.*s: event not found\n",
+						(int) (event - position), position);
+				free(result);
+				return -1;
+			}
+			piece = entry->text;
+			pieceLength = entry->length;
+			position = event - pieceLength;
+			expandedAny = 1;
+		}
+		if (length + pieceLength + 1 > capacity) {
+			capacity = (length + pieceLength + 1) * 2;
+			char *grown = (char*) realloc(result, capacity);
+			if (grown == NULL) {
+				perror("malloc error");
+				free(result);
+				return -1;
+			}
+			result = grown;
+		}
+		memcpy(result + length, piece, pieceLength);
+		length += pieceLength;
+		position += pieceLength;
+	}
+	result[length] = '\0';
+	if (!expandedAny) {
+		free(result);
+		return 0;
+	}
+	(*expanded) = result;
+	return 1;
+}
+
+/**
+ * @brief Function that writes the last entries of the history, numbered, to an output buffer.
+ *
+ * @param output The output buffer
+ * @param count Number of entries to write (0: All)
+ */
+void outputHistory(struct outputBuffer *output, unsigned long count) {
+	unsigned long first = firstHistoryNumber();
+	unsigned long number = history.last;
+	unsigned long found = 0;
+	// Find the first entry to write
+	while ((number > first) && ((count == 0) || (found < count))) {
+		if (findHistoryEntry(number) != NULL)
+			found++;
+		if ((count != 0) && (found == count))
+			break;
+		number--;
+	}
+	for (; (number <= history.last) && (number > 0); number++) {
+		struct historyEntry *entry = findHistoryEntry(number);
+		if (entry == NULL)
+			continue;
+		outputFormat(output, "%5lu  ", number);
+		outputWrite(output, entry->text, entry->length);
+		outputCharacter(output, '\n');
+	}
+	outputFlush(output);
+}
+
+/**
+ * @brief Function that clears the history in memory (the history file is kept).
+ */
+void clearHistory() {
+	unsigned long number;
+	for (number = firstHistoryNumber(); (number <= history.last) && (number > 0);
+			number++)
+		releaseHistoryText(&history.ring[(number - 1) % history.size]);
+	history.last = 0;
+	if (history.set != NULL)
+		memset(history.set, 0, history.setCapacity * sizeof(unsigned long));
+	history.setUsed = 0;
+	if (history.signatures != NULL)
+		memset(history.signatures, 0,
+				((history.ringCapacity + HISTORY_INDEX_BLOCK_SIZE - 1)
+						/ HISTORY_INDEX_BLOCK_SIZE) * HISTORY_SIGNATURE_WORDS
+						* sizeof(uint64_t));
+}
@@ -0,0 +1,135 @@
+/*  @file history.h
+ *  @author Nicolas Poyiadjis
+ *
+ *  @brief Command history header.
+ *  The history is kept in memory in a ring buffer of the most recent commands (HISTSIZE),
+ *  and persisted in an append-only history file (HISTFILE, ~/.nicpoyiash_history by default).
+ *  	- At startup, the file is mapped in memory, and only the entries kept are copied out of it
+ *  	  (into a single block), so that the history never refers to the file itself.
+ *  	- Every command is appended to the file at once, under an exclusive lock,
+ *  	  picking up the commands appended by concurrent sessions since.
+ *  	- Repeated commands are deduplicated through a hash set: only the latest one is kept.
+ *  	- Substring searches (!?string) use an index of trigram signatures
+ *  	  per block of entries, so that only blocks that may match are searched.
+ */
+
+#ifndef HISTORY_H_
+#define HISTORY_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <ctype.h>
+#include <errno.h>
+#include <sys/file.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "variables.h"
+#include "output.h"
+
+#define HISTORY_FILE_NAME ".nicpoyiash_history"
+#define HISTORY_DEFAULT_SIZE 10000
+#define HISTORY_INITIAL_CAPACITY 256
+// Entries per block of the substring index, and bits per block signature
+#define HISTORY_INDEX_BLOCK_SIZE 32
+#define HISTORY_SIGNATURE_BITS 4096
+#define HISTORY_SIGNATURE_WORDS (HISTORY_SIGNATURE_BITS / 64)
+
+/**
+ * @brief A history entry. Its text is not NUL-terminated.
+ */
+struct historyEntry {
+	const char *text;
+	size_t length;
+	unsigned int hash;
+	// Whether the text is allocated (otherwise, it lies in the block loaded from the history file)
+	int allocated;
+	// Whether the entry has been superseded by a newer identical one
+	int erased;
+};
+
+/**
+ * @brief The command history.
+ * Entry number n (1, 2, ...) is kept in ring slot (n - 1) % size, while among the last size entries.
+ */
+struct history {
+	int enabled;
+	struct historyEntry *ring;
+	size_t size;
+	size_t ringCapacity;
+	// Number of the latest entry
+	unsigned long last;
+	// Hash set of entry numbers (0: free slot), to deduplicate entries
+	unsigned long *set;
+	size_t setCapacity;
+	size_t setUsed;
+	// Substring index: trigram signature of every block of ring slots
+	uint64_t *signatures;
+	// The history file, the text of the entries loaded from it, and the end of the file known so far
+	char *path;
+	int fd;
+	char *loadedText;
+	off_t fileEnd;
+};
+
+extern struct history history;
+
+/**
+ * @brief Function that returns the number of the oldest entry kept.
+ */
+unsigned long firstHistoryNumber();
+
+/**
+ * @brief Function that finds a history entry by its number.
+ *
+ * @param number The entry number
+ * @return The entry / NULL: Not kept (or superseded by a newer identical one)
+ */
+struct historyEntry *findHistoryEntry(unsigned long number);
+
+/**
+ * @brief Function that loads the history file and enables the history.
+ * The history size and file are given by HISTSIZE and HISTFILE.
+ *
+ * @return 0: OK / -1: Error
+ */
+int initializeHistory();
+
+/**
+ * @brief Function that adds a command to the history, and appends it to the history file.
+ *
+ * @param command The command text
+ * @return 0: OK / -1: Error
+ */
+int addHistory(const char *command);
+
+/**
+ * @brief Function that performs history expansion on a command line:
+ * !! (last command), !n (command n), !-n (n commands back),
+ * !prefix (last command beginning with prefix) and !?string[?] (last command containing string).
+ *
+ * @param line The command line
+ * @param expanded Filled in with the expanded line (allocated), if anything was expanded
+ * @return 1: Expanded / 0: Nothing to expand / -1: Event not found (reported)
+ */
+int expandHistory(const char *line, char **expanded);
+
+/**
+ * @brief Function that writes the last entries of the history, numbered, to an output buffer.
+ *
+ * @param output The output buffer
+ * @param count Number of entries to write (0: All)
+ */
+void outputHistory(struct outputBuffer *output, unsigned long count);
+
+/**
+ * @brief Function that clears the history in memory (the history file is kept).
+ */
+void clearHistory();
+
+#endif /* HISTORY_H_ */
@@ -0,0 +1,216 @@
+/*  @file job_queue.c
+ *  @author Nicolas Poyiadjis
+ *
+ *  @brief Job admission queue implementation
+ */
+
+#include "jobs.h"
+
+// The admission queue
+struct jobQueue jobQueue = { NULL, 0, 1, 0 };
+
+/**
+ * @brief Function that checks whether a job can be started now,
+ * within the limits of concurrent jobs and processes (or because nothing is running).
+ *
+ * @param processesNeeded The number of processes of the job
+ * @return 1: true / 0: false
+ */
+int jobAdmissible(int processesNeeded) {
+	if ((activeJobs == 0) && (actPrCount == 0))
+		return 1;
+	if ((maxJobsRunning > 0) && (activeJobs >= maxJobsRunning))
+		return 0;
+	if ((maxActiveProcesses > 0)
+			&& (actPrCount + processesNeeded > maxActiveProcesses))
+		return 0;
+	return 1;
+}
+
+/**
+ * @brief Function that checks whether a background job has to wait in the admission queue.
+ *
+ * @param pipeline The pipeline of the job
+ * @return 1: true / 0: false
+ */
+int jobMustQueue(struct pipelineNode *pipeline) {
+	return pipeline->background
+			&& ((jobQueue.count > 0) || !jobAdmissible(pipeline->commandsCount));
+}
+
+/**
+ * @brief Function that copies a command into a queued job, with its words expanded and quoted.
+ *
+ * @param job The queued job
+ * @param copy The command copy to fill in
+ * @param command The command syntax tree
+ * @return 0: OK / -1: Error
+ */
+int copyQueuedCommand(struct queuedJob *job, struct commandNode *copy,
+		struct commandNode *command) {
+	char **words;
+	int wordsCount = expandCommand(&scriptArena, command, &words);
+	if (wordsCount == -1)
+		return -1;
+	copy->wordsCount = wordsCount;
+	copy->words = (char**) arenaAllocate(&job->arena,
+			(wordsCount + 1) * sizeof(char*));
+	copy->redirectionsCount = command->redirectionsCount;
+	copy->redirections = (struct redirectionNode*) arenaAllocate(&job->arena,
+			(command->redirectionsCount + 1) * sizeof(struct redirectionNode));
+	if ((copy->words == NULL) || (copy->redirections == NULL))
+		return -1;
+	int i;
+	for (i = 0; i < wordsCount; i++)
+		if ((copy->words[i] = quoteForShell(&job->arena, words[i])) == NULL)
+			return -1;
+	copy->words[wordsCount] = NULL;
+	for (i = 0; i < command->redirectionsCount; i++) {
+		copy->redirections[i] = command->redirections[i];
+		char *target = expandWord(&scriptArena, command->redirections[i].target);
+		if ((target == NULL) || ((copy->redirections[i].target = quoteForShell(
+				&job->arena, target)) == NULL))
+			return -1;
+	}
+	return 0;
+}
+
+/**
+ * @brief Function that releases a queued job.
+ *
+ * @param job
+ */
+void releaseQueuedJob(struct queuedJob *job) {
+	destroyArena(&job->arena);
+	free(job);
+}
+
+/**
+ * @brief Function that queues a background job, expanding its words now.
+ *
+ * @param pipeline The pipeline of the job
+ * @return 0: OK / -1: Error
+ */
+int queueJob(struct pipelineNode *pipeline) {
+	struct queuedJob *job = (struct queuedJob*) malloc(sizeof(struct queuedJob));
+	if (job == NULL) {
+		perror("malloc error");
+		return -1;
+	}
+	initializeArenaWithChunkSize(&job->arena, JOB_QUEUE_CHUNK_SIZE);
+	job->pipeline = *pipeline;
+	job->pipeline.commands = (struct commandNode*) arenaAllocate(&job->arena,
+			pipeline->commandsCount * sizeof(struct commandNode));
+	job->pipeline.text = arenaCopyString(&job->arena, pipeline->text);
+	if ((job->pipeline.commands == NULL) || (job->pipeline.text == NULL)) {
+		releaseQueuedJob(job);
+		return -1;
+	}
+	// The words are expanded as the job is queued, as if it was started at once
+	struct arenaMark mark = arenaGetMark(&scriptArena);
+	int i;
+	for (i = 0; i < pipeline->commandsCount; i++)
+		if (copyQueuedCommand(job, &job->pipeline.commands[i],
+				&pipeline->commands[i]) == -1)
+			break;
+	arenaRelease(&scriptArena, mark);
+	if (i < pipeline->commandsCount) {
+		releaseQueuedJob(job);
+		return -1;
+	}
+	const char *priority = getVariable(JOB_PRIORITY_VARIABLE);
+	job->priority = (priority != NULL) ? atoi(priority) : 0;
+	job->number = jobQueue.nextNumber++;
+	clock_gettime(CLOCK_MONOTONIC, &job->queued);
+	// Behind every job of the same or higher priority
+	struct queuedJob **position = &jobQueue.head;
+	while ((*position != NULL) && ((*position)->priority >= job->priority))
+		position = &(*position)->next;
+	job->next = *position;
+	*position = job;
+	jobQueue.count++;
+	printf("[Q%lu] Queued Job: %s\n", job->number, job->pipeline.text);
+	return 0;
+}
+
+/**
+ * @brief Function that starts the queued jobs, in order, as long as they are admissible.
+ * Called whenever some children have been reaped, or a limit has changed.
+ */
+void startQueuedJobs() {
+	if (jobQueue.starting)
+		return;
+	jobQueue.starting = 1;
+	while ((jobQueue.head != NULL)
+			&& jobAdmissible(jobQueue.head->pipeline.commandsCount)) {
+		struct queuedJob *job = jobQueue.head;
+		jobQueue.head = job->next;
+		jobQueue.count--;
+		// The job may be started in the middle of a statement:
+		// its temporaries are released at once
+		struct arenaMark mark = arenaGetMark(&scriptArena);
+		handlePipedCommands(&job->pipeline);
+		arenaRelease(&scriptArena, mark);
+		releaseQueuedJob(job);
+	}
+	jobQueue.starting = 0;
+}
+
+/**
+ * @brief Function that blocks a foreground job until it is admissible, behind the queued jobs.
+ *
+ * @param processesNeeded The number of processes of the job
+ */
+void waitForAdmission(int processesNeeded) {
+	// (the queue cannot advance while its own jobs are being started)
+	if (jobQueue.starting)
+		return;
+	// The queued jobs are started as the children are reaped
+	while ((jobQueue.count > 0) || !jobAdmissible(processesNeeded)) {
+		if (reapChildren(1) > 0)
+			continue;
+		// No child is left to free a slot: the job is admitted after the queued ones
+		startQueuedJobs();
+		break;
+	}
+}
+
+/**
+ * @brief Function that blocks until every queued job has been started (e.g. before the shell exits).
+ */
+void waitForJobQueue() {
+	while (jobQueue.count > 0) {
+		if (reapChildren(1) > 0)
+			continue;
+		// No child is left to free a slot (the queue advances only if a job is started)
+		int queued = jobQueue.count;
+		startQueuedJobs();
+		if (jobQueue.count == queued)
+			break;
+	}
+}
+
+/**
+ * @brief Function that outputs the queued jobs (as listed by the jobs built-in function).
+ *
+ * @param output The output buffer
+ * @param format JOBS_LIST_DEFAULT / JOBS_LIST_LONG / JOBS_LIST_PIDS (queued jobs have no PIDs)
+ */
+void outputQueuedJobs(struct outputBuffer *output, int format) {
+	if (format == JOBS_LIST_PIDS)
+		return;
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	struct queuedJob *job;
+	for (job = jobQueue.head; job != NULL; job = job->next) {
+		if (format == JOBS_LIST_DEFAULT)
+			outputFormat(output, "[Q%lu]  %-24s%s &\n", job->number, "Queued",
+					job->pipeline.text);
+		else
+			outputFormat(output,
+					"[Q%lu]  %s &  (queued %.3fs, priority %d, %d processes)\n",
+					job->number, job->pipeline.text,
+					elapsedSeconds(&job->queued, &now), job->priority,
+					job->pipeline.commandsCount);
+	}
+}
@@ -0,0 +1,109 @@
+/*  @file job_queue.h
+ *  @author Nicolas Poyiadjis
+ *
+ *  @brief Job admission queue header.
+ *  A job is admitted only while the running jobs and processes are within their limits
+ *  (NICPOYIASH_MAX_JOBS / NICPOYIASH_MAX_PROCESSES), instead of being rejected:
+ *  	- A background job beyond the limits is queued, with its words already expanded,
+ *  	  and started automatically as soon as the finished children free enough slots
+ *  	- A foreground job waits for its turn, behind the queued jobs
+ *  Queued jobs are started in FIFO order, those of higher priority (NICPOYIASH_JOB_PRIORITY,
+ *  when the job is queued) first. When nothing is running, the next job is started
+ *  even if it needs more than the limits, so that no job is ever dropped.
+ */
+
+#ifndef JOB_QUEUE_H_
+#define JOB_QUEUE_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "parser.h"
+#include "arena.h"
+#include "output.h"
+
+// Variable giving the priority of the jobs queued (higher first, 0 by default)
+#define JOB_PRIORITY_VARIABLE "NICPOYIASH_JOB_PRIORITY"
+#define JOB_QUEUE_CHUNK_SIZE 1024
+
+/**
+ * @brief A job waiting in the admission queue.
+ * Its pipeline is a copy of its own, with every word expanded (and quoted, so that expanding it again
+ * gives the same words), allocated from an arena of its own.
+ */
+struct queuedJob {
+	unsigned long number;
+	int priority;
+	struct arena arena;
+	struct pipelineNode pipeline;
+	struct timespec queued;
+	struct queuedJob *next;
+};
+
+/**
+ * @brief The admission queue, in the order the jobs are started.
+ */
+struct jobQueue {
+	struct queuedJob *head;
+	int count;
+	unsigned long nextNumber;
+	// Whether queued jobs are being started (the queue is not entered again meanwhile)
+	int starting;
+};
+
+extern struct jobQueue jobQueue;
+
+/**
+ * @brief Function that checks whether a job can be started now,
+ * within the limits of concurrent jobs and processes (or because nothing is running).
+ *
+ * @param processesNeeded The number of processes of the job
+ * @return 1: true / 0: false
+ */
+int jobAdmissible(int processesNeeded);
+
+/**
+ * @brief Function that checks whether a background job has to wait in the admission queue.
+ *
+ * @param pipeline The pipeline of the job
+ * @return 1: true / 0: false
+ */
+int jobMustQueue(struct pipelineNode *pipeline);
+
+/**
+ * @brief Function that queues a background job, expanding its words now.
+ *
+ * @param pipeline The pipeline of the job
+ * @return 0: OK / -1: Error
+ */
+int queueJob(struct pipelineNode *pipeline);
+
+/**
+ * @brief Function that starts the queued jobs, in order, as long as they are admissible.
+ * Called whenever some children have been reaped, or a limit has changed.
+ */
+void startQueuedJobs();
+
+/**
+ * @brief Function that blocks a foreground job until it is admissible, behind the queued jobs.
+ *
+ * @param processesNeeded The number of processes of the job
+ */
+void waitForAdmission(int processesNeeded);
+
+/**
+ * @brief Function that blocks until every queued job has been started (e.g. before the shell exits).
+ */
+void waitForJobQueue();
+
+/**
+ * @brief Function that outputs the queued jobs (as listed by the jobs built-in function).
+ *
+ * @param output The output buffer
+ * @param format JOBS_LIST_DEFAULT / JOBS_LIST_LONG / JOBS_LIST_PIDS (queued jobs have no PIDs)
+ */
+void outputQueuedJobs(struct outputBuffer *output, int format);
+
+#endif /* JOB_QUEUE_H_ */
@@ -0,0 +1,327 @@
+/*  @file job_wait.c
+ *  @author Nicolas Poyiadjis
+ *
+ *  @brief Implementation of waiting for background jobs (wait built-in function)
+ */
+
+#include "processes.h"
+
+// The finished background processes not waited for yet
+struct finishedStatuses finishedStatuses = { NULL, 0, 0 };
+
+/**
+ * @brief Function that remembers the exit status of a background process that has been reaped.
+ *
+ * @param pid
+ * @param status The wait status
+ */
+void rememberFinishedStatus(pid_t pid, int status) {
+	if (finishedStatuses.count == finishedStatuses.capacity) {
+		if (finishedStatuses.capacity == FINISHED_STATUSES_REMEMBERED) {
+			// The oldest status is forgotten
+			forgetFinishedStatus(0);
+		} else {
+			int newCapacity =
+					finishedStatuses.capacity ? finishedStatuses.capacity * 2 : 16;
+			struct finishedStatus *newEntries = (struct finishedStatus*) realloc(
+					finishedStatuses.entries,
+					newCapacity * sizeof(struct finishedStatus));
+			if (newEntries == NULL) {
+				perror("malloc error");
+				return;
+			}
+			finishedStatuses.entries = newEntries;
+			finishedStatuses.capacity = newCapacity;
+		}
+	}
+	struct finishedStatus *entry =
+			&finishedStatuses.entries[finishedStatuses.count++];
+	entry->pid = pid;
+	entry->status = status;
+	entry->jobFinished = 0;
+}
+
+/**
+ * @brief Function that marks the last process of a background job as the end of its job
+ * (once the whole job has finished), so that it is reported by wait -n.
+ *
+ * @param pid The last process of the job
+ */
+void rememberFinishedJob(pid_t pid) {
+	int position = findFinishedStatus(pid);
+	if (position != -1)
+		finishedStatuses.entries[position].jobFinished = 1;
+}
+
+/**
+ * @brief Function that finds the remembered exit status of a finished background process.
+ *
+ * @param pid
+ * @return The position of the status: OK / -1: Not remembered
+ */
+int findFinishedStatus(pid_t pid) {
+	int i;
+	// (the latest process of a reused PID is found first)
+	for (i = finishedStatuses.count - 1; i >= 0; i--)
+		if (finishedStatuses.entries[i].pid == pid)
+			return i;
+	return -1;
+}
+
+/**
+ * @brief Function that forgets a remembered exit status, once it has been waited for.
+ *
+ * @param position The position of the status
+ */
+void forgetFinishedStatus(int position) {
+	memmove(&finishedStatuses.entries[position],
+			&finishedStatuses.entries[position + 1],
+			(finishedStatuses.count - position - 1)
+					* sizeof(struct finishedStatus));
+	finishedStatuses.count--;
+}
+
+/**
+ * @brief Function that opens a pidfd of a process, readable once the process has finished.
+ *
+ * @param pid
+ * @return The pidfd (close-on-exec): OK / -1: Error (e.g. not supported by the kernel)
+ */
+int openProcessFD(pid_t pid) {
+#ifdef SYS_pidfd_open
+	return (int) syscall(SYS_pidfd_open, pid, 0);
+#else
+	errno = ENOSYS;
+	return -1;
+#endif
+}
+
+/**
+ * @brief Function that blocks until at least one of the given processes has finished
+ * (or any child, if none is given), reaping every child that has finished.
+ *
+ * @param pids The processes
+ * @param count Number of processes
+ */
+void waitForProcesses(pid_t *pids, int count) {
+	int epollFD = epoll_create1(EPOLL_CLOEXEC);
+	int *processFDs = (int*) malloc((count + 1) * sizeof(int));
+	if ((epollFD == -1) || (processFDs == NULL)) {
+		perror("wait: epoll");
+		if (epollFD != -1)
+			close(epollFD);
+		free(processFDs);
+		reapChildren(1);
+		return;
+	}
+	// Any other child finishing meanwhile is reaped as well (through the child signal file descriptor)
+	struct epoll_event event;
+	event.events = EPOLLIN;
+	event.data.u32 = count;
+	epoll_ctl(epollFD, EPOLL_CTL_ADD, childSignalFD, &event);
+	int i;
+	for (i = 0; i < count; i++) {
+		processFDs[i] = openProcessFD(pids[i]);
+		if (processFDs[i] == -1)
+			continue;
+		event.data.u32 = i;
+		epoll_ctl(epollFD, EPOLL_CTL_ADD, processFDs[i], &event);
+	}
+	fflush(stdout);
+	struct epoll_event events[WAIT_EVENTS];
+	int eventsCount;
+	while (((eventsCount = epoll_wait(epollFD, events, WAIT_EVENTS, -1)) == -1)
+			&& (errno == EINTR))
+		;
+	reapChildren(0);
+	// A process finished but not reaped is not a child of this process
+	// (e.g. waited for within a pipeline, by a forked built-in function): it is no longer waited for
+	for (i = 0; i < eventsCount; i++) {
+		int process = events[i].data.u32;
+		struct pidEntry entry;
+		if ((process < count)
+				&& (pidMapLookup(&processes, pids[process]) != NULL)
+				&& (waitpid(pids[process], NULL, WNOHANG) == -1)
+				&& (errno == ECHILD))
+			processFinished(pids[process], &entry);
+	}
+	for (i = 0; i < count; i++)
+		if (processFDs[i] != -1)
+			close(processFDs[i]);
+	free(processFDs);
+	close(epollFD);
+}
+
+/**
+ * @brief Function that collects the processes of the background jobs still running.
+ *
+ * @param pids Filled in with the processes (allocated)
+ * @return Number of processes: OK / -1: Error
+ */
+int collectBackgroundProcesses(pid_t **pids) {
+	int capacity = 0;
+	int i;
+	for (i = 0; i < jobsCapacity; i++)
+		if (jobs[i].running && jobs[i].background)
+			capacity += jobs[i].processesActive;
+	*pids = (pid_t*) malloc((capacity + 1) * sizeof(pid_t));
+	if (*pids == NULL) {
+		perror("malloc error");
+		return -1;
+	}
+	int count = 0;
+	for (i = 0; i < jobsCapacity; i++) {
+		struct job *job = &jobs[i];
+		if (!job->running || !job->background)
+			continue;
+		int stage;
+		for (stage = 0; (stage < job->processesCount) && (count < capacity);
+				stage++)
+			if ((job->statuses[stage] == -1)
+					&& (pidMapLookup(&processes, job->pids[stage]) != NULL))
+				(*pids)[count++] = job->pids[stage];
+	}
+	return count;
+}
+
+/**
+ * @brief Function that waits for every process of a job to finish.
+ *
+ * @param jobIndex
+ * @return The exit status of the last process of the job
+ */
+int waitForBackgroundJob(int jobIndex) {
+	struct job *job = &jobs[jobIndex];
+	int count = job->processesCount;
+	if (count == 0)
+		return 0;
+	// (the job position may be reused once the job has finished)
+	pid_t *pids = (pid_t*) malloc(count * sizeof(pid_t));
+	if (pids == NULL) {
+		perror("malloc error");
+		return 1;
+	}
+	memcpy(pids, job->pids, count * sizeof(pid_t));
+	pid_t lastPid = pids[count - 1];
+	int active = count;
+	while (active > 0) {
+		// The processes still running are kept at the front
+		int i;
+		active = 0;
+		for (i = 0; i < count; i++)
+			if (pidMapLookup(&processes, pids[i]) != NULL) {
+				pid_t pid = pids[i];
+				pids[i] = pids[active];
+				pids[active++] = pid;
+			}
+		if (active > 0)
+			waitForProcesses(pids, active);
+	}
+	// The last process gives the exit status, and the whole job has been waited for
+	int status = WAIT_UNKNOWN_STATUS;
+	int position = findFinishedStatus(lastPid);
+	if (position != -1)
+		status = exitStatusOf(finishedStatuses.entries[position].status);
+	int i;
+	for (i = 0; i < count; i++)
+		if ((position = findFinishedStatus(pids[i])) != -1)
+			forgetFinishedStatus(position);
+	free(pids);
+	return status;
+}
+
+/**
+ * @brief Function that waits for a process to finish.
+ *
+ * @param pid
+ * @return The exit status of the process / WAIT_UNKNOWN_STATUS: Not a child of the shell
+ */
+int waitForBackgroundProcess(pid_t pid) {
+	while (pidMapLookup(&processes, pid) != NULL)
+		waitForProcesses(&pid, 1);
+	int position = findFinishedStatus(pid);
+	if (position == -1)
+		return WAIT_UNKNOWN_STATUS;
+	int status = exitStatusOf(finishedStatuses.entries[position].status);
+	forgetFinishedStatus(position);
+	return status;
+}
+
+/**
+ * @brief Function that waits for every background job, and for the queued jobs, to finish.
+ * The exit statuses remembered are forgotten.
+ *
+ * @return 0
+ */
+int waitForBackgroundJobs() {
+	while (1) {
+		pid_t *pids;
+		int count = collectBackgroundProcesses(&pids);
+		if (count == -1)
+			return 1;
+		if (count > 0)
+			waitForProcesses(pids, count);
+		free(pids);
+		if (count > 0)
+			continue;
+		// Nothing is running: the queued jobs are started (or nothing is left)
+		int queued = jobQueue.count;
+		if (queued == 0)
+			break;
+		startQueuedJobs();
+		if (jobQueue.count == queued)
+			break;
+	}
+	finishedStatuses.count = 0;
+	return 0;
+}
+
+/**
+ * @brief Function that waits for the next background job to finish (wait -n):
+ * a job already finished but not waited for yet is reported at once.
+ *
+ * @param pids The processes to wait for (the last ones of the jobs given) / NULL: Any job
+ * @param count Number of processes
+ * @return The exit status of the job / WAIT_UNKNOWN_STATUS: Nothing to wait for
+ */
+int waitForNextJob(pid_t *pids, int count) {
+	while (1) {
+		int i;
+		for (i = 0; i < finishedStatuses.count; i++) {
+			struct finishedStatus *entry = &finishedStatuses.entries[i];
+			int waited = (pids == NULL) ? entry->jobFinished : 0;
+			int j;
+			for (j = 0; j < count; j++)
+				if (pids[j] == entry->pid)
+					waited = 1;
+			if (waited) {
+				int status = exitStatusOf(entry->status);
+				forgetFinishedStatus(i);
+				return status;
+			}
+		}
+		// Block on the processes still running
+		pid_t *active;
+		int activeCount;
+		if (pids == NULL) {
+			activeCount = collectBackgroundProcesses(&active);
+			if (activeCount == -1)
+				return 1;
+		} else {
+			active = (pid_t*) malloc((count + 1) * sizeof(pid_t));
+			if (active == NULL) {
+				perror("malloc error");
+				return 1;
+			}
+			activeCount = 0;
+			for (i = 0; i < count; i++)
+				if (pidMapLookup(&processes, pids[i]) != NULL)
+					active[activeCount++] = pids[i];
+		}
+		if (activeCount > 0)
+			waitForProcesses(active, activeCount);
+		free(active);
+		if (activeCount == 0)
+			return WAIT_UNKNOWN_STATUS;
+	}
+}
@@ -0,0 +1,142 @@
+/*  @file job_wait.h
+ *  @author Nicolas Poyiadjis
+ *
+ *  @brief Header of waiting for background jobs (wait built-in function).
+ *  The shell blocks in epoll on a pidfd of every process waited for, and on the child signal
+ *  file descriptor, so that the other children finishing meanwhile are reaped (and the queued jobs
+ *  started) as well. Nothing is polled: the shell sleeps until a child has finished.
+ *  The exit status of every background process is remembered once it has been reaped,
+ *  until it has been waited for, so that a job can be waited for even after it has finished.
+ */
+
+#ifndef JOB_WAIT_H_
+#define JOB_WAIT_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+
+// Exit statuses of finished background processes remembered (the oldest ones are forgotten)
+#define FINISHED_STATUSES_REMEMBERED 1024
+// Exit status of waiting for a process or job unknown to the shell
+#define WAIT_UNKNOWN_STATUS 127
+// Events handled per epoll wakeup
+#define WAIT_EVENTS 64
+
+/**
+ * @brief The exit status of a finished background process, not waited for yet.
+ */
+struct finishedStatus {
+	pid_t pid;
+	int status;
+	// Whether the process is the last one of its job, and its job has finished
+	int jobFinished;
+};
+
+/**
+ * @brief The finished background processes not waited for yet, in the order they finished.
+ */
+struct finishedStatuses {
+	struct finishedStatus *entries;
+	int count;
+	int capacity;
+};
+
+extern struct finishedStatuses finishedStatuses;
+
+/**
+ * @brief Function that remembers the exit status of a background process that has been reaped.
+ *
+ * @param pid
+ * @param status The wait status
+ */
+void rememberFinishedStatus(pid_t pid, int status);
+
+/**
+ * @brief Function that marks the last process of a background job as the end of its job
+ * (once the whole job has finished), so that it is reported by wait -n.
+ *
+ * @param pid The last process of the job
+ */
+void rememberFinishedJob(pid_t pid);
+
+/**
+ * @brief Function that finds the remembered exit status of a finished background process.
+ *
+ * @param pid
+ * @return The position of the status: OK / -1: Not remembered
+ */
+int findFinishedStatus(pid_t pid);
+
+/**
+ * @brief Function that forgets a remembered exit status, once it has been waited for.
+ *
+ * @param position The position of the status
+ */
+void forgetFinishedStatus(int position);
+
+/**
+ * @brief Function that opens a pidfd of a process, readable once the process has finished.
+ *
+ * @param pid
+ * @return The pidfd (close-on-exec): OK / -1: Error (e.g. not supported by the kernel)
+ */
+int openProcessFD(pid_t pid);
+
+/**
+ * @brief Function that collects the processes of the background jobs still running.
+ *
+ * @param pids Filled in with the processes (allocated)
+ * @return Number of processes: OK / -1: Error
+ */
+int collectBackgroundProcesses(pid_t **pids);
+
+/**
+ * @brief Function that blocks until at least one of the given processes has finished
+ * (or any child, if none is given), reaping every child that has finished.
+ *
+ * @param pids The processes
+ * @param count Number of processes
+ */
+void waitForProcesses(pid_t *pids, int count);
+
+/**
+ * @brief Function that waits for every process of a job to finish.
+ *
+ * @param jobIndex
+ * @return The exit status of the last process of the job
+ */
+int waitForBackgroundJob(int jobIndex);
+
+/**
+ * @brief Function that waits for a process to finish.
+ *
+ * @param pid
+ * @return The exit status of the process / WAIT_UNKNOWN_STATUS: Not a child of the shell
+ */
+int waitForBackgroundProcess(pid_t pid);
+
+/**
+ * @brief Function that waits for every background job, and for the queued jobs, to finish.
+ * The exit statuses remembered are forgotten.
+ *
+ * @return 0
+ */
+int waitForBackgroundJobs();
+
+/**
+ * @brief Function that waits for the next background job to finish (wait -n):
+ * a job already finished but not waited for yet is reported at once.
+ *
+ * @param pids The processes to wait for (the last ones of the jobs given) / NULL: Any job
+ * @param count Number of processes
+ * @return The exit status of the job / WAIT_UNKNOWN_STATUS: Nothing to wait for
+ */
+int waitForNextJob(pid_t *pids, int count);
+
+#endif /* JOB_WAIT_H_ */
@@ -17,47 +17,32 @@
 #include "processes.h"
 #include "pipes.h"
 #include "commands.h"
+#include "parser.h"
+#include "builtin_stages.h"
 
 /**
- * @brief Function that carries out the execution of a complete given jobScript.
- * The job may consist of multiple commands, containing pipes and redirections.
+ * @brief Function that starts a job.
  *
- * @param jobScript
- * @return The number of forked processes / -1: Error occurred
+ * @param pipeline The pipeline syntax tree of the job
+ * @return Job index: OK / -1: Job could not be started
  */
-int executeJob(char *jobScript);
-
-/** @brief This function splits the individual jobs, separated by ';' or '&'.
- * The full job script is given as the first parameter,
- * while the second parameter is filled with up to MAX_JOBS individual jobs.
- *
- * @param jobScript The entire job script
- * @param splittedJobs Splitted jobs container
- * @param countOnly Whether to count only / or also to split the script
- * @param wordsCount Number of words in the script
- * @param splittedWords Splitted words container
- * @return The number of jobs discovereds
- */
-int splitJobs(char *jobScript, char ***splittedJobs, int countOnly,
-		int wordsCount, char *splittedWords[]);
+int jobStarted(struct pipelineNode *pipeline);
 
 /**
- * @brief Function the discovers the pipeline structure within a given job.
+ * @brief Function that carries out the execution of a complete given job.
+ * The job may consist of multiple commands, containing pipes and redirections.
  *
- * @param pipeDelimited A job containing process commands delimiter using pipes
- * @param pipedProcesses Container to be filled with single pipelined processes
- * @param countOnly Whether to count only / or also to split the job
+ * @param pipeline The pipeline syntax tree of the job
+ * @return The number of forked processes / -1: Error occurred
  */
-int getPipedProcesses(char *pipeDelimited, char ***pipedProcesses,
-		int countOnly);
+int executeJob(struct pipelineNode *pipeline);
 
 /**
  * @brief Function that executes a sequence of piped commands and handles their communication.
  *
- * @param pipedCount
- * @param pipedJob
+ * @param pipeline The pipeline syntax tree
  * @return The number of forked processes / -1: Error occurred
  */
-int handlePipedCommands(int pipedCount, char *pipedCommand);
+int handlePipedCommands(struct pipelineNode *pipeline);
 
 #endif /* JOBS_H_ */
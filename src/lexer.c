@@ -0,0 +1,276 @@
+/*  @file lexer.c
+ *  @author Nicolas Poyiadjis
+ *
+ *  @brief Script lexer implementation.
+ *  The script is scanned once, from the beginning to the end, producing a stream of tokens.
+ *  Quoted text ('...', "...") and escaped characters (\c) never delimit words or operators.
+ */
+
+#include "lexer.h"
+
+/**
+ * @brief Function that initializes a lexer to scan the given script.
+ *
+ * @param lexer
+ * @param input The script text
+ * @param length The script length
+ */
+void initializeLexer(struct lexer *lexer, const char *input, size_t length) {
+	lexer->input = input;
+	lexer->length = length;
+	lexer->position = 0;
+	lexer->quiet = 0;
+}
+
+/**
+ * @brief Function that finds the end of an arithmetic expression, up to the matching )).
+ * Nested parentheses are part of the expression.
+ *
+ * @param text The expression text, after the opening ((
+ * @param length The maximum length to scan
+ * @return The expression length (the )) follows) / -1: No matching ))
+ */
+long arithmeticExpressionLength(const char *text, size_t length) {
+	int depth = 0;
+	size_t i;
+	for (i = 0; i < length; i++) {
+		if (text[i] == '(') {
+			depth++;
+		} else if (text[i] == ')') {
+			if ((depth == 0) && (i + 1 < length) && (text[i + 1] == ')'))
+				return i;
+			if (depth == 0)
+				return -1;
+			depth--;
+		}
+	}
+	return -1;
+}
+
+/**
+ * @brief Function that checks whether a character ends an unquoted word.
+ *
+ * @param character
+ * @return 1: true / 0: false
+ */
+int isWordDelimiter(char character) {
+	switch (character) {
+	case ' ':
+	case '\t':
+	case '\n':
+	case '|':
+	case '&':
+	case ';':
+	case '<':
+	case '>':
+		return 1;
+	}
+	return 0;
+}
+
+/**
+ * @brief Function that returns the character at a given offset from the current position.
+ *
+ * @return The character / '\0' past the end of the script
+ */
+char peekCharacter(struct lexer *lexer, size_t offset) {
+	if (lexer->position + offset >= lexer->length)
+		return '\0';
+	return lexer->input[lexer->position + offset];
+}
+
+/**
+ * @brief Function that scans a redirection operator, once its first symbol has been reached.
+ *
+ * @param lexer
+ * @param token The token to be filled in
+ * @param fd The file descriptor given before the operator / -1: None given
+ * @return The token type
+ */
+int scanRedirection(struct lexer *lexer, struct token *token, int fd) {
+	token->type = TOKEN_REDIRECTION;
+	char symbol = peekCharacter(lexer, 0);
+	// &> (both standard output and error)
+	if (symbol == '&') {
+		lexer->position += 2;
+		token->redirection = REDIRECT_OUTPUT_ERROR;
+		token->fd = 1;
+		return token->type;
+	}
+	lexer->position++;
+	if (peekCharacter(lexer, 0) == '&') {
+		lexer->position++;
+		token->redirection = REDIRECT_DUPLICATE;
+	} else if ((symbol == '>') && (peekCharacter(lexer, 0) == '>')) {
+		lexer->position++;
+		token->redirection = REDIRECT_APPEND;
+	} else {
+		token->redirection = (symbol == '<') ? REDIRECT_INPUT : REDIRECT_OUTPUT;
+	}
+	if (fd == -1)
+		fd = (symbol == '<') ? 0 : 1;
+	token->fd = fd;
+	return token->type;
+}
+
+/**
+ * @brief Function that scans a word, up to the first unquoted delimiter.
+ *
+ * @param lexer
+ * @param token The token to be filled in
+ * @return The token type
+ */
+int scanWord(struct lexer *lexer, struct token *token) {
+	size_t start = lexer->position;
+	int digitsOnly = 1;
+	while (lexer->position < lexer->length) {
+		char character = lexer->input[lexer->position];
+		if (isWordDelimiter(character))
+			break;
+		if (!isdigit((unsigned char) character))
+			digitsOnly = 0;
+		if (character == '\\') {
+			lexer->position += 2;
+			continue;
+		}
+		if ((character == '$') && (peekCharacter(lexer, 1) == '(')
+				&& (peekCharacter(lexer, 2) == '(')) {
+			// An arithmetic expansion $(( )) is part of the word, whatever it contains
+			long expressionLength = arithmeticExpressionLength(
+					lexer->input + lexer->position + 3,
+					lexer->length - lexer->position - 3);
+			if (expressionLength != -1) {
+				lexer->position += expressionLength + 5;
+				continue;
+			}
+		}
+		if ((character == '\'') || (character == '"')) {
+			// Skip up to the closing quote
+			lexer->position++;
+			while ((lexer->position < lexer->length)
+					&& (lexer->input[lexer->position] != character)) {
+				if ((character == '"')
+						&& (lexer->input[lexer->position] == '\\'))
+					lexer->position++;
+				lexer->position++;
+			}
+			if (lexer->position >= lexer->length) {
+				if (!lexer->quiet)
+					fprintf(stderr,
+							"nicpoyia-sh: unexpected EOF while looking for matching `%c'\n",
+							character);
+				token->type = TOKEN_ERROR;
+				return token->type;
+			}
+		}
+		lexer->position++;
+	}
+	if (lexer->position > lexer->length)
+		lexer->position = lexer->length;
+	// A number right before a redirection operator is the file descriptor to redirect (e.g. 2>)
+	char next = peekCharacter(lexer, 0);
+	if (digitsOnly && ((next == '<') || (next == '>'))) {
+		token->text = lexer->input + start;
+		token->length = lexer->position - start;
+		return scanRedirection(lexer, token, atoi(lexer->input + start));
+	}
+	token->type = TOKEN_WORD;
+	token->text = lexer->input + start;
+	token->length = lexer->position - start;
+	return token->type;
+}
+
+/**
+ * @brief Function that scans the next token of the script.
+ *
+ * @param lexer
+ * @param token The token to be filled in
+ * @return The token type
+ */
+int nextToken(struct lexer *lexer, struct token *token) {
+	// Skip whitespace and comments
+	while (lexer->position < lexer->length) {
+		char character = lexer->input[lexer->position];
+		if ((character == ' ') || (character == '\t') || (character == '\r')) {
+			lexer->position++;
+		} else if (character == '#') {
+			while ((lexer->position < lexer->length)
+					&& (lexer->input[lexer->position] != '\n'))
+				lexer->position++;
+		} else if ((character == '\\') && (peekCharacter(lexer, 1) == '\n')) {
+			// Line continuation
+			lexer->position += 2;
+		} else {
+			break;
+		}
+	}
+	token->text = lexer->input + lexer->position;
+	token->length = 1;
+	token->redirection = 0;
+	token->fd = -1;
+	if (lexer->position >= lexer->length) {
+		token->type = TOKEN_END;
+		token->length = 0;
+		return token->type;
+	}
+	switch (lexer->input[lexer->position]) {
+	case '|':
+		if (peekCharacter(lexer, 1) == '|') {
+			token->type = TOKEN_OR;
+			token->length = 2;
+			lexer->position++;
+			break;
+		}
+		token->type = TOKEN_PIPE;
+		break;
+	case ';':
+		token->type = TOKEN_SEPARATOR;
+		break;
+	case '\n':
+		token->type = TOKEN_NEWLINE;
+		break;
+	case '&':
+		if (peekCharacter(lexer, 1) == '>') {
+			scanRedirection(lexer, token, -1);
+			token->length = 2;
+			return token->type;
+		}
+		if (peekCharacter(lexer, 1) == '&') {
+			token->type = TOKEN_AND;
+			token->length = 2;
+			lexer->position++;
+			break;
+		}
+		token->type = TOKEN_BACKGROUND;
+		break;
+	case '(':
+		if (peekCharacter(lexer, 1) == '(') {
+			// Arithmetic command: the token text is the expression
+			long expressionLength = arithmeticExpressionLength(
+					lexer->input + lexer->position + 2,
+					lexer->length - lexer->position - 2);
+			if (expressionLength == -1) {
+				if (!lexer->quiet)
+					fprintf(stderr,
+							"nicpoyia-sh: unexpected EOF while looking for matching `))'\n");
+				token->type = TOKEN_ERROR;
+				return token->type;
+			}
+			token->type = TOKEN_ARITHMETIC;
+			token->text = lexer->input + lexer->position + 2;
+			token->length = expressionLength;
+			lexer->position += expressionLength + 4;
+			return token->type;
+		}
+		return scanWord(lexer, token);
+	case '<':
+	case '>':
+		scanRedirection(lexer, token, -1);
+		token->length = (lexer->input + lexer->position) - token->text;
+		return token->type;
+	default:
+		return scanWord(lexer, token);
+	}
+	lexer->position++;
+	return token->type;
+}
@@ -0,0 +1,90 @@
+/*  @file lexer.h
+ *  @author Nicolas Poyiadjis
+ *
+ *  @brief Script lexer header.
+ *  The script is scanned once, from the beginning to the end, producing a stream of tokens.
+ *  Quoted text ('...', "...") and escaped characters (\c) never delimit words or operators.
+ */
+
+#ifndef LEXER_H_
+#define LEXER_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+// Token types
+#define TOKEN_ERROR -1
+#define TOKEN_END 0
+#define TOKEN_WORD 1
+#define TOKEN_PIPE 2
+#define TOKEN_BACKGROUND 3
+#define TOKEN_SEPARATOR 4
+#define TOKEN_NEWLINE 5
+#define TOKEN_REDIRECTION 6
+#define TOKEN_AND 7
+#define TOKEN_OR 8
+#define TOKEN_ARITHMETIC 9		// (( expression ))
+
+// Redirection operators
+#define REDIRECT_INPUT 1		// [n]<
+#define REDIRECT_OUTPUT 2		// [n]>
+#define REDIRECT_APPEND 3		// [n]>>
+#define REDIRECT_OUTPUT_ERROR 4	// &>
+#define REDIRECT_DUPLICATE 5	// [n]>&m / [n]<&m
+
+/**
+ * @brief A token of the script.
+ * Token text is not copied, it points within the script.
+ */
+struct token {
+	int type;
+	const char *text;
+	size_t length;
+	// Redirection operator and the file descriptor it is applied to (redirection tokens only)
+	int redirection;
+	int fd;
+};
+
+/**
+ * @brief The lexer state over a script.
+ * The script does not need to be NUL-terminated.
+ */
+struct lexer {
+	const char *input;
+	size_t length;
+	size_t position;
+	// Whether scanning errors are left unreported
+	int quiet;
+};
+
+/**
+ * @brief Function that finds the end of an arithmetic expression, up to the matching )).
+ * Nested parentheses are part of the expression.
+ *
+ * @param text The expression text, after the opening ((
+ * @param length The maximum length to scan
+ * @return The expression length (the )) follows) / -1: No matching ))
+ */
+long arithmeticExpressionLength(const char *text, size_t length);
+
+/**
+ * @brief Function that initializes a lexer to scan the given script.
+ *
+ * @param lexer
+ * @param input The script text
+ * @param length The script length
+ */
+void initializeLexer(struct lexer *lexer, const char *input, size_t length);
+
+/**
+ * @brief Function that scans the next token of the script.
+ *
+ * @param lexer
+ * @param token The token to be filled in
+ * @return The token type
+ */
+int nextToken(struct lexer *lexer, struct token *token);
+
+#endif /* LEXER_H_ */
@@ -0,0 +1,661 @@
+/*  @file line_editor.c
+ *  @author Nicolas Poyiadjis
+ *
+ *  @brief Interactive line editor implementation
+ */
+
+#include "line_editor.h"
+
+// The terminal attributes restored once a line has been read
+struct termios originalTerminalAttributes;
+
+/**
+ * @brief Function that checks whether lines can be edited (standard input and output are a terminal).
+ *
+ * @return 1: true / 0: false
+ */
+int lineEditingAvailable() {
+	const char *terminal = getVariable("TERM");
+	if ((terminal != NULL) && (strcmp(terminal, "dumb") == 0))
+		return 0;
+	return isatty(STDIN_FILENO) && isatty(STDOUT_FILENO);
+}
+
+/**
+ * @brief Function that switches the terminal to raw mode (no echo, keys read one by one).
+ *
+ * @return 0: OK / -1: Error
+ */
+int enableRawMode() {
+	if (tcgetattr(STDIN_FILENO, &originalTerminalAttributes) == -1)
+		return -1;
+	struct termios raw = originalTerminalAttributes;
+	raw.c_iflag &= ~(BRKINT | ICRNL | INPCK | ISTRIP | IXON);
+	raw.c_cflag |= CS8;
+	raw.c_lflag &= ~(ECHO | ICANON | IEXTEN | ISIG);
+	raw.c_cc[VMIN] = 1;
+	raw.c_cc[VTIME] = 0;
+	return tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw);
+}
+
+/**
+ * @brief Function that restores the terminal attributes.
+ */
+void disableRawMode() {
+	tcsetattr(STDIN_FILENO, TCSAFLUSH, &originalTerminalAttributes);
+}
+
+/**
+ * @brief Function that checks whether a byte continues a UTF-8 character.
+ *
+ * @param character
+ * @return 1: true / 0: false
+ */
+int isContinuationByte(char character) {
+	return (character & 0xC0) == 0x80;
+}
+
+/**
+ * @brief Function that returns the number of terminal columns taken by a text.
+ *
+ * @param text
+ * @param length The text length
+ * @return The number of columns
+ */
+size_t textColumns(const char *text, size_t length) {
+	size_t columns = 0;
+	size_t i;
+	for (i = 0; i < length; i++)
+		if (!isContinuationByte(text[i]))
+			columns++;
+	return columns;
+}
+
+/**
+ * @brief Function that makes room for some more bytes in the edited line.
+ *
+ * @param editor
+ * @param extra Number of bytes to add
+ * @return 0: OK / -1: Error
+ */
+int reserveEditorLine(struct lineEditor *editor, size_t extra) {
+	if (editor->length + extra + 1 <= editor->capacity)
+		return 0;
+	size_t capacity = 2 * (editor->length + extra + 1);
+	char *buffer = (char*) realloc(editor->buffer, capacity);
+	if (buffer == NULL) {
+		perror("malloc error");
+		return -1;
+	}
+	editor->buffer = buffer;
+	editor->capacity = capacity;
+	return 0;
+}
+
+/**
+ * @brief Function that inserts some text at the cursor.
+ *
+ * @param editor
+ * @param text
+ * @param length The text length
+ * @return 0: OK / -1: Error
+ */
+int insertEditorText(struct lineEditor *editor, const char *text, size_t length) {
+	if (reserveEditorLine(editor, length) == -1)
+		return -1;
+	memmove(editor->buffer + editor->cursor + length,
+			editor->buffer + editor->cursor, editor->length - editor->cursor + 1);
+	memcpy(editor->buffer + editor->cursor, text, length);
+	editor->length += length;
+	editor->cursor += length;
+	return 0;
+}
+
+/**
+ * @brief Function that deletes the text between two positions (the cursor is moved to the first).
+ *
+ * @param editor
+ * @param start
+ * @param end
+ */
+void deleteEditorText(struct lineEditor *editor, size_t start, size_t end) {
+	memmove(editor->buffer + start, editor->buffer + end,
+			editor->length - end + 1);
+	editor->length -= end - start;
+	editor->cursor = start;
+}
+
+/**
+ * @brief Function that replaces the whole edited line (the cursor is moved to its end).
+ *
+ * @param editor
+ * @param text
+ * @param length The text length
+ * @return 0: OK / -1: Error
+ */
+int replaceEditorLine(struct lineEditor *editor, const char *text, size_t length) {
+	editor->length = 0;
+	editor->cursor = 0;
+	editor->buffer[0] = '\0';
+	return insertEditorText(editor, text, length);
+}
+
+/**
+ * @brief Function that returns the position of the character before a position.
+ */
+size_t previousCharacter(struct lineEditor *editor, size_t position) {
+	if (position > 0)
+		position--;
+	while ((position > 0) && isContinuationByte(editor->buffer[position]))
+		position--;
+	return position;
+}
+
+/**
+ * @brief Function that returns the position of the character after a position.
+ */
+size_t nextCharacter(struct lineEditor *editor, size_t position) {
+	if (position < editor->length)
+		position++;
+	while ((position < editor->length)
+			&& isContinuationByte(editor->buffer[position]))
+		position++;
+	return position;
+}
+
+/**
+ * @brief Function that returns the start of the word before a position.
+ */
+size_t previousWord(struct lineEditor *editor, size_t position) {
+	while ((position > 0) && (editor->buffer[position - 1] == ' '))
+		position--;
+	while ((position > 0) && (editor->buffer[position - 1] != ' '))
+		position--;
+	return position;
+}
+
+/**
+ * @brief Function that returns the end of the word after a position.
+ */
+size_t nextWord(struct lineEditor *editor, size_t position) {
+	while ((position < editor->length) && (editor->buffer[position] == ' '))
+		position++;
+	while ((position < editor->length) && (editor->buffer[position] != ' '))
+		position++;
+	return position;
+}
+
+/**
+ * @brief Function that moves the terminal cursor between two columns of the prompt and line,
+ * which may wrap across several screen rows.
+ *
+ * @param editor
+ * @param from The current column (counted from the start of the prompt)
+ * @param to The target column
+ */
+void moveEditorCursor(struct lineEditor *editor, size_t from, size_t to) {
+	size_t fromRow = from / editor->columns;
+	size_t toRow = to / editor->columns;
+	if (toRow < fromRow)
+		outputFormat(&editor->output, "\x1b[%zuA", fromRow - toRow);
+	else if (toRow > fromRow)
+		outputFormat(&editor->output, "\x1b[%zuB", toRow - fromRow);
+	size_t fromColumn = from % editor->columns;
+	size_t toColumn = to % editor->columns;
+	if (toColumn == fromColumn)
+		return;
+	if (toColumn == 0)
+		outputCharacter(&editor->output, '\r');
+	else if (toColumn > fromColumn)
+		outputFormat(&editor->output, "\x1b[%zuC", toColumn - fromColumn);
+	else if (toColumn < fromColumn)
+		outputFormat(&editor->output, "\x1b[%zuD", fromColumn - toColumn);
+}
+
+/**
+ * @brief Function that brings the screen up to date with the edited line.
+ * Only the text after the first difference from the text on the screen is written.
+ *
+ * @param editor
+ * @return 0: OK / -1: Error
+ */
+int refreshEditorLine(struct lineEditor *editor) {
+	struct winsize size;
+	editor->columns = ((ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0)
+			&& (size.ws_col > 0)) ? size.ws_col : LINE_EDITOR_DEFAULT_COLUMNS;
+	size_t common = 0;
+	while ((common < editor->shownLength) && (common < editor->length)
+			&& (editor->shown[common] == editor->buffer[common]))
+		common++;
+	while ((common > 0) && (common < editor->length)
+			&& isContinuationByte(editor->buffer[common]))
+		common--;
+	if ((common == editor->shownLength) && (common == editor->length)
+			&& (editor->cursor == editor->shownCursor)) {
+		outputFlush(&editor->output);
+		return 0;
+	}
+	size_t shownColumns = editor->promptColumns
+			+ textColumns(editor->shown, editor->shownLength);
+	size_t commonColumns = editor->promptColumns
+			+ textColumns(editor->buffer, common);
+	size_t endColumns = commonColumns
+			+ textColumns(editor->buffer + common, editor->length - common);
+	moveEditorCursor(editor,
+			editor->promptColumns
+					+ textColumns(editor->shown, editor->shownCursor),
+			commonColumns);
+	outputWrite(&editor->output, editor->buffer + common, editor->length - common);
+	// At the last column, the terminal only wraps on the next character: wrap now
+	if ((editor->length > common) && (endColumns % editor->columns == 0))
+		outputString(&editor->output, "\r\n");
+	if (shownColumns > endColumns)
+		outputString(&editor->output, "\x1b[J");
+	moveEditorCursor(editor, endColumns,
+			editor->promptColumns + textColumns(editor->buffer, editor->cursor));
+	outputFlush(&editor->output);
+	// Remember what is on the screen
+	if (editor->length + 1 > editor->shownCapacity) {
+		char *shown = (char*) realloc(editor->shown, editor->capacity);
+		if (shown == NULL) {
+			perror("malloc error");
+			return -1;
+		}
+		editor->shown = shown;
+		editor->shownCapacity = editor->capacity;
+	}
+	memcpy(editor->shown, editor->buffer, editor->length + 1);
+	editor->shownLength = editor->length;
+	editor->shownCursor = editor->cursor;
+	return 0;
+}
+
+/**
+ * @brief Function that erases the prompt and line from the screen (e.g. to report a finished job).
+ *
+ * @param editor
+ */
+void hideEditorLine(struct lineEditor *editor) {
+	moveEditorCursor(editor,
+			editor->promptColumns
+					+ textColumns(editor->shown, editor->shownCursor), 0);
+	outputString(&editor->output, "\r\x1b[J");
+	outputFlush(&editor->output);
+	editor->shownLength = 0;
+	editor->shownCursor = 0;
+}
+
+/**
+ * @brief Function that displays the prompt and the whole line, from the current screen position.
+ *
+ * @param editor
+ * @return 0: OK / -1: Error
+ */
+int showEditorLine(struct lineEditor *editor) {
+	outputString(&editor->output, editor->prompt);
+	editor->shownLength = 0;
+	editor->shownCursor = 0;
+	if (editor->length == 0) {
+		outputFlush(&editor->output);
+		return 0;
+	}
+	return refreshEditorLine(editor);
+}
+
+/**
+ * @brief Function that moves the cursor to the end of the line and starts a new screen line.
+ *
+ * @param editor
+ */
+void finishEditorLine(struct lineEditor *editor) {
+	editor->cursor = editor->length;
+	refreshEditorLine(editor);
+	outputString(&editor->output, "\r\n");
+	outputFlush(&editor->output);
+}
+
+/**
+ * @brief Function that waits for the next key byte.
+ * Background jobs finishing meanwhile are reported on a clean line, and the line is displayed again.
+ *
+ * @param editor
+ * @param key Filled in with the byte read
+ * @return 1: OK / 0: End of input / -1: Error
+ */
+int readEditorKey(struct lineEditor *editor, unsigned char *key) {
+	struct pollfd pollFDs[2];
+	pollFDs[0].fd = STDIN_FILENO;
+	pollFDs[0].events = POLLIN;
+	pollFDs[1].fd = childSignalFD;
+	pollFDs[1].events = POLLIN;
+	while (1) {
+		if (poll(pollFDs, 2, -1) == -1) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		if (pollFDs[0].revents) {
+			ssize_t bytes = read(STDIN_FILENO, key, 1);
+			if (bytes == 1)
+				return 1;
+			if ((bytes == -1) && (errno == EINTR))
+				continue;
+			return (bytes == 0) ? 0 : -1;
+		}
+		if (pollFDs[1].revents) {
+			hideEditorLine(editor);
+			reapChildren(0);
+			fflush(stdout);
+			if (showEditorLine(editor) == -1)
+				return -1;
+		}
+	}
+}
+
+/**
+ * @brief Function that reads the next byte of an escape sequence, if it follows shortly.
+ *
+ * @return The byte / -1: None
+ */
+int readEscapeByte() {
+	struct pollfd pollFD;
+	pollFD.fd = STDIN_FILENO;
+	pollFD.events = POLLIN;
+	unsigned char byte;
+	if ((poll(&pollFD, 1, LINE_EDITOR_ESCAPE_TIMEOUT) <= 0)
+			|| (read(STDIN_FILENO, &byte, 1) != 1))
+		return -1;
+	return byte;
+}
+
+/**
+ * @brief Function that recalls the previous (or next) command of the history.
+ * Commands of several lines are skipped.
+ *
+ * @param editor
+ * @param direction -1: Previous / 1: Next
+ * @return 0: OK / -1: Error
+ */
+int recallHistory(struct lineEditor *editor, int direction) {
+	if (editor->historyNumber == 0) {
+		if (direction > 0)
+			return 0;
+		// The line being edited is kept, to be restored after the newest command
+		free(editor->savedLine);
+		editor->savedLine = strdup(editor->buffer);
+		if (editor->savedLine == NULL) {
+			perror("malloc error");
+			return -1;
+		}
+		editor->historyNumber = history.last + 1;
+	}
+	unsigned long number = editor->historyNumber;
+	struct historyEntry *entry = NULL;
+	while (entry == NULL) {
+		if ((direction < 0) && (number <= firstHistoryNumber()))
+			return 0;
+		number += direction;
+		if (number > history.last)
+			break;
+		entry = findHistoryEntry(number);
+		if ((entry != NULL) && (memchr(entry->text, '\n', entry->length) != NULL))
+			entry = NULL;
+	}
+	editor->historyNumber = number;
+	if (entry == NULL) {
+		// Back to the line being edited
+		editor->historyNumber = 0;
+		return replaceEditorLine(editor, editor->savedLine,
+				strlen(editor->savedLine));
+	}
+	return replaceEditorLine(editor, entry->text, entry->length);
+}
+
+/**
+ * @brief Function that lists the completion candidates below the line, in columns,
+ * and displays the prompt and line again.
+ *
+ * @param editor
+ * @param completion
+ * @return 0: OK / -1: Error
+ */
+int listCompletion(struct lineEditor *editor, struct completion *completion) {
+	size_t cursor = editor->cursor;
+	finishEditorLine(editor);
+	editor->cursor = cursor;
+	size_t width = 0;
+	size_t i;
+	for (i = 0; i < completion->candidatesCount; i++) {
+		size_t columns = textColumns(completion->candidates[i],
+				strlen(completion->candidates[i]));
+		if (columns > width)
+			width = columns;
+	}
+	width += 2;
+	size_t perRow = (editor->columns > width) ? (editor->columns / width) : 1;
+	for (i = 0; i < completion->candidatesCount; i++) {
+		const char *candidate = completion->candidates[i];
+		outputString(&editor->output, candidate);
+		if (((i + 1) % perRow == 0) || (i + 1 == completion->candidatesCount)) {
+			outputString(&editor->output, "\r\n");
+		} else {
+			size_t padding = width - textColumns(candidate, strlen(candidate));
+			while (padding-- > 0)
+				outputCharacter(&editor->output, ' ');
+		}
+	}
+	if (completion->count > completion->candidatesCount)
+		outputFormat(&editor->output, "... and %zu more\r\n",
+				completion->count - completion->candidatesCount);
+	return showEditorLine(editor);
+}
+
+/**
+ * @brief Function that completes the word before the cursor (the Tab key).
+ * If the candidates share nothing more than the word, they are listed on a second Tab.
+ *
+ * @param editor
+ * @return 0: OK / -1: Error
+ */
+int completeEditorLine(struct lineEditor *editor) {
+	struct completion completion;
+	if (completeLine(editor->buffer, editor->cursor, &completion) == -1)
+		return -1;
+	int result = 0;
+	if ((completion.insertion != NULL) && (completion.insertion[0] != '\0'))
+		result = insertEditorText(editor, completion.insertion,
+				strlen(completion.insertion));
+	else if ((completion.count > 1) && editor->lastKeyTab)
+		result = listCompletion(editor, &completion);
+	else
+		outputCharacter(&editor->output, '\a');
+	releaseCompletion(&completion);
+	return result;
+}
+
+/**
+ * @brief Function that handles an escape sequence (arrows, Home, End, Delete, Alt-b/f).
+ *
+ * @param editor
+ * @return 0: OK / -1: Error
+ */
+int handleEscapeSequence(struct lineEditor *editor) {
+	int first = readEscapeByte();
+	if (first == 'b') {
+		editor->cursor = previousWord(editor, editor->cursor);
+		return 0;
+	}
+	if (first == 'f') {
+		editor->cursor = nextWord(editor, editor->cursor);
+		return 0;
+	}
+	if ((first != '[') && (first != 'O'))
+		return 0;
+	int second = readEscapeByte();
+	if ((first == '[') && (second >= '0') && (second <= '9')) {
+		// Sequences such as ESC [ 3 ~ (any parameters are skipped)
+		int last = readEscapeByte();
+		while ((last != -1) && (last != '~') && !isalpha(last))
+			last = readEscapeByte();
+		if (last != '~')
+			return 0;
+		if ((second == '1') || (second == '7'))
+			second = 'H';
+		else if ((second == '4') || (second == '8'))
+			second = 'F';
+		else if (second == '3')
+			second = 'P';
+	}
+	switch (second) {
+	case 'A':
+		return recallHistory(editor, -1);
+	case 'B':
+		return recallHistory(editor, 1);
+	case 'C':
+		editor->cursor = nextCharacter(editor, editor->cursor);
+		break;
+	case 'D':
+		editor->cursor = previousCharacter(editor, editor->cursor);
+		break;
+	case 'H':
+		editor->cursor = 0;
+		break;
+	case 'F':
+		editor->cursor = editor->length;
+		break;
+	case 'P': // Delete
+		if (editor->cursor < editor->length)
+			deleteEditorText(editor, editor->cursor,
+					nextCharacter(editor, editor->cursor));
+		break;
+	}
+	return 0;
+}
+
+/**
+ * @brief Function that displays a prompt and reads a line edited by the user.
+ *
+ * @param prompt The prompt
+ * @param line Filled in with the line read (allocated, without its end-of-line)
+ * @return 1: Line read / LINE_EDITOR_CANCELLED: Line cancelled (Ctrl-C) /
+ * 		0: End of input / -1: Error
+ */
+int readEditedLine(const char *prompt, char **line) {
+	struct lineEditor editor;
+	memset(&editor, 0, sizeof(editor));
+	initializeOutputBuffer(&editor.output, STDOUT_FILENO);
+	editor.prompt = prompt;
+	editor.promptColumns = textColumns(prompt, strlen(prompt));
+	editor.columns = LINE_EDITOR_DEFAULT_COLUMNS;
+	editor.capacity = LINE_EDITOR_INITIAL_CAPACITY;
+	editor.buffer = (char*) malloc(editor.capacity);
+	if (editor.buffer == NULL) {
+		perror("malloc error");
+		return -1;
+	}
+	editor.buffer[0] = '\0';
+	fflush(stdout);
+	if (enableRawMode() == -1) {
+		free(editor.buffer);
+		return -1;
+	}
+	int result = showEditorLine(&editor);
+	while (result == 0) {
+		unsigned char key;
+		int status = readEditorKey(&editor, &key);
+		if (status != 1) {
+			result = (status == 0) ? -2 : -1;
+			break;
+		}
+		int tab = 0;
+		switch (key) {
+		case '\r':
+		case '\n':
+			finishEditorLine(&editor);
+			result = 1;
+			break;
+		case 3: // Ctrl-C
+			editor.cursor = editor.length;
+			refreshEditorLine(&editor);
+			outputString(&editor.output, "^C\r\n");
+			outputFlush(&editor.output);
+			editor.length = 0;
+			editor.buffer[0] = '\0';
+			result = LINE_EDITOR_CANCELLED;
+			break;
+		case 4: // Ctrl-D: End of input on an empty line
+			if (editor.length == 0) {
+				outputString(&editor.output, "\r\n");
+				outputFlush(&editor.output);
+				// End of input
+				result = -2;
+			} else if (editor.cursor < editor.length) {
+				deleteEditorText(&editor, editor.cursor,
+						nextCharacter(&editor, editor.cursor));
+			}
+			break;
+		case '\t':
+			tab = 1;
+			result = completeEditorLine(&editor);
+			break;
+		case 127: // Backspace
+		case 8:
+			if (editor.cursor > 0)
+				deleteEditorText(&editor, previousCharacter(&editor, editor.cursor),
+						editor.cursor);
+			break;
+		case 1: // Ctrl-A
+			editor.cursor = 0;
+			break;
+		case 5: // Ctrl-E
+			editor.cursor = editor.length;
+			break;
+		case 2: // Ctrl-B
+			editor.cursor = previousCharacter(&editor, editor.cursor);
+			break;
+		case 6: // Ctrl-F
+			editor.cursor = nextCharacter(&editor, editor.cursor);
+			break;
+		case 11: // Ctrl-K
+			deleteEditorText(&editor, editor.cursor, editor.length);
+			break;
+		case 21: // Ctrl-U
+			deleteEditorText(&editor, 0, editor.cursor);
+			break;
+		case 23: // Ctrl-W
+			deleteEditorText(&editor, previousWord(&editor, editor.cursor),
+					editor.cursor);
+			break;
+		case 12: // Ctrl-L
+			outputString(&editor.output, "\x1b[H\x1b[2J");
+			result = showEditorLine(&editor);
+			break;
+		case 16: // Ctrl-P
+			result = recallHistory(&editor, -1);
+			break;
+		case 14: // Ctrl-N
+			result = recallHistory(&editor, 1);
+			break;
+		case 27:
+			result = handleEscapeSequence(&editor);
+			break;
+		default:
+			// Other control characters are ignored
+			if ((key >= 32) && (key != 127))
+				result = insertEditorText(&editor, (char*) &key, 1);
+			break;
+		}
+		editor.lastKeyTab = tab;
+		if (result == 0)
+			result = refreshEditorLine(&editor);
+	}
+	disableRawMode();
+	free(editor.shown);
+	free(editor.savedLine);
+	if ((result == 1) || (result == LINE_EDITOR_CANCELLED)) {
+		(*line) = editor.buffer;
+		return result;
+	}
+	free(editor.buffer);
+	return (result == -2) ? 0 : -1;
+}
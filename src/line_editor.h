@@ -0,0 +1,77 @@
+/*  @file line_editor.h
+ *  @author Nicolas Poyiadjis
+ *
+ *  @brief Interactive line editor header.
+ *  The terminal is switched to raw mode while a line is edited, and the keys are handled by the shell:
+ *  cursor movement, deletion, history recall and tab completion.
+ *  The line is rendered incrementally: only the part that differs from the text on the screen
+ *  is written again, so typing at the end of the line writes a single character.
+ */
+
+#ifndef LINE_EDITOR_H_
+#define LINE_EDITOR_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <ctype.h>
+#include <errno.h>
+#include <poll.h>
+#include <termios.h>
+#include <sys/ioctl.h>
+
+#include "output.h"
+#include "history.h"
+#include "completion.h"
+#include "processes.h"
+
+#define LINE_EDITOR_INITIAL_CAPACITY 256
+#define LINE_EDITOR_DEFAULT_COLUMNS 80
+// Time to wait for the rest of an escape sequence (milliseconds)
+#define LINE_EDITOR_ESCAPE_TIMEOUT 50
+
+// Result of reading a line cancelled by the user (Ctrl-C)
+#define LINE_EDITOR_CANCELLED 2
+
+/**
+ * @brief The state of the line being edited, and of its rendering on the screen.
+ */
+struct lineEditor {
+	char *buffer;
+	size_t length;
+	size_t capacity;
+	size_t cursor;
+	const char *prompt;
+	size_t promptColumns;
+	// The text on the screen, and the cursor position in it
+	char *shown;
+	size_t shownLength;
+	size_t shownCapacity;
+	size_t shownCursor;
+	size_t columns;
+	struct outputBuffer output;
+	// History entry recalled (0: None), and the line edited before the recall
+	unsigned long historyNumber;
+	char *savedLine;
+	int lastKeyTab;
+};
+
+/**
+ * @brief Function that checks whether lines can be edited (standard input and output are a terminal).
+ *
+ * @return 1: true / 0: false
+ */
+int lineEditingAvailable();
+
+/**
+ * @brief Function that displays a prompt and reads a line edited by the user.
+ *
+ * @param prompt The prompt
+ * @param line Filled in with the line read (allocated, without its end-of-line)
+ * @return 1: Line read / LINE_EDITOR_CANCELLED: Line cancelled (Ctrl-C) /
+ * 		0: End of input / -1: Error
+ */
+int readEditedLine(const char *prompt, char **line);
+
+#endif /* LINE_EDITOR_H_ */
@@ -5,16 +5,64 @@
  *
  *  It can start both
  *  	- Terminal interaction
+ *  	- Script execution (using a script file, e.g. ./usysh script.sh arg1 arg2)
  *  	- Command interpreter (using command line argumens, e.g. ./usysh ls -l)
  */
 
 #include <stdio.h>
 #include <signal.h>
+#include <fcntl.h>
+#include <sys/stat.h>
 
 #include "nicpoyiash_interpreter.h"
 #include "nicpoyiash_terminal.h"
 #include "processes.h"
 
+// Bytes read from an executable file to tell whether it is a script of the shell
+#define SCRIPT_HEADER_SIZE 256
+
+// The environment the shell was started with
+extern char **environ;
+
+/**
+ * @brief Function that checks whether a command line argument names a script file.
+ * An executable file is run as a command instead (e.g. nicpoyia-shell /bin/echo hi),
+ * unless it is a script of this shell (#! line naming the shell itself).
+ *
+ * @param argument The command line argument
+ * @param shellName The name the shell was started with
+ * @return Whether the argument is a regular file that can be read, and not another executable
+ */
+int isScriptFile(const char *argument, const char *shellName) {
+	struct stat fileStatus;
+	if ((stat(argument, &fileStatus) != 0) || !S_ISREG(fileStatus.st_mode)
+			|| (access(argument, R_OK) != 0))
+		return 0;
+	if (access(argument, X_OK) != 0)
+		return 1;
+	// The first line of the executable file
+	char header[SCRIPT_HEADER_SIZE];
+	int fd = open(argument, O_RDONLY | O_CLOEXEC);
+	if (fd == -1)
+		return 0;
+	ssize_t length = read(fd, header, sizeof(header) - 1);
+	close(fd);
+	// An executable text file without a #! line is a script, a binary one (e.g. ELF) is not
+	if ((length < 2) || (header[0] != '#') || (header[1] != '!'))
+		return (length >= 0) && (memchr(header, '\0', length) == NULL);
+	header[length] = '\0';
+	// The interpreter named by the #! line
+	char *interpreter = header + 2;
+	while ((*interpreter == ' ') || (*interpreter == '\t'))
+		interpreter++;
+	interpreter[strcspn(interpreter, " \t\r\n")] = '\0';
+	const char *interpreterName = strrchr(interpreter, '/');
+	interpreterName = (interpreterName != NULL) ? interpreterName + 1 : interpreter;
+	const char *name = strrchr(shellName, '/');
+	name = (name != NULL) ? name + 1 : shellName;
+	return strcmp(interpreterName, name) == 0;
+}
+
 /**
  * @brief The main function of the nicpoyia-sh shell
  *
@@ -23,21 +71,36 @@
  * @return error code 0: OK / -1: Error
  */
 int main(int args, char *argv[]) {
+	// Initialize the shell variables from the environment
+	if (initializeVariables(environ) == -1)
+		return -1;
 	// Initialize process handling
 	processesInitialization();
 	// Handle all possible signals
 	int signalCode;
+	// (except SIGCHLD, which is received through the child signal file descriptor)
 	for (signalCode = 1; signalCode < 32; signalCode++)
-		nativeSignalHandlerFPs[signalCode] = signal(signalCode, signal_handler);
+		if (signalCode != SIGCHLD)
+			nativeSignalHandlerFPs[signalCode] = signal(signalCode,
+					signal_handler);
+	int result = 0;
 	// Start the terminal interaction, if no argument has been passed
 	if (args == 1) {
 		startTerminal();
 	}
+	// If the first argument is a script file:
+	// Execute the script, using the rest of the arguments as its positional parameters.
+	else if (isScriptFile(argv[1], argv[0])) {
+		result = (executeScriptFileUsingArguments(args, argv) == -1) ?
+				-1 : lastExitStatus;
+	}
 	// If some arguments have been passed:
 	// Use the shell interpreter using the script passed as command line arguments.
 	else {
 		if (executeScriptUsingArguments(args, argv) == -1)
-			return -1;
+			result = -1;
 	}
-	return 0;
+	// Every queued job is started before the shell exits (none of them is dropped)
+	waitForJobQueue();
+	return result;
 }
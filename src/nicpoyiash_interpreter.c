@@ -9,43 +9,443 @@
 
 #include "nicpoyiash_interpreter.h"
 
+int executeList(struct listNode *list);
+
+/**
+ * @brief Function that checks whether the statement following a given one should be skipped,
+ * according to the operator connecting them (&&, ||) and the exit status of the last statement.
+ *
+ * @param statement The statement (executed or skipped)
+ * @return Whether the next statement should be skipped
+ */
+int skipsNextStatement(struct statementNode *statement) {
+	if (statement->connector == CONNECT_AND)
+		return (lastExitStatus != 0);
+	if (statement->connector == CONNECT_OR)
+		return (lastExitStatus == 0);
+	return 0;
+}
+
+/**
+ * @brief Function that checks whether a loop should stop after a part of it has been executed,
+ * consuming any pending break / continue meant for it.
+ *
+ * @return Whether the loop should stop
+ */
+int loopStops() {
+	if (loopControl == LOOP_CONTROL_NONE)
+		return exitNow();
+	// A break / continue of outer loops stops this one
+	if (loopControlLevels > 1) {
+		loopControlLevels--;
+		return 1;
+	}
+	int stop = (loopControl == LOOP_CONTROL_BREAK);
+	loopControl = LOOP_CONTROL_NONE;
+	return stop;
+}
+
+/**
+ * @brief Function that executes an if command.
+ *
+ * @param ifCommand The if command syntax tree
+ * @return The number of forked processes
+ */
+int executeIfCommand(struct ifNode *ifCommand) {
+	int forkedProcesses = executeList(ifCommand->condition);
+	if (exitNow() || (loopControl != LOOP_CONTROL_NONE))
+		return forkedProcesses;
+	if (lastExitStatus == 0)
+		forkedProcesses += executeList(ifCommand->body);
+	else if (ifCommand->elseBody != NULL)
+		forkedProcesses += executeList(ifCommand->elseBody);
+	else
+		lastExitStatus = 0;
+	return forkedProcesses;
+}
+
+/**
+ * @brief Function that executes a while / until loop.
+ * The condition and the body are executed from their syntax trees, parsed only once.
+ *
+ * @param loop The loop syntax tree
+ * @param until Whether the loop runs until (instead of while) its condition succeeds
+ * @return The number of forked processes
+ */
+int executeLoopCommand(struct loopNode *loop, int until) {
+	int forkedProcesses = 0;
+	int status = 0;
+	loopDepth++;
+	while (1) {
+		forkedProcesses += executeList(loop->condition);
+		if (loopStops())
+			break;
+		if ((lastExitStatus == 0) == until)
+			break;
+		forkedProcesses += executeList(loop->body);
+		status = lastExitStatus;
+		if (loopStops())
+			break;
+	}
+	loopDepth--;
+	lastExitStatus = status;
+	return forkedProcesses;
+}
+
+/**
+ * @brief Function that evaluates an expression of an arithmetic for loop.
+ * An omitted (empty) expression is 1.
+ *
+ * @param arithmetic The expression as written
+ * @param value Filled in with the value
+ * @return 0: OK / -1: Error
+ */
+int evaluateLoopExpression(char *arithmetic, long long *value) {
+	(*value) = 1;
+	if (strspn(arithmetic, " \t\n") == strlen(arithmetic))
+		return 0;
+	struct arenaMark mark = arenaGetMark(&scriptArena);
+	char *expression = expandWord(&scriptArena, arithmetic);
+	int result = -1;
+	if (expression != NULL)
+		result = evaluateArithmetic(expression, value);
+	arenaRelease(&scriptArena, mark);
+	return result;
+}
+
+/**
+ * @brief Function that executes an arithmetic for loop, for (( initial; condition; step )).
+ *
+ * @param forLoop The for loop syntax tree
+ * @return The number of forked processes
+ */
+int executeArithmeticFor(struct forNode *forLoop) {
+	long long value;
+	int forkedProcesses = 0;
+	int status = 0;
+	if (evaluateLoopExpression(forLoop->initial, &value) == -1) {
+		lastExitStatus = 1;
+		return 0;
+	}
+	loopDepth++;
+	while (1) {
+		if (evaluateLoopExpression(forLoop->condition, &value) == -1) {
+			status = 1;
+			break;
+		}
+		if (value == 0)
+			break;
+		forkedProcesses += executeList(forLoop->body);
+		status = lastExitStatus;
+		if (loopStops())
+			break;
+		if (evaluateLoopExpression(forLoop->step, &value) == -1) {
+			status = 1;
+			break;
+		}
+	}
+	loopDepth--;
+	lastExitStatus = status;
+	return forkedProcesses;
+}
+
+/**
+ * @brief Function that executes a for loop.
+ * The words are expanded once, and the body is executed for each one of them.
+ *
+ * @param forLoop The for loop syntax tree
+ * @return The number of forked processes
+ */
+int executeForCommand(struct forNode *forLoop) {
+	if (forLoop->variable == NULL)
+		return executeArithmeticFor(forLoop);
+	// Without any words given, the loop iterates over "$@"
+	char *allParameters = "\"$@\"";
+	char **values;
+	int valuesCount;
+	if (forLoop->wordsGiven)
+		valuesCount = expandWords(&scriptArena, forLoop->words,
+				forLoop->wordsCount, &values);
+	else
+		valuesCount = expandWords(&scriptArena, &allParameters, 1, &values);
+	if (valuesCount == -1) {
+		lastExitStatus = 1;
+		return 0;
+	}
+	int forkedProcesses = 0;
+	int status = 0;
+	size_t variableLength = strlen(forLoop->variable);
+	loopDepth++;
+	int i;
+	for (i = 0; i < valuesCount; i++) {
+		// Assign the loop variable (NAME=value)
+		struct arenaMark assignmentMark = arenaGetMark(&scriptArena);
+		char *assignment = (char*) arenaAllocate(&scriptArena,
+				variableLength + strlen(values[i]) + 2);
+		if (assignment == NULL)
+			break;
+		sprintf(assignment, "%s=%s", forLoop->variable, values[i]);
+		int assigned = assignVariable(assignment);
+		arenaRelease(&scriptArena, assignmentMark);
+		if (assigned == -1)
+			break;
+		forkedProcesses += executeList(forLoop->body);
+		status = lastExitStatus;
+		if (loopStops())
+			break;
+	}
+	loopDepth--;
+	lastExitStatus = status;
+	return forkedProcesses;
+}
+
+/**
+ * @brief Function that executes an arithmetic command (( )).
+ * Its status is 0 if the expression is non-zero, 1 otherwise.
+ *
+ * @param arithmetic The expression as written
+ */
+void executeArithmeticCommand(char *arithmetic) {
+	long long value;
+	char *expression = expandWord(&scriptArena, arithmetic);
+	if ((expression == NULL) || (evaluateArithmetic(expression, &value) == -1))
+		lastExitStatus = 1;
+	else
+		lastExitStatus = (value == 0);
+}
+
+/**
+ * @brief Function that executes a single statement: a pipeline, or a compound command.
+ *
+ * @param statement The statement syntax tree
+ * @return The number of forked processes: OK / -1: Error occurred
+ */
+int executeStatement(struct statementNode *statement) {
+	int result;
+	switch (statement->type) {
+	case STATEMENT_IF:
+		result = executeIfCommand(statement->ifCommand);
+		break;
+	case STATEMENT_WHILE:
+	case STATEMENT_UNTIL:
+		result = executeLoopCommand(statement->loop,
+				statement->type == STATEMENT_UNTIL);
+		break;
+	case STATEMENT_FOR:
+		result = executeForCommand(statement->forLoop);
+		break;
+	case STATEMENT_ARITHMETIC:
+		executeArithmeticCommand(statement->arithmetic);
+		result = 0;
+		break;
+	default:
+		result = executeJob(&statement->pipeline);
+		break;
+	}
+	if (statement->negated)
+		lastExitStatus = (lastExitStatus == 0);
+	return result;
+}
+
+/**
+ * @brief Function that executes a list of statements, already parsed into its syntax tree.
+ * The syntax tree is not modified, so that it can be executed again (e.g. a loop body).
+ *
+ * @param list The list of statements
+ * @return The number of forked processes
+ */
+int executeList(struct listNode *list) {
+	int forkedProcesses = 0;
+	int skip = 0;
+	int i;
+	for (i = 0; i < list->statementsCount; i++) {
+		if (exitNow() || (loopControl != LOOP_CONTROL_NONE))
+			break;
+		struct statementNode *statement = &list->statements[i];
+		if (!skip) {
+			// Every execution temporary of a statement is released when the statement finishes
+			struct arenaMark statementMark = arenaGetMark(&scriptArena);
+			int result = executeStatement(statement);
+			if (result != -1)
+				forkedProcesses += result;
+			arenaRelease(&scriptArena, statementMark);
+		}
+		skip = skipsNextStatement(statement);
+	}
+	return forkedProcesses;
+}
+
+/**
+ * @brief Function that executes an entire script, given as a text of a certain length.
+ * The text is only read, so it may be a file mapped in memory (it is not NUL-terminated).
+ *
+ * @param script The script text
+ * @param length The script length
+ * @return The number of forked processes: OK / -1: Error occurred
+ */
+int executeScriptText(const char *script, size_t length) {
+	struct parser parser;
+	initializeParser(&parser, &scriptArena, script, length);
+	// Every statement is parsed and executed before the next one is parsed,
+	// so that large scripts start executing at once, and use constant memory.
+	// Every parsing and execution temporary of a statement is allocated from the script arena,
+	// and released at once when the statement finishes.
+	int forkedProcesses = 0;
+	int skip = 0;
+	while (!exitNow()) {
+		struct arenaMark statementMark = arenaGetMark(&scriptArena);
+		struct statementNode statement;
+		uint64_t traceStart = tracing ? traceNow() : 0;
+		int parsed = parseNextStatement(&parser, &statement);
+		if (tracing)
+			traceSpan("parse", traceStart, NULL);
+		if (parsed != 1) {
+			arenaRelease(&scriptArena, statementMark);
+			if (parsed == -1)
+				return -1;
+			break;
+		}
+		if (!skip) {
+			int result = executeStatement(&statement);
+			if (result != -1)
+				forkedProcesses += result;
+		}
+		skip = skipsNextStatement(&statement);
+		arenaRelease(&scriptArena, statementMark);
+		// A break / continue outside of any loop has no effect
+		loopControl = LOOP_CONTROL_NONE;
+	}
+	return forkedProcesses;
+}
+
 /**
- * @brief Function that executes an entire script, given in a single string
+ * @brief Function that executes a script already parsed into its syntax tree.
+ * The syntax tree is not modified, so that it can be executed again.
  *
- * @param script The full script string as given
+ * @param list The list of statements of the script
+ * @return The number of forked processes: OK / -1: Error occurred
+ */
+int executeParsedScript(struct listNode *list) {
+	int forkedProcesses = executeList(list);
+	loopControl = LOOP_CONTROL_NONE;
+	return forkedProcesses;
+}
+
+/**
+ * @brief Function that executes an entire script, given in a single string.
+ * Scripts executed before are found in the parse cache, without being parsed again.
+ *
+ * @param script The full script string as given (released by the function)
  * @return The number of forked processes: OK / -1: Error occurred
  */
 int executeScript(char *script) {
-	char *scriptCopy = (char*) malloc((strlen(script) + 1) * sizeof(char));
-	if (scriptCopy == NULL ) {
+	size_t length = strlen(script);
+	struct parseCacheEntry *parsed;
+	int forkedProcesses;
+	uint64_t traceStart = tracing ? traceNow() : 0;
+	int cached = getParsedScript(script, length, &parsed);
+	if (tracing)
+		traceSpan("parse", traceStart, script);
+	switch (cached) {
+	case 1:
+		// A script parsed before (or just parsed) is executed from its cached syntax tree
+		forkedProcesses = executeParsedScript(parsed->list);
+		releaseParsedScript(parsed);
+		break;
+	case 0:
+		forkedProcesses = executeScriptText(script, length);
+		break;
+	default:
+		forkedProcesses = -1;
+		break;
+	}
+	if (tracing)
+		traceSpan("executeScript", traceStart, script);
+	free(script);
+	return forkedProcesses;
+}
+
+/**
+ * @brief Function that reads a whole script from a file descriptor and executes it.
+ *
+ * @param fd The file descriptor to read the script from
+ * @return The number of forked processes: OK / -1: Error occurred
+ */
+int executeScriptStream(int fd) {
+	size_t length = 0;
+	size_t size = MAX_SCRIPT_SIZE;
+	char *script = (char*) malloc(size);
+	if (script == NULL) {
 		perror("malloc error");
 		return -1;
 	}
-	strcpy(scriptCopy, script);
-	// Count the jobs given
-	char *words[MAX_ARGS_SIZE];
-	int wordsCount = splitJobs(scriptCopy, NULL, 1, 0, words);
-	if (wordsCount == -1)
+	ssize_t readCount;
+	while ((readCount = read(fd, script + length, size - length)) != 0) {
+		if (readCount == -1) {
+			if (errno == EINTR)
+				continue;
+			perror("read error");
+			free(script);
+			return -1;
+		}
+		length += readCount;
+		if (length == size) {
+			char *grownScript = (char*) realloc(script, size * 2);
+			if (grownScript == NULL) {
+				perror("malloc error");
+				free(script);
+				return -1;
+			}
+			script = grownScript;
+			size *= 2;
+		}
+	}
+	int forkedProcesses = executeScriptText(script, length);
+	free(script);
+	return forkedProcesses;
+}
+
+/**
+ * @brief Function that executes a script file within the current shell (as source does).
+ * The file is mapped in memory and parsed in place, without being copied.
+ *
+ * @param path The script file path
+ * @return The number of forked processes: OK / -1: Error occurred
+ */
+int executeScriptFile(const char *path) {
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd == -1) {
+		perror(path);
 		return -1;
-	// Allocate space from the system
-	char **splittedJobs = (char**) malloc(wordsCount * sizeof(char*));
-	if (splittedJobs == NULL ) {
-		perror("malloc error");
+	}
+	struct stat fileStatus;
+	if (fstat(fd, &fileStatus) == -1) {
+		perror(path);
+		close(fd);
 		return -1;
 	}
-	strcpy(scriptCopy, script);
-	// Split and execute the individual jobs
-	int jobsCount = splitJobs(scriptCopy, &splittedJobs, 0, wordsCount, words);
-	free(script);
-	// Script copy is not freed, since is is maintained in a
-	// divided form as the splittedJobs array
-	int forkedProcesses = 0;
-	int i;
-	for (i = 0; i < jobsCount; i++) {
-		int jobResult = executeJob(splittedJobs[i]);
-		if (jobResult != -1)
-			forkedProcesses += jobResult;
+	// Anything other than a regular file (e.g. a pipe) cannot be mapped, so it is read instead
+	if (!S_ISREG(fileStatus.st_mode)) {
+		int forkedProcesses = executeScriptStream(fd);
+		close(fd);
+		return forkedProcesses;
+	}
+	// Nothing to map for an empty file
+	if (fileStatus.st_size == 0) {
+		close(fd);
+		return 0;
+	}
+	char *script = (char*) mmap(NULL, fileStatus.st_size, PROT_READ,
+			MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (script == MAP_FAILED) {
+		perror("mmap");
+		return -1;
 	}
+	// The script is read once, from the beginning to the end
+	madvise(script, fileStatus.st_size, MADV_SEQUENTIAL);
+	int forkedProcesses = executeScriptText(script, fileStatus.st_size);
+	munmap(script, fileStatus.st_size);
 	return forkedProcesses;
 }
 
@@ -58,19 +458,33 @@ int executeScript(char *script) {
  */
 int executeScriptUsingArguments(int args, char *argv[]) {
 	// Concatenate script to avoid invalid word-tokenization on whitespace characters
-	char *script = (char*) malloc(MAX_SCRIPT_SIZE * sizeof(char));
+	size_t scriptLength = 1;
 	int argsIndex;
+	for (argsIndex = 1; argsIndex < args; argsIndex++)
+		scriptLength += strlen(argv[argsIndex]) + 1;
+	char *script = (char*) malloc(scriptLength * sizeof(char));
+	if (script == NULL) {
+		perror("malloc error");
+		return -1;
+	}
+	script[0] = '\0';
 	for (argsIndex = 1; argsIndex < args; argsIndex++) {
 		strcat(script, argv[argsIndex]);
 		if (argv[argsIndex][strlen(argv[argsIndex]) - 1] != ';')
 			strcat(script, " ");
 	}
-	char *scriptCopy = (char*) malloc((strlen(script) + 1) * sizeof(char));
-	if (scriptCopy == NULL ) {
-		perror("malloc error");
-		return -1;
-	}
-	strcpy(scriptCopy, script);
-	free(script);
-	return executeScript(scriptCopy);
+	return executeScript(script);
+}
+
+/**
+ * @brief Function that executes a script file given as the first command argument,
+ * with the rest of the arguments as its positional parameters.
+ *
+ * @param args Number of command arguments
+ * @param argv Command arguments vector / array
+ * @return The number of forked processes: OK / -1: Error occurred
+ */
+int executeScriptFileUsingArguments(int args, char *argv[]) {
+	setPositionalParameters(argv[1], argv + 2, args - 2);
+	return executeScriptFile(argv[1]);
 }
@@ -10,21 +10,65 @@
 #ifndef NICPOYIASH_INTERPRETER_H_
 #define NICPOYIASH_INTERPRETER_H_
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
 #include "files.h"
 #include "commands.h"
 #include "processes.h"
 #include "jobs.h"
+#include "parser.h"
+#include "arena.h"
+#include "parse_cache.h"
+#include "expansion.h"
+#include "arithmetic.h"
 
-#define MAX_ARGS_SIZE 128
+/**
+ * @brief Function that executes an entire script, given as a text of a certain length.
+ * The text is only read, so it may be a file mapped in memory (it is not NUL-terminated).
+ *
+ * @param script The script text
+ * @param length The script length
+ * @return The number of forked processes: OK / -1: Error occurred
+ */
+int executeScriptText(const char *script, size_t length);
+
+/**
+ * @brief Function that executes a script already parsed into its syntax tree.
+ * The syntax tree is not modified, so that it can be executed again.
+ *
+ * @param list The list of statements of the script
+ * @return The number of forked processes: OK / -1: Error occurred
+ */
+int executeParsedScript(struct listNode *list);
 
 /**
- * @brief Function that executes an entire script, given in a single string
+ * @brief Function that executes an entire script, given in a single string.
+ * Scripts executed before are found in the parse cache, without being parsed again.
  *
- * @param script The full script string as given
+ * @param script The full script string as given (released by the function)
  * @return The number of forked processes: OK / -1: Error occurred
  */
 int executeScript(char *script);
 
+/**
+ * @brief Function that reads a whole script from a file descriptor and executes it.
+ *
+ * @param fd The file descriptor to read the script from
+ * @return The number of forked processes: OK / -1: Error occurred
+ */
+int executeScriptStream(int fd);
+
+/**
+ * @brief Function that executes a script file within the current shell (as source does).
+ * The file is mapped in memory and parsed in place, without being copied.
+ *
+ * @param path The script file path
+ * @return The number of forked processes: OK / -1: Error occurred
+ */
+int executeScriptFile(const char *path);
+
 /**
  * @brief Function that executes a script given its full command arguments vector.
  *
@@ -34,4 +78,14 @@ int executeScript(char *script);
  */
 int executeScriptUsingArguments(int args, char *argv[]);
 
+/**
+ * @brief Function that executes a script file given as the first command argument,
+ * with the rest of the arguments as its positional parameters.
+ *
+ * @param args Number of command arguments
+ * @param argv Command arguments vector / array
+ * @return The number of forked processes: OK / -1: Error occurred
+ */
+int executeScriptFileUsingArguments(int args, char *argv[]);
+
 #endif /* NICPOYIASH_INTERPRETER_H_ */
@@ -15,13 +15,90 @@ int forkedProcesses = 0;
 // Whether the terminal should wait blocked for the user,
 // to complete the input for the previous command.
 int blockedForInput = 0;
+// Lines of a statement left unfinished (e.g. an if command without its fi), if any.
+// The statement continues in the next lines.
+char *pendingScript = NULL;
+
+/**
+ * @brief Function that formats the command line prompt.
+ *
+ * @param prompt The prompt buffer
+ * @param size The buffer size
+ */
+void formatCommandPrompt(char *prompt, size_t size) {
+	if (pendingScript != NULL)
+		snprintf(prompt, size, "> ");
+	else
+		snprintf(prompt, size, "%d-nicpoyia-sh>", forkedProcesses);
+}
 
 /**
  * @brief Function the displays the command line prompt,
  * which signs that the shell is ready to get new commands from the user.
  */
 void printCommandPrompt() {
-	printf("%d-nicpoyia-sh>", forkedProcesses);
+	char prompt[MAX_PROMPT_LENGTH];
+	formatCommandPrompt(prompt, sizeof(prompt));
+	printf("%s", prompt);
+}
+
+/**
+ * @brief Function that reads the next input line, without the line editor.
+ *
+ * @param interactive Whether the input is a terminal
+ * @return The line read (allocated, without its end-of-line) / NULL: End of input or error
+ */
+char *readInputLine(int interactive) {
+	char nextUserCommand[MAX_SCRIPT_SIZE];
+	if (!blockedForInput) {
+		// nicpoyia-sh command line prompt is displayed
+		printCommandPrompt();
+	}
+	// While waiting for the user, background jobs are reported as soon as they finish
+	// (the prompt is displayed again after the notification)
+	if (interactive)
+		while (!waitForUserInput(STDIN_FILENO))
+			if (!blockedForInput)
+				printCommandPrompt();
+	// Read user command and dynamically allocate the appropriate space to store it.
+	// The shell exits at the end of its input
+	if (fgets(nextUserCommand, MAX_SCRIPT_SIZE, stdin) == NULL)
+		return NULL;
+	char *inputScript = (char*) malloc(
+			(strlen(nextUserCommand) + 1) * sizeof(char));
+	if (inputScript == NULL ) {
+		perror("malloc error");
+		return NULL;
+	}
+	strcpy(inputScript, nextUserCommand);
+	// Remove the end-of-line character
+	if ((inputScript[0] != '\0')
+			&& (inputScript[strlen(inputScript) - 1] == '\n'))
+		inputScript[strlen(inputScript) - 1] = '\0';
+	return inputScript;
+}
+
+/**
+ * @brief Function that appends a line to the lines of an unfinished statement.
+ *
+ * @param script The lines read so far (released by the function)
+ * @param line The next line (released by the function)
+ * @return The joined lines: OK / NULL: Error
+ */
+char *appendScriptLine(char *script, char *line) {
+	size_t scriptLength = strlen(script);
+	char *joined = (char*) realloc(script,
+			(scriptLength + strlen(line) + 2) * sizeof(char));
+	if (joined == NULL) {
+		perror("malloc error");
+		free(script);
+		free(line);
+		return NULL;
+	}
+	joined[scriptLength] = '\n';
+	strcpy(joined + scriptLength + 1, line);
+	free(line);
+	return joined;
 }
 
 /**
@@ -29,28 +106,68 @@ void printCommandPrompt() {
  * This function handles the terminal user I/O interaction.
  */
 void startTerminal() {
-	char nextUserCommand[MAX_SCRIPT_SIZE];
-	nextUserCommand[0] = '\0';
+	int interactive = isatty(STDIN_FILENO);
+	// Input is polled before reading, so nothing may be left behind in the stdin buffer
+	if (interactive)
+		setvbuf(stdin, NULL, _IONBF, 0);
+	// The command history is kept for interactive sessions only
+	if (interactive)
+		initializeHistory();
+	// Lines are edited within the shell if the terminal allows it,
+	// and the executables of PATH are indexed in the background for completion
+	int lineEditing = interactive && lineEditingAvailable();
+	if (lineEditing)
+		refreshCommandIndex();
 	while (terminalActive) {
 		// Release any completed background processes and jobs
-		releaseCompleteBackgroundProcesses();
-		if (!blockedForInput) {
-			// nicpoyia-sh command line prompt is displayed
-			printCommandPrompt();
-		}
-		// Read user command and dynamically allocate the appropriate space to store it.
-		fgets(nextUserCommand, MAX_SCRIPT_SIZE, stdin);
-		char *inputScript = (char*) malloc(
-				(strlen(nextUserCommand) + 1) * sizeof(char));
-		if (inputScript == NULL ) {
-			perror("malloc error");
-			return;
+		reapChildren(0);
+		char *inputScript;
+		if (lineEditing) {
+			char prompt[MAX_PROMPT_LENGTH];
+			formatCommandPrompt(prompt, sizeof(prompt));
+			int status = readEditedLine(blockedForInput ? "" : prompt,
+					&inputScript);
+			if ((status == 0) || (status == -1))
+				break;
+			// A cancelled line also discards an unfinished statement
+			if (status == LINE_EDITOR_CANCELLED) {
+				free(inputScript);
+				free(pendingScript);
+				pendingScript = NULL;
+				continue;
+			}
+		} else {
+			inputScript = readInputLine(interactive);
+			if (inputScript == NULL)
+				break;
 		}
-		strcpy(inputScript, nextUserCommand);
-		// Remove the end-of-line character
-		inputScript[strlen(inputScript) - 1] = '\0';
 		// Ordinary command execution
 		if (!blockedForInput) {
+			// History expansion (!!, !n, !prefix, ...): the expanded line is displayed
+			char *expandedScript;
+			int expansion = expandHistory(inputScript, &expandedScript);
+			if (expansion == -1) {
+				free(inputScript);
+				continue;
+			}
+			if (expansion == 1) {
+				free(inputScript);
+				inputScript = expandedScript;
+				printf("%s\n", inputScript);
+			}
+			if (pendingScript != NULL) {
+				inputScript = appendScriptLine(pendingScript, inputScript);
+				pendingScript = NULL;
+				if (inputScript == NULL)
+					return;
+			}
+			// An unfinished statement is only executed once its last line is read
+			if (isScriptIncomplete(&scriptArena, inputScript,
+					strlen(inputScript))) {
+				pendingScript = inputScript;
+				continue;
+			}
+			addHistory(inputScript);
 			int lastForkedProcesses = executeScript(inputScript);
 			// If something went wrong during the user command execution
 			if (lastForkedProcesses != -1) {
@@ -60,12 +177,16 @@ void startTerminal() {
 		// Continue blocked command, if any
 		else {
 			continueBashExecution(inputScript);
+			free(inputScript);
 		}
-		// Reset variables
-		nextUserCommand[0] = '\0';
 		terminalActive = !exitNow();
 		// Check if any command left waiting to feed it with input.
 		// Also, check if any read operation is waiting to read characters.
 		blockedForInput = inputWaiting() || readFromUser();
 	}
+	// A statement still unfinished at the end of the input is reported
+	if (pendingScript != NULL) {
+		executeScript(pendingScript);
+		pendingScript = NULL;
+	}
 }
@@ -13,6 +13,10 @@
 #include "jobs.h"
 #include "nicpoyiash_interpreter.h"
 #include "processes.h"
+#include "history.h"
+#include "line_editor.h"
+
+#define MAX_PROMPT_LENGTH 256
 
 /**
  * @brief Function that starts the terminal interaction with the user.
@@ -0,0 +1,179 @@
+/*  @file output.c
+ *  @author Nicolas Poyiadjis
+ *
+ *  @brief Built-in function output buffer implementation
+ */
+
+#include "output.h"
+
+// The buffer of the built-in function output (standard output; every thread has a buffer of its own)
+__thread struct outputBuffer builtinOutput = { .fd = STDOUT_FILENO };
+
+/**
+ * @brief Function that initializes an empty output buffer.
+ *
+ * @param buffer The output buffer
+ * @param fd The file descriptor written when the buffer is flushed
+ */
+void initializeOutputBuffer(struct outputBuffer *buffer, int fd) {
+	buffer->fd = fd;
+	buffer->vectorsCount = 0;
+	buffer->used = 0;
+}
+
+/**
+ * @brief Function that writes every piece gathered in the buffer, using writev.
+ *
+ * @param buffer The output buffer
+ * @return 0: OK / -1: Error
+ */
+int outputFlush(struct outputBuffer *buffer) {
+	struct iovec *vectors = buffer->vectors;
+	int vectorsCount = buffer->vectorsCount;
+	int result = 0;
+	while (vectorsCount > 0) {
+		ssize_t written = writev(buffer->fd, vectors, vectorsCount);
+		if (written == -1) {
+			if (errno == EINTR)
+				continue;
+			// A closed reader (e.g. a pipeline stage that exited) is not reported,
+			// as a process writing to it would be silently terminated by SIGPIPE
+			if (errno != EPIPE)
+				perror("write error");
+			result = -1;
+			break;
+		}
+		// Skip the pieces written completely, and the written part of a partial one
+		while ((vectorsCount > 0) && ((size_t) written >= vectors->iov_len)) {
+			written -= vectors->iov_len;
+			vectors++;
+			vectorsCount--;
+		}
+		if (vectorsCount > 0) {
+			vectors->iov_base = (char*) vectors->iov_base + written;
+			vectors->iov_len -= written;
+		}
+	}
+	buffer->vectorsCount = 0;
+	buffer->used = 0;
+	return result;
+}
+
+/**
+ * @brief Function that appends some data to the output buffer.
+ *
+ * @param buffer The output buffer
+ * @param data The data to append
+ * @param length The data length
+ * @return 0: OK / -1: Error
+ */
+int outputWrite(struct outputBuffer *buffer, const char *data, size_t length) {
+	if (length == 0)
+		return 0;
+	int direct = (length >= OUTPUT_DIRECT_LENGTH);
+	// Make room for the piece
+	if ((buffer->vectorsCount == OUTPUT_MAX_VECTORS)
+			|| (!direct && (buffer->used + length > OUTPUT_BUFFER_SIZE)))
+		if (outputFlush(buffer) == -1)
+			return -1;
+	if (direct) {
+		// Large pieces are referenced in place
+		struct iovec *vector = &buffer->vectors[buffer->vectorsCount++];
+		vector->iov_base = (char*) data;
+		vector->iov_len = length;
+		return 0;
+	}
+	char *copy = buffer->data + buffer->used;
+	memcpy(copy, data, length);
+	buffer->used += length;
+	// Extend the last piece, if it ends where the copy starts
+	if (buffer->vectorsCount > 0) {
+		struct iovec *last = &buffer->vectors[buffer->vectorsCount - 1];
+		if ((char*) last->iov_base + last->iov_len == copy) {
+			last->iov_len += length;
+			return 0;
+		}
+	}
+	struct iovec *vector = &buffer->vectors[buffer->vectorsCount++];
+	vector->iov_base = copy;
+	vector->iov_len = length;
+	return 0;
+}
+
+/**
+ * @brief Function that appends a string to the output buffer.
+ *
+ * @param buffer The output buffer
+ * @param string The string to append
+ * @return 0: OK / -1: Error
+ */
+int outputString(struct outputBuffer *buffer, const char *string) {
+	return outputWrite(buffer, string, strlen(string));
+}
+
+/**
+ * @brief Function that appends a single character to the output buffer.
+ *
+ * @param buffer The output buffer
+ * @param character The character to append
+ * @return 0: OK / -1: Error
+ */
+int outputCharacter(struct outputBuffer *buffer, char character) {
+	return outputWrite(buffer, &character, 1);
+}
+
+/**
+ * @brief Function that appends formatted output to the output buffer (as printf).
+ *
+ * @param buffer The output buffer
+ * @param format The printf format
+ * @return 0: OK / -1: Error
+ */
+int outputFormat(struct outputBuffer *buffer, const char *format, ...) {
+	char text[OUTPUT_DIRECT_LENGTH];
+	va_list arguments;
+	va_start(arguments, format);
+	int length = vsnprintf(text, sizeof(text), format, arguments);
+	va_end(arguments);
+	if (length < 0)
+		return -1;
+	if ((size_t) length < sizeof(text))
+		return outputWrite(buffer, text, length);
+	// Too long for the local space: format it again, and write it at once
+	char *longText = (char*) malloc(length + 1);
+	if (longText == NULL) {
+		perror("malloc error");
+		return -1;
+	}
+	va_start(arguments, format);
+	vsnprintf(longText, length + 1, format, arguments);
+	va_end(arguments);
+	int result = outputFlush(buffer);
+	if (result != -1)
+		result = outputWrite(buffer, longText, length);
+	if (result != -1)
+		result = outputFlush(buffer);
+	free(longText);
+	return result;
+}
+
+/**
+ * @brief Function that writes a string as a JSON string.
+ *
+ * @param output The output buffer
+ * @param text The string (NULL: empty)
+ * @return 0: OK / -1: Error
+ */
+int outputJSONString(struct outputBuffer *output, const char *text) {
+	outputCharacter(output, '"');
+	for (; (text != NULL) && (*text != '\0'); text++) {
+		unsigned char character = *text;
+		if ((character == '"') || (character == '\\'))
+			outputFormat(output, "\\%c", character);
+		else if (character < 0x20)
+			outputFormat(output, "\\u%04x", character);
+		else
+			outputCharacter(output, character);
+	}
+	return outputCharacter(output, '"');
+}
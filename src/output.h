@@ -0,0 +1,103 @@
+/*  @file output.h
+ *  @author Nicolas Poyiadjis
+ *
+ *  @brief Built-in function output buffer header.
+ *  Output of the built-in functions is gathered in a shell-owned buffer,
+ *  so that a whole command is written using a single writev system call.
+ *  Small pieces are copied in the buffer, while large ones are referenced in place.
+ */
+
+#ifndef OUTPUT_H_
+#define OUTPUT_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/uio.h>
+
+#define OUTPUT_BUFFER_SIZE 8192
+#define OUTPUT_MAX_VECTORS 64
+// Pieces of at least this length are not copied in the buffer
+#define OUTPUT_DIRECT_LENGTH 512
+
+/**
+ * @brief The output buffer of a file descriptor.
+ * Every referenced piece must stay valid until the buffer is flushed.
+ */
+struct outputBuffer {
+	int fd;
+	struct iovec vectors[OUTPUT_MAX_VECTORS];
+	int vectorsCount;
+	char data[OUTPUT_BUFFER_SIZE];
+	size_t used;
+};
+
+// The buffer of the built-in function output (standard output; every thread has a buffer of its own)
+extern __thread struct outputBuffer builtinOutput;
+
+/**
+ * @brief Function that initializes an empty output buffer.
+ *
+ * @param buffer The output buffer
+ * @param fd The file descriptor written when the buffer is flushed
+ */
+void initializeOutputBuffer(struct outputBuffer *buffer, int fd);
+
+/**
+ * @brief Function that appends some data to the output buffer.
+ *
+ * @param buffer The output buffer
+ * @param data The data to append
+ * @param length The data length
+ * @return 0: OK / -1: Error
+ */
+int outputWrite(struct outputBuffer *buffer, const char *data, size_t length);
+
+/**
+ * @brief Function that appends a string to the output buffer.
+ *
+ * @param buffer The output buffer
+ * @param string The string to append
+ * @return 0: OK / -1: Error
+ */
+int outputString(struct outputBuffer *buffer, const char *string);
+
+/**
+ * @brief Function that appends a single character to the output buffer.
+ *
+ * @param buffer The output buffer
+ * @param character The character to append
+ * @return 0: OK / -1: Error
+ */
+int outputCharacter(struct outputBuffer *buffer, char character);
+
+/**
+ * @brief Function that appends formatted output to the output buffer (as printf).
+ *
+ * @param buffer The output buffer
+ * @param format The printf format
+ * @return 0: OK / -1: Error
+ */
+int outputFormat(struct outputBuffer *buffer, const char *format, ...);
+
+/**
+ * @brief Function that writes every piece gathered in the buffer, using writev.
+ *
+ * @param buffer The output buffer
+ * @return 0: OK / -1: Error
+ */
+int outputFlush(struct outputBuffer *buffer);
+
+/**
+ * @brief Function that writes a string as a JSON string.
+ *
+ * @param output The output buffer
+ * @param text The string (NULL: empty)
+ * @return 0: OK / -1: Error
+ */
+int outputJSONString(struct outputBuffer *output, const char *text);
+
+#endif /* OUTPUT_H_ */
@@ -0,0 +1,488 @@
+/*  @file parallel.c
+ *  @author Nicolas Poyiadjis
+ *
+ *  @brief Implementation of the parallel built-in function
+ */
+
+// memfd_create() is a GNU extension
+#define _GNU_SOURCE
+
+#include "parallel.h"
+
+/**
+ * @brief Function that reads every item from the input, up to its end.
+ *
+ * @param separator The item separator
+ * @param items Filled in with the items (allocated, pointing within the storage)
+ * @param storage Filled in with the text read (allocated)
+ * @return Number of items: OK / -1: Error
+ */
+int readParallelItems(char separator, char ***items, char **storage) {
+	size_t length = 0;
+	size_t capacity = PARALLEL_READ_SIZE;
+	char *text = (char*) malloc(capacity + 1);
+	if (text == NULL) {
+		perror("malloc error");
+		return -1;
+	}
+	while (1) {
+		if (length == capacity) {
+			char *newText = (char*) realloc(text, capacity * 2 + 1);
+			if (newText == NULL) {
+				perror("malloc error");
+				free(text);
+				return -1;
+			}
+			text = newText;
+			capacity *= 2;
+		}
+		ssize_t bytesRead = read(STDIN_FILENO, text + length, capacity - length);
+		if (bytesRead == -1) {
+			if (errno == EINTR)
+				continue;
+			perror("parallel: read");
+			free(text);
+			return -1;
+		}
+		if (bytesRead == 0)
+			break;
+		length += bytesRead;
+	}
+	text[length] = separator;
+	// Count the items, then split the text in place (empty items are skipped)
+	int count = 0;
+	size_t i;
+	for (i = 0; i < length; i++)
+		if ((text[i] != separator) && (text[i + 1] == separator))
+			count++;
+	*items = (char**) malloc((count + 1) * sizeof(char*));
+	if (*items == NULL) {
+		perror("malloc error");
+		free(text);
+		return -1;
+	}
+	int item = 0;
+	char *start = text;
+	for (i = 0; i <= length; i++) {
+		if (text[i] != separator)
+			continue;
+		text[i] = '\0';
+		if (text + i > start)
+			(*items)[item++] = start;
+		start = text + i + 1;
+	}
+	(*items)[count] = NULL;
+	*storage = text;
+	return count;
+}
+
+/**
+ * @brief Function that computes the argument space left for the items of a single command:
+ * ARG_MAX, less the environment, the command template and some headroom.
+ *
+ * @param run The parallel run
+ * @param environment The environment of the commands
+ * @return The argument space (bytes)
+ */
+long parallelArgumentSpace(struct parallelRun *run, char **environment) {
+	long space = sysconf(_SC_ARG_MAX);
+	if (space <= 0)
+		space = PARALLEL_DEFAULT_ARG_MAX;
+	space -= PARALLEL_ARG_MAX_HEADROOM;
+	int i;
+	for (i = 0; environment[i] != NULL; i++)
+		space -= strlen(environment[i]) + 1 + sizeof(char*);
+	for (i = 0; i < run->templateCount; i++)
+		space -= strlen(run->template[i]) + 1 + sizeof(char*);
+	return space;
+}
+
+/**
+ * @brief Function that finds the end of the batch of items starting at the given one.
+ * A batch holds at least one item.
+ *
+ * @param run The parallel run
+ * @param first The first item of the batch
+ * @return The item after the last one of the batch
+ */
+int parallelBatchEnd(struct parallelRun *run, int first) {
+	int maxItems = run->options->maxItems;
+	if (!run->options->batch)
+		return first + ((maxItems > 0) ? maxItems : 1) > run->itemsCount ?
+				run->itemsCount : first + ((maxItems > 0) ? maxItems : 1);
+	long space = run->argumentSpace;
+	long joinedSpace = run->joinedSpace;
+	int end = first;
+	while ((end < run->itemsCount)
+			&& ((maxItems == 0) || (end - first < maxItems))) {
+		size_t length = strlen(run->items[end]) + 1;
+		long needed = length + sizeof(char*);
+		if ((end > first)
+				&& ((needed > space)
+						|| ((run->joinedSpace > 0) && (length > joinedSpace))))
+			break;
+		space -= needed;
+		joinedSpace -= length;
+		end++;
+	}
+	return end;
+}
+
+/**
+ * @brief Function that replaces every placeholder within a template word.
+ *
+ * @param word The template word
+ * @param replacement The replacement text
+ * @return The word (allocated from the script arena): OK / NULL: Error
+ */
+char *replacePlaceholder(const char *word, const char *replacement) {
+	size_t placeholderLength = strlen(PARALLEL_PLACEHOLDER);
+	size_t replacementLength = strlen(replacement);
+	size_t count = 0;
+	const char *position;
+	for (position = strstr(word, PARALLEL_PLACEHOLDER); position != NULL;
+			position = strstr(position + placeholderLength,
+					PARALLEL_PLACEHOLDER))
+		count++;
+	char *result = (char*) arenaAllocate(&scriptArena,
+			strlen(word) + count * replacementLength + 1);
+	if (result == NULL)
+		return NULL;
+	char *end = result;
+	while ((position = strstr(word, PARALLEL_PLACEHOLDER)) != NULL) {
+		memcpy(end, word, position - word);
+		end += position - word;
+		memcpy(end, replacement, replacementLength);
+		end += replacementLength;
+		word = position + placeholderLength;
+	}
+	strcpy(end, word);
+	return result;
+}
+
+/**
+ * @brief Function that joins the items of a batch, separated by spaces.
+ *
+ * @param run The parallel run
+ * @param first The first item of the batch
+ * @param end The item after the last one of the batch
+ * @return The items joined (allocated from the script arena): OK / NULL: Error
+ */
+char *joinParallelItems(struct parallelRun *run, int first, int end) {
+	size_t length = 0;
+	int i;
+	for (i = first; i < end; i++)
+		length += strlen(run->items[i]) + 1;
+	char *joined = (char*) arenaAllocate(&scriptArena, length);
+	if (joined == NULL)
+		return NULL;
+	char *position = joined;
+	for (i = first; i < end; i++) {
+		size_t itemLength = strlen(run->items[i]);
+		memcpy(position, run->items[i], itemLength);
+		position += itemLength;
+		*position++ = (i < end - 1) ? ' ' : '\0';
+	}
+	return joined;
+}
+
+/**
+ * @brief Function that builds the words of the command of a batch of items.
+ * A template word that is just the placeholder is replaced by every item (as words of their own),
+ * a placeholder within a word by the items separated by spaces,
+ * and the items are appended if the template has no placeholder.
+ *
+ * @param run The parallel run
+ * @param first The first item of the batch
+ * @param end The item after the last one of the batch
+ * @return The NULL-terminated command words (allocated from the script arena): OK / NULL: Error
+ */
+char **parallelCommandWords(struct parallelRun *run, int first, int end) {
+	int itemsCount = end - first;
+	char **words = (char**) arenaAllocate(&scriptArena,
+			(run->templateCount + itemsCount + 1) * sizeof(char*));
+	if (words == NULL)
+		return NULL;
+	// The items joined, for placeholders within words (built once needed)
+	char *joined = (itemsCount == 1) ? run->items[first] : NULL;
+	int count = 0;
+	int i;
+	for (i = 0; i < run->templateCount; i++) {
+		char *word = run->template[i];
+		if (strcmp(word, PARALLEL_PLACEHOLDER) == 0) {
+			int item;
+			for (item = first; item < end; item++)
+				words[count++] = run->items[item];
+		} else if (strstr(word, PARALLEL_PLACEHOLDER) != NULL) {
+			if ((joined == NULL)
+					&& ((joined = joinParallelItems(run, first, end)) == NULL))
+				return NULL;
+			if ((words[count++] = replacePlaceholder(word, joined)) == NULL)
+				return NULL;
+		} else {
+			words[count++] = word;
+		}
+	}
+	if (!run->templateHasPlaceholder) {
+		int item;
+		for (item = first; item < end; item++)
+			words[count++] = run->items[item];
+	}
+	words[count] = NULL;
+	return words;
+}
+
+/**
+ * @brief Function that starts the command of a batch, as a process of the parallel job.
+ *
+ * @param run The parallel run
+ * @param commandPath The executable path
+ * @param words The command words
+ * @param environment The environment of the command
+ * @return 0: OK / -1: Error
+ */
+int startParallelCommand(struct parallelRun *run, const char *commandPath,
+		char **words, char **environment) {
+	struct launchPlan plan;
+	initializeLaunchPlan(&plan);
+	// The commands do not consume the items left in the input
+	if (run->itemsFromInput
+			&& (addOpenAction(&plan, STDIN_FILENO, "/dev/null", O_RDONLY) == -1))
+		return -1;
+	// The output of a command is kept until the output of the previous ones has been written
+	int output = -1;
+	if (run->options->keepOrder) {
+		output = memfd_create("parallel", MFD_CLOEXEC);
+		if (output == -1) {
+			perror("parallel: memfd_create");
+			return -1;
+		}
+		if (addDup2Action(&plan, STDOUT_FILENO, output) == -1) {
+			close(output);
+			return -1;
+		}
+	}
+	struct job *job = &jobs[run->jobIndex];
+	if (job->processesCount == run->commandsCapacity) {
+		int newCapacity = run->commandsCapacity ? run->commandsCapacity * 2 : 16;
+		struct parallelCommand *newCommands = (struct parallelCommand*) realloc(
+				run->commands, newCapacity * sizeof(struct parallelCommand));
+		if (newCommands == NULL) {
+			perror("malloc error");
+			if (output != -1)
+				close(output);
+			return -1;
+		}
+		run->commands = newCommands;
+		run->commandsCapacity = newCapacity;
+	}
+	allocateProcess();
+	// The job time is measured from the start of its first process
+	if (job->processesCount == 0)
+		clock_gettime(CLOCK_MONOTONIC, &job->started);
+	uint64_t traceStart = tracing ? traceNow() : 0;
+	pid_t processPid = launchProcess(commandPath, words, environment, &plan);
+	if (tracing)
+		traceSpan("launch", traceStart, commandPath);
+	int stage = -1;
+	if ((processPid == -1)
+			|| ((stage = processStarted(run->jobIndex, processPid)) == -1)) {
+		if (processPid != -1) {
+			kill(processPid, SIGKILL);
+			waitpid(processPid, NULL, 0);
+		}
+		deallocateProcess();
+		if (output != -1)
+			close(output);
+		return -1;
+	}
+	run->commands[stage].output = output;
+	run->commands[stage].counted = 0;
+	return 0;
+}
+
+/**
+ * @brief Function that writes the output of a finished command, kept in its memory file.
+ *
+ * @param output The memory file
+ */
+void writeParallelOutput(int output) {
+	char buffer[PARALLEL_READ_SIZE];
+	lseek(output, 0, SEEK_SET);
+	ssize_t bytesRead;
+	while ((bytesRead = read(output, buffer, sizeof(buffer))) > 0) {
+		ssize_t written = 0;
+		while (written < bytesRead) {
+			ssize_t result = write(STDOUT_FILENO, buffer + written,
+					bytesRead - written);
+			if (result == -1) {
+				if (errno == EINTR)
+					continue;
+				close(output);
+				return;
+			}
+			written += result;
+		}
+	}
+	close(output);
+}
+
+/**
+ * @brief Function that accounts for the commands finished,
+ * and writes the outputs that are next in order (-k).
+ *
+ * @param run The parallel run
+ */
+void parallelCommandsFinished(struct parallelRun *run) {
+	struct job *job = &jobs[run->jobIndex];
+	int stage;
+	for (stage = run->firstUncounted; stage < job->processesCount; stage++) {
+		struct parallelCommand *command = &run->commands[stage];
+		int status = job->statuses[stage];
+		if (command->counted || (status == -1))
+			continue;
+		command->counted = 1;
+		if (exitStatusOf(status) != 0)
+			run->failures++;
+		// An interrupted command stops the rest from being started
+		if (WIFSIGNALED(status)
+				&& ((WTERMSIG(status) == SIGINT) || (WTERMSIG(status) == SIGTERM)))
+			run->interrupted = 1;
+	}
+	while ((run->firstUncounted < job->processesCount)
+			&& run->commands[run->firstUncounted].counted)
+		run->firstUncounted++;
+	while ((run->nextOutput < job->processesCount)
+			&& run->commands[run->nextOutput].counted) {
+		if (run->commands[run->nextOutput].output != -1)
+			writeParallelOutput(run->commands[run->nextOutput].output);
+		run->nextOutput++;
+	}
+}
+
+/**
+ * @brief Function that blocks until another command can be started:
+ * fewer commands than the jobs option are running, within the process limit of the shell.
+ *
+ * @param run The parallel run
+ */
+void waitForParallelSlot(struct parallelRun *run) {
+	while (1) {
+		int active = jobs[run->jobIndex].processesActive;
+		if ((active == 0)
+				|| ((active < run->options->jobs)
+						&& ((maxActiveProcesses == 0)
+								|| (actPrCount < maxActiveProcesses))))
+			return;
+		if (reapChildren(1) == 0)
+			return;
+		parallelCommandsFinished(run);
+	}
+}
+
+/**
+ * @brief Function that runs a command template over a list of items, as a job of the shell.
+ *
+ * @param options The options
+ * @param template The command template words
+ * @param templateCount Number of template words
+ * @param items The items / NULL: Read the items from the input
+ * @param itemsCount Number of items given
+ * @return The exit status: 0: Every command succeeded / Number of failed commands (up to 101) /
+ * 		130: Interrupted / 1: Error
+ */
+int runParallel(struct parallelOptions *options, char **template,
+		int templateCount, char **items, int itemsCount) {
+	struct parallelRun run;
+	memset(&run, 0, sizeof(run));
+	run.options = options;
+	run.template = template;
+	run.templateCount = templateCount;
+	int i;
+	for (i = 0; i < templateCount; i++) {
+		if (strstr(template[i], PARALLEL_PLACEHOLDER) == NULL)
+			continue;
+		run.templateHasPlaceholder = 1;
+		// The items joined within a word are kept within the argument length limit
+		if (strcmp(template[i], PARALLEL_PLACEHOLDER) != 0) {
+			long joinedSpace = PARALLEL_MAX_ARGUMENT_LENGTH
+					- (long) strlen(template[i]);
+			if ((joinedSpace < 1) || (run.joinedSpace == 0)
+					|| (joinedSpace < run.joinedSpace))
+				run.joinedSpace = (joinedSpace < 1) ? 1 : joinedSpace;
+		}
+	}
+	char *storage = NULL;
+	run.items = items;
+	run.itemsCount = itemsCount;
+	if (items == NULL) {
+		run.itemsFromInput = 1;
+		run.itemsCount = readParallelItems(options->separator, &run.items,
+				&storage);
+		if (run.itemsCount == -1)
+			return 1;
+	}
+	fflush(stdout);
+	int result = 0;
+	const char *commandPath = resolveCommand(template[0]);
+	char **environment = exportedEnvironment();
+	if (commandPath == NULL) {
+		fprintf(stderr, "nicpoyia-sh: parallel: %s: command not found\n",
+				template[0]);
+		result = 127;
+	} else if (environment == NULL) {
+		result = 1;
+	} else if (run.itemsCount > 0) {
+		run.argumentSpace = parallelArgumentSpace(&run, environment);
+		// The commands are the processes of a single foreground job
+		struct pipelineNode pipeline;
+		memset(&pipeline, 0, sizeof(pipeline));
+		pipeline.commandsCount = 1;
+		pipeline.text = "parallel";
+		pipeline.timed = TIME_NONE;
+		run.jobIndex = jobStarted(&pipeline);
+		if (run.jobIndex == -1) {
+			result = 1;
+		} else {
+			foregroundJob = run.jobIndex;
+			int first = 0;
+			while ((first < run.itemsCount) && !run.interrupted) {
+				waitForParallelSlot(&run);
+				if (run.interrupted)
+					break;
+				int end = parallelBatchEnd(&run, first);
+				struct arenaMark mark = arenaGetMark(&scriptArena);
+				char **words = parallelCommandWords(&run, first, end);
+				int started = (words != NULL)
+						&& (startParallelCommand(&run, commandPath, words,
+								environment) != -1);
+				arenaRelease(&scriptArena, mark);
+				if (!started) {
+					result = 1;
+					break;
+				}
+				first = end;
+			}
+			// Wait for the rest of the commands
+			while (jobs[run.jobIndex].processesActive > 0) {
+				if (reapChildren(1) == 0)
+					break;
+				parallelCommandsFinished(&run);
+			}
+			parallelCommandsFinished(&run);
+			foregroundJob = -1;
+			jobFinished(run.jobIndex);
+			if (run.interrupted)
+				result = 130;
+			else if (result == 0)
+				result = (run.failures < PARALLEL_MAX_FAILURES_STATUS) ?
+						run.failures : PARALLEL_MAX_FAILURES_STATUS;
+		}
+	}
+	free(run.commands);
+	if (run.itemsFromInput) {
+		free(run.items);
+		free(storage);
+	}
+	return result;
+}
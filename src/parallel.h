@@ -0,0 +1,108 @@
+/*  @file parallel.h
+ *  @author Nicolas Poyiadjis
+ *
+ *  @brief Header of the parallel built-in function.
+ *  A command template is run once per item (or per batch of items), with a bounded number of
+ *  commands running at once. The items are given as arguments (after :::), or read from the input.
+ *  Every command is a process of a single job of the shell, so the commands are listed by jobs,
+ *  reaped by the shell reaper, and receive the signals forwarded to the foreground job.
+ *  	- {} within the template is replaced by the item (the items are appended if there is no {})
+ *  	- Batches (-X) are packed up to the argument space of exec (ARG_MAX, less the environment)
+ *  	- The output of every command can be kept in order (-k), buffered in memory files
+ */
+
+#ifndef PARALLEL_H_
+#define PARALLEL_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/mman.h>
+
+#include "processes.h"
+#include "jobs.h"
+
+// Replaced by the items within the command template
+#define PARALLEL_PLACEHOLDER "{}"
+// Separates the command template from the items given as arguments
+#define PARALLEL_ITEMS_SEPARATOR ":::"
+// Argument space left unused (as xargs does), and the assumed ARG_MAX if unknown
+#define PARALLEL_ARG_MAX_HEADROOM 4096
+#define PARALLEL_DEFAULT_ARG_MAX 131072
+// Length limit of a single argument of exec (MAX_ARG_STRLEN of Linux)
+#define PARALLEL_MAX_ARGUMENT_LENGTH 131072
+#define PARALLEL_READ_SIZE 65536
+// Exit status limit (the number of failed commands is given, up to this)
+#define PARALLEL_MAX_FAILURES_STATUS 101
+
+/**
+ * @brief The options of the parallel built-in function.
+ */
+struct parallelOptions {
+	// Commands running at once
+	int jobs;
+	// Items per command (0: As many as fit, in batch mode)
+	int maxItems;
+	// Whether the items are packed into batches up to ARG_MAX (-X)
+	int batch;
+	// Whether the output of every command is written in the order of the items (-k)
+	int keepOrder;
+	// Separator of the items read from the input ('\n', or '\0' using -0)
+	char separator;
+};
+
+/**
+ * @brief A command started by the parallel built-in function (indexed by its job stage).
+ */
+struct parallelCommand {
+	// Memory file keeping the command output (-k), -1 if none
+	int output;
+	// Whether its completion has been accounted for
+	int counted;
+};
+
+/**
+ * @brief The state of a parallel built-in function run.
+ */
+struct parallelRun {
+	struct parallelOptions *options;
+	char **template;
+	int templateCount;
+	int templateHasPlaceholder;
+	char **items;
+	int itemsCount;
+	// Whether the items have been read from the input (the commands are given no input then)
+	int itemsFromInput;
+	// Argument space left for the items of a single command,
+	// and for the items joined within a word (0: No placeholder within a word)
+	long argumentSpace;
+	long joinedSpace;
+	int jobIndex;
+	struct parallelCommand *commands;
+	int commandsCapacity;
+	// The first command not accounted for, and the next command output to write (-k)
+	int firstUncounted;
+	int nextOutput;
+	int failures;
+	int interrupted;
+};
+
+/**
+ * @brief Function that runs a command template over a list of items, as a job of the shell.
+ *
+ * @param options The options
+ * @param template The command template words
+ * @param templateCount Number of template words
+ * @param items The items / NULL: Read the items from the input
+ * @param itemsCount Number of items given
+ * @return The exit status: 0: Every command succeeded / Number of failed commands (up to 101) /
+ * 		130: Interrupted / 1: Error
+ */
+int runParallel(struct parallelOptions *options, char **template,
+		int templateCount, char **items, int itemsCount);
+
+#endif /* PARALLEL_H_ */
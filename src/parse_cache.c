@@ -0,0 +1,193 @@
+/*  @file parse_cache.c
+ *  @author Nicolas Poyiadjis
+ *
+ *  @brief Parse cache implementation
+ */
+
+#include "parse_cache.h"
+
+// The parse cache of the shell
+struct parseCache parseCache;
+
+/**
+ * @brief FNV-1a hash of a script text
+ *
+ * @param script
+ * @param length
+ * @return The hash value
+ */
+unsigned int scriptHash(const char *script, size_t length) {
+	unsigned int hash = 2166136261u;
+	size_t i;
+	for (i = 0; i < length; i++) {
+		hash ^= (unsigned char) script[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+/**
+ * @brief Function that removes an entry from the recently used order.
+ *
+ * @param entry
+ */
+void unlinkRecentlyUsed(struct parseCacheEntry *entry) {
+	if (entry->newer != NULL)
+		entry->newer->older = entry->older;
+	else
+		parseCache.newest = entry->older;
+	if (entry->older != NULL)
+		entry->older->newer = entry->newer;
+	else
+		parseCache.oldest = entry->newer;
+	entry->newer = NULL;
+	entry->older = NULL;
+}
+
+/**
+ * @brief Function that places an entry first in the recently used order.
+ *
+ * @param entry
+ */
+void linkMostRecentlyUsed(struct parseCacheEntry *entry) {
+	entry->newer = NULL;
+	entry->older = parseCache.newest;
+	if (parseCache.newest != NULL)
+		parseCache.newest->newer = entry;
+	parseCache.newest = entry;
+	if (parseCache.oldest == NULL)
+		parseCache.oldest = entry;
+}
+
+/**
+ * @brief Function that forgets a parsed script, releasing its memory.
+ *
+ * @param entry
+ */
+void forgetParsedScript(struct parseCacheEntry *entry) {
+	struct parseCacheEntry **link = &parseCache.buckets[entry->hash
+			% PARSE_CACHE_BUCKETS];
+	while (*link != entry)
+		link = &(*link)->nextInBucket;
+	*link = entry->nextInBucket;
+	unlinkRecentlyUsed(entry);
+	destroyArena(&entry->arena);
+	free(entry->script);
+	free(entry);
+	parseCache.count--;
+}
+
+/**
+ * @brief Function that forgets the least recently used script not in use,
+ * to make room for a new one.
+ */
+void evictParsedScript() {
+	struct parseCacheEntry *entry = parseCache.oldest;
+	while ((entry != NULL) && (entry->users > 0))
+		entry = entry->newer;
+	if (entry == NULL)
+		return;
+	forgetParsedScript(entry);
+	parseCache.evictions++;
+}
+
+/**
+ * @brief Function that gets the syntax tree of a script, parsing it only if it is not cached.
+ * The entry given is in use, until released using releaseParsedScript.
+ *
+ * @param script The script text
+ * @param length The script length
+ * @param entry Filled in with the cache entry of the script
+ * @return 1: OK / 0: The script cannot be cached (too long) / -1: Syntax error
+ */
+int getParsedScript(const char *script, size_t length,
+		struct parseCacheEntry **entry) {
+	if (length > PARSE_CACHE_MAX_SCRIPT_SIZE)
+		return 0;
+	unsigned int hash = scriptHash(script, length);
+	struct parseCacheEntry *cached;
+	for (cached = parseCache.buckets[hash % PARSE_CACHE_BUCKETS];
+			cached != NULL; cached = cached->nextInBucket) {
+		if ((cached->hash == hash) && (cached->length == length)
+				&& (memcmp(cached->script, script, length) == 0)) {
+			parseCache.hits++;
+			unlinkRecentlyUsed(cached);
+			linkMostRecentlyUsed(cached);
+			cached->users++;
+			*entry = cached;
+			return 1;
+		}
+	}
+	parseCache.misses++;
+	cached = (struct parseCacheEntry*) malloc(sizeof(struct parseCacheEntry));
+	if (cached == NULL) {
+		perror("malloc error");
+		return -1;
+	}
+	// The syntax tree points within the script, so the entry keeps a copy of its own
+	cached->script = (char*) malloc(length + 1);
+	if (cached->script == NULL) {
+		perror("malloc error");
+		free(cached);
+		return -1;
+	}
+	memcpy(cached->script, script, length);
+	cached->script[length] = '\0';
+	cached->length = length;
+	cached->hash = hash;
+	initializeArenaWithChunkSize(&cached->arena, PARSE_CACHE_CHUNK_SIZE);
+	cached->list = parseScript(&cached->arena, cached->script, length);
+	// Scripts with syntax errors are not cached
+	if (cached->list == NULL) {
+		destroyArena(&cached->arena);
+		free(cached->script);
+		free(cached);
+		return -1;
+	}
+	if (parseCache.count >= PARSE_CACHE_CAPACITY)
+		evictParsedScript();
+	cached->users = 1;
+	cached->nextInBucket = parseCache.buckets[hash % PARSE_CACHE_BUCKETS];
+	parseCache.buckets[hash % PARSE_CACHE_BUCKETS] = cached;
+	linkMostRecentlyUsed(cached);
+	parseCache.count++;
+	*entry = cached;
+	return 1;
+}
+
+/**
+ * @brief Function that releases a cache entry given by getParsedScript.
+ *
+ * @param entry
+ */
+void releaseParsedScript(struct parseCacheEntry *entry) {
+	entry->users--;
+	// The cache may have grown over its capacity, while every entry was in use
+	if ((entry->users == 0) && (parseCache.count > PARSE_CACHE_CAPACITY))
+		evictParsedScript();
+}
+
+/**
+ * @brief Function that forgets every parsed script not in use.
+ */
+void clearParseCache() {
+	struct parseCacheEntry *entry = parseCache.oldest;
+	while (entry != NULL) {
+		struct parseCacheEntry *newer = entry->newer;
+		if (entry->users == 0)
+			forgetParsedScript(entry);
+		entry = newer;
+	}
+}
+
+/**
+ * @brief Function that prints the parse cache statistics (hits, misses, evictions).
+ */
+void printParseCacheStatistics() {
+	unsigned long lookups = parseCache.hits + parseCache.misses;
+	printf("parse cache: %d/%d scripts, %lu hits, %lu misses (%.1f%% hit rate), %lu evictions\n",
+			parseCache.count, PARSE_CACHE_CAPACITY, parseCache.hits,
+			parseCache.misses,
+			lookups ? (100.0 * parseCache.hits / lookups) : 0.0,
+			parseCache.evictions);
+}
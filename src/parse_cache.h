@@ -0,0 +1,96 @@
+/*  @file parse_cache.h
+ *  @author Nicolas Poyiadjis
+ *
+ *  @brief Parse cache header.
+ *  Remembers the syntax tree of the most recently executed scripts (e.g. command lines),
+ *  so that a repeated script is executed without being parsed again.
+ *  The least recently used script is forgotten when the cache is full.
+ */
+
+#ifndef PARSE_CACHE_H_
+#define PARSE_CACHE_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "parser.h"
+
+#define PARSE_CACHE_CAPACITY 64
+#define PARSE_CACHE_BUCKETS 128
+// Longer scripts are not cached, but parsed statement by statement
+#define PARSE_CACHE_MAX_SCRIPT_SIZE 4096
+#define PARSE_CACHE_CHUNK_SIZE 2048
+
+/**
+ * @brief A parsed script. Its syntax tree is allocated from an arena of its own,
+ * released when the script is forgotten.
+ */
+struct parseCacheEntry {
+	char *script;
+	size_t length;
+	unsigned int hash;
+	struct arena arena;
+	struct listNode *list;
+	// Executions of the script in progress (the script is not forgotten while in use)
+	int users;
+	// Next entry of the same hash bucket
+	struct parseCacheEntry *nextInBucket;
+	// Neighbours in the recently used order
+	struct parseCacheEntry *newer;
+	struct parseCacheEntry *older;
+};
+
+/**
+ * @brief The parse cache: a hash table of parsed scripts, in recently used order.
+ */
+struct parseCache {
+	struct parseCacheEntry *buckets[PARSE_CACHE_BUCKETS];
+	struct parseCacheEntry *newest;
+	struct parseCacheEntry *oldest;
+	int count;
+	unsigned long hits;
+	unsigned long misses;
+	unsigned long evictions;
+};
+
+/**
+ * @brief FNV-1a hash of a script text
+ *
+ * @param script
+ * @param length
+ * @return The hash value
+ */
+unsigned int scriptHash(const char *script, size_t length);
+
+/**
+ * @brief Function that gets the syntax tree of a script, parsing it only if it is not cached.
+ * The entry given is in use, until released using releaseParsedScript.
+ *
+ * @param script The script text
+ * @param length The script length
+ * @param entry Filled in with the cache entry of the script
+ * @return 1: OK / 0: The script cannot be cached (too long) / -1: Syntax error
+ */
+int getParsedScript(const char *script, size_t length,
+		struct parseCacheEntry **entry);
+
+/**
+ * @brief Function that releases a cache entry given by getParsedScript.
+ *
+ * @param entry
+ */
+void releaseParsedScript(struct parseCacheEntry *entry);
+
+/**
+ * @brief Function that forgets every parsed script not in use.
+ */
+void clearParseCache();
+
+/**
+ * @brief Function that prints the parse cache statistics (hits, misses, evictions).
+ */
+void printParseCacheStatistics();
+
+#endif /* PARSE_CACHE_H_ */
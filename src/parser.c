@@ -0,0 +1,684 @@
+/*  @file parser.c
+ *  @author Nicolas Poyiadjis
+ *
+ *  @brief Script parser implementation.
+ *  The token stream of a script is parsed, in a single pass, into its syntax tree:
+ *  	- A list of statements, each one executed serially (;), in the background (&),
+ *  	  or depending on the status of the previous one (&&, ||)
+ *  	- A statement: a pipeline, a compound command (if, while, until, for)
+ *  	  containing lists of statements, or an arithmetic command (( ))
+ *  	- A pipeline of commands, interconnected using pipes (|)
+ *  	- A command of words and redirections
+ *  Compound command bodies are parsed once, and executed as many times as needed.
+ */
+
+#include "parser.h"
+
+/**
+ * @brief Function that moves to the next token.
+ *
+ * @return The type of the new current token
+ */
+int advance(struct parser *parser) {
+	return nextToken(&parser->lexer, &parser->current);
+}
+
+/**
+ * @brief Function that reports a syntax error at the current token.
+ */
+void syntaxError(struct parser *parser) {
+	if (parser->current.type == TOKEN_END)
+		parser->incomplete = 1;
+	if ((parser->current.type == TOKEN_ERROR) || parser->quiet)
+		return;
+	if ((parser->current.type == TOKEN_END)
+			|| (parser->current.type == TOKEN_NEWLINE))
+		fprintf(stderr,
+				"nicpoyia-sh: syntax error near unexpected token `newline'\n");
+	else
+		fprintf(stderr, "nicpoyia-sh: syntax error near unexpected token `%.*s'\n",
+				(int) parser->current.length, parser->current.text);
+}
+
+/**
+ * @brief Function that grows a dynamic array, when it is full.
+ * The capacity is doubled, so that appending is of constant amortized cost.
+ *
+ * @param parser
+ * @param array The array
+ * @param count Number of elements stored
+ * @param capacity Capacity of the array (updated)
+ * @param elementSize Size of an element
+ * @return 0: OK / -1: Error
+ */
+int growArray(struct parser *parser, void **array, int count, int *capacity,
+		size_t elementSize) {
+	if (count < (*capacity))
+		return 0;
+	int newCapacity = ((*capacity) == 0) ? 4 : ((*capacity) * 2);
+	void *newArray = arenaResize(parser->arena, *array,
+			(*capacity) * elementSize, newCapacity * elementSize);
+	if (newArray == NULL)
+		return -1;
+	(*array) = newArray;
+	(*capacity) = newCapacity;
+	return 0;
+}
+
+/**
+ * @brief Function that parses a simple command: words and redirections.
+ *
+ * @param parser
+ * @param command The command to be filled in
+ * @return 0: OK / -1: Syntax error
+ */
+int parseCommandNode(struct parser *parser, struct commandNode *command) {
+	int wordsCapacity = 0;
+	int redirectionsCapacity = 0;
+	command->words = NULL;
+	command->wordsCount = 0;
+	command->redirections = NULL;
+	command->redirectionsCount = 0;
+	while (1) {
+		if (parser->current.type == TOKEN_WORD) {
+			if (growArray(parser, (void**) &command->words, command->wordsCount + 1,
+					&wordsCapacity, sizeof(char*)) == -1)
+				return -1;
+			char *word = arenaCopyText(parser->arena, parser->current.text,
+					parser->current.length);
+			if (word == NULL)
+				return -1;
+			command->words[command->wordsCount] = word;
+			command->wordsCount++;
+			// Keep the words NULL-terminated
+			command->words[command->wordsCount] = NULL;
+		} else if (parser->current.type == TOKEN_REDIRECTION) {
+			if (growArray(parser, (void**) &command->redirections,
+					command->redirectionsCount, &redirectionsCapacity,
+					sizeof(struct redirectionNode)) == -1)
+				return -1;
+			struct redirectionNode *redirection =
+					&command->redirections[command->redirectionsCount];
+			redirection->type = parser->current.redirection;
+			redirection->fd = parser->current.fd;
+			redirection->target = NULL;
+			// The redirection target follows the operator
+			if (advance(parser) != TOKEN_WORD) {
+				syntaxError(parser);
+				return -1;
+			}
+			redirection->target = arenaCopyText(parser->arena,
+					parser->current.text, parser->current.length);
+			if (redirection->target == NULL)
+				return -1;
+			command->redirectionsCount++;
+		} else {
+			break;
+		}
+		advance(parser);
+	}
+	if ((command->wordsCount == 0) && (command->redirectionsCount == 0)) {
+		syntaxError(parser);
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * @brief Function that parses a pipeline of commands.
+ *
+ * @param parser
+ * @param pipeline The pipeline to be filled in
+ * @return 0: OK / -1: Syntax error
+ */
+int parsePipelineNode(struct parser *parser, struct pipelineNode *pipeline) {
+	int commandsCapacity = 0;
+	const char *start = parser->current.text;
+	const char *end = start;
+	pipeline->commands = NULL;
+	pipeline->commandsCount = 0;
+	pipeline->background = 0;
+	pipeline->text = NULL;
+	pipeline->timed = TIME_NONE;
+	while (1) {
+		if (growArray(parser, (void**) &pipeline->commands, pipeline->commandsCount,
+				&commandsCapacity, sizeof(struct commandNode)) == -1)
+			return -1;
+		struct commandNode *command =
+				&pipeline->commands[pipeline->commandsCount];
+		if (parseCommandNode(parser, command) == -1)
+			return -1;
+		pipeline->commandsCount++;
+		end = parser->current.text;
+		if (parser->current.type != TOKEN_PIPE)
+			break;
+		// A pipe may be followed by new lines
+		while (advance(parser) == TOKEN_NEWLINE)
+			;
+	}
+	// Trim the whitespace before the operator ending the pipeline
+	while ((end > start) && ((end[-1] == ' ') || (end[-1] == '\t')))
+		end--;
+	pipeline->text = arenaCopyText(parser->arena, start, end - start);
+	if (pipeline->text == NULL)
+		return -1;
+	return 0;
+}
+
+/**
+ * @brief Function that checks whether the current token is a given reserved word (e.g. then).
+ * Reserved words are recognized only when unquoted.
+ *
+ * @param parser
+ * @param keyword The reserved word
+ * @return Whether the current token is the reserved word
+ */
+int isKeyword(struct parser *parser, const char *keyword) {
+	return (parser->current.type == TOKEN_WORD)
+			&& (parser->current.length == strlen(keyword))
+			&& (strncmp(parser->current.text, keyword, parser->current.length)
+					== 0);
+}
+
+/**
+ * @brief Function that checks whether the current token is any of the given reserved words.
+ *
+ * @param parser
+ * @param keywords The reserved words (NULL-terminated)
+ * @return Whether the current token is one of the reserved words
+ */
+int isAnyKeyword(struct parser *parser, const char *const keywords[]) {
+	int i;
+	for (i = 0; keywords[i] != NULL; i++)
+		if (isKeyword(parser, keywords[i]))
+			return 1;
+	return 0;
+}
+
+// Reserved words that can only continue a compound command
+const char *const continuationKeywords[] = { "then", "elif", "else", "fi", "do",
+		"done", NULL };
+const char *const thenKeywords[] = { "then", NULL };
+const char *const ifBodyKeywords[] = { "elif", "else", "fi", NULL };
+const char *const fiKeywords[] = { "fi", NULL };
+const char *const doKeywords[] = { "do", NULL };
+const char *const doneKeywords[] = { "done", NULL };
+const char *const compoundKeywords[] = { "if", "while", "until", "for", NULL };
+
+/**
+ * @brief Function that consumes a reserved word expected at the current token.
+ *
+ * @param parser
+ * @param keyword The reserved word
+ * @return 0: OK / -1: Syntax error
+ */
+int expectKeyword(struct parser *parser, const char *keyword) {
+	if (!isKeyword(parser, keyword)) {
+		syntaxError(parser);
+		return -1;
+	}
+	advance(parser);
+	return 0;
+}
+
+/**
+ * @brief Function that skips any new lines.
+ *
+ * @param parser
+ */
+void skipNewLines(struct parser *parser) {
+	while (parser->current.type == TOKEN_NEWLINE)
+		advance(parser);
+}
+
+int parseCompleteStatement(struct parser *parser, struct statementNode *statement);
+
+/**
+ * @brief Function that parses the list of statements of a compound command,
+ * up to one of the reserved words ending it (which is not consumed).
+ *
+ * @param parser
+ * @param terminators The reserved words ending the list (NULL-terminated)
+ * @return The list: OK / NULL: Syntax error
+ */
+struct listNode *parseCompoundList(struct parser *parser,
+		const char *const terminators[]) {
+	struct listNode *list = (struct listNode*) arenaAllocate(parser->arena,
+			sizeof(struct listNode));
+	if (list == NULL)
+		return NULL;
+	list->statements = NULL;
+	list->statementsCount = 0;
+	int statementsCapacity = 0;
+	while (1) {
+		// Empty statements
+		while ((parser->current.type == TOKEN_NEWLINE)
+				|| (parser->current.type == TOKEN_SEPARATOR))
+			advance(parser);
+		if ((parser->current.type == TOKEN_END)
+				|| isAnyKeyword(parser, terminators))
+			break;
+		if (growArray(parser, (void**) &list->statements, list->statementsCount,
+				&statementsCapacity, sizeof(struct statementNode)) == -1)
+			return NULL;
+		if (parseCompleteStatement(parser,
+				&list->statements[list->statementsCount]) == -1)
+			return NULL;
+		list->statementsCount++;
+	}
+	// The list may not be empty, nor left unterminated
+	if ((list->statementsCount == 0) || (parser->current.type == TOKEN_END)) {
+		if (parser->current.type != TOKEN_END)
+			syntaxError(parser);
+		else {
+			parser->incomplete = 1;
+			if (!parser->quiet)
+				fprintf(stderr,
+						"nicpoyia-sh: syntax error: unexpected end of file\n");
+		}
+		return NULL;
+	}
+	return list;
+}
+
+/**
+ * @brief Function that parses an if command, from if (or elif) up to fi.
+ *
+ * @param parser
+ * @param statement The statement to be filled in
+ * @return 0: OK / -1: Syntax error
+ */
+int parseIfCommand(struct parser *parser, struct statementNode *statement) {
+	statement->type = STATEMENT_IF;
+	statement->ifCommand = (struct ifNode*) arenaAllocate(parser->arena,
+			sizeof(struct ifNode));
+	if (statement->ifCommand == NULL)
+		return -1;
+	struct ifNode *ifCommand = statement->ifCommand;
+	ifCommand->elseBody = NULL;
+	advance(parser);
+	if ((ifCommand->condition = parseCompoundList(parser, thenKeywords)) == NULL)
+		return -1;
+	advance(parser);
+	if ((ifCommand->body = parseCompoundList(parser, ifBodyKeywords)) == NULL)
+		return -1;
+	if (isKeyword(parser, "elif")) {
+		// The elif part is an if command of its own, ending at the same fi
+		struct listNode *elseBody = (struct listNode*) arenaAllocate(
+				parser->arena, sizeof(struct listNode));
+		if (elseBody == NULL)
+			return -1;
+		elseBody->statements = (struct statementNode*) arenaAllocate(
+				parser->arena, sizeof(struct statementNode));
+		if (elseBody->statements == NULL)
+			return -1;
+		elseBody->statementsCount = 1;
+		memset(elseBody->statements, 0, sizeof(struct statementNode));
+		ifCommand->elseBody = elseBody;
+		return parseIfCommand(parser, elseBody->statements);
+	}
+	if (isKeyword(parser, "else")) {
+		advance(parser);
+		if ((ifCommand->elseBody = parseCompoundList(parser, fiKeywords))
+				== NULL)
+			return -1;
+	}
+	return expectKeyword(parser, "fi");
+}
+
+/**
+ * @brief Function that parses a while / until loop, up to done.
+ *
+ * @param parser
+ * @param statement The statement to be filled in
+ * @param type The loop type (STATEMENT_WHILE / STATEMENT_UNTIL)
+ * @return 0: OK / -1: Syntax error
+ */
+int parseLoopCommand(struct parser *parser, struct statementNode *statement,
+		int type) {
+	statement->type = type;
+	statement->loop = (struct loopNode*) arenaAllocate(parser->arena,
+			sizeof(struct loopNode));
+	if (statement->loop == NULL)
+		return -1;
+	advance(parser);
+	if ((statement->loop->condition = parseCompoundList(parser, doKeywords))
+			== NULL)
+		return -1;
+	advance(parser);
+	if ((statement->loop->body = parseCompoundList(parser, doneKeywords))
+			== NULL)
+		return -1;
+	return expectKeyword(parser, "done");
+}
+
+/**
+ * @brief Function that parses the rest of an arithmetic for loop, for (( initial; condition; step )),
+ * from its expressions up to done.
+ *
+ * @param parser
+ * @param forLoop The for loop to be filled in
+ * @return 0: OK / -1: Syntax error
+ */
+int parseArithmeticFor(struct parser *parser, struct forNode *forLoop) {
+	char **expressions[3] = { &forLoop->initial, &forLoop->condition,
+			&forLoop->step };
+	const char *start = parser->current.text;
+	const char *end = start + parser->current.length;
+	int i;
+	for (i = 0; i < 3; i++) {
+		const char *separator = start;
+		while ((separator < end) && (*separator != ';'))
+			separator++;
+		// Exactly three expressions are given
+		if ((separator == end) != (i == 2)) {
+			syntaxError(parser);
+			return -1;
+		}
+		*expressions[i] = arenaCopyText(parser->arena, start, separator - start);
+		if (*expressions[i] == NULL)
+			return -1;
+		start = separator + 1;
+	}
+	advance(parser);
+	if (parser->current.type == TOKEN_SEPARATOR)
+		advance(parser);
+	skipNewLines(parser);
+	if (expectKeyword(parser, "do") == -1)
+		return -1;
+	if ((forLoop->body = parseCompoundList(parser, doneKeywords)) == NULL)
+		return -1;
+	return expectKeyword(parser, "done");
+}
+
+/**
+ * @brief Function that parses a for loop, up to done.
+ *
+ * @param parser
+ * @param statement The statement to be filled in
+ * @return 0: OK / -1: Syntax error
+ */
+int parseForCommand(struct parser *parser, struct statementNode *statement) {
+	statement->type = STATEMENT_FOR;
+	statement->forLoop = (struct forNode*) arenaAllocate(parser->arena,
+			sizeof(struct forNode));
+	if (statement->forLoop == NULL)
+		return -1;
+	struct forNode *forLoop = statement->forLoop;
+	forLoop->variable = NULL;
+	forLoop->words = NULL;
+	forLoop->wordsCount = 0;
+	forLoop->wordsGiven = 0;
+	if (advance(parser) == TOKEN_ARITHMETIC)
+		return parseArithmeticFor(parser, forLoop);
+	// The loop variable name
+	if (parser->current.type != TOKEN_WORD) {
+		syntaxError(parser);
+		return -1;
+	}
+	size_t i;
+	for (i = 0; i < parser->current.length; i++) {
+		char character = parser->current.text[i];
+		if (!isalnum((unsigned char) character) && (character != '_')) {
+			fprintf(stderr, "nicpoyia-sh: `%.*s': not a valid identifier\n",
+					(int) parser->current.length, parser->current.text);
+			return -1;
+		}
+	}
+	forLoop->variable = arenaCopyText(parser->arena, parser->current.text,
+			parser->current.length);
+	if (forLoop->variable == NULL)
+		return -1;
+	advance(parser);
+	skipNewLines(parser);
+	if (isKeyword(parser, "in")) {
+		forLoop->wordsGiven = 1;
+		int wordsCapacity = 0;
+		while (advance(parser) == TOKEN_WORD) {
+			if (growArray(parser, (void**) &forLoop->words, forLoop->wordsCount,
+					&wordsCapacity, sizeof(char*)) == -1)
+				return -1;
+			forLoop->words[forLoop->wordsCount] = arenaCopyText(parser->arena,
+					parser->current.text, parser->current.length);
+			if (forLoop->words[forLoop->wordsCount] == NULL)
+				return -1;
+			forLoop->wordsCount++;
+		}
+		if ((parser->current.type != TOKEN_SEPARATOR)
+				&& (parser->current.type != TOKEN_NEWLINE)) {
+			syntaxError(parser);
+			return -1;
+		}
+		advance(parser);
+	} else if (parser->current.type == TOKEN_SEPARATOR)
+		advance(parser);
+	skipNewLines(parser);
+	if (expectKeyword(parser, "do") == -1)
+		return -1;
+	if ((forLoop->body = parseCompoundList(parser, doneKeywords)) == NULL)
+		return -1;
+	return expectKeyword(parser, "done");
+}
+
+/**
+ * @brief Function that parses a statement: a pipeline or a compound command.
+ *
+ * @param parser
+ * @param statement The statement to be filled in
+ * @return 0: OK / -1: Syntax error
+ */
+int parseStatement(struct parser *parser, struct statementNode *statement) {
+	memset(statement, 0, sizeof(struct statementNode));
+	statement->connector = CONNECT_NONE;
+	// A timed pipeline (time [-p | -j] pipeline)
+	int timed = TIME_NONE;
+	if (isKeyword(parser, "time")) {
+		advance(parser);
+		timed = TIME_DEFAULT;
+		while ((parser->current.type == TOKEN_WORD)
+				&& (parser->current.length == 2) && (parser->current.text[0] == '-')
+				&& ((parser->current.text[1] == 'p')
+						|| (parser->current.text[1] == 'j'))) {
+			timed = (parser->current.text[1] == 'p') ? TIME_POSIX : TIME_JSON;
+			advance(parser);
+		}
+		// time alone times an empty pipeline (only the times of the shell are reported)
+		if ((parser->current.type == TOKEN_NEWLINE)
+				|| (parser->current.type == TOKEN_SEPARATOR)
+				|| (parser->current.type == TOKEN_END)
+				|| (parser->current.type == TOKEN_AND)
+				|| (parser->current.type == TOKEN_OR)) {
+			statement->type = STATEMENT_PIPELINE;
+			statement->pipeline.timed = timed;
+			statement->pipeline.text = arenaCopyText(parser->arena, "", 0);
+			return (statement->pipeline.text == NULL) ? -1 : 0;
+		}
+	}
+	if (isKeyword(parser, "!")) {
+		statement->negated = 1;
+		advance(parser);
+	}
+	// Only pipelines are timed
+	if ((timed != TIME_NONE) && (isAnyKeyword(parser, compoundKeywords)
+			|| (parser->current.type == TOKEN_ARITHMETIC))) {
+		syntaxError(parser);
+		return -1;
+	}
+	if (isKeyword(parser, "if"))
+		return parseIfCommand(parser, statement);
+	if (isKeyword(parser, "while"))
+		return parseLoopCommand(parser, statement, STATEMENT_WHILE);
+	if (isKeyword(parser, "until"))
+		return parseLoopCommand(parser, statement, STATEMENT_UNTIL);
+	if (isKeyword(parser, "for"))
+		return parseForCommand(parser, statement);
+	if (parser->current.type == TOKEN_ARITHMETIC) {
+		statement->type = STATEMENT_ARITHMETIC;
+		statement->arithmetic = arenaCopyText(parser->arena, parser->current.text,
+				parser->current.length);
+		if (statement->arithmetic == NULL)
+			return -1;
+		advance(parser);
+		return 0;
+	}
+	if (isAnyKeyword(parser, continuationKeywords)) {
+		syntaxError(parser);
+		return -1;
+	}
+	statement->type = STATEMENT_PIPELINE;
+	if (parsePipelineNode(parser, &statement->pipeline) == -1)
+		return -1;
+	statement->pipeline.timed = timed;
+	return 0;
+}
+
+/**
+ * @brief Function that parses a statement, together with the operator ending it.
+ *
+ * @param parser
+ * @param statement The statement to be filled in
+ * @return 0: OK / -1: Syntax error
+ */
+int parseCompleteStatement(struct parser *parser, struct statementNode *statement) {
+	if (parseStatement(parser, statement) == -1)
+		return -1;
+	// The statement terminator
+	switch (parser->current.type) {
+	case TOKEN_BACKGROUND:
+		// Only pipelines are executed in the background (compound commands are not yet)
+		if (statement->type != STATEMENT_PIPELINE) {
+			syntaxError(parser);
+			return -1;
+		}
+		statement->pipeline.background = 1;
+		advance(parser);
+		break;
+	case TOKEN_SEPARATOR:
+	case TOKEN_NEWLINE:
+		advance(parser);
+		break;
+	case TOKEN_AND:
+	case TOKEN_OR:
+		statement->connector =
+				(parser->current.type == TOKEN_AND) ? CONNECT_AND : CONNECT_OR;
+		// The next statement may follow in the next lines
+		advance(parser);
+		skipNewLines(parser);
+		if ((parser->current.type == TOKEN_END)
+				|| (parser->current.type == TOKEN_SEPARATOR)
+				|| isAnyKeyword(parser, continuationKeywords)) {
+			syntaxError(parser);
+			return -1;
+		}
+		break;
+	case TOKEN_END:
+		break;
+	default:
+		// A compound command may be followed directly by the reserved word ending its parent
+		if ((statement->type != STATEMENT_PIPELINE)
+				&& isAnyKeyword(parser, continuationKeywords))
+			break;
+		syntaxError(parser);
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * @brief Function that initializes a parser over a script, to be parsed statement by statement.
+ *
+ * @param parser
+ * @param arena The arena to allocate the syntax trees from
+ * @param script The script text
+ * @param length The script length
+ */
+void initializeParser(struct parser *parser, struct arena *arena,
+		const char *script, size_t length) {
+	parser->arena = arena;
+	parser->quiet = 0;
+	parser->incomplete = 0;
+	initializeLexer(&parser->lexer, script, length);
+	advance(parser);
+}
+
+/**
+ * @brief Function that parses the next statement of the script.
+ * Only the script text up to the end of the statement is scanned,
+ * so that the statement can be executed before the rest of the script is parsed.
+ *
+ * @param parser
+ * @param statement The statement to be filled in
+ * @return 1: Parsed / 0: End of script / -1: Syntax error
+ */
+int parseNextStatement(struct parser *parser, struct statementNode *statement) {
+	// Empty statements
+	while ((parser->current.type == TOKEN_NEWLINE)
+			|| (parser->current.type == TOKEN_SEPARATOR))
+		advance(parser);
+	if (parser->current.type == TOKEN_END)
+		return 0;
+	if (parseCompleteStatement(parser, statement) == -1)
+		return -1;
+	return 1;
+}
+
+/**
+ * @brief Function that checks whether a script ends within an unfinished statement
+ * (e.g. an if command without its fi), so that more lines should be read to complete it.
+ * Nothing is reported, and nothing remains allocated.
+ *
+ * @param arena The arena to parse the script within
+ * @param script The script text
+ * @param length The script length
+ * @return Whether the script is incomplete
+ */
+int isScriptIncomplete(struct arena *arena, const char *script, size_t length) {
+	struct arenaMark mark = arenaGetMark(arena);
+	struct parser parser;
+	parser.arena = arena;
+	parser.quiet = 1;
+	parser.incomplete = 0;
+	initializeLexer(&parser.lexer, script, length);
+	parser.lexer.quiet = 1;
+	advance(&parser);
+	struct statementNode statement;
+	int parsed;
+	while ((parsed = parseNextStatement(&parser, &statement)) == 1)
+		;
+	arenaRelease(arena, mark);
+	return (parsed == -1) && parser.incomplete;
+}
+
+/**
+ * @brief Function that parses an entire script into its syntax tree.
+ *
+ * @param arena The arena to allocate the syntax tree from
+ * @param script The script text
+ * @param length The script length
+ * @return The list of statements: OK / NULL: Syntax error
+ */
+struct listNode *parseScript(struct arena *arena, const char *script,
+		size_t length) {
+	struct parser parser;
+	initializeParser(&parser, arena, script, length);
+	struct listNode *list = (struct listNode*) arenaAllocate(arena,
+			sizeof(struct listNode));
+	if (list == NULL)
+		return NULL;
+	list->statements = NULL;
+	list->statementsCount = 0;
+	int statementsCapacity = 0;
+	while (1) {
+		if (growArray(&parser, (void**) &list->statements, list->statementsCount,
+				&statementsCapacity, sizeof(struct statementNode)) == -1)
+			return NULL;
+		int parsed = parseNextStatement(&parser,
+				&list->statements[list->statementsCount]);
+		if (parsed == -1)
+			return NULL;
+		if (parsed == 0)
+			break;
+		list->statementsCount++;
+	}
+	return list;
+}
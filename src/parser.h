@@ -0,0 +1,201 @@
+/*  @file parser.h
+ *  @author Nicolas Poyiadjis
+ *
+ *  @brief Script parser header.
+ *  The token stream of a script is parsed, in a single pass, into its syntax tree:
+ *  	- A list of statements, each one executed serially (;), in the background (&),
+ *  	  or depending on the status of the previous one (&&, ||)
+ *  	- A statement: a pipeline, a compound command (if, while, until, for)
+ *  	  containing lists of statements, or an arithmetic command (( ))
+ *  	- A pipeline of commands, interconnected using pipes (|)
+ *  	- A command of words and redirections
+ *  Compound command bodies are parsed once, and executed as many times as needed.
+ */
+
+#ifndef PARSER_H_
+#define PARSER_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lexer.h"
+#include "arena.h"
+
+/**
+ * @brief A redirection of a command (e.g. 2> file).
+ * The target word is kept as written, to be expanded when the command is executed.
+ */
+struct redirectionNode {
+	int type;
+	int fd;
+	char *target;
+};
+
+/**
+ * @brief A simple command.
+ * Words (the command name followed by its arguments) are kept as written,
+ * to be expanded when the command is executed.
+ */
+struct commandNode {
+	char **words;
+	int wordsCount;
+	struct redirectionNode *redirections;
+	int redirectionsCount;
+};
+
+/**
+ * @brief A pipeline of commands.
+ */
+struct pipelineNode {
+	struct commandNode *commands;
+	int commandsCount;
+	// Whether the pipeline is executed in the background (&)
+	int background;
+	// The pipeline script text, as given by the user
+	char *text;
+	// How the pipeline is timed (time keyword): TIME_NONE / TIME_DEFAULT / TIME_POSIX / TIME_JSON
+	int timed;
+};
+
+// Pipeline timing (time keyword): none / TIMEFORMAT / POSIX format (-p) / JSON (-j)
+#define TIME_NONE 0
+#define TIME_DEFAULT 1
+#define TIME_POSIX 2
+#define TIME_JSON 3
+
+// Statement types
+#define STATEMENT_PIPELINE 1
+#define STATEMENT_IF 2
+#define STATEMENT_WHILE 3
+#define STATEMENT_UNTIL 4
+#define STATEMENT_FOR 5
+#define STATEMENT_ARITHMETIC 6
+
+// Connectors of a statement to the next one
+#define CONNECT_NONE 0
+#define CONNECT_AND 1	// &&: The next statement is executed only if this one succeeds
+#define CONNECT_OR 2	// ||: The next statement is executed only if this one fails
+
+struct listNode;
+
+/**
+ * @brief An if command. An elif part is kept as an else part, containing a single if command.
+ */
+struct ifNode {
+	struct listNode *condition;
+	struct listNode *body;
+	// NULL if there is no else part
+	struct listNode *elseBody;
+};
+
+/**
+ * @brief A while / until loop.
+ */
+struct loopNode {
+	struct listNode *condition;
+	struct listNode *body;
+};
+
+/**
+ * @brief A for loop. The words are kept as written, to be expanded when the loop is executed.
+ * An arithmetic for loop, for (( initial; condition; step )), has no variable.
+ */
+struct forNode {
+	char *variable;
+	char **words;
+	int wordsCount;
+	// Whether the words are given (for NAME in words), instead of the positional parameters
+	int wordsGiven;
+	// Expressions of an arithmetic for loop (empty if omitted)
+	char *initial;
+	char *condition;
+	char *step;
+	struct listNode *body;
+};
+
+/**
+ * @brief A statement: a pipeline, a compound command or an arithmetic command.
+ */
+struct statementNode {
+	int type;
+	// Whether the status of the statement is negated (! pipeline)
+	int negated;
+	// How the next statement depends on this one (CONNECT_NONE / CONNECT_AND / CONNECT_OR)
+	int connector;
+	struct pipelineNode pipeline;
+	struct ifNode *ifCommand;
+	struct loopNode *loop;
+	struct forNode *forLoop;
+	// Expression of an arithmetic command (( ))
+	char *arithmetic;
+};
+
+/**
+ * @brief A list of statements, executed in the given order.
+ */
+struct listNode {
+	struct statementNode *statements;
+	int statementsCount;
+};
+
+/**
+ * @brief The parser state: the lexer and a single look-ahead token.
+ */
+struct parser {
+	struct lexer lexer;
+	struct token current;
+	// Arena to allocate the syntax tree from
+	struct arena *arena;
+	// Whether syntax errors are left unreported
+	int quiet;
+	// Whether the script ended within a statement (e.g. an unfinished if command)
+	int incomplete;
+};
+
+/**
+ * @brief Function that initializes a parser over a script, to be parsed statement by statement.
+ *
+ * @param parser
+ * @param arena The arena to allocate the syntax trees from
+ * @param script The script text
+ * @param length The script length
+ */
+void initializeParser(struct parser *parser, struct arena *arena,
+		const char *script, size_t length);
+
+/**
+ * @brief Function that parses the next statement of the script.
+ * Only the script text up to the end of the statement is scanned,
+ * so that the statement can be executed before the rest of the script is parsed.
+ *
+ * @param parser
+ * @param statement The statement to be filled in
+ * @return 1: Parsed / 0: End of script / -1: Syntax error
+ */
+int parseNextStatement(struct parser *parser, struct statementNode *statement);
+
+/**
+ * @brief Function that checks whether a script ends within an unfinished statement
+ * (e.g. an if command without its fi), so that more lines should be read to complete it.
+ * Nothing is reported, and nothing remains allocated.
+ *
+ * @param arena The arena to parse the script within
+ * @param script The script text
+ * @param length The script length
+ * @return Whether the script is incomplete
+ */
+int isScriptIncomplete(struct arena *arena, const char *script, size_t length);
+
+/**
+ * @brief Function that parses an entire script into its syntax tree.
+ *
+ * @param arena The arena to allocate the syntax tree from
+ * @param script The script text
+ * @param length The script length
+ * @return The list of statements: OK / NULL: Syntax error
+ */
+struct listNode *parseScript(struct arena *arena, const char *script,
+		size_t length);
+
+#endif /* PARSER_H_ */
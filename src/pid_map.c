@@ -0,0 +1,127 @@
+/*  @file pid_map.c
+ *  @author Nicolas Poyiadjis
+ *
+ *  @brief Process ID map implementation
+ */
+
+#include "pid_map.h"
+
+/**
+ * @brief Function that computes the home slot of a PID (Fibonacci hashing).
+ *
+ * @param map The PID map
+ * @param pid The PID
+ * @return The slot index
+ */
+size_t pidSlot(struct pidMap *map, pid_t pid) {
+	return (size_t) (((unsigned int) pid * 2654435769u) & (map->size - 1));
+}
+
+/**
+ * @brief Function that doubles the size of the map, keeping every entry.
+ *
+ * @param map The PID map
+ * @return 0: OK / -1: Error
+ */
+int growPidMap(struct pidMap *map) {
+	size_t newSize = map->size ? map->size * 2 : PID_MAP_INITIAL_SIZE;
+	struct pidEntry *newEntries = (struct pidEntry*) calloc(newSize,
+			sizeof(struct pidEntry));
+	if (newEntries == NULL) {
+		perror("malloc error");
+		return -1;
+	}
+	struct pidEntry *oldEntries = map->entries;
+	size_t oldSize = map->size;
+	map->entries = newEntries;
+	map->size = newSize;
+	size_t i;
+	for (i = 0; i < oldSize; i++) {
+		if (oldEntries[i].pid == 0)
+			continue;
+		size_t slot = pidSlot(map, oldEntries[i].pid);
+		while (map->entries[slot].pid != 0)
+			slot = (slot + 1) & (map->size - 1);
+		map->entries[slot] = oldEntries[i];
+	}
+	free(oldEntries);
+	return 0;
+}
+
+/**
+ * @brief Function that inserts a child process into the map (or updates its position).
+ *
+ * @param map The PID map
+ * @param pid The PID of the child process
+ * @param jobIndex The job of the process
+ * @param stage The pipeline stage of the process within its job
+ * @return 0: OK / -1: Error
+ */
+int pidMapInsert(struct pidMap *map, pid_t pid, int jobIndex, int stage) {
+	// Keep the load factor under 1/2
+	if ((map->count + 1) * 2 > map->size)
+		if (growPidMap(map) == -1)
+			return -1;
+	size_t slot = pidSlot(map, pid);
+	while ((map->entries[slot].pid != 0) && (map->entries[slot].pid != pid))
+		slot = (slot + 1) & (map->size - 1);
+	if (map->entries[slot].pid == 0)
+		map->count++;
+	map->entries[slot].pid = pid;
+	map->entries[slot].jobIndex = jobIndex;
+	map->entries[slot].stage = stage;
+	return 0;
+}
+
+/**
+ * @brief Function that finds the position of a child process.
+ *
+ * @param map The PID map
+ * @param pid The PID of the child process
+ * @return The process entry (valid until the map is next modified) / NULL: Not found
+ */
+struct pidEntry *pidMapLookup(struct pidMap *map, pid_t pid) {
+	if (map->size == 0)
+		return NULL;
+	size_t slot = pidSlot(map, pid);
+	while (map->entries[slot].pid != 0) {
+		if (map->entries[slot].pid == pid)
+			return &map->entries[slot];
+		slot = (slot + 1) & (map->size - 1);
+	}
+	return NULL;
+}
+
+/**
+ * @brief Function that removes a child process from the map.
+ *
+ * @param map The PID map
+ * @param pid The PID of the child process
+ * @param removed Filled in with the removed entry (if not NULL)
+ * @return 0: OK / -1: Not found
+ */
+int pidMapRemove(struct pidMap *map, pid_t pid, struct pidEntry *removed) {
+	struct pidEntry *entry = pidMapLookup(map, pid);
+	if (entry == NULL)
+		return -1;
+	if (removed != NULL)
+		*removed = *entry;
+	// Shift back the following entries of the probe sequence,
+	// so that no tombstone is needed
+	size_t hole = entry - map->entries;
+	size_t slot = hole;
+	while (1) {
+		slot = (slot + 1) & (map->size - 1);
+		if (map->entries[slot].pid == 0)
+			break;
+		size_t home = pidSlot(map, map->entries[slot].pid);
+		// Move the entry only if its home slot is not within (hole, slot]
+		if (((slot - home) & (map->size - 1)) >= ((slot - hole) & (map->size - 1))) {
+			map->entries[hole] = map->entries[slot];
+			hole = slot;
+		}
+	}
+	map->entries[hole].pid = 0;
+	map->count--;
+	return 0;
+}
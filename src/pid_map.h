@@ -0,0 +1,63 @@
+/*  @file pid_map.h
+ *  @author Nicolas Poyiadjis
+ *
+ *  @brief Process ID map header.
+ *  Maps the PID of every running child process to the job and pipeline stage it belongs to,
+ *  using an open addressing hash table (linear probing, without tombstones).
+ */
+
+#ifndef PID_MAP_H_
+#define PID_MAP_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define PID_MAP_INITIAL_SIZE 64
+
+// Position of a child process within the job table
+struct pidEntry {
+	pid_t pid;
+	int jobIndex;
+	int stage;
+};
+
+// Open addressing table of child processes (a zero PID means a free slot)
+struct pidMap {
+	struct pidEntry *entries;
+	size_t size;
+	size_t count;
+};
+
+/**
+ * @brief Function that inserts a child process into the map (or updates its position).
+ *
+ * @param map The PID map
+ * @param pid The PID of the child process
+ * @param jobIndex The job of the process
+ * @param stage The pipeline stage of the process within its job
+ * @return 0: OK / -1: Error
+ */
+int pidMapInsert(struct pidMap *map, pid_t pid, int jobIndex, int stage);
+
+/**
+ * @brief Function that finds the position of a child process.
+ *
+ * @param map The PID map
+ * @param pid The PID of the child process
+ * @return The process entry (valid until the map is next modified) / NULL: Not found
+ */
+struct pidEntry *pidMapLookup(struct pidMap *map, pid_t pid);
+
+/**
+ * @brief Function that removes a child process from the map.
+ *
+ * @param map The PID map
+ * @param pid The PID of the child process
+ * @param removed Filled in with the removed entry (if not NULL)
+ * @return 0: OK / -1: Not found
+ */
+int pidMapRemove(struct pidMap *map, pid_t pid, struct pidEntry *removed);
+
+#endif /* PID_MAP_H_ */
@@ -4,56 +4,80 @@
  *  @brief Interprocess communication function implementation
  */
 
+// pipe2() is a GNU extension
+#define _GNU_SOURCE
+
 #include "pipes.h"
 
 /**
- * @brief Function that creates FIFO files to interconnect the piped processes.
- * Fills in the pipesArray reference argument.
+ * @brief Function that closes a single pipe end, if it is still open.
+ *
+ * @param pipeEnd The pipe end descriptor (set to -1 once closed)
+ */
+void closePipeEnd(int *pipeEnd) {
+	if ((*pipeEnd) == -1)
+		return;
+	close(*pipeEnd);
+	(*pipeEnd) = -1;
+}
+
+/**
+ * @brief Function that creates the anonymous pipes interconnecting the piped processes.
+ * Fills in the pipesArray reference argument with one (read, write) descriptor pair per pipe.
+ * Every descriptor is created close-on-exec, so no process keeps an unused pipe end after exec.
  *
  * @param pipedProcesses Number of pipelined processes
- * @param pipesArray Container to be filled with FIFO files
+ * @param pipesArray Container to be filled with pipe descriptor pairs
  * @return Number of pipes: OK / -1: Error
  */
-int createPipes(int pipedProcesses, char *pipesArray[]) {
+int createPipes(int pipedProcesses, int pipesArray[][2]) {
 	int pipesCount = pipedProcesses - 1;
 	if (pipesCount > MAX_PIPES_PER_JOB)
 		return -1;
-	// Maximum pipes allowed = 256 (2^8) + "fifo" (4 characters)
-	char *nextFifoName = (char*) malloc(14 * sizeof(char));
 	int i;
 	for (i = 0; i < pipesCount; i++) {
-		sprintf(nextFifoName, "fifo%d", i);
-		if (access(nextFifoName, F_OK) == -1) {
-			if (mkfifo(nextFifoName, 0777) == -1) {
-				perror("mkfifo");
-				return -1;
-			}
+		if (pipe2(pipesArray[i], O_CLOEXEC) == -1) {
+			perror("pipe2");
+			// Do not leak the pipes already created
+			destroyPipes(i + 1, pipesArray);
+			return -1;
 		}
-		pipesArray[i] = (char*) malloc(
-				(strlen(nextFifoName) + 1) * sizeof(char));
-		strcpy(pipesArray[i], nextFifoName);
 	}
 	return pipesCount;
 }
 
 /**
- * @brief Function that destroys FIFO files that interconnected the piped processes.
+ * @brief Function that closes the pipe ends not needed anymore by the shell,
+ * once the process at the given pipeline position has been started.
+ *
+ * @param pipedProcesses Number of pipelined processes
+ * @param pipesArray Container filled with pipe descriptor pairs
+ * @param pipelinePos The position of the process just started in the pipeline
+ */
+void releasePipeEnds(int pipedProcesses, int pipesArray[][2], int pipelinePos) {
+	// The previous pipe has now got its reader
+	if (pipelinePos > 0)
+		closePipeEnd(&pipesArray[pipelinePos - 1][READ_FROM_PIPE]);
+	// The next pipe has now got its writer
+	if (pipelinePos < (pipedProcesses - 1))
+		closePipeEnd(&pipesArray[pipelinePos][WRITE_TO_PIPE]);
+}
+
+/**
+ * @brief Function that closes every pipe end still open.
  *
  * @param pipedProcesses Number of pipelined processes
- * @param pipesArray Container filled with FIFO files
+ * @param pipesArray Container filled with pipe descriptor pairs
  * @return Number of pipes: OK / -1: Error
  */
-int destroyPipes(int pipedProcesses, char *pipesArray[]) {
+int destroyPipes(int pipedProcesses, int pipesArray[][2]) {
 	int pipesCount = pipedProcesses - 1;
 	if (pipesCount > MAX_PIPES_PER_JOB)
 		return -1;
 	int i;
 	for (i = 0; i < pipesCount; i++) {
-		char rmCommand[15];
-		strcpy(rmCommand, "rm -f ");
-		strcat(rmCommand, pipesArray[i]);
-		system(rmCommand);
-		free(pipesArray[i]);
+		closePipeEnd(&pipesArray[i][READ_FROM_PIPE]);
+		closePipeEnd(&pipesArray[i][WRITE_TO_PIPE]);
 	}
 	return pipesCount;
 }
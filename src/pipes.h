@@ -20,22 +20,33 @@
 #define WRITE_TO_PIPE 1
 
 /**
- * @brief Function that creates FIFO files to interconnect the piped processes.
- * Fills in the pipesArray reference argument.
+ * @brief Function that creates the anonymous pipes interconnecting the piped processes.
+ * Fills in the pipesArray reference argument with one (read, write) descriptor pair per pipe.
+ * Every descriptor is created close-on-exec, so no process keeps an unused pipe end after exec.
  *
  * @param pipedProcesses Number of pipelined processes
- * @param pipesArray Container to be filled with FIFO files
+ * @param pipesArray Container to be filled with pipe descriptor pairs
  * @return Number of pipes: OK / -1: Error
  */
-int createPipes(int pipedProcesses, char *pipesArray[]);
+int createPipes(int pipedProcesses, int pipesArray[][2]);
 
 /**
- * @brief Function that destroys FIFO files that interconnected the piped processes.
+ * @brief Function that closes the pipe ends not needed anymore by the shell,
+ * once the process at the given pipeline position has been started.
  *
  * @param pipedProcesses Number of pipelined processes
- * @param pipesArray Container filled with FIFO files
+ * @param pipesArray Container filled with pipe descriptor pairs
+ * @param pipelinePos The position of the process just started in the pipeline
+ */
+void releasePipeEnds(int pipedProcesses, int pipesArray[][2], int pipelinePos);
+
+/**
+ * @brief Function that closes every pipe end still open.
+ *
+ * @param pipedProcesses Number of pipelined processes
+ * @param pipesArray Container filled with pipe descriptor pairs
  * @return Number of pipes: OK / -1: Error
  */
-int destroyPipes(int pipedProcesses, char *pipesArray[]);
+int destroyPipes(int pipedProcesses, int pipesArray[][2]);
 
 #endif /* PIPES_H_ */
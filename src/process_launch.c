@@ -0,0 +1,287 @@
+/*  @file process_launch.c
+ *  @author Nicolas Poyiadjis
+ *
+ *  @brief Process launching engine implementation.
+ *  The shell plans every I/O redirection of a process before launching it,
+ *  so that the process can be started either:
+ *  	- using posix_spawn (the child shares the shell memory until exec, no page-table copy)
+ *  	- using fork (the child replays the plan before exec)
+ */
+
+#include "process_launch.h"
+
+// The launch mode used for every process (LAUNCH_SPAWN / LAUNCH_FORK)
+int launchMode = LAUNCH_SPAWN;
+
+/**
+ * @brief Function that initializes an empty launch plan.
+ *
+ * @param plan
+ */
+void initializeLaunchPlan(struct launchPlan *plan) {
+	plan->actionsCount = 0;
+}
+
+/**
+ * @brief Function that adds an open action to a launch plan.
+ *
+ * @param plan
+ * @param fd The file descriptor to open the file as
+ * @param path The file path
+ * @param flags The open flags
+ * @return 0: OK / -1: Too many actions
+ */
+int addOpenAction(struct launchPlan *plan, int fd, char *path, int flags) {
+	if (plan->actionsCount == MAX_IO_ACTIONS)
+		return -1;
+	struct ioAction *action = &plan->actions[plan->actionsCount];
+	action->action = IO_ACTION_OPEN;
+	action->fd = fd;
+	action->sourceFd = -1;
+	action->path = path;
+	action->flags = flags;
+	plan->actionsCount++;
+	return 0;
+}
+
+/**
+ * @brief Function that adds a dup2 action to a launch plan.
+ *
+ * @param plan
+ * @param fd The file descriptor to be replaced
+ * @param sourceFd The file descriptor to duplicate
+ * @return 0: OK / -1: Too many actions
+ */
+int addDup2Action(struct launchPlan *plan, int fd, int sourceFd) {
+	if (plan->actionsCount == MAX_IO_ACTIONS)
+		return -1;
+	struct ioAction *action = &plan->actions[plan->actionsCount];
+	action->action = IO_ACTION_DUP2;
+	action->fd = fd;
+	action->sourceFd = sourceFd;
+	action->path = NULL;
+	action->flags = 0;
+	plan->actionsCount++;
+	return 0;
+}
+
+/**
+ * @brief Function that carries out every action of a launch plan in the current process.
+ * Used by forked children before exec.
+ *
+ * @param plan
+ * @return 0: OK / -1: Error
+ */
+int applyLaunchPlan(struct launchPlan *plan) {
+	int i;
+	for (i = 0; i < plan->actionsCount; i++) {
+		struct ioAction *action = &plan->actions[i];
+		if (action->action == IO_ACTION_OPEN) {
+			int fd;
+			if ((fd = open(action->path, action->flags, 0660)) < 0) {
+				perror(action->path);
+				return -1;
+			}
+			if (fd != action->fd) {
+				if (dup2(fd, action->fd) == -1) {
+					perror("dup2");
+					return -1;
+				}
+				close(fd);
+			}
+		} else if (action->action == IO_ACTION_DUP2) {
+			if (dup2(action->sourceFd, action->fd) == -1) {
+				perror("dup2");
+				return -1;
+			}
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief Function that carries out a launch plan in the shell itself (used by built-in functions),
+ * keeping copies of the replaced file descriptors.
+ *
+ * @param plan
+ * @param saved Filled in with the replaced file descriptors
+ * @return 0: OK / -1: Error (the file descriptors are already restored)
+ */
+int applyShellRedirections(struct launchPlan *plan,
+		struct savedDescriptors *saved) {
+	saved->count = 0;
+	int i, j;
+	for (i = 0; i < plan->actionsCount; i++) {
+		int fd = plan->actions[i].fd;
+		for (j = 0; (j < saved->count) && (saved->fds[j] != fd); j++)
+			;
+		if (j < saved->count)
+			continue;
+		// The copy is kept above the descriptors used by the user (and not inherited)
+		int copy = fcntl(fd, F_DUPFD_CLOEXEC, 10);
+		if ((copy == -1) && (errno != EBADF)) {
+			perror("fcntl");
+			restoreShellDescriptors(saved);
+			return -1;
+		}
+		saved->fds[saved->count] = fd;
+		saved->copies[saved->count] = copy;
+		saved->count++;
+	}
+	// Anything buffered so far is written where it was meant to
+	fflush(stdout);
+	fflush(stderr);
+	if (applyLaunchPlan(plan) == -1) {
+		restoreShellDescriptors(saved);
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * @brief Function that restores the shell file descriptors replaced by applyShellRedirections.
+ *
+ * @param saved The replaced file descriptors
+ */
+void restoreShellDescriptors(struct savedDescriptors *saved) {
+	fflush(stdout);
+	fflush(stderr);
+	int i;
+	for (i = saved->count - 1; i >= 0; i--) {
+		if (saved->copies[i] == -1) {
+			close(saved->fds[i]);
+			continue;
+		}
+		dup2(saved->copies[i], saved->fds[i]);
+		close(saved->copies[i]);
+	}
+	saved->count = 0;
+}
+
+/**
+ * @brief Function that launches a process using posix_spawn.
+ *
+ * @return The PID of the launched process: OK / -1: Error
+ */
+pid_t spawnProcess(const char *commandPath, char *arguments[],
+		char *environment[], struct launchPlan *plan) {
+	posix_spawn_file_actions_t fileActions;
+	posix_spawnattr_t attributes;
+	posix_spawn_file_actions_init(&fileActions);
+	posix_spawnattr_init(&attributes);
+	int i;
+	for (i = 0; i < plan->actionsCount; i++) {
+		struct ioAction *action = &plan->actions[i];
+		if (action->action == IO_ACTION_OPEN)
+			posix_spawn_file_actions_addopen(&fileActions, action->fd,
+					action->path, action->flags, 0660);
+		else if (action->action == IO_ACTION_DUP2)
+			posix_spawn_file_actions_adddup2(&fileActions, action->sourceFd,
+					action->fd);
+	}
+	// The command starts with no signal blocked, whatever the shell blocks
+	sigset_t emptyMask;
+	sigemptyset(&emptyMask);
+	posix_spawnattr_setsigmask(&attributes, &emptyMask);
+	posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETSIGMASK);
+	pid_t processPid;
+	int spawnError = posix_spawn(&processPid, commandPath, &fileActions,
+			&attributes, arguments, environment);
+	posix_spawn_file_actions_destroy(&fileActions);
+	posix_spawnattr_destroy(&attributes);
+	if (spawnError != 0) {
+		fprintf(stderr, "nicpoyia-sh: %s: %s\n", arguments[0],
+				strerror(spawnError));
+		return -1;
+	}
+	return processPid;
+}
+
+/**
+ * @brief Function that launches a process using fork.
+ *
+ * @return The PID of the launched process: OK / -1: Error
+ */
+pid_t forkProcess(const char *commandPath, char *arguments[],
+		char *environment[], struct launchPlan *plan) {
+	pid_t processPid;
+	uint64_t traceStart = tracing ? traceNow() : 0;
+	if ((processPid = fork()) == -1) {
+		perror("fork error");
+		return -1;
+	}
+	//------------------------------ Parent-Process ------------------------------//
+	if (processPid > 0) {
+		if (tracing)
+			traceSpan("fork", traceStart, commandPath);
+		return processPid;
+	}
+	//------------------------------ Child-Process ------------------------------//
+	sigset_t emptyMask;
+	sigemptyset(&emptyMask);
+	sigprocmask(SIG_SETMASK, &emptyMask, NULL);
+	if (tracing) {
+		traceChildStarted();
+		traceStart = traceNow();
+	}
+	if (applyLaunchPlan(plan) == -1)
+		_exit(EXIT_FAILURE);
+	if (tracing) {
+		traceSpan("redirections", traceStart, NULL);
+		traceInstant("exec", commandPath);
+	}
+	// Replace the text-segment
+	execve(commandPath, arguments, environment);
+	perror("execve");
+	_exit(127);
+}
+
+/**
+ * @brief Function that launches an executable with its I/O set up as planned.
+ *
+ * @param commandPath The executable path
+ * @param arguments The NULL-terminated arguments vector (including the command name)
+ * @param environment The NULL-terminated environment vector
+ * @param plan The I/O plan of the process
+ * @return The PID of the launched process: OK / -1: Error
+ */
+pid_t launchProcess(const char *commandPath, char *arguments[],
+		char *environment[], struct launchPlan *plan) {
+	if (launchMode == LAUNCH_FORK)
+		return forkProcess(commandPath, arguments, environment, plan);
+	return spawnProcess(commandPath, arguments, environment, plan);
+}
+
+/**
+ * @brief Function that sets the launch mode by its name (spawn / fork).
+ *
+ * @param modeName
+ */
+void setLaunchMode(const char *modeName) {
+	if (strcmp(modeName, "fork") == 0)
+		launchMode = LAUNCH_FORK;
+	else
+		launchMode = LAUNCH_SPAWN;
+}
+
+/**
+ * @brief Function that initializes the launch mode from the environment.
+ */
+void launchInitialization() {
+	const char *modeName = getVariable(LAUNCH_MODE_VARIABLE);
+	if (modeName != NULL)
+		setLaunchMode(modeName);
+}
+
+/**
+ * @brief Function to be notified about every variable assignment.
+ * Assigning the launch mode variable switches the launch mode.
+ *
+ * @param assignment The assignment string (NAME=value)
+ */
+void launchVariableAssigned(const char *assignment) {
+	size_t nameLength = strlen(LAUNCH_MODE_VARIABLE);
+	if ((strncmp(assignment, LAUNCH_MODE_VARIABLE, nameLength) == 0)
+			&& (assignment[nameLength] == '='))
+		setLaunchMode(assignment + nameLength + 1);
+}
@@ -0,0 +1,153 @@
+/*  @file process_launch.h
+ *  @author Nicolas Poyiadjis
+ *
+ *  @brief Process launching engine header.
+ *  The shell plans every I/O redirection of a process before launching it,
+ *  so that the process can be started either:
+ *  	- using posix_spawn (the child shares the shell memory until exec, no page-table copy)
+ *  	- using fork (the child replays the plan before exec)
+ */
+
+#ifndef PROCESS_LAUNCH_H_
+#define PROCESS_LAUNCH_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+
+#include "variables.h"
+#include "trace.h"
+
+#define MAX_IO_ACTIONS 16
+
+// Launch modes
+#define LAUNCH_SPAWN 0
+#define LAUNCH_FORK 1
+
+// Environment variable selecting the launch mode (spawn / fork)
+#define LAUNCH_MODE_VARIABLE "NICPOYIASH_LAUNCH"
+
+// I/O action types
+#define IO_ACTION_OPEN 1
+#define IO_ACTION_DUP2 2
+
+/**
+ * @brief A single I/O action, to be carried out in the child before exec.
+ * 	- IO_ACTION_OPEN: Open path (with flags) as file descriptor fd
+ * 	- IO_ACTION_DUP2: Duplicate sourceFd as file descriptor fd
+ */
+struct ioAction {
+	int action;
+	int fd;
+	int sourceFd;
+	char *path;
+	int flags;
+};
+
+/**
+ * @brief The I/O plan of a process, in the order the actions are carried out.
+ */
+struct launchPlan {
+	struct ioAction actions[MAX_IO_ACTIONS];
+	int actionsCount;
+};
+
+/**
+ * @brief The shell file descriptors replaced while a launch plan is applied in the shell itself,
+ * together with the copies restoring them afterwards (-1: the descriptor was closed).
+ */
+struct savedDescriptors {
+	int fds[MAX_IO_ACTIONS];
+	int copies[MAX_IO_ACTIONS];
+	int count;
+};
+
+// The launch mode used for every process (LAUNCH_SPAWN / LAUNCH_FORK)
+extern int launchMode;
+
+/**
+ * @brief Function that initializes an empty launch plan.
+ *
+ * @param plan
+ */
+void initializeLaunchPlan(struct launchPlan *plan);
+
+/**
+ * @brief Function that adds an open action to a launch plan.
+ *
+ * @param plan
+ * @param fd The file descriptor to open the file as
+ * @param path The file path
+ * @param flags The open flags
+ * @return 0: OK / -1: Too many actions
+ */
+int addOpenAction(struct launchPlan *plan, int fd, char *path, int flags);
+
+/**
+ * @brief Function that adds a dup2 action to a launch plan.
+ *
+ * @param plan
+ * @param fd The file descriptor to be replaced
+ * @param sourceFd The file descriptor to duplicate
+ * @return 0: OK / -1: Too many actions
+ */
+int addDup2Action(struct launchPlan *plan, int fd, int sourceFd);
+
+/**
+ * @brief Function that carries out every action of a launch plan in the current process.
+ * Used by forked children before exec.
+ *
+ * @param plan
+ * @return 0: OK / -1: Error
+ */
+int applyLaunchPlan(struct launchPlan *plan);
+
+/**
+ * @brief Function that carries out a launch plan in the shell itself (used by built-in functions),
+ * keeping copies of the replaced file descriptors.
+ *
+ * @param plan
+ * @param saved Filled in with the replaced file descriptors
+ * @return 0: OK / -1: Error (the file descriptors are already restored)
+ */
+int applyShellRedirections(struct launchPlan *plan,
+		struct savedDescriptors *saved);
+
+/**
+ * @brief Function that restores the shell file descriptors replaced by applyShellRedirections.
+ *
+ * @param saved The replaced file descriptors
+ */
+void restoreShellDescriptors(struct savedDescriptors *saved);
+
+/**
+ * @brief Function that launches an executable with its I/O set up as planned.
+ *
+ * @param commandPath The executable path
+ * @param arguments The NULL-terminated arguments vector (including the command name)
+ * @param environment The NULL-terminated environment vector
+ * @param plan The I/O plan of the process
+ * @return The PID of the launched process: OK / -1: Error
+ */
+pid_t launchProcess(const char *commandPath, char *arguments[],
+		char *environment[], struct launchPlan *plan);
+
+/**
+ * @brief Function that initializes the launch mode from the environment.
+ */
+void launchInitialization();
+
+/**
+ * @brief Function to be notified about every variable assignment.
+ * Assigning the launch mode variable switches the launch mode.
+ *
+ * @param assignment The assignment string (NAME=value)
+ */
+void launchVariableAssigned(const char *assignment);
+
+#endif /* PROCESS_LAUNCH_H_ */
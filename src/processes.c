@@ -6,720 +6,702 @@
 
 #include "processes.h"
 
-/** @brief Function that finds the job in which a process was launched.
+// The job running in the foreground (-1 if none).
+// Any terminal signal is forwarded to the processes of the foreground job.
+int foregroundJob = -1;
+// Exit status of the last foreground job
+__thread int lastExitStatus = 0;
+
+/** @brief Function that finds the running job in which a process was launched.
  *
  * @param pid
  * @return Job Index: OK / -1: Not found
  */
 int getJobIndex(int pid) {
-	int i, j;
-	for (i = 0; i < MAX_JOBS_RUNNING; i++)
-		for (j = 0; j < MAX_ACTIVE_PROCESSES; j++)
-			if (jobPIDs[i][j] == pid)
-				return i;
-	return -1;
+	struct pidEntry *entry = pidMapLookup(&processes, pid);
+	if (entry == NULL)
+		return -1;
+	return entry->jobIndex;
 }
 
-/** @brief Function that finds the process position in the process allocation table.
+/** @brief Function that converts a wait status into an exit status (as shown by $?).
  *
- * @param pid
- * @return Process Index: OK / -1: Not found
+ * @param status The wait status
+ * @return The exit status
  */
-int getProcessIndex(int pid) {
-	int i;
-	for (i = 0; i < MAX_ACTIVE_PROCESSES; i++)
-		if (processes[i] == pid)
-			return i;
-	return -1;
+int exitStatusOf(int status) {
+	if (WIFEXITED(status))
+		return WEXITSTATUS(status);
+	if (WIFSIGNALED(status))
+		return 128 + WTERMSIG(status);
+	return 0;
 }
 
-/** @brief Function that removes a process from the job's running processes.
+/** @brief Function that finishes a job, releasing its position.
  *
  * @param jobIndex
- * @param pid
- * @return 0: OK / -1: Not found
  */
-int jobProcessCompleted(int jobIndex, int pid) {
-	if (jobProcessesActive[jobIndex] == 0)
-		return -1;
-	int i;
-	for (i = 0; i < MAX_ACTIVE_PROCESSES; i++) {
-		if (jobPIDs[jobIndex][i] == pid) {
-			jobPIDs[jobIndex][i] = 0;
-			jobProcessesActive[jobIndex]--;
-			if (jobProcessesActive[jobIndex] == 0) {
-				jobsRunning[jobIndex] = 0;
-				activeJobs--;
-				printf("[%d]+\tJob Finished (done/exited/stopped)\n",
-						(jobIndex + 1));
-			}
-			return 0;
-		}
-	}
-	return -1;
+void jobFinished(int jobIndex) {
+	if (!jobs[jobIndex].running)
+		return;
+	jobs[jobIndex].running = 0;
+	activeJobs--;
 }
 
-/** @brief Function that releases every background process that has been completed.
- * Used before a job execution, in order to free some process space.
- * Notifies the user that the job-number has been completed.
+/** @brief Function that reports the resources used by a timed job, once all its processes have finished.
+ *
+ * @param job
+ * @param timing Resources already used besides the job processes (e.g. by the shell)
  */
-void releaseCompleteBackgroundProcesses() {
-	int backgroundProcesses = actPrCount;
-	int i;
-	for (i = 0; i < backgroundProcesses; i++) {
-		// For every active process
-		int nextPid = processes[i];
-		int nextPidStatus;
-		// Return immediately, if no child-process with PID=nextPid has finished (WNOHANG)
-		waitpid(nextPid, &nextPidStatus, WNOHANG);
-		// Check if completed
-		if ((WIFEXITED(nextPidStatus)) || (WIFSTOPPED(nextPidStatus))
-				|| (WIFSIGNALED(nextPidStatus))) {
-			// If so, release it from the allocation table.
-			int jobIndex = getJobIndex(nextPid);
-			if (jobIndex != -1)
-				jobProcessCompleted(jobIndex, nextPid);
-			deallocateProcess(i);
-		}
+void reportJobTiming(struct job *job, struct timing *timing) {
+	if (job->processesCount > 0) {
+		timing->real = elapsedSeconds(&job->started, &job->finished);
+		timing->user += timevalSeconds(&job->usage.ru_utime);
+		timing->system += timevalSeconds(&job->usage.ru_stime);
+		timing->maxResident = job->usage.ru_maxrss;
+		timing->status = exitStatusOf(job->statuses[job->processesCount - 1]);
 	}
+	timing->text = job->text;
+	reportTiming(job->timed, timing);
 }
 
-// Flag that shows whether a process is in the foreground.
-// Variable contains the PID of the foreground process.
-// If the flags is enabled:
-// 	Any terminal signal is be forwarded to the foreground process.
-int foregroundProcess = 0;
-
-/** @brief Signal handler that handles or forwards any signal received.
+/** @brief Function that records the completion of a process within its job.
+ * Notifies the user as soon as a background job has been completed.
  *
- * @param signalCode
+ * @param jobIndex
+ * @param stage The pipeline stage of the process
+ * @param status The wait status of the process
+ * @param usage The resources used by the process
+ * @return 0: OK / -1: Not found
  */
-void signal_handler(int signalCode) {
-	if (foregroundProcess == 0) {
-		// Handle the signal if no process is in the foreground
-		//
-		// Revert back to the native signal handler
-		void *signal_handler = nativeSignalHandlerFPs[signalCode];
-		nativeSignalHandlerFPs[signalCode] = signal(signalCode, signal_handler);
-		// Send the signal, so as to be handled by the native signal handler
-		kill(getpid(), signalCode);
-		// Replace the native signal handler again
-		nativeSignalHandlerFPs[signalCode] = signal(signalCode, signal_handler);
-	} else {
-		// Forward the signal to the foreground process, if any
-		kill(foregroundProcess, signalCode);
+int jobProcessCompleted(int jobIndex, int stage, int status,
+		struct rusage *usage) {
+	struct job *job = &jobs[jobIndex];
+	if ((job->processesActive == 0) || (job->statuses[stage] != -1))
+		return -1;
+	job->statuses[stage] = status;
+	job->usages[stage] = (*usage);
+	addResourceUsage(&job->usage, usage);
+	job->processesActive--;
+	if (job->processesActive == 0)
+		clock_gettime(CLOCK_MONOTONIC, &job->finished);
+	// The status of a background process is kept until waited for (wait built-in function)
+	if (job->background)
+		rememberFinishedStatus(job->pids[stage], status);
+	if ((job->processesActive == 0) && job->background) {
+		jobFinished(jobIndex);
+		rememberFinishedJob(job->pids[job->processesCount - 1]);
+		// The job is reported with its exit status and the resources it used
+		char description[64];
+		describeProcessStatus(job->statuses[job->processesCount - 1], description,
+				sizeof(description));
+		printf("[%d]+\t%-10s\t%s\t(real %.3fs, user %.3fs, sys %.3fs)\n",
+				(jobIndex + 1), description, (job->text != NULL) ? job->text : "",
+				elapsedSeconds(&job->started, &job->finished),
+				timevalSeconds(&job->usage.ru_utime),
+				timevalSeconds(&job->usage.ru_stime));
+		fflush(stdout);
+		if (job->timed != TIME_NONE) {
+			struct timing timing;
+			memset(&timing, 0, sizeof(timing));
+			reportJobTiming(job, &timing);
+		}
 	}
+	return 0;
 }
 
-// Standard I/O file descriptors for the current process
-int stdinFD = STDIN_FILENO;
-int stdoutFD = STDOUT_FILENO;
-int stderrFD = STDERR_FILENO;
+/** @brief Function that describes how a process ended (e.g. Done, Exit 2, Killed).
+ *
+ * @param status The wait status / -1: Still running
+ * @param description Filled in with the description
+ * @param size The description size
+ */
+void describeProcessStatus(int status, char *description, size_t size) {
+	if (status == -1)
+		snprintf(description, size, "Running");
+	else if (WIFSIGNALED(status))
+		snprintf(description, size, "%s", strsignal(WTERMSIG(status)));
+	else if (exitStatusOf(status) != 0)
+		snprintf(description, size, "Exit %d", exitStatusOf(status));
+	else
+		snprintf(description, size, "Done");
+}
 
-/** @brief Function that starts a process within a running job.
+/** @brief Function that reads the CPU time used so far by a running process (from /proc).
  *
- * @param jobIndex
  * @param pid
- * @return Process index: OK / -1: Process could not be started
+ * @param user Filled in with the user mode seconds
+ * @param system Filled in with the system mode seconds
+ * @return 0: OK / -1: Not available
  */
-int processStarted(int jobIndex, int pid) {
-	if (jobProcessesActive[jobIndex] == MAX_ACTIVE_PROCESSES)
+int readProcessTimes(pid_t pid, double *user, double *system) {
+	char path[64];
+	snprintf(path, sizeof(path), "/proc/%d/stat", (int) pid);
+	FILE *file = fopen(path, "r");
+	if (file == NULL)
 		return -1;
-	jobPIDs[jobIndex][jobProcessesActive[jobIndex]] = pid;
-	jobProcessesActive[jobIndex]++;
-	return 0;
+	char line[1024];
+	int result = -1;
+	if (fgets(line, sizeof(line), file) != NULL) {
+		// The fields following the command name (which may contain spaces),
+		// utime and stime being the 12th and 13th of them
+		char *fields = strrchr(line, ')');
+		unsigned long userTicks, systemTicks;
+		if ((fields != NULL)
+				&& (sscanf(fields + 2,
+						"%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu",
+						&userTicks, &systemTicks) == 2)) {
+			long ticks = sysconf(_SC_CLK_TCK);
+			(*user) = (double) userTicks / ticks;
+			(*system) = (double) systemTicks / ticks;
+			result = 0;
+		}
+	}
+	fclose(file);
+	return result;
 }
 
-/** @brief Function to finish a process.
+/** @brief Function that finds the job started most recently (the current job, marked with +).
  *
- * @param pid
- * @return Process index: OK / -1: Process could not be finished
+ * @return Job index / -1: No job running
  */
-int processFinished(int pid) {
-	if (pid == -1)
+int currentJob() {
+	int current = -1;
+	int i;
+	for (i = 0; i < jobsCapacity; i++)
+		if (jobs[i].running && (jobs[i].processesCount > 0)
+				&& ((current == -1)
+						|| (elapsedSeconds(&jobs[current].started, &jobs[i].started)
+								> 0)))
+			current = i;
+	return current;
+}
+
+/** @brief Function that finds the job given by a job specification:
+ * %N (job number), %% or %+ (current job), %- (previous job), %prefix (command text prefix)
+ * or %?text (command text containing the text).
+ *
+ * @param jobSpec The job specification
+ * @param finished Whether a job finished by number (whose position is not reused yet) is found as well
+ * @return Job index: OK / -1: No such job (or ambiguous)
+ */
+int findJob(const char *jobSpec, int finished) {
+	if (jobSpec[0] != '%')
 		return -1;
+	const char *spec = jobSpec + 1;
+	if ((*spec == '\0') || (strcmp(spec, "%") == 0) || (strcmp(spec, "+") == 0))
+		return currentJob();
 	int i;
-	for (i = 0; i < MAX_ACTIVE_PROCESSES; i++) {
-		if (processes[i] == pid) {
-			deallocateProcess(i);
-			return 0;
+	if (isdigit((unsigned char) *spec)) {
+		char *end;
+		long number = strtol(spec, &end, 10);
+		if ((*end != '\0') || (number < 1) || (number > jobsCapacity))
+			return -1;
+		i = number - 1;
+		if ((jobs[i].running || finished) && (jobs[i].processesCount > 0))
+			return i;
+		return -1;
+	}
+	int found = -1;
+	int current = currentJob();
+	for (i = 0; i < jobsCapacity; i++) {
+		struct job *job = &jobs[i];
+		if (!job->running || (job->processesCount == 0))
+			continue;
+		int matches;
+		if (strcmp(spec, "-") == 0) {
+			// The previous job: started most recently, besides the current one
+			matches = (i != current)
+					&& ((found == -1)
+							|| (elapsedSeconds(&jobs[found].started, &job->started)
+									> 0));
+			if (matches)
+				found = i;
+			continue;
+		}
+		if (job->text == NULL)
+			continue;
+		if (spec[0] == '?')
+			matches = (strstr(job->text, spec + 1) != NULL);
+		else
+			matches = (strncmp(job->text, spec, strlen(spec)) == 0);
+		if (matches) {
+			// An ambiguous specification gives no job
+			if (found != -1)
+				return -1;
+			found = i;
 		}
 	}
-	return -1;
+	// With a single job, the previous job is the current one
+	if ((found == -1) && (strcmp(spec, "-") == 0))
+		return current;
+	return found;
 }
 
-/**
- *  @brief Function that initializes the process information
+/** @brief Function that writes the description of a running job (jobs built-in function).
+ *
+ * @param output The output buffer
+ * @param jobIndex
+ * @param format JOBS_LIST_DEFAULT / JOBS_LIST_LONG (every process, with its resources) / JOBS_LIST_PIDS
  */
-void processesInitialization() {
-	int prInit;
-	for (prInit = 0; prInit < MAX_ACTIVE_PROCESSES; prInit++) {
-		processes[prInit] = 0;
+void outputJob(struct outputBuffer *output, int jobIndex, int format) {
+	struct job *job = &jobs[jobIndex];
+	if (format == JOBS_LIST_PIDS) {
+		if (job->processesCount > 0)
+			outputFormat(output, "%d\n", (int) job->pids[0]);
+		return;
+	}
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	char marker = (jobIndex == currentJob()) ? '+' : ' ';
+	const char *text = (job->text != NULL) ? job->text : "";
+	if (format == JOBS_LIST_DEFAULT) {
+		outputFormat(output, "[%d]%c  %-24s%s%s\n", jobIndex + 1, marker,
+				"Running", text, job->background ? " &" : "");
+		return;
+	}
+	outputFormat(output, "[%d]%c  %s%s  (running %.3fs)\n", jobIndex + 1, marker,
+			text, job->background ? " &" : "",
+			(job->processesCount > 0) ? elapsedSeconds(&job->started, &now) : 0.0);
+	// Every pipeline stage, with the CPU time it has used
+	int stage;
+	for (stage = 0; stage < job->processesCount; stage++) {
+		char description[64];
+		describeProcessStatus(job->statuses[stage], description,
+				sizeof(description));
+		double user = timevalSeconds(&job->usages[stage].ru_utime);
+		double system = timevalSeconds(&job->usages[stage].ru_stime);
+		if (job->statuses[stage] == -1)
+			readProcessTimes(job->pids[stage], &user, &system);
+		outputFormat(output, "      %-8d%-12suser %.3fs, sys %.3fs", (int) job->pids[stage],
+				description, user, system);
+		if (job->statuses[stage] != -1)
+			outputFormat(output, ", max rss %ld KB", job->usages[stage].ru_maxrss);
+		outputCharacter(output, '\n');
 	}
-	actPrCount = 0;
 }
 
-/** @brief This function is responsible for reserving one out
- * of the ten available process positions is the shell.
+/** @brief Function that reaps every child process that has finished,
+ * updating the process and job tables as soon as each child exits.
+ * Driven by SIGCHLD, received through the child signal file descriptor.
  *
- * @return The process index [0-9]: If OK / -1: If the process could not be allocated
+ * @param blocking Whether to block until at least one child has been reaped
+ * @return Number of children reaped
  */
-int allocateProcess() {
-	if (actPrCount == MAX_ACTIVE_PROCESSES) {
-		printf("Insufficient Resources\n");
-		return -1;
-	}
-	int prIndex = 0;
-	while (processes[prIndex]) {
-		prIndex++;
+int reapChildren(int blocking) {
+	// Consume the pending SIGCHLD notifications
+	struct signalfd_siginfo signalInfo;
+	while (read(childSignalFD, &signalInfo, sizeof(signalInfo))
+			== sizeof(signalInfo))
+		;
+	int reaped = 0;
+	while (1) {
+		int status;
+		struct rusage usage;
+		pid_t pid = wait4(-1, &status,
+				(blocking && (reaped == 0)) ? 0 : WNOHANG, &usage);
+		if (pid == -1) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		// No other child has finished
+		if (pid == 0)
+			break;
+		struct pidEntry entry;
+		if (processFinished(pid, &entry) == 0)
+			jobProcessCompleted(entry.jobIndex, entry.stage, status, &usage);
+		reaped++;
 	}
-	processes[prIndex] = 1;
-	actPrCount++;
-	return prIndex;
+	// The slots freed admit the queued jobs
+	if (jobQueue.count > 0)
+		startQueuedJobs();
+	return reaped;
 }
 
-/** @brief Function that releases a process that has finished executing.
+/** @brief Function that blocks until every process of a job has finished.
+ * Any other child finishing in the meantime is reaped as well.
  *
- * @param processIndex
- * @return 0: If released OK / -1: If no process to release
+ * @param jobIndex
+ * @return The exit status of the last process of the job
  */
-int deallocateProcess(int processIndex) {
-	if (actPrCount == 0)
-		return -1;
-	if (processes[processIndex] == 0)
-		return -1;
-	processes[processIndex] = 0;
-	actPrCount--;
-	return 0;
+int waitForJob(int jobIndex) {
+	uint64_t traceStart = tracing ? traceNow() : 0;
+	foregroundJob = jobIndex;
+	// (the job table may grow meanwhile, as queued jobs are started)
+	while (jobs[jobIndex].processesActive > 0)
+		if (reapChildren(1) == 0)
+			break;
+	foregroundJob = -1;
+	struct job *job = &jobs[jobIndex];
+	if (tracing)
+		traceSpan("wait", traceStart, job->text);
+	int lastProcess = job->processesCount - 1;
+	if ((lastProcess < 0) || (job->statuses[lastProcess] == -1))
+		return 0;
+	return exitStatusOf(job->statuses[lastProcess]);
 }
 
-/** @brief Function that handles the process creation and concurrent running in the system.
- * This function should be called only after:
- * 	-The process has its own index in the shell
- * 	-The I/O has been properly redirected
+/** @brief Function that blocks until the given file descriptor has input to read.
+ * Any child finishing in the meantime is reaped immediately.
  *
- * @param jobIndex The index of the job within the process is executed
- * @param commandName The command name itself
- * @param commandArguments Array of command arguments
- * @param isBackground Whether is is going to be executed in the background
- * @param args The total number of arguments right to the command name
- * @param pipelinePos The position of the process in the pipeline
- * @param pipelineCount How many pipelined processes are there
- * @param pipesArray An array containing names of FIFO files to be used
- * @param processString The full string given from the user for the process
- * @param lastInBackground Whether that last command is given with an ampersand
- * @return The number of forked processes: OK / -1: Error occurred
+ * @param fd The file descriptor to wait for
+ * @return 1: Input is ready / 0: Some children were reaped while waiting
  */
-int executeProcess(int jobIndex, char *commandName, char **commandArguments,
-		int isBackground, int args, int pipelinePos, int pipelineCount,
-		char *pipesArray[], char *processString, int lastInBackground) {
-	// Reset standard I/O file descriptors
-	stdinFD = STDIN_FILENO;
-	stdoutFD = STDOUT_FILENO;
-	stderrFD = STDERR_FILENO;
-	// Allocate process space within the shell
-	int processIndex = allocateProcess();
-	if (processIndex == -1) {
-		return -1;
-	}
-	// If any processes need to be forked
-	if (actPrCount == 0)
-		return -1;
-	if (processes[processIndex] == 0)
-		return -1;
-	// PROCESS EXECUTION
-	int processPid;
-	if ((processPid = fork()) == -1) {
-		perror("fork error");
-		return -1;
-	}
-	if (isBackground) {
-		// Remove the background ampersand character from the command name
-		if (commandName[strlen(commandName) - 1] == '&')
-			commandName = subString(commandName, 0, strlen(commandName) - 1);
-	}
-	//------------------------------ Parent-Process ------------------------------//
-	if (processPid > 0) {
-		// Store PID of forked process
-		processes[processIndex] = processPid;
-		if (isBackground) {
-			// Remove the background ampersand character from the command name
-			if (commandName[strlen(commandName) - 1] == '&')
-				commandName = subString(commandName, 0,
-						strlen(commandName) - 2);
-			processStarted(jobIndex, processPid);
-		} else {
-			foregroundProcess = processPid;
-			// Wait for the process to complete
-			int childStatus;
-			wait(&childStatus);
-			// Release the process
-			deallocateProcess(processIndex);
-			foregroundProcess = 0;
-		}
-		if (!lastInBackground) {
-			// Release the process
-			deallocateProcess(processIndex);
-			foregroundProcess = 0;
+int waitForUserInput(int fd) {
+	struct pollfd pollFDs[2];
+	pollFDs[0].fd = fd;
+	pollFDs[0].events = POLLIN;
+	pollFDs[1].fd = childSignalFD;
+	pollFDs[1].events = POLLIN;
+	fflush(stdout);
+	while (1) {
+		if (poll(pollFDs, 2, -1) == -1) {
+			if (errno == EINTR)
+				continue;
+			return 1;
 		}
-		free(commandName);
-		int i;
-		for (i = 0; i < args; i++)
-			free(commandArguments[i]);
-		free(commandArguments);
-		return 1;
+		if (pollFDs[0].revents)
+			return 1;
+		if (pollFDs[1].revents && (reapChildren(0) > 0))
+			return 0;
 	}
-	//------------------------------ Child-Process ------------------------------//
-	else {
-		// Define and execute I/O redirections
-		int IOArgs;
-		if ((IOArgs = executeRedirections(processString, 0, 0, 0, 0)) == -1)
-			return -1;
-		int nonIOArgs = args - IOArgs;
-		//
-		// Handle pipe redirections redirections
+}
+
+/** @brief Signal handler that handles or forwards any signal received.
+ *
+ * @param signalCode
+ */
+void signal_handler(int signalCode) {
+	if (foregroundJob == -1) {
+		// Handle the signal if no process is in the foreground
 		//
-		// Read from the previous pipe (except first process)
-		if (executeRedirections(commandName, 1, pipesArray[pipelinePos - 1],
-				pipelinePos, pipelineCount) == -1)
+		// Revert back to the native signal handler
+		void *signal_handler = nativeSignalHandlerFPs[signalCode];
+		nativeSignalHandlerFPs[signalCode] = signal(signalCode, signal_handler);
+		// Send the signal, so as to be handled by the native signal handler
+		kill(getpid(), signalCode);
+		// Replace the native signal handler again
+		nativeSignalHandlerFPs[signalCode] = signal(signalCode, signal_handler);
+	} else {
+		// Forward the signal to the foreground processes still running
+		struct job *job = &jobs[foregroundJob];
+		int i;
+		for (i = 0; i < job->processesCount; i++)
+			if (job->statuses[i] == -1)
+				kill(job->pids[i], signalCode);
+	}
+}
+
+/** @brief Function that starts a process within a running job.
+ *
+ * @param jobIndex
+ * @param pid
+ * @return Pipeline stage of the process: OK / -1: Process could not be started
+ */
+int processStarted(int jobIndex, int pid) {
+	struct job *job = &jobs[jobIndex];
+	// Grow the stages of the job
+	if (job->processesCount == job->processesCapacity) {
+		int newCapacity =
+				job->processesCapacity ?
+						job->processesCapacity * 2 : INITIAL_JOB_PROCESSES;
+		pid_t *newPIDs = (pid_t*) realloc(job->pids,
+				newCapacity * sizeof(pid_t));
+		if (newPIDs == NULL) {
+			perror("malloc error");
 			return -1;
-		// Write to the next pipe (except last process)
-		if (executeRedirections(commandName, 2, pipesArray[pipelinePos],
-				pipelinePos, pipelineCount) == -1)
+		}
+		job->pids = newPIDs;
+		int *newStatuses = (int*) realloc(job->statuses,
+				newCapacity * sizeof(int));
+		if (newStatuses == NULL) {
+			perror("malloc error");
 			return -1;
-		//
-		// Filter out the arguments about redirections
-		char *nonIOArguments[nonIOArgs + 2];
-		// Clear container in case of dangling data pointed
-		int argsCounter;
-		for (argsCounter = 0; argsCounter < nonIOArgs + 2; argsCounter++)
-			nonIOArguments[argsCounter] = NULL;
-		// Fill in the execution arguments
-		int i;
-		for (i = 0; i < nonIOArgs; i++)
-			nonIOArguments[i + 1] = commandArguments[i];
-		nonIOArguments[nonIOArgs + 1] = NULL;
-		nonIOArguments[0] = commandName;
-		// Replace the text-segment
-		int execRes;
-		execRes = execvp(commandName, nonIOArguments);
-		if (execRes == -1) {
-			perror("execvp");
+		}
+		job->statuses = newStatuses;
+		struct rusage *newUsages = (struct rusage*) realloc(job->usages,
+				newCapacity * sizeof(struct rusage));
+		if (newUsages == NULL) {
+			perror("malloc error");
 			return -1;
 		}
+		job->usages = newUsages;
+		job->processesCapacity = newCapacity;
 	}
-	//---------------------------------------------------------------------------//
-	return 0;
+	int stage = job->processesCount;
+	if (pidMapInsert(&processes, pid, jobIndex, stage) == -1)
+		return -1;
+	job->pids[stage] = pid;
+	job->statuses[stage] = -1;
+	memset(&job->usages[stage], 0, sizeof(struct rusage));
+	job->processesCount++;
+	job->processesActive++;
+	return stage;
 }
 
-/** @brief Function that checks whether a character represents a number in the range [0-9].
+/** @brief Function to finish a process.
  *
- * @param character
- * @return 1 if it is a file descriptor / 0 if it is not a number.
+ * @param pid
+ * @param entry Filled in with the job and pipeline stage of the process
+ * @return 0: OK / -1: Process could not be finished
  */
-int isFileDescriptor(char character) {
-	int charOffset = character - '0';
-	if ((charOffset >= 0) && (charOffset <= 2))
-		return 1;
-	if (character == '&')
-		return 1;
+int processFinished(int pid, struct pidEntry *entry) {
+	if (pidMapRemove(&processes, pid, entry) == -1)
+		return -1;
+	deallocateProcess();
 	return 0;
 }
 
-/** @brief Function that checks if a redirection string is a file descriptor.
- * ---> File descriptors are defined using the '&' symbol.
+/** @brief Function that forgets the jobs inherited by a forked child of the shell
+ * (a built-in function run as a pipeline stage), which has no child process of its own.
+ * The queued jobs are dropped as well (they are started by the shell itself).
+ */
+void forgetInheritedJobs() {
+	int i;
+	for (i = 0; i < jobsCapacity; i++)
+		jobs[i].running = 0;
+	activeJobs = 0;
+	actPrCount = 0;
+	foregroundJob = -1;
+	if (processes.entries != NULL)
+		memset(processes.entries, 0, processes.size * sizeof(struct pidEntry));
+	processes.count = 0;
+	// (the queued jobs memory is released as the child exits)
+	jobQueue.head = NULL;
+	jobQueue.count = 0;
+	finishedStatuses.count = 0;
+}
+
+/** @brief Function that parses a limit of concurrent processes or jobs.
  *
- * @param redirectionString
- * @return the file descriptor number if is is a file descriptor / 0 if it is not a file descriptor.
+ * @param value The limit as given by the user (0: unlimited)
+ * @param defaultLimit The limit to use if the value is not valid
+ * @return The limit
  */
-int checkIfFd(char *redirectionString) {
-	if (redirectionString == NULL)
-		return 0;
-	if (strlen(redirectionString) == 0)
-		return 0;
-	// If it is a file descriptor, parse the text after the '&' as a number
-	if (redirectionString[0] == '&') {
-		int fdNumber = atoi(redirectionString + 1);
-		return fdNumber;
+int parseLimit(const char *value, int defaultLimit) {
+	if ((value == NULL) || (*value == '\0'))
+		return defaultLimit;
+	char *end;
+	long limit = strtol(value, &end, 10);
+	if ((*end != '\0') || (limit < 0) || (limit > INT_MAX)) {
+		fprintf(stderr, "nicpoyia-sh: %s: invalid limit\n", value);
+		return defaultLimit;
 	}
-	return 0;
+	return (int) limit;
 }
 
-/**
- * @brief Function that checks whether a character is a redirection symbol (<,>)
+/** @brief Function to be notified about every variable assignment.
+ * Any change of the process or job limit takes effect immediately.
  *
- * @param character
- * @return 1: true / 0: false
+ * @param assignment The assignment string (NAME=value)
  */
-int isRedirectionSymbol(char character) {
-	if (character == '<')
-		return 1;
-	if (character == '>')
-		return 1;
-	return 0;
+void processesVariableAssigned(const char *assignment) {
+	size_t nameLength = strlen(MAX_PROCESSES_VARIABLE);
+	if ((strncmp(assignment, MAX_PROCESSES_VARIABLE, nameLength) == 0)
+			&& (assignment[nameLength] == '='))
+		maxActiveProcesses = parseLimit(assignment + nameLength + 1,
+				DEFAULT_MAX_ACTIVE_PROCESSES);
+	nameLength = strlen(MAX_JOBS_VARIABLE);
+	if ((strncmp(assignment, MAX_JOBS_VARIABLE, nameLength) == 0)
+			&& (assignment[nameLength] == '='))
+		maxJobsRunning = parseLimit(assignment + nameLength + 1,
+				DEFAULT_MAX_JOBS_RUNNING);
+	// Higher limits admit the queued jobs at once
+	if (jobQueue.count > 0)
+		startQueuedJobs();
 }
 
-/** @brief Method that finds the redirection string defined for a certain redirection string
- *
- *  * Redirection Strings:
- * 0 < / 0<
- * 1 > / 1>
- * 2 > / 2>
- * & > / &>
- *
- * Fills in the target character array by reference
- * Returns the redirection type:
- * 	- 1: Redirection from to StdIn
- * 	- 2: Redirection from StdOut
- * 	- 3: Redirection from StdErr
- * 	- 4: Redirection from both StdOut and StdErr
- * 	- 5: Redirection from StdOut (append mode)
- *
- * 	Returns 0 if no valid redirection occurs
- * 	Returns -1 if an error occurred
+/**
+ *  @brief Function that initializes the process information
+ */
+void processesInitialization() {
+	memset(&processes, 0, sizeof(processes));
+	actPrCount = 0;
+	jobs = NULL;
+	jobsCapacity = 0;
+	activeJobs = 0;
+	maxActiveProcesses = parseLimit(getVariable(MAX_PROCESSES_VARIABLE),
+			DEFAULT_MAX_ACTIVE_PROCESSES);
+	maxJobsRunning = parseLimit(getVariable(MAX_JOBS_VARIABLE),
+			DEFAULT_MAX_JOBS_RUNNING);
+	lastExitStatus = 0;
+	// SIGCHLD is only received through the child signal file descriptor
+	sigset_t childSignalMask;
+	sigemptyset(&childSignalMask);
+	sigaddset(&childSignalMask, SIGCHLD);
+	sigprocmask(SIG_BLOCK, &childSignalMask, NULL);
+	childSignalFD = signalfd(-1, &childSignalMask, SFD_NONBLOCK | SFD_CLOEXEC);
+	if (childSignalFD == -1)
+		perror("signalfd");
+	launchInitialization();
+	traceInitialization();
+}
+
+/** @brief Function that reserves a job position, growing the job table if needed.
  *
- * @param redString The entire redirection string
- * @param target The redirection target pointer
- * @return redirection type / 0 / -1
+ * @return Job index: OK / -1: Error
  */
-int findRedirections(char *redString, char **target) {
-	if (redString == NULL)
-		return 0;
-	// Split the redirection type and target
-	// Redirection Type
-	char *redType;
-	int redTypeLength;
-	if (isRedirectionSymbol(redString[0])) {
-		if (redString[0] == redString[1])
-			redTypeLength = 2;
-		else
-			redTypeLength = 1;
-	} else {
-		if ((redString[1] == ' ') && (isRedirectionSymbol(redString[2])))
-			redTypeLength = 3;
-		else
-			redTypeLength = 2;
-	}
-	redType = (char*) malloc((redTypeLength + 1) * sizeof(char));
-	if (redType == NULL) {
-		perror("malloc error");
-		return -1;
-	}
+int allocateJob() {
 	int i;
-	for (i = 0; i < redTypeLength; i++)
-		redType[i] = redString[i];
-	redType[redTypeLength] = '\0';
-	// Redirection Target
-	int redTargetLength = strlen(redString) - redTypeLength;
-	char *redTarget = (char*) malloc(redTargetLength * sizeof(char));
-	if (redTarget == NULL) {
+	for (i = 0; i < jobsCapacity; i++)
+		if (!jobs[i].running)
+			return i;
+	// Every position is in use: double the job table
+	int newCapacity = jobsCapacity ? jobsCapacity * 2 : DEFAULT_MAX_JOBS_RUNNING;
+	struct job *newJobs = (struct job*) realloc(jobs,
+			newCapacity * sizeof(struct job));
+	if (newJobs == NULL) {
 		perror("malloc error");
 		return -1;
 	}
-	int targetIndex = 0;
-	for (i = 0; i < redTargetLength; i++) {
-		char nextCharacter = redString[i + redTypeLength];
-		if (nextCharacter != ' ') {
-			redTarget[targetIndex] = nextCharacter;
-			targetIndex++;
-		}
-	}
-	redTarget[targetIndex] = '\0';
-	(*target) = redTarget;
-	// Define the type of redirection
-	// Check the first and last characters of the redirection type
-	// E.g. 1 > will be checked by the first and third characters
-	// while &> will be checked by the first and second characters
-	switch (redType[redTypeLength - 1]) {
-	case '<':
-		if ((strlen(redType) == 1) || (redType[0] == '0'))
-			return 1;
-		break;
-	case '>':
-		if (redTypeLength == 1)
-			return 2;
-		else
-			switch (redType[strlen(redType) - 2]) {
-			case '1':
-				return 2;
-				break;
-			case '2':
-				return 3;
-				break;
-			case '&':
-				return 4;
-				break;
-			case '>':
-				return 5;
-				break;
-			}
-		break;
-	}
-	return 0;
+	memset(newJobs + jobsCapacity, 0,
+			(newCapacity - jobsCapacity) * sizeof(struct job));
+	jobs = newJobs;
+	i = jobsCapacity;
+	jobsCapacity = newCapacity;
+	return i;
 }
 
-/**
- * @brief Function that checks whether a string is a redirection (>..., ...<)
+/** @brief This function is responsible for reserving one
+ * of the available process positions is the shell.
  *
- * @param string
- * @return 0 if it is not a redirection / 1 if has an internal redirection (e.g. 1>..., 0<...) / 2 if has an external redirection (e.g. 1>, 0<).
+ * @return 0: If OK / -1: If the process could not be allocated
  */
-int isRedirection(char *string) {
-	if (string == NULL)
-		return 0;
-	if (strlen(string) == 0)
-		return 0;
-	// If external redirection exist
-	if (isRedirectionSymbol(string[strlen(string) - 1]))
-		return 2;
-	int i;
-	// Check for internal redirections
-	for (i = 0; i < strlen(string); i++)
-		if (isRedirectionSymbol(string[i]))
-			return 1;
-	// If no redirection found
+int allocateProcess() {
+	// (the process limit is kept by the admission of the whole job)
+	actPrCount++;
 	return 0;
 }
 
-/** @brief Function that extracts the redirection statements from the full command string.
- * The redirection statements rest after the command arguments.
- *
- * For example:
- * 		command1 arg1 arg2 > file1.txt 2> file2.txt
- * 			would produce the following array:
- * 			[> file1.txt, 2> file2.txt]
- *
- * Fills in the redArgs referenced via an argument, that represents
- * the number of arguments that have to do with redirections.
+/** @brief Function that releases a process that has finished executing.
  *
- * @param commandCopy Copy of the full command
- * @param redirectionsArray Redirection arguments array
- * @param redArgs Redirection arguments count
- * @return the number of redirections
+ * @return 0: If released OK / -1: If no process to release
  */
-int splitRedirectionStrings(char *commandCopy, char***redirectionsArray,
-		int *redArgs) {
-	int redirections = 0;
-	// Allocate temporary space for the maximum redirections possible:
-	// (input, output, error = 3 possible redirections).
-	char **redStrings = (char**) malloc(3 * sizeof(char*));
-	if (redStrings == NULL) {
-		perror("malloc error");
-		return -1;
-	}
-	// Parse the command by splitting a copy of it by the whitespace character
-	char nextString[MAX_PROCESS_SIZE] = "";
-	int nextStringArgs = 0;
-	int redirectionType;
-	int redSymbolPassed = 0;
-	int isRedirectionFlag = 0;
-	char *nextCommandWord = strtok(commandCopy, " ");
-	(*redArgs) = 0;
-	// Word-tokenization procedure
-	while (nextCommandWord != NULL) {
-		nextStringArgs++;
-		// Ignore command and arguments
-		if (!(isFileDescriptor(nextCommandWord[0]))
-				&& !(isRedirectionSymbol(nextCommandWord[0]))) {
-			if (!redSymbolPassed && !redirections) {
-				nextCommandWord = strtok(NULL, " ");
-				nextStringArgs = 0;
-				continue;
-			}
-		}
-		// For the redirection region of the command
-		strcat(nextString, nextCommandWord);
-		strcat(nextString, " ");
-		redirectionType = isRedirection(nextCommandWord);
-		// If the word is a redirection at all
-		if (redirectionType == 1) {
-			isRedirectionFlag = 1;
-		}
-		// If a redirection symbol occurred at the end of the word
-		else if (redirectionType == 2) {
-			if (redSymbolPassed == 0)
-				redSymbolPassed = 1;
-			// Return NULL pointer if a redirection syntax error occur
-			else
-				return -1;
-		}
-		// If a redirection symbol (<,>) has occurred before, and a string follows
-		else if (redirectionType == 0) {
-			if (redSymbolPassed) {
-				isRedirectionFlag = 1;
-				redSymbolPassed = 0;
-			}
-		}
-		// The next redirection statement has been parsed, and so it is stored
-		if (isRedirectionFlag) {
-			(*redArgs) += nextStringArgs;
-			nextStringArgs = 0;
-			char *nextRedirectionCopy = (char*) malloc(
-					(strlen(nextString) + 1) * sizeof(char));
-			if (nextRedirectionCopy == NULL) {
-				perror("malloc error");
-				return -1;
-			}
-			strcpy(nextRedirectionCopy, nextString);
-			redStrings[redirections] = nextRedirectionCopy;
-			redirections++;
-			// Clear the next string container
-			nextString[0] = '\0';
-			redSymbolPassed = 0;
-			isRedirectionFlag = 0;
-		}
-		nextCommandWord = strtok(NULL, " ");
-	}
-	// Reallocate space to return an array with the required size,
-	// according to the redirections found while parsing.
-	*redirectionsArray = (char**) malloc(redirections * sizeof(char*));
-	if ((*redirectionsArray) == NULL) {
-		perror("malloc error");
+int deallocateProcess() {
+	if (actPrCount == 0)
 		return -1;
-	}
-	// Copy the found redirections
-	int i;
-	for (i = 0; i < redirections; i++) {
-		(*redirectionsArray)[i] = redStrings[i];
-	}
-	// Release the temporary array space
-	free(redStrings);
-	return redirections;
+	actPrCount--;
+	return 0;
 }
 
 /**
- * @brief Function that redirects the I/O of a certain command as described using symbols.
- * Also, it can be used for redirecting the process input or output from/to a pipe.
+ * @brief Function that plans the I/O redirections of a certain command, as described using symbols.
+ * The process input and output from/to the pipeline pipes is planned first,
+ * so that the redirections given explicitly take precedence over the pipes.
  *
- * @param command A copy of the full command
- * @param toPipe Type of redirection to a pipe
- * @param fifoName Name of the FIFO file to redirect from/to
+ * @param command The command syntax tree
  * @param pipelinePos The position of the process in the pipeline
  * @param pipelineCount How many pipelined processes are there
- * @return Number of redirections arguments / 0: OK / -1: Error
+ * @param pipesArray An array containing the pipe descriptor pairs of the pipeline
+ * @param plan The launch plan to be filled in
+ * @return 0: OK / -1: Error
  */
-int executeRedirections(char *command, int toPipe, char *fifoName,
-		int pipelinePos, int pipelineCount) {
-	// Pipe redirection
-	if (toPipe) {
-		// Read from pipe
-		if (toPipe == 1) {
-			if (pipelinePos > 0) {
-				int fifoFD;
-				if ((fifoFD = open(fifoName, O_RDONLY)) == -1) {
-					perror("opening fifo for reading");
-					return -1;
-				}
-				if (dup2(fifoFD, stdinFD) == -1)
-					return -1;
-			}
-		}
-		// Write to pipe
-		else if (toPipe == 2) {
-			if (pipelinePos < (pipelineCount - 1)) {
-				int fifoFD;
-				if ((fifoFD = open(fifoName, O_WRONLY)) == -1) {
-					perror("opening fifo for writing");
-					return -1;
-				}
-				if (dup2(fifoFD, stdoutFD) == -1)
-					return -1;
-			}
-		}
-		return 0;
-	}
-	// Parse the command to find the redirections
-	char *redirectFromInput = NULL;
-	char *redirectToStdOut = NULL;
-	char *redirectToStdOutAppend = NULL;
-	char *redirectToStdErr = NULL;
-	// Get the redirection statements after the command arguments
-	char *commandCopy = (char*) malloc((strlen(command) + 1) * sizeof(char));
-	if (commandCopy == NULL) {
-		perror("malloc error");
-		return -1;
-	}
-	strcpy(commandCopy, command);
-	char **redirectionStrings;
-	int redArgs;
-	int redStringsCount = splitRedirectionStrings(commandCopy,
-			&redirectionStrings, &redArgs);
-	if (redirectionStrings == NULL) {
-		return -1;
-	}
-	int redCounter;
-	for (redCounter = 0; redCounter < redStringsCount; redCounter++) {
-		char *nextRedString = redirectionStrings[redCounter];
-		char *redTarget;
-		int redType = findRedirections(nextRedString, &redTarget);
-		if (redType == -1)
+int planRedirections(struct commandNode *command, int pipelinePos,
+		int pipelineCount, int pipesArray[][2], struct launchPlan *plan) {
+	initializeLaunchPlan(plan);
+	// Read from the previous pipe (except first process)
+	if (pipelinePos > 0)
+		if (redirectToFd(plan, STDIN_FILENO,
+				pipesArray[pipelinePos - 1][READ_FROM_PIPE]) == -1)
 			return -1;
-		switch (redType) {
-		case 1:
-			redirectFromInput = redTarget;
+	// Write to the next pipe (except last process)
+	if (pipelinePos < (pipelineCount - 1))
+		if (redirectToFd(plan, STDOUT_FILENO,
+				pipesArray[pipelinePos][WRITE_TO_PIPE]) == -1)
+			return -1;
+	// Redirections given explicitly, in the order given
+	int i;
+	for (i = 0; i < command->redirectionsCount; i++) {
+		struct redirectionNode *redirection = &command->redirections[i];
+		char *target = expandWord(&scriptArena, redirection->target);
+		if (target == NULL)
+			return -1;
+		int redirectionResult = 0;
+		switch (redirection->type) {
+		case REDIRECT_INPUT:
+			redirectionResult = redirectFromFile(plan, redirection->fd, target);
 			break;
-		case 2:
-			redirectToStdOut = redTarget;
+		case REDIRECT_OUTPUT:
+			redirectionResult = redirectToFile(plan, redirection->fd, target, 0);
 			break;
-		case 3:
-			redirectToStdErr = redTarget;
+		case REDIRECT_APPEND:
+			redirectionResult = redirectToFile(plan, redirection->fd, target, 1);
 			break;
-		case 4:
-			redirectToStdOut = redTarget;
-			redirectToStdErr = redTarget;
+		case REDIRECT_OUTPUT_ERROR:
+			redirectionResult = redirectToFile(plan, STDOUT_FILENO, target, 0);
+			if (redirectionResult != -1)
+				redirectionResult = redirectToFd(plan, STDERR_FILENO,
+						STDOUT_FILENO);
 			break;
-		case 5:
-			redirectToStdOutAppend = redTarget;
+		case REDIRECT_DUPLICATE:
+			redirectionResult = redirectToFd(plan, redirection->fd,
+					atoi(target));
 			break;
 		}
+		if (redirectionResult == -1)
+			return -1;
 	}
-	// Standard Input redirection
-	if (redirectFromInput != NULL) {
-		int fd;
-		if ((fd = checkIfFd(redirectFromInput)) > 0) {
-			if (redirectStdInFd(fd) == -1)
-				fprintf(stderr, "Error while redirecting input/output\n");
-			stdinFD = fd;
-		} else {
-			if ((stdinFD = redirectStdIn(redirectFromInput)) == -1)
-				fprintf(stderr, "Error while redirecting input/output\n");
-		}
+	return 0;
+}
+
+/** @brief Function that handles the process creation and concurrent running in the system.
+ * The I/O redirections of the process are planned by the shell,
+ * and the process is launched as selected by the launch mode (spawn / fork).
+ *
+ * @param jobIndex The index of the job within the process is executed
+ * @param commandPath The path of the command executable, as resolved in PATH
+ * @param commandWords The expanded command name and arguments (NULL-terminated)
+ * @param command The command syntax tree, containing its redirections
+ * @param pipelinePos The position of the process in the pipeline
+ * @param pipelineCount How many pipelined processes are there
+ * @param pipesArray An array containing the pipe descriptor pairs of the pipeline
+ * @return The number of forked processes: OK / -1: Error occurred
+ */
+int executeProcess(int jobIndex, const char *commandPath, char **commandWords,
+		struct commandNode *command, int pipelinePos, int pipelineCount,
+		int pipesArray[][2]) {
+	// Allocate process space within the shell
+	if (allocateProcess() == -1) {
+		return -1;
 	}
-	// Standard Output redirection (append mode >>)
-	if (redirectToStdOutAppend != NULL) {
-		int fd;
-		if ((fd = checkIfFd(redirectToStdOutAppend)) > 0) {
-			if (redirectStdOutFd(fd) == -1)
-				fprintf(stderr, "Error while redirecting input/output\n");
-			stdoutFD = fd;
-		} else {
-			if ((stdoutFD = redirectStdOut(redirectToStdOutAppend, 1)) == -1)
-				fprintf(stderr, "Error while redirecting input/output\n");
-		}
+	// Plan the pipe and file redirections, before launching the process
+	struct launchPlan plan;
+	uint64_t traceStart = tracing ? traceNow() : 0;
+	if (planRedirections(command, pipelinePos, pipelineCount, pipesArray,
+			&plan) == -1) {
+		fprintf(stderr, "Error while redirecting input/output\n");
+		deallocateProcess();
+		return -1;
 	}
-	// Standard Output redirection
-	else if (redirectToStdOut != NULL) {
-		int fd;
-		if ((fd = checkIfFd(redirectToStdOut)) > 0) {
-			if (redirectStdOutFd(fd) == -1)
-				fprintf(stderr, "Error while redirecting input/output\n");
-			stdoutFD = fd;
-		} else {
-			if ((stdoutFD = redirectStdOut(redirectToStdOut, 0)) == -1)
-				fprintf(stderr, "Error while redirecting input/output\n");
-		}
+	if (tracing)
+		traceSpan("planRedirections", traceStart, NULL);
+	// PROCESS EXECUTION
+	// (the command is handed the exported variables only)
+	char **environment = exportedEnvironment();
+	if (environment == NULL) {
+		deallocateProcess();
+		return -1;
 	}
-	// Standard Error redirection
-	if (redirectToStdErr != NULL) {
-		int fd;
-		if ((fd = checkIfFd(redirectToStdErr)) > 0) {
-			if (redirectStdErrFd(fd) == -1)
-				fprintf(stderr, "Error while redirecting input/output\n");
-			stderrFD = fd;
-		} else {
-			if ((stderrFD = redirectStdErr(redirectToStdErr)) == -1)
-				fprintf(stderr, "Error while redirecting input/output\n");
-		}
+	// The job time is measured from the start of its first process
+	if (jobs[jobIndex].processesCount == 0)
+		clock_gettime(CLOCK_MONOTONIC, &jobs[jobIndex].started);
+	traceStart = tracing ? traceNow() : 0;
+	pid_t processPid = launchProcess(commandPath, commandWords, environment,
+			&plan);
+	if (tracing)
+		traceSpan("launch", traceStart, commandPath);
+	if (processPid == -1) {
+		deallocateProcess();
+		return -1;
+	}
+	// Store PID of launched process
+	// (it is reaped as soon as it exits, see reapChildren)
+	if (processStarted(jobIndex, processPid) == -1) {
+		kill(processPid, SIGKILL);
+		waitpid(processPid, NULL, 0);
+		deallocateProcess();
+		return -1;
 	}
-	return redArgs;
+	return 1;
 }
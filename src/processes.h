@@ -10,32 +10,90 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
 #include <sys/wait.h>
+#include <sys/resource.h>
+#include <sys/signalfd.h>
 #include "bash_builtin_functions.h"
 #include "files.h"
 #include "pipes.h"
+#include "process_launch.h"
+#include "parser.h"
+#include "expansion.h"
+#include "pid_map.h"
+#include "timing.h"
+#include "job_queue.h"
+#include "job_wait.h"
 
-#define MAX_ACTIVE_PROCESSES 10
-#define MAX_JOBS_RUNNING 10
-#define MAX_PROCESS_SIZE 512
+#define DEFAULT_MAX_ACTIVE_PROCESSES 10
+#define DEFAULT_MAX_JOBS_RUNNING 10
+#define INITIAL_JOB_PROCESSES 4
+// Listing formats of the jobs built-in function
+#define JOBS_LIST_DEFAULT 0
+#define JOBS_LIST_LONG 1
+#define JOBS_LIST_PIDS 2
+// Environmental variables setting the limits of concurrent processes and jobs
+#define MAX_PROCESSES_VARIABLE "NICPOYIASH_MAX_PROCESSES"
+#define MAX_JOBS_VARIABLE "NICPOYIASH_MAX_JOBS"
 
-// PIDs of all active processes
-// A zero value means a free position
-pid_t processes[MAX_ACTIVE_PROCESSES];
+// Every active process, mapped to its job and pipeline stage
+struct pidMap processes;
 // Active processes count;
 int actPrCount;
+// Limits of concurrent processes and jobs (0: unlimited)
+int maxActiveProcesses;
+int maxJobsRunning;
 
 // Native signal handlers
 void (*nativeSignalHandlerFPs[32])(int);
 
+// Record keeping track of a job session
+struct job {
+	// Whether the job position is in use
+	int running;
+	// Whether the job has been started in the background
+	int background;
+	// Processes still running
+	int processesActive;
+	// Processes started (one per pipeline stage)
+	int processesCount;
+	int processesCapacity;
+	// PID and wait status of every pipeline stage (-1 while the stage is running)
+	pid_t *pids;
+	int *statuses;
+	// Resources used by every pipeline stage (filled in once the stage is reaped)
+	struct rusage *usages;
+	// The job text, as given by the user (allocated)
+	char *text;
+	// Resources used by the processes reaped so far
+	struct rusage usage;
+	// Monotonic times of the first process start and of the last process end
+	struct timespec started;
+	struct timespec finished;
+	// How the job is timed (TIME_NONE / TIME_DEFAULT / TIME_POSIX / TIME_JSON)
+	int timed;
+};
+
 // Data containers keeping track of every active job session
 //
+// Job table (grown on demand)
+struct job *jobs;
+int jobsCapacity;
 // Active jobs
 int activeJobs;
-int jobsRunning[MAX_JOBS_RUNNING];
-// Active processes per job
-int jobProcessesActive[MAX_JOBS_RUNNING];
-int jobPIDs[MAX_JOBS_RUNNING][MAX_ACTIVE_PROCESSES];
+// The job running in the foreground (-1 if none)
+extern int foregroundJob;
+// Exit status of the last foreground job
+// (every built-in function thread keeps a status of its own)
+extern __thread int lastExitStatus;
+// PID of the last process started in the background ($!)
+pid_t lastBackgroundPid;
+
+// File descriptor receiving SIGCHLD, whenever a child process changes state
+int childSignalFD;
 
 /**
  *  @brief Function that initializes the process information
@@ -48,73 +106,177 @@ void processesInitialization();
  */
 void signal_handler(int signalCode);
 
+/** @brief Function to be notified about every variable assignment.
+ * Any change of the process or job limit takes effect immediately.
+ *
+ * @param assignment The assignment string (NAME=value)
+ */
+void processesVariableAssigned(const char *assignment);
+
 /** @brief Function to finish a process.
  *
  * @param pid
- * @return Process index: OK / -1: Process could not be finished
+ * @param entry Filled in with the job and pipeline stage of the process
+ * @return 0: OK / -1: Process could not be finished
+ */
+int processFinished(int pid, struct pidEntry *entry);
+
+/** @brief Function that forgets the jobs inherited by a forked child of the shell
+ * (a built-in function run as a pipeline stage), which has no child process of its own.
+ * The queued jobs are dropped as well (they are started by the shell itself).
+ */
+void forgetInheritedJobs();
+
+/** @brief Function that finds the running job in which a process was launched.
+ *
+ * @param pid
+ * @return Job Index: OK / -1: Not found
+ */
+int getJobIndex(int pid);
+
+/** @brief Function that reserves a job position, growing the job table if needed.
+ *
+ * @return Job index: OK / -1: Error
+ */
+int allocateJob();
+
+/** @brief Function that converts a wait status into an exit status (as shown by $?).
+ *
+ * @param status The wait status
+ * @return The exit status
+ */
+int exitStatusOf(int status);
+
+/** @brief Function that finishes a job, releasing its position.
+ *
+ * @param jobIndex
+ */
+void jobFinished(int jobIndex);
+
+/** @brief Function that reports the resources used by a timed job, once all its processes have finished.
+ *
+ * @param job
+ * @param timing Resources already used besides the job processes (e.g. by the shell)
+ */
+void reportJobTiming(struct job *job, struct timing *timing);
+
+/** @brief Function that describes how a process ended (e.g. Done, Exit 2, Killed).
+ *
+ * @param status The wait status / -1: Still running
+ * @param description Filled in with the description
+ * @param size The description size
+ */
+void describeProcessStatus(int status, char *description, size_t size);
+
+/** @brief Function that reads the CPU time used so far by a running process (from /proc).
+ *
+ * @param pid
+ * @param user Filled in with the user mode seconds
+ * @param system Filled in with the system mode seconds
+ * @return 0: OK / -1: Not available
+ */
+int readProcessTimes(pid_t pid, double *user, double *system);
+
+/** @brief Function that writes the description of a running job (jobs built-in function).
+ *
+ * @param output The output buffer
+ * @param jobIndex
+ * @param format JOBS_LIST_DEFAULT / JOBS_LIST_LONG (every process, with its resources) / JOBS_LIST_PIDS
  */
-int processFinished(int pid);
+void outputJob(struct outputBuffer *output, int jobIndex, int format);
 
-/** @brief Function that finds the process position in the process allocation table.
+/** @brief Function that finds the job started most recently (the current job, marked with +).
  *
+ * @return Job index / -1: No job running
+ */
+int currentJob();
+
+/** @brief Function that finds the job given by a job specification:
+ * %N (job number), %% or %+ (current job), %- (previous job), %prefix (command text prefix)
+ * or %?text (command text containing the text).
+ *
+ * @param jobSpec The job specification
+ * @param finished Whether a job finished by number (whose position is not reused yet) is found as well
+ * @return Job index: OK / -1: No such job (or ambiguous)
+ */
+int findJob(const char *jobSpec, int finished);
+
+/** @brief Function that starts a process within a running job.
+ *
+ * @param jobIndex
  * @param pid
- * @return Process Index: OK / -1: Not found
+ * @return Pipeline stage of the process: OK / -1: Process could not be started
  */
-int getProcessIndex(int pid);
+int processStarted(int jobIndex, int pid);
 
-/** @brief Function that releases every background process that has been completed.
- * Used before a job execution, in order to free some process space.
- * Notifies the user that the job-number has been completed.
+/** @brief Function that reaps every child process that has finished,
+ * updating the process and job tables as soon as each child exits.
+ * Driven by SIGCHLD, received through the child signal file descriptor.
+ *
+ * @param blocking Whether to block until at least one child has been reaped
+ * @return Number of children reaped
+ */
+int reapChildren(int blocking);
+
+/** @brief Function that blocks until every process of a job has finished.
+ * Any other child finishing in the meantime is reaped as well.
+ *
+ * @param jobIndex
+ * @return The exit status of the last process of the job
+ */
+int waitForJob(int jobIndex);
+
+/** @brief Function that blocks until the given file descriptor has input to read.
+ * Any child finishing in the meantime is reaped immediately.
+ *
+ * @param fd The file descriptor to wait for
+ * @return 1: Input is ready / 0: Some children were reaped while waiting
  */
-void releaseCompleteBackgroundProcesses();
+int waitForUserInput(int fd);
 
 /**
- * @brief Function that redirects the I/O of a certain command as described using symbols.
- * Also, it can be used for redirecting the process input or output from/to a pipe.
+ * @brief Function that plans the I/O redirections of a certain command, as described using symbols.
+ * The process input and output from/to the pipeline pipes is planned first,
+ * so that the redirections given explicitly take precedence over the pipes.
  *
- * @param command A copy of the full command
- * @param toPipe Type of redirection to a pipe
- * @param fifoName Name of the FIFO file to redirect from/to
+ * @param command The command syntax tree
  * @param pipelinePos The position of the process in the pipeline
  * @param pipelineCount How many pipelined processes are there
- * @return Number of redirections arguments / 0: OK / -1: Error
+ * @param pipesArray An array containing the pipe descriptor pairs of the pipeline
+ * @param plan The launch plan to be filled in
+ * @return 0: OK / -1: Error
  */
-int executeRedirections(char *command, int toPipe, char *fifoName,
-		int pipelinePos, int pipelineCount);
+int planRedirections(struct commandNode *command, int pipelinePos,
+		int pipelineCount, int pipesArray[][2], struct launchPlan *plan);
 
-/** @brief This function is responsible for reserving one out
- * of the ten available process positions is the shell.
+/** @brief This function is responsible for reserving one
+ * of the available process positions is the shell.
  *
- * @return The process index [0-9]: If OK / -1: If the process could not be allocated
+ * @return 0: If OK / -1: If the process could not be allocated
  */
 int allocateProcess();
 
 /** @brief Function that releases a process that has finished executing.
  *
- * @param processIndex
  * @return 0: If released OK / -1: If no process to release
  */
-int deallocateProcess(int processIndex);
+int deallocateProcess();
 
 /** @brief Function that handles the process creation and concurrent running in the system.
- * This function should be called only after:
- * 	-The process has its own index in the shell
- * 	-The I/O has been properly redirected
+ * The I/O redirections of the process are planned by the shell,
+ * and the process is launched as selected by the launch mode (spawn / fork).
  *
  * @param jobIndex The index of the job within the process is executed
- * @param commandName The command name itself
- * @param commandArguments Array of command arguments
- * @param isBackground Whether is is going to be executed in the background
- * @param args The total number of arguments right to the command name
+ * @param commandPath The path of the command executable, as resolved in PATH
+ * @param commandWords The expanded command name and arguments (NULL-terminated)
+ * @param command The command syntax tree, containing its redirections
  * @param pipelinePos The position of the process in the pipeline
  * @param pipelineCount How many pipelined processes are there
- * @param pipesArray An array containing names of FIFO files to be used
- * @param processString The full string given from the user for the process
- * @param lastInBackground Whether that last command is given with an ampersand
+ * @param pipesArray An array containing the pipe descriptor pairs of the pipeline
  * @return The number of forked processes: OK / -1: Error occurred
  */
-int executeProcess(int jobIndex, char *commandName, char **commandArguments,
-		int isBackground, int args, int pipelinePos, int pipelineCount,
-		char *pipesArray[], char *processString, int lastInBackground);
+int executeProcess(int jobIndex, const char *commandPath, char **commandWords,
+		struct commandNode *command, int pipelinePos, int pipelineCount,
+		int pipesArray[][2]);
 
 #endif /* PROCESSES_H_ */
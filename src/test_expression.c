@@ -0,0 +1,346 @@
+/*  @file test_expression.c
+ *  @author Nicolas Poyiadjis
+ *
+ *  @brief Conditional expression (test, [) evaluation implementation.
+ *  The expression is parsed by recursive descent, in order of precedence:
+ *  	- expr -o expr
+ *  	- expr -a expr
+ *  	- ! expr
+ *  	- ( expr ), unary operators, binary operators, single strings
+ */
+
+#include "test_expression.h"
+
+/**
+ * @brief The state of the evaluation of an expression.
+ */
+struct testExpression {
+	char **arguments;
+	int count;
+	int position;
+	int error;
+};
+
+// Binary operators
+const char *const binaryOperators[] = { "=", "==", "!=", "<", ">", "-eq", "-ne",
+		"-lt", "-le", "-gt", "-ge", "-nt", "-ot", NULL };
+
+int evaluateOrExpression(struct testExpression *expression);
+
+/**
+ * @brief Function that reports an invalid expression.
+ *
+ * @param expression
+ * @param message The error message
+ * @param argument The argument concerned / NULL: None
+ */
+void testError(struct testExpression *expression, const char *message,
+		const char *argument) {
+	if (expression->error)
+		return;
+	expression->error = 1;
+	if (argument != NULL)
+		fprintf(stderr, "nicpoyia-sh: test: %s: %s\n", argument, message);
+	else
+		fprintf(stderr, "nicpoyia-sh: test: %s\n", message);
+}
+
+/**
+ * @brief Function that returns the argument at a given offset from the current position.
+ *
+ * @return The argument / NULL: Past the end of the expression
+ */
+char *peekArgument(struct testExpression *expression, int offset) {
+	if (expression->position + offset >= expression->count)
+		return NULL;
+	return expression->arguments[expression->position + offset];
+}
+
+/**
+ * @brief Function that checks whether an argument is a binary operator.
+ *
+ * @param argument
+ * @return Whether the argument is a binary operator
+ */
+int isBinaryOperator(const char *argument) {
+	int i;
+	if (argument == NULL)
+		return 0;
+	for (i = 0; binaryOperators[i] != NULL; i++)
+		if (strcmp(argument, binaryOperators[i]) == 0)
+			return 1;
+	return 0;
+}
+
+/**
+ * @brief Function that checks whether an argument is a unary operator.
+ *
+ * @param argument
+ * @return Whether the argument is a unary operator
+ */
+int isUnaryOperator(const char *argument) {
+	return (argument != NULL) && (argument[0] == '-') && (argument[1] != '\0')
+			&& (argument[2] == '\0')
+			&& (strchr("nzefdrwxsLhbcpSt", argument[1]) != NULL);
+}
+
+/**
+ * @brief Function that converts an integer operand.
+ *
+ * @param expression
+ * @param operand
+ * @param value The integer value
+ * @return 0: OK / -1: Not an integer
+ */
+int integerOperand(struct testExpression *expression, const char *operand,
+		long long *value) {
+	char *end;
+	errno = 0;
+	(*value) = strtoll(operand, &end, 10);
+	while ((*end == ' ') || (*end == '\t'))
+		end++;
+	if ((end == operand) || (*end != '\0') || (errno != 0)) {
+		testError(expression, "integer expression expected", operand);
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * @brief Function that evaluates a unary operator.
+ *
+ * @param expression
+ * @param operator The operator (e.g. -f)
+ * @param operand The operand
+ * @return 1: True / 0: False
+ */
+int evaluateUnary(struct testExpression *expression, char operator,
+		const char *operand) {
+	struct stat fileStatus;
+	switch (operator) {
+	case 'n':
+		return operand[0] != '\0';
+	case 'z':
+		return operand[0] == '\0';
+	case 'r':
+		return access(operand, R_OK) == 0;
+	case 'w':
+		return access(operand, W_OK) == 0;
+	case 'x':
+		return access(operand, X_OK) == 0;
+	case 't': {
+		long long fd;
+		if (integerOperand(expression, operand, &fd) == -1)
+			return 0;
+		return isatty((int) fd);
+	}
+	case 'L':
+	case 'h':
+		return (lstat(operand, &fileStatus) == 0) && S_ISLNK(fileStatus.st_mode);
+	}
+	if (stat(operand, &fileStatus) == -1)
+		return 0;
+	switch (operator) {
+	case 'f':
+		return S_ISREG(fileStatus.st_mode);
+	case 'd':
+		return S_ISDIR(fileStatus.st_mode);
+	case 's':
+		return fileStatus.st_size > 0;
+	case 'b':
+		return S_ISBLK(fileStatus.st_mode);
+	case 'c':
+		return S_ISCHR(fileStatus.st_mode);
+	case 'p':
+		return S_ISFIFO(fileStatus.st_mode);
+	case 'S':
+		return S_ISSOCK(fileStatus.st_mode);
+	}
+	// -e
+	return 1;
+}
+
+/**
+ * @brief Function that compares the modification times of two files.
+ *
+ * @param left
+ * @param right
+ * @return <0: Left older / 0: Same / >0: Left newer (a missing file is the oldest)
+ */
+int compareModificationTimes(const char *left, const char *right) {
+	struct stat leftStatus, rightStatus;
+	int leftExists = (stat(left, &leftStatus) == 0);
+	int rightExists = (stat(right, &rightStatus) == 0);
+	if (!leftExists || !rightExists)
+		return leftExists - rightExists;
+	if (leftStatus.st_mtim.tv_sec != rightStatus.st_mtim.tv_sec)
+		return (leftStatus.st_mtim.tv_sec < rightStatus.st_mtim.tv_sec) ? -1 : 1;
+	if (leftStatus.st_mtim.tv_nsec != rightStatus.st_mtim.tv_nsec)
+		return (leftStatus.st_mtim.tv_nsec < rightStatus.st_mtim.tv_nsec) ?
+				-1 : 1;
+	return 0;
+}
+
+/**
+ * @brief Function that evaluates a binary operator.
+ *
+ * @param expression
+ * @param left The left operand
+ * @param operator The operator (e.g. -eq)
+ * @param right The right operand
+ * @return 1: True / 0: False
+ */
+int evaluateBinary(struct testExpression *expression, const char *left,
+		const char *operator, const char *right) {
+	if ((strcmp(operator, "=") == 0) || (strcmp(operator, "==") == 0))
+		return strcmp(left, right) == 0;
+	if (strcmp(operator, "!=") == 0)
+		return strcmp(left, right) != 0;
+	if (strcmp(operator, "<") == 0)
+		return strcmp(left, right) < 0;
+	if (strcmp(operator, ">") == 0)
+		return strcmp(left, right) > 0;
+	if (strcmp(operator, "-nt") == 0)
+		return compareModificationTimes(left, right) > 0;
+	if (strcmp(operator, "-ot") == 0)
+		return compareModificationTimes(left, right) < 0;
+	// Integer comparison
+	long long leftValue, rightValue;
+	if ((integerOperand(expression, left, &leftValue) == -1)
+			|| (integerOperand(expression, right, &rightValue) == -1))
+		return 0;
+	if (strcmp(operator, "-eq") == 0)
+		return leftValue == rightValue;
+	if (strcmp(operator, "-ne") == 0)
+		return leftValue != rightValue;
+	if (strcmp(operator, "-lt") == 0)
+		return leftValue < rightValue;
+	if (strcmp(operator, "-le") == 0)
+		return leftValue <= rightValue;
+	if (strcmp(operator, "-gt") == 0)
+		return leftValue > rightValue;
+	return leftValue >= rightValue;
+}
+
+/**
+ * @brief Function that evaluates a primary expression.
+ *
+ * @param expression
+ * @return 1: True / 0: False
+ */
+int evaluatePrimary(struct testExpression *expression) {
+	char *argument = peekArgument(expression, 0);
+	if (argument == NULL) {
+		testError(expression, "argument expected", NULL);
+		return 0;
+	}
+	// A binary operator takes precedence (e.g. [ "-n" = "-n" ])
+	if (isBinaryOperator(peekArgument(expression, 1))
+			&& (peekArgument(expression, 2) != NULL)) {
+		char *operator = peekArgument(expression, 1);
+		char *right = peekArgument(expression, 2);
+		expression->position += 3;
+		return evaluateBinary(expression, argument, operator, right);
+	}
+	if ((strcmp(argument, "(") == 0) && (peekArgument(expression, 1) != NULL)) {
+		expression->position++;
+		int result = evaluateOrExpression(expression);
+		char *closing = peekArgument(expression, 0);
+		if ((closing == NULL) || (strcmp(closing, ")") != 0)) {
+			testError(expression, "`)' expected", NULL);
+			return 0;
+		}
+		expression->position++;
+		return result;
+	}
+	if (isUnaryOperator(argument) && (peekArgument(expression, 1) != NULL)) {
+		char *operand = peekArgument(expression, 1);
+		expression->position += 2;
+		return evaluateUnary(expression, argument[1], operand);
+	}
+	// A single string is true if it is not empty
+	expression->position++;
+	return argument[0] != '\0';
+}
+
+/**
+ * @brief Function that evaluates a (possibly negated) expression.
+ *
+ * @param expression
+ * @return 1: True / 0: False
+ */
+int evaluateNotExpression(struct testExpression *expression) {
+	char *argument = peekArgument(expression, 0);
+	if ((argument != NULL) && (strcmp(argument, "!") == 0)
+			&& (peekArgument(expression, 1) != NULL)) {
+		expression->position++;
+		return !evaluateNotExpression(expression);
+	}
+	return evaluatePrimary(expression);
+}
+
+/**
+ * @brief Function that evaluates a conjunction of expressions (-a).
+ *
+ * @param expression
+ * @return 1: True / 0: False
+ */
+int evaluateAndExpression(struct testExpression *expression) {
+	int result = evaluateNotExpression(expression);
+	char *argument;
+	while (((argument = peekArgument(expression, 0)) != NULL)
+			&& (strcmp(argument, "-a") == 0)) {
+		expression->position++;
+		// Both operands are evaluated, so that any error is reported
+		int right = evaluateNotExpression(expression);
+		result = result && right;
+	}
+	return result;
+}
+
+/**
+ * @brief Function that evaluates a disjunction of expressions (-o).
+ *
+ * @param expression
+ * @return 1: True / 0: False
+ */
+int evaluateOrExpression(struct testExpression *expression) {
+	int result = evaluateAndExpression(expression);
+	char *argument;
+	while (((argument = peekArgument(expression, 0)) != NULL)
+			&& (strcmp(argument, "-o") == 0)) {
+		expression->position++;
+		int right = evaluateAndExpression(expression);
+		result = result || right;
+	}
+	return result;
+}
+
+/**
+ * @brief Function that evaluates a conditional expression, given as separate arguments.
+ * Supported:
+ * 	- Logical: ! expr, expr -a expr, expr -o expr, ( expr )
+ * 	- Strings: -n, -z, string, =, ==, !=, <, >
+ * 	- Integers: -eq, -ne, -lt, -le, -gt, -ge
+ * 	- Files: -e, -f, -d, -r, -w, -x, -s, -L, -h, -b, -c, -p, -S, -t, -nt, -ot
+ *
+ * @param arguments The expression arguments
+ * @param count Number of arguments
+ * @return Exit status: 0: True / 1: False / 2: Invalid expression
+ */
+int evaluateTestExpression(char **arguments, int count) {
+	// An empty expression is false
+	if (count == 0)
+		return 1;
+	struct testExpression expression;
+	expression.arguments = arguments;
+	expression.count = count;
+	expression.position = 0;
+	expression.error = 0;
+	int result = evaluateOrExpression(&expression);
+	if (!expression.error && (expression.position < count))
+		testError(&expression, "too many arguments", NULL);
+	if (expression.error)
+		return 2;
+	return result ? 0 : 1;
+}
@@ -0,0 +1,33 @@
+/*  @file test_expression.h
+ *  @author Nicolas Poyiadjis
+ *
+ *  @brief Conditional expression (test, [) evaluation header.
+ *  The expression is evaluated directly from the arguments, within the shell,
+ *  so that conditions of if / while commands are checked without forking any process.
+ */
+
+#ifndef TEST_EXPRESSION_H_
+#define TEST_EXPRESSION_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+/**
+ * @brief Function that evaluates a conditional expression, given as separate arguments.
+ * Supported:
+ * 	- Logical: ! expr, expr -a expr, expr -o expr, ( expr )
+ * 	- Strings: -n, -z, string, =, ==, !=, <, >
+ * 	- Integers: -eq, -ne, -lt, -le, -gt, -ge
+ * 	- Files: -e, -f, -d, -r, -w, -x, -s, -L, -h, -b, -c, -p, -S, -t, -nt, -ot
+ *
+ * @param arguments The expression arguments
+ * @param count Number of arguments
+ * @return Exit status: 0: True / 1: False / 2: Invalid expression
+ */
+int evaluateTestExpression(char **arguments, int count);
+
+#endif /* TEST_EXPRESSION_H_ */
@@ -0,0 +1,198 @@
+/*  @file timing.c
+ *  @author Nicolas Poyiadjis
+ *
+ *  @brief Pipeline timing (time keyword) implementation
+ */
+
+#include "timing.h"
+#include "parser.h"
+
+/**
+ * @brief Function that returns the seconds elapsed between two (monotonic) times.
+ *
+ * @param start
+ * @param end
+ * @return The seconds elapsed
+ */
+double elapsedSeconds(const struct timespec *start, const struct timespec *end) {
+	return (end->tv_sec - start->tv_sec) + (end->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/**
+ * @brief Function that converts a time value to seconds.
+ *
+ * @param value
+ * @return The seconds
+ */
+double timevalSeconds(const struct timeval *value) {
+	return value->tv_sec + value->tv_usec / 1e6;
+}
+
+/**
+ * @brief Function that adds a time value to another.
+ *
+ * @param total
+ * @param value
+ */
+void addTimeval(struct timeval *total, const struct timeval *value) {
+	total->tv_sec += value->tv_sec;
+	total->tv_usec += value->tv_usec;
+	if (total->tv_usec >= 1000000) {
+		total->tv_sec++;
+		total->tv_usec -= 1000000;
+	}
+}
+
+/**
+ * @brief Function that adds the resources used by a process (or job) to a resource usage total.
+ * CPU times are summed, and so are the resident set size peaks.
+ *
+ * @param total
+ * @param usage
+ */
+void addResourceUsage(struct rusage *total, const struct rusage *usage) {
+	addTimeval(&total->ru_utime, &usage->ru_utime);
+	addTimeval(&total->ru_stime, &usage->ru_stime);
+	total->ru_maxrss += usage->ru_maxrss;
+	total->ru_minflt += usage->ru_minflt;
+	total->ru_majflt += usage->ru_majflt;
+	total->ru_inblock += usage->ru_inblock;
+	total->ru_oublock += usage->ru_oublock;
+	total->ru_nvcsw += usage->ru_nvcsw;
+	total->ru_nivcsw += usage->ru_nivcsw;
+}
+
+/**
+ * @brief Function that records the start of a timed pipeline.
+ *
+ * @param start
+ */
+void startTiming(struct timingStart *start) {
+	clock_gettime(CLOCK_MONOTONIC, &start->wall);
+	getrusage(RUSAGE_SELF, &start->self);
+}
+
+/**
+ * @brief Function that adds the CPU time spent by the shell itself since the start of a timed pipeline.
+ *
+ * @param start
+ * @param timing
+ */
+void addShellTiming(struct timingStart *start, struct timing *timing) {
+	struct rusage self;
+	getrusage(RUSAGE_SELF, &self);
+	timing->user += timevalSeconds(&self.ru_utime)
+			- timevalSeconds(&start->self.ru_utime);
+	timing->system += timevalSeconds(&self.ru_stime)
+			- timevalSeconds(&start->self.ru_stime);
+}
+
+/**
+ * @brief Function that writes a number of seconds, as given by a TIMEFORMAT conversion.
+ *
+ * @param output
+ * @param seconds
+ * @param precision Number of decimal places (0 - 3)
+ * @param longFormat Whether minutes are separated (e.g. 1m2.345s)
+ */
+void outputSeconds(struct outputBuffer *output, double seconds, int precision,
+		int longFormat) {
+	if (seconds < 0)
+		seconds = 0;
+	if (longFormat) {
+		long minutes = (long) (seconds / 60);
+		outputFormat(output, "%ldm%.*fs", minutes, precision,
+				seconds - minutes * 60);
+	} else {
+		outputFormat(output, "%.*f", precision, seconds);
+	}
+}
+
+/**
+ * @brief Function that writes the report of a timed pipeline, as given by a TIMEFORMAT string:
+ * %[p][l]R / U / S (real, user and system seconds, p decimal places, l for minutes),
+ * %P (CPU percentage), %M (peak resident set size, KB) and %%.
+ *
+ * @param output
+ * @param format
+ * @param timing
+ */
+void outputTimeFormat(struct outputBuffer *output, const char *format,
+		struct timing *timing) {
+	const char *position;
+	for (position = format; *position != '\0'; position++) {
+		if (*position != '%') {
+			outputCharacter(output, *position);
+			continue;
+		}
+		const char *conversion = position + 1;
+		int precision = 3;
+		int longFormat = 0;
+		if ((*conversion >= '0') && (*conversion <= '9')) {
+			precision = (*conversion - '0' > 3) ? 3 : (*conversion - '0');
+			conversion++;
+		}
+		if (*conversion == 'l') {
+			longFormat = 1;
+			conversion++;
+		}
+		switch (*conversion) {
+		case 'R':
+			outputSeconds(output, timing->real, precision, longFormat);
+			break;
+		case 'U':
+			outputSeconds(output, timing->user, precision, longFormat);
+			break;
+		case 'S':
+			outputSeconds(output, timing->system, precision, longFormat);
+			break;
+		case 'P':
+			outputFormat(output, "%.2f",
+					(timing->real > 0) ?
+							100 * (timing->user + timing->system) / timing->real : 0);
+			break;
+		case 'M':
+			outputFormat(output, "%ld", timing->maxResident);
+			break;
+		case '%':
+			outputCharacter(output, '%');
+			break;
+		default:
+			// Not a conversion: written as given
+			outputCharacter(output, '%');
+			continue;
+		}
+		position = conversion;
+	}
+	outputCharacter(output, '\n');
+}
+
+/**
+ * @brief Function that reports the resources used by a timed pipeline to the standard error.
+ *
+ * @param mode The report format (TIME_DEFAULT: TIMEFORMAT / TIME_POSIX / TIME_JSON)
+ * @param timing
+ */
+void reportTiming(int mode, struct timing *timing) {
+	struct outputBuffer output;
+	initializeOutputBuffer(&output, STDERR_FILENO);
+	if (mode == TIME_JSON) {
+		// A single line, machine-readable
+		outputString(&output, "{\"command\":");
+		outputJSONString(&output, timing->text);
+		outputFormat(&output,
+				",\"real\":%.6f,\"user\":%.6f,\"sys\":%.6f,\"maxrss_kb\":%ld,\"status\":%d}\n",
+				timing->real, timing->user, timing->system, timing->maxResident,
+				timing->status);
+	} else if (mode == TIME_POSIX) {
+		outputTimeFormat(&output, POSIX_TIME_FORMAT, timing);
+	} else {
+		const char *format = getVariable(TIME_FORMAT_VARIABLE);
+		// An empty format reports nothing
+		if ((format != NULL) && (*format == '\0'))
+			return;
+		outputTimeFormat(&output, (format != NULL) ? format : DEFAULT_TIME_FORMAT,
+				timing);
+	}
+	outputFlush(&output);
+}
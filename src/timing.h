@@ -0,0 +1,100 @@
+/*  @file timing.h
+ *  @author Nicolas Poyiadjis
+ *
+ *  @brief Pipeline timing (time keyword) header.
+ *  A timed pipeline reports its wall clock time, from the first process started to the last one reaped,
+ *  and the user / system CPU time and peak resident set size of all its processes (as given by wait4),
+ *  together with the CPU time spent by the shell itself (e.g. in built-in functions).
+ */
+
+#ifndef TIMING_H_
+#define TIMING_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include "output.h"
+#include "variables.h"
+
+// Variable giving the report format (as in bash)
+#define TIME_FORMAT_VARIABLE "TIMEFORMAT"
+#define DEFAULT_TIME_FORMAT "\nreal\t%3lR\nuser\t%3lU\nsys\t%3lS"
+#define POSIX_TIME_FORMAT "real %2R\nuser %2U\nsys %2S"
+
+/**
+ * @brief The start of a timed pipeline.
+ */
+struct timingStart {
+	struct timespec wall;
+	struct rusage self;
+};
+
+/**
+ * @brief The resources used by a timed pipeline.
+ */
+struct timing {
+	// Seconds elapsed, and CPU seconds spent in user / system mode
+	double real;
+	double user;
+	double system;
+	// Resident set size peaks of the processes, summed (KB)
+	long maxResident;
+	// Exit status of the pipeline, and its text
+	int status;
+	const char *text;
+};
+
+/**
+ * @brief Function that returns the seconds elapsed between two (monotonic) times.
+ *
+ * @param start
+ * @param end
+ * @return The seconds elapsed
+ */
+double elapsedSeconds(const struct timespec *start, const struct timespec *end);
+
+/**
+ * @brief Function that converts a time value to seconds.
+ *
+ * @param value
+ * @return The seconds
+ */
+double timevalSeconds(const struct timeval *value);
+
+/**
+ * @brief Function that adds the resources used by a process (or job) to a resource usage total.
+ * CPU times are summed, and so are the resident set size peaks.
+ *
+ * @param total
+ * @param usage
+ */
+void addResourceUsage(struct rusage *total, const struct rusage *usage);
+
+/**
+ * @brief Function that records the start of a timed pipeline.
+ *
+ * @param start
+ */
+void startTiming(struct timingStart *start);
+
+/**
+ * @brief Function that adds the CPU time spent by the shell itself since the start of a timed pipeline.
+ *
+ * @param start
+ * @param timing
+ */
+void addShellTiming(struct timingStart *start, struct timing *timing);
+
+/**
+ * @brief Function that reports the resources used by a timed pipeline to the standard error.
+ *
+ * @param mode The report format (TIME_DEFAULT: TIMEFORMAT / TIME_POSIX / TIME_JSON)
+ * @param timing
+ */
+void reportTiming(int mode, struct timing *timing);
+
+#endif /* TIMING_H_ */
@@ -0,0 +1,164 @@
+/*  @file trace.c
+ *  @author Nicolas Poyiadjis
+ *
+ *  @brief Latency tracing implementation
+ */
+
+#include "trace.h"
+
+// Whether the stages of the commands are traced
+int tracing = 0;
+// The trace events, buffered before being appended to the trace file
+struct outputBuffer traceOutput;
+// Whether the trace file has to be completed at exit
+int traceExitRegistered = 0;
+// Whether the events are written at once (in a forked child process)
+int traceUnbuffered = 0;
+
+/**
+ * @brief Function that returns the current time for the trace spans (nanoseconds, monotonic).
+ *
+ * @return The time
+ */
+uint64_t traceNow() {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/**
+ * @brief Function that writes the fields shared by every trace event.
+ *
+ * @param name The event name
+ * @param phase The event phase (X: complete span / i: instant)
+ * @param start The event time
+ */
+void traceEventStart(const char *name, char phase, uint64_t start) {
+	outputString(&traceOutput, "{\"name\":");
+	outputJSONString(&traceOutput, name);
+	outputFormat(&traceOutput,
+			",\"cat\":\"nicpoyia-sh\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":%d,\"tid\":%d",
+			phase, start / 1000.0, (int) getpid(), (int) getpid());
+}
+
+/**
+ * @brief Function that writes the end of a trace event, with its detail.
+ *
+ * @param detail The event detail / NULL: None
+ */
+void traceEventEnd(const char *detail) {
+	if (detail != NULL) {
+		char cut[TRACE_MAX_DETAIL + 1];
+		strncpy(cut, detail, TRACE_MAX_DETAIL);
+		cut[TRACE_MAX_DETAIL] = '\0';
+		outputString(&traceOutput, ",\"args\":{\"detail\":");
+		outputJSONString(&traceOutput, cut);
+		outputCharacter(&traceOutput, '}');
+	}
+	outputString(&traceOutput, "},\n");
+	// The file is shared with the forked children, so it is only written between whole events
+	// (the buffer never fills in the middle of an event)
+	if (traceUnbuffered || (traceOutput.used > OUTPUT_BUFFER_SIZE / 2))
+		outputFlush(&traceOutput);
+}
+
+/**
+ * @brief Function that records a span, from the given start time to now.
+ *
+ * @param name The span name
+ * @param start The start time (as given by traceNow)
+ * @param detail Detail shown with the span (e.g. the command) / NULL: None
+ */
+void traceSpan(const char *name, uint64_t start, const char *detail) {
+	uint64_t end = traceNow();
+	traceEventStart(name, 'X', start);
+	outputFormat(&traceOutput, ",\"dur\":%.3f", (end - start) / 1000.0);
+	traceEventEnd(detail);
+}
+
+/**
+ * @brief Function that records an instant event (e.g. exec, which never returns).
+ *
+ * @param name The event name
+ * @param detail Detail shown with the event / NULL: None
+ */
+void traceInstant(const char *name, const char *detail) {
+	traceEventStart(name, 'i', traceNow());
+	outputString(&traceOutput, ",\"s\":\"t\"");
+	traceEventEnd(detail);
+}
+
+/**
+ * @brief Function to be called by a forked child process before it records any event.
+ * The events buffered by the shell are dropped, and the events of the child are written at once.
+ */
+void traceChildStarted() {
+	initializeOutputBuffer(&traceOutput, traceOutput.fd);
+	traceUnbuffered = 1;
+}
+
+/**
+ * @brief Function that starts tracing to a file (replacing any trace in progress).
+ *
+ * @param path The trace file path
+ * @return 0: OK / -1: Error
+ */
+int startTracing(const char *path) {
+	stopTracing();
+	// Forked children append their own events to the file
+	int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+	if (fd == -1) {
+		perror(path);
+		return -1;
+	}
+	initializeOutputBuffer(&traceOutput, fd);
+	outputString(&traceOutput, "[\n");
+	outputFlush(&traceOutput);
+	tracing = 1;
+	if (!traceExitRegistered) {
+		atexit(stopTracing);
+		traceExitRegistered = 1;
+	}
+	return 0;
+}
+
+/**
+ * @brief Function that stops tracing, completing the trace file.
+ */
+void stopTracing() {
+	if (!tracing)
+		return;
+	// The last event (naming the shell process) ends the array of events
+	outputFormat(&traceOutput,
+			"{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"nicpoyia-sh\"}}\n]\n",
+			(int) getpid());
+	outputFlush(&traceOutput);
+	close(traceOutput.fd);
+	tracing = 0;
+}
+
+/**
+ * @brief Function that starts tracing if the environment asks for it.
+ */
+void traceInitialization() {
+	const char *path = getVariable(TRACE_VARIABLE);
+	if ((path != NULL) && (*path != '\0'))
+		startTracing(path);
+}
+
+/**
+ * @brief Function to be notified about every variable assignment.
+ * Assigning the trace variable starts tracing to the file given (or stops tracing if empty).
+ *
+ * @param assignment The assignment string (NAME=value)
+ */
+void traceVariableAssigned(const char *assignment) {
+	size_t nameLength = strlen(TRACE_VARIABLE);
+	if ((strncmp(assignment, TRACE_VARIABLE, nameLength) != 0)
+			|| (assignment[nameLength] != '='))
+		return;
+	if (assignment[nameLength + 1] == '\0')
+		stopTracing();
+	else
+		startTracing(assignment + nameLength + 1);
+}
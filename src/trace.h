@@ -0,0 +1,89 @@
+/*  @file trace.h
+ *  @author Nicolas Poyiadjis
+ *
+ *  @brief Latency tracing header.
+ *  When NICPOYIASH_TRACE names a file, the stages of every command (parsing, expansion, command resolution,
+ *  redirections, process launch, exec and wait) are recorded as timestamped spans,
+ *  and written to the file as Chrome trace events (to be loaded in a trace viewer, e.g. Perfetto).
+ *  While tracing is disabled, every trace point costs a single branch.
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+
+#include "output.h"
+#include "variables.h"
+
+// Variable naming the trace file
+#define TRACE_VARIABLE "NICPOYIASH_TRACE"
+// Maximum length of the detail recorded with an event (longer details are cut)
+#define TRACE_MAX_DETAIL 256
+
+// Whether the stages of the commands are traced
+extern int tracing;
+
+/**
+ * @brief Function that returns the current time for the trace spans (nanoseconds, monotonic).
+ *
+ * @return The time
+ */
+uint64_t traceNow();
+
+/**
+ * @brief Function that records a span, from the given start time to now.
+ *
+ * @param name The span name
+ * @param start The start time (as given by traceNow)
+ * @param detail Detail shown with the span (e.g. the command) / NULL: None
+ */
+void traceSpan(const char *name, uint64_t start, const char *detail);
+
+/**
+ * @brief Function that records an instant event (e.g. exec, which never returns).
+ *
+ * @param name The event name
+ * @param detail Detail shown with the event / NULL: None
+ */
+void traceInstant(const char *name, const char *detail);
+
+/**
+ * @brief Function to be called by a forked child process before it records any event.
+ * The events buffered by the shell are dropped, and the events of the child are written at once.
+ */
+void traceChildStarted();
+
+/**
+ * @brief Function that starts tracing to a file (replacing any trace in progress).
+ *
+ * @param path The trace file path
+ * @return 0: OK / -1: Error
+ */
+int startTracing(const char *path);
+
+/**
+ * @brief Function that stops tracing, completing the trace file.
+ */
+void stopTracing();
+
+/**
+ * @brief Function that starts tracing if the environment asks for it.
+ */
+void traceInitialization();
+
+/**
+ * @brief Function to be notified about every variable assignment.
+ * Assigning the trace variable starts tracing to the file given (or stops tracing if empty).
+ *
+ * @param assignment The assignment string (NAME=value)
+ */
+void traceVariableAssigned(const char *assignment);
+
+#endif /* TRACE_H_ */
@@ -0,0 +1,357 @@
+/*  @file variables.c
+ *  @author Nicolas Poyiadjis
+ *
+ *  @brief Shell variable store implementation
+ */
+
+#include "variables.h"
+#include "parse_cache.h"
+
+// The variables of the shell
+struct variableTable variables;
+// The prebuilt environment of the executed commands
+struct environmentCache environmentCache;
+
+/**
+ * @brief Function that finds the slot of a variable, or the free slot it would take.
+ *
+ * @param name The variable name
+ * @param length The name length
+ * @param hash The hash of the name
+ * @return The slot
+ */
+struct variable *findVariableSlot(const char *name, size_t length,
+		unsigned int hash) {
+	size_t mask = variables.capacity - 1;
+	size_t index = hash & mask;
+	while (1) {
+		struct variable *slot = &variables.slots[index];
+		if (slot->name == NULL)
+			return slot;
+		if ((slot->hash == hash) && (slot->nameLength == length)
+				&& (memcmp(slot->name, name, length) == 0))
+			return slot;
+		index = (index + 1) & mask;
+	}
+}
+
+/**
+ * @brief Function that doubles the capacity of the variable table.
+ *
+ * @return 0: OK / -1: Error
+ */
+int growVariables() {
+	struct variable *oldSlots = variables.slots;
+	size_t oldCapacity = variables.capacity;
+	size_t newCapacity =
+			(oldCapacity == 0) ? VARIABLES_INITIAL_CAPACITY : (oldCapacity * 2);
+	struct variable *newSlots = (struct variable*) calloc(newCapacity,
+			sizeof(struct variable));
+	if (newSlots == NULL) {
+		perror("malloc error");
+		return -1;
+	}
+	variables.slots = newSlots;
+	variables.capacity = newCapacity;
+	size_t i;
+	for (i = 0; i < oldCapacity; i++) {
+		if (oldSlots[i].name == NULL)
+			continue;
+		struct variable *slot = findVariableSlot(oldSlots[i].name,
+				oldSlots[i].nameLength, oldSlots[i].hash);
+		(*slot) = oldSlots[i];
+	}
+	free(oldSlots);
+	return 0;
+}
+
+/**
+ * @brief Function that finds a variable, adding it (unset, not exported) if it does not exist.
+ *
+ * @param name The variable name
+ * @param length The name length
+ * @return The variable / NULL: Error
+ */
+struct variable *addVariable(const char *name, size_t length) {
+	if (2 * (variables.count + 1) > variables.capacity)
+		if (growVariables() == -1)
+			return NULL;
+	unsigned int hash = scriptHash(name, length);
+	struct variable *slot = findVariableSlot(name, length, hash);
+	if (slot->name != NULL)
+		return slot;
+	// The name is interned: it is kept as long as the shell runs
+	slot->name = (char*) malloc(length + 1);
+	if (slot->name == NULL) {
+		perror("malloc error");
+		return NULL;
+	}
+	memcpy(slot->name, name, length);
+	slot->name[length] = '\0';
+	slot->nameLength = length;
+	slot->hash = hash;
+	slot->value = NULL;
+	slot->valueLength = 0;
+	slot->valueCapacity = 0;
+	slot->exported = 0;
+	variables.count++;
+	return slot;
+}
+
+/**
+ * @brief Function that finds a variable.
+ *
+ * @param name The variable name
+ * @param length The name length
+ * @return The variable / NULL: Not found
+ */
+struct variable *lookupVariable(const char *name, size_t length) {
+	if (variables.count == 0)
+		return NULL;
+	struct variable *slot = findVariableSlot(name, length,
+			scriptHash(name, length));
+	return (slot->name != NULL) ? slot : NULL;
+}
+
+/**
+ * @brief Function that initializes the variable table with the variables of the environment,
+ * all of them exported.
+ *
+ * @param environment The NULL-terminated environment (NAME=value strings)
+ * @return 0: OK / -1: Error
+ */
+int initializeVariables(char **environment) {
+	memset(&variables, 0, sizeof(variables));
+	if (growVariables() == -1)
+		return -1;
+	char **entry;
+	for (entry = environment; *entry != NULL; entry++) {
+		char *separator = strchr(*entry, '=');
+		if ((separator == NULL) || (separator == *entry))
+			continue;
+		size_t length = separator - *entry;
+		if ((setVariable(*entry, length, separator + 1) == -1)
+				|| (exportVariable(*entry, length, 1) == -1))
+			return -1;
+	}
+	return 0;
+}
+
+/**
+ * @brief Function that gets the value of a variable, given its name text (not NUL-terminated).
+ *
+ * @param name The variable name
+ * @param length The name length
+ * @return The value / NULL: Not set
+ */
+const char *getVariableText(const char *name, size_t length) {
+	struct variable *variable = lookupVariable(name, length);
+	return (variable != NULL) ? variable->value : NULL;
+}
+
+/**
+ * @brief Function that gets the value of a variable.
+ *
+ * @param name The variable name
+ * @return The value / NULL: Not set
+ */
+const char *getVariable(const char *name) {
+	return getVariableText(name, strlen(name));
+}
+
+/**
+ * @brief Function that sets the value of a variable, keeping its export flag
+ * (a new variable is not exported).
+ *
+ * @param name The variable name
+ * @param length The name length
+ * @param value The value (copied)
+ * @return 0: OK / -1: Error
+ */
+int setVariable(const char *name, size_t length, const char *value) {
+	struct variable *variable = addVariable(name, length);
+	if (variable == NULL)
+		return -1;
+	size_t valueLength = strlen(value);
+	// The value is updated in place, unless it does not fit
+	if (valueLength + 1 > variable->valueCapacity) {
+		size_t newCapacity = (variable->valueCapacity == 0) ? 16 : variable->valueCapacity;
+		while (newCapacity < valueLength + 1)
+			newCapacity *= 2;
+		char *newValue = (char*) realloc(variable->value, newCapacity);
+		if (newValue == NULL) {
+			perror("malloc error");
+			return -1;
+		}
+		variable->value = newValue;
+		variable->valueCapacity = newCapacity;
+	}
+	memcpy(variable->value, value, valueLength + 1);
+	variable->valueLength = valueLength;
+	if (variable->exported)
+		variables.exportGeneration++;
+	return 0;
+}
+
+/**
+ * @brief Function that marks a variable as exported (or not), setting it empty if it is not set.
+ *
+ * @param name The variable name
+ * @param length The name length
+ * @param exported Whether the variable is exported
+ * @return 0: OK / -1: Error
+ */
+int exportVariable(const char *name, size_t length, int exported) {
+	struct variable *variable = addVariable(name, length);
+	if (variable == NULL)
+		return -1;
+	if ((variable->value == NULL) && (setVariable(name, length, "") == -1))
+		return -1;
+	if (variable->exported != exported) {
+		variables.exportedCount += exported ? 1 : -1;
+		variables.exportGeneration++;
+	}
+	variable->exported = exported;
+	return 0;
+}
+
+/**
+ * @brief Function that rebuilds the environment from the exported variables.
+ *
+ * @return 0: OK / -1: Error
+ */
+int rebuildEnvironment() {
+	size_t blockSize = 0;
+	size_t i;
+	for (i = 0; i < variables.capacity; i++) {
+		struct variable *variable = &variables.slots[i];
+		if ((variable->name != NULL) && variable->exported)
+			blockSize += variable->nameLength + variable->valueLength + 2;
+	}
+	// Both the vector and the block only grow, so that they are mostly reused
+	if (variables.exportedCount + 1 > environmentCache.vectorCapacity) {
+		size_t newCapacity = (variables.exportedCount + 1) * 2;
+		char **newVector = (char**) realloc(environmentCache.vector,
+				newCapacity * sizeof(char*));
+		if (newVector == NULL) {
+			perror("malloc error");
+			return -1;
+		}
+		environmentCache.vector = newVector;
+		environmentCache.vectorCapacity = newCapacity;
+	}
+	if ((blockSize > environmentCache.blockCapacity)
+			|| (environmentCache.block == NULL)) {
+		size_t newCapacity = blockSize * 2 + 1;
+		char *newBlock = (char*) realloc(environmentCache.block, newCapacity);
+		if (newBlock == NULL) {
+			perror("malloc error");
+			return -1;
+		}
+		environmentCache.block = newBlock;
+		environmentCache.blockCapacity = newCapacity;
+	}
+	char *entry = environmentCache.block;
+	size_t count = 0;
+	for (i = 0; i < variables.capacity; i++) {
+		struct variable *variable = &variables.slots[i];
+		if ((variable->name == NULL) || !variable->exported)
+			continue;
+		environmentCache.vector[count++] = entry;
+		memcpy(entry, variable->name, variable->nameLength);
+		entry += variable->nameLength;
+		*entry++ = '=';
+		memcpy(entry, variable->value, variable->valueLength + 1);
+		entry += variable->valueLength + 1;
+	}
+	environmentCache.vector[count] = NULL;
+	environmentCache.generation = variables.exportGeneration;
+	environmentCache.built = 1;
+	environmentCache.rebuilds++;
+	return 0;
+}
+
+/**
+ * @brief Function that gets the environment of an executed command: every exported variable.
+ * The environment is rebuilt only if an exported variable has changed since it was last built.
+ * It stays valid until the next call.
+ *
+ * @return The NULL-terminated environment (NAME=value strings) / NULL: Error
+ */
+char **exportedEnvironment() {
+	if ((!environmentCache.built)
+			|| (environmentCache.generation != variables.exportGeneration))
+		if (rebuildEnvironment() == -1)
+			return NULL;
+	environmentCache.uses++;
+	return environmentCache.vector;
+}
+
+/**
+ * @brief Function that prints the statistics of the environment cache.
+ */
+void printEnvironmentStatistics() {
+	printf("environment: %zu/%zu variables exported, %lu launches, %lu rebuilds\n",
+			variables.exportedCount, variables.count, environmentCache.uses,
+			environmentCache.rebuilds);
+}
+
+/**
+ * @brief Function that compares two variables by name (for sorting).
+ */
+int compareVariableNames(const void *first, const void *second) {
+	return strcmp((*(struct variable**) first)->name,
+			(*(struct variable**) second)->name);
+}
+
+/**
+ * @brief Function that writes the variables, sorted by name, to an output buffer.
+ *
+ * @param output The output buffer
+ * @param exportedOnly Whether only the exported variables are written
+ * @param prefix The text written before every variable (e.g. "declare -x ")
+ * @param quoted Whether the values are written in double quotes
+ * @return 0: OK / -1: Error
+ */
+int outputVariables(struct outputBuffer *output, int exportedOnly,
+		const char *prefix, int quoted) {
+	struct variable **sorted = (struct variable**) malloc(
+			(variables.count + 1) * sizeof(struct variable*));
+	if (sorted == NULL) {
+		perror("malloc error");
+		return -1;
+	}
+	size_t count = 0;
+	size_t i;
+	for (i = 0; i < variables.capacity; i++) {
+		struct variable *variable = &variables.slots[i];
+		if ((variable->name == NULL) || (variable->value == NULL)
+				|| (exportedOnly && !variable->exported))
+			continue;
+		sorted[count++] = variable;
+	}
+	qsort(sorted, count, sizeof(struct variable*), compareVariableNames);
+	for (i = 0; i < count; i++) {
+		outputString(output, prefix);
+		outputWrite(output, sorted[i]->name, sorted[i]->nameLength);
+		outputCharacter(output, '=');
+		if (quoted) {
+			// Within double quotes, the special characters are escaped
+			const char *character;
+			outputCharacter(output, '"');
+			for (character = sorted[i]->value; *character != '\0'; character++) {
+				if (strchr("\"\\$`", *character) != NULL)
+					outputCharacter(output, '\\');
+				outputCharacter(output, *character);
+			}
+			outputCharacter(output, '"');
+		} else {
+			outputWrite(output, sorted[i]->value, sorted[i]->valueLength);
+		}
+		outputCharacter(output, '\n');
+	}
+	// The values are referenced in place, until written
+	outputFlush(output);
+	free(sorted);
+	return 0;
+}
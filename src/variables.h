@@ -0,0 +1,144 @@
+/*  @file variables.h
+ *  @author Nicolas Poyiadjis
+ *
+ *  @brief Shell variable store header.
+ *  Shell variables are kept in an open-addressing hash table of their own (linear probing),
+ *  separate from the process environment. Every variable has an export flag:
+ *  only exported variables are handed to the executed commands.
+ *  Variable names are interned (allocated once, when the variable is first set),
+ *  and values are updated in place whenever they fit.
+ *  The environment of the executed commands is kept prebuilt (a contiguous vector and string block),
+ *  and rebuilt only when an exported variable has changed since.
+ */
+
+#ifndef VARIABLES_H_
+#define VARIABLES_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "output.h"
+
+#define VARIABLES_INITIAL_CAPACITY 128
+
+/**
+ * @brief A shell variable (a free slot has no name).
+ */
+struct variable {
+	char *name;
+	size_t nameLength;
+	unsigned int hash;
+	char *value;
+	size_t valueLength;
+	size_t valueCapacity;
+	// Whether the variable is handed to the executed commands
+	int exported;
+};
+
+/**
+ * @brief The variable table. The capacity is a power of two, kept at least twice the count.
+ */
+struct variableTable {
+	struct variable *slots;
+	size_t capacity;
+	size_t count;
+	size_t exportedCount;
+	// Incremented whenever an exported variable changes (value or export flag)
+	unsigned long exportGeneration;
+};
+
+/**
+ * @brief The prebuilt environment of the executed commands.
+ */
+struct environmentCache {
+	// NULL-terminated vector, pointing within the string block
+	char **vector;
+	size_t vectorCapacity;
+	// NAME=value strings, one after the other
+	char *block;
+	size_t blockCapacity;
+	// Export generation the environment was built for
+	unsigned long generation;
+	int built;
+	unsigned long rebuilds;
+	unsigned long uses;
+};
+
+extern struct variableTable variables;
+
+/**
+ * @brief Function that initializes the variable table with the variables of the environment,
+ * all of them exported.
+ *
+ * @param environment The NULL-terminated environment (NAME=value strings)
+ * @return 0: OK / -1: Error
+ */
+int initializeVariables(char **environment);
+
+/**
+ * @brief Function that gets the value of a variable, given its name text (not NUL-terminated).
+ *
+ * @param name The variable name
+ * @param length The name length
+ * @return The value / NULL: Not set
+ */
+const char *getVariableText(const char *name, size_t length);
+
+/**
+ * @brief Function that gets the value of a variable.
+ *
+ * @param name The variable name
+ * @return The value / NULL: Not set
+ */
+const char *getVariable(const char *name);
+
+/**
+ * @brief Function that sets the value of a variable, keeping its export flag
+ * (a new variable is not exported).
+ *
+ * @param name The variable name
+ * @param length The name length
+ * @param value The value (copied)
+ * @return 0: OK / -1: Error
+ */
+int setVariable(const char *name, size_t length, const char *value);
+
+/**
+ * @brief Function that marks a variable as exported (or not), setting it empty if it is not set.
+ *
+ * @param name The variable name
+ * @param length The name length
+ * @param exported Whether the variable is exported
+ * @return 0: OK / -1: Error
+ */
+int exportVariable(const char *name, size_t length, int exported);
+
+/**
+ * @brief Function that gets the environment of an executed command: every exported variable.
+ * The environment is rebuilt only if an exported variable has changed since it was last built.
+ * It stays valid until the next call.
+ *
+ * @return The NULL-terminated environment (NAME=value strings) / NULL: Error
+ */
+char **exportedEnvironment();
+
+/**
+ * @brief Function that prints the statistics of the environment cache.
+ */
+void printEnvironmentStatistics();
+
+/**
+ * @brief Function that writes the variables, sorted by name, to an output buffer.
+ *
+ * @param output The output buffer
+ * @param exportedOnly Whether only the exported variables are written
+ * @param prefix The text written before every variable (e.g. "declare -x ")
+ * @param quoted Whether the values are written in double quotes
+ * @return 0: OK / -1: Error
+ */
+int outputVariables(struct outputBuffer *output, int exportedOnly,
+		const char *prefix, int quoted);
+
+#endif /* VARIABLES_H_ */